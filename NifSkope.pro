@@ -35,6 +35,8 @@ CONFIG(debug, debug|release) {
 # TODO: Get rid of this define
 #	uncomment this if you want the text stats gl option
 #	DEFINES += USE_GL_QPAINTER
+#	uncomment this to compile out the trace zones
+#	DEFINES += NIFSKOPE_NO_TRACE
 
 #TRANSLATIONS += \
 #	res/lang/NifSkope_de.ts \
@@ -149,6 +151,7 @@ HEADERS += \
 	src/gl/BSMesh.h \
 	src/gl/bsshape.h \
 	src/gl/controllers.h \
+	src/gl/framestats.h \
 	src/gl/glcontroller.h \
 	src/gl/glmarker.h \
 	src/gl/glmesh.h \
@@ -162,20 +165,27 @@ HEADERS += \
 	src/gl/gltools.h \
 	src/gl/icontrollable.h \
 	src/gl/renderer.h \
+	src/gl/thumbnailer.h \
 	src/io/material.h \
 	src/io/MeshFile.h \
+	src/io/nifdigest.h \
 	src/io/nifstream.h \
 	src/lib/importex/3ds.h \
+	src/lib/meshsimplify.h \
 	src/lib/nvtristripwrapper.h \
 	src/lib/qhull.h \
+	src/lib/vertexcache.h \
 	src/model/basemodel.h \
 	src/model/kfmmodel.h \
+	src/model/nifdiff.h \
+	src/model/nifloadthread.h \
 	src/model/nifmodel.h \
 	src/model/nifproxymodel.h \
 	src/model/undocommands.h \
 	src/spells/blocks.h \
 	src/spells/mesh.h \
 	src/spells/misc.h \
+	src/spells/optimizecache.h \
 	src/spells/sanitize.h \
 	src/spells/skeleton.h \
 	src/spells/stringpalette.h \
@@ -191,6 +201,7 @@ HEADERS += \
 	src/ui/widgets/inspect.h \
 	src/ui/widgets/lightingwidget.h \
 	src/ui/widgets/nifcheckboxlist.h \
+	src/ui/widgets/nifdiffview.h \
 	src/ui/widgets/nifeditors.h \
 	src/ui/widgets/nifview.h \
 	src/ui/widgets/refrbrowser.h \
@@ -207,8 +218,10 @@ HEADERS += \
 	src/gamemanager.h \
 	src/glview.h \
 	src/message.h \
+	src/nifbench.h \
 	src/nifskope.h \
 	src/spellbook.h \
+	src/trace.h \
 	src/version.h \
 	lib/dds.h \
 	lib/dxgiformat.h \
@@ -225,6 +238,7 @@ SOURCES += \
 	src/gl/BSMesh.cpp \
 	src/gl/bsshape.cpp \
 	src/gl/controllers.cpp \
+	src/gl/framestats.cpp \
 	src/gl/glcontroller.cpp \
 	src/gl/glmarker.cpp \
 	src/gl/glmesh.cpp \
@@ -237,19 +251,25 @@ SOURCES += \
 	src/gl/gltexloaders.cpp \
 	src/gl/gltools.cpp \
 	src/gl/renderer.cpp \
+	src/gl/thumbnailer.cpp \
 	src/io/materialfile.cpp \
 	src/io/MeshFile.cpp \
+	src/io/nifdigest.cpp \
 	src/io/nifstream.cpp \
 	src/lib/importex/3ds.cpp \
 	src/lib/importex/importex.cpp \
 	src/lib/importex/obj.cpp \
 	src/lib/importex/col.cpp \
 	src/lib/importex/gltf.cpp \
+	src/lib/meshsimplify.cpp \
 	src/lib/nvtristripwrapper.cpp \
 	src/lib/qhull.cpp \
+	src/lib/vertexcache.cpp \
 	src/model/basemodel.cpp \
 	src/model/kfmmodel.cpp \
 	src/model/nifdelegate.cpp \
+	src/model/nifdiff.cpp \
+	src/model/nifloadthread.cpp \
 	src/model/nifmodel.cpp \
 	src/model/nifextfiles.cpp \
 	src/model/nifproxymodel.cpp \
@@ -274,8 +294,10 @@ SOURCES += \
 	src/spells/morphctrl.cpp \
 	src/spells/normals.cpp \
 	src/spells/optimize.cpp \
+	src/spells/optimizecache.cpp \
 	src/spells/sanitize.cpp \
 	src/spells/sfmatexport.cpp \
+	src/spells/simplify.cpp \
 	src/spells/skeleton.cpp \
 	src/spells/stringpalette.cpp \
 	src/spells/strippify.cpp \
@@ -291,6 +313,7 @@ SOURCES += \
 	src/ui/widgets/inspect.cpp \
 	src/ui/widgets/lightingwidget.cpp \
 	src/ui/widgets/nifcheckboxlist.cpp \
+	src/ui/widgets/nifdiffview.cpp \
 	src/ui/widgets/nifeditors.cpp \
 	src/ui/widgets/nifview.cpp \
 	src/ui/widgets/refrbrowser.cpp \
@@ -309,9 +332,11 @@ SOURCES += \
 	src/glview.cpp \
 	src/main.cpp \
 	src/message.cpp \
+	src/nifbench.cpp \
 	src/nifskope.cpp \
 	src/nifskope_ui.cpp \
 	src/spellbook.cpp \
+	src/trace.cpp \
 	src/version.cpp \
 	lib/half.cpp
 
@@ -156,11 +156,35 @@ doxygen.commands += doxygen $${doxyfile} $$nt
 doxygen.CONFIG += recursive
 
 
+###############################
+## nifbench
+###############################
+# Times loading, saving, scene setup and spells on generated NIF files
+#
+# Requirements:
+#    A built NifSkope, OpenGL for the scene stages (xvfb-run without a display)
+#
+# Usage:
+#    jom release-nifbench
+#    jom release-nifbench NIFBENCH_ARGS="-baseline old.json"
+#
+# Writes nifbench.json next to the executable. Any of the -bench options of
+# NifSkope -no-gui -help can be passed in NIFBENCH_ARGS.
+#______________________________
+
+nifbench.target = nifbench
+
+nifbench.commands += $$syspath($${DESTDIR}/$${TARGET}$${EXE}) -no-gui
+nifbench.commands += -bench $$syspath($${DESTDIR}/nifbench.json) $(NIFBENCH_ARGS) $$nt
+
+nifbench.CONFIG += recursive
+
+
 ###############################
 ## ADD TARGETS
 ###############################
 
-QMAKE_EXTRA_TARGETS += docs doxygen
+QMAKE_EXTRA_TARGETS += docs doxygen nifbench
 
 
 
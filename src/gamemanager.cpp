@@ -1,31 +1,265 @@
 #include "gamemanager.h"
 
 #include "message.h"
+#include "trace.h"
 #include "bsrefl.hpp"
 
 #include <QSettings>
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QProgressDialog>
+#include <QReadWriteLock>
 #include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
 #include <QMessageBox>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <unordered_map>
 
 namespace Game
 {
 
 static CE2MaterialDB	starfield_materials;
-static std::uintptr_t	starfield_materials_id = 1;
-static bool	have_materials_cdb = false;
+static std::atomic< std::uintptr_t >	starfield_materials_id = 1;
+static std::atomic< bool >	have_materials_cdb = false;
 static bool	have_temp_materials = false;
+static std::atomic< std::uintptr_t >	archives_id = 1;
+// background loader of the Starfield material database, started by GameManager::preload_materials()
+static QThread *	materials_loader = nullptr;
+static QMutex	materials_loader_mutex;
+// set if the background loader failed, preload_materials() does not retry until close_materials()
+static std::atomic< bool >	materials_load_failed = false;
+
+//! On-disk index of the files available in the archive folders of a game
+/*!
+ * Opening all the archives of a game is slow, but most queries (existence checks, file sizes and
+ * file lists) only need the directory of the archives. The index stores that directory together
+ * with the path, size and modification time of every archive it was built from, and a hash of
+ * the paths, sizes and modification times of the loose files in the folders and their subfolders.
+ * It is mapped and validated on first use, so the archives themselves are only opened for extraction.
+ *
+ * Layout: magic, version, signature length and bytes, file count, then for each file its
+ * unpacked size (64-bit), name length (16-bit) and the null-terminated name.
+ */
+struct ArchiveIndex {
+	static constexpr quint32	magic = 0x4941534E;	// "NSAI"
+	static constexpr quint32	version = 2;
+
+	QFile	file;
+	std::unordered_map< std::string_view, qint64 >	files;
+	bool	checked = false;
+	bool	valid = false;
+	//! Signature computed by load(), reused by save() when the archives are opened for the same folders
+	QByteArray	loadedSignature;
+	QStringList	loadedFolders;
+
+	static QString fileName( GameMode game );
+	static QByteArray signature( const QStringList & folders );
+	bool load( GameMode game, const QStringList & folders );
+	void save( GameMode game, const QStringList & folders, const BA2File & ba2File );
+	void clear();
+};
+
+QString ArchiveIndex::fileName( GameMode game )
+{
+	return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + QString( "/archives_%1.idx" ).arg( int(game) );
+}
+
+static void appendSource( QByteArray & s, const QFileInfo & f )
+{
+	QByteArray	path = f.absoluteFilePath().toUtf8();
+	qint64	tmp[3] = { qint64(path.size()), f.size(), f.lastModified().toMSecsSinceEpoch() };
+	s.append( reinterpret_cast< const char * >( tmp ), qsizetype( sizeof( tmp ) ) );
+	s.append( path );
+}
+
+QByteArray ArchiveIndex::signature( const QStringList & folders )
+{
+	// Archives are only loaded directly under the folders and are listed one by one, loose files
+	// are loaded from all subfolders and are summarized in a hash to keep the signature short
+	static const QStringList	archiveFilters = { "*.bsa", "*.ba2" };
+	QByteArray	s;
+	for ( const auto & folder : folders ) {
+		if ( folder.isEmpty() )
+			continue;
+		QFileInfo	f( folder );
+		appendSource( s, f );
+		if ( !f.isDir() )
+			continue;
+		QDir	dir( folder );
+		for ( const auto & i : dir.entryInfoList( archiveFilters, QDir::Files, QDir::Name | QDir::IgnoreCase ) )
+			appendSource( s, i );
+
+		QByteArrayList	looseFiles;
+		QDirIterator	it( folder, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories );
+		while ( it.hasNext() ) {
+			it.next();
+			QFileInfo	i = it.fileInfo();
+			if ( i.dir() == dir && archiveFilters.contains( "*." + i.suffix().toLower() ) )
+				continue;
+			QByteArray	entry;
+			appendSource( entry, i );
+			looseFiles.append( entry );
+		}
+		// The iteration order depends on the file system
+		std::sort( looseFiles.begin(), looseFiles.end() );
+
+		QCryptographicHash	hash( QCryptographicHash::Sha1 );
+		for ( const auto & entry : looseFiles )
+			hash.addData( entry );
+		qint64	count = looseFiles.size();
+		s.append( reinterpret_cast< const char * >( &count ), qsizetype( sizeof( count ) ) );
+		s.append( hash.result() );
+	}
+	return s;
+}
+
+void ArchiveIndex::clear()
+{
+	files.clear();
+	if ( file.isOpen() )
+		file.close();
+	checked = false;
+	valid = false;
+	loadedSignature.clear();
+	loadedFolders.clear();
+}
+
+bool ArchiveIndex::load( GameMode game, const QStringList & folders )
+{
+	if ( checked )
+		return valid;
+	clear();
+	checked = true;
+
+	file.setFileName( fileName( game ) );
+	if ( !file.open( QIODevice::ReadOnly ) )
+		return false;
+	qint64	size = file.size();
+	const uchar *	p = file.map( 0, size );
+	if ( !p || size < 16 || qFromLittleEndian< quint32 >( p ) != magic || qFromLittleEndian< quint32 >( p + 4 ) != version ) {
+		file.close();
+		return false;
+	}
+
+	const uchar *	end = p + size;
+	quint32	sigLen = qFromLittleEndian< quint32 >( p + 8 );
+	p = p + 12;
+	QByteArray	sig = signature( folders );
+	loadedSignature = sig;
+	loadedFolders = folders;
+	if ( qint64( end - p ) < qint64( sigLen ) + 4 || sig.size() != qsizetype( sigLen ) || std::memcmp( p, sig.constData(), sigLen ) != 0 ) {
+		file.close();
+		return false;
+	}
+	p = p + sigLen;
+
+	quint32	n = qFromLittleEndian< quint32 >( p );
+	p = p + 4;
+	files.reserve( n );
+	for ( ; n > 0; n-- ) {
+		if ( end - p < 10 )
+			break;
+		qint64	fileSize = qFromLittleEndian< qint64 >( p );
+		size_t	len = qFromLittleEndian< quint16 >( p + 8 );
+		p = p + 10;
+		if ( size_t( end - p ) <= len || p[len] != 0 )
+			break;
+		files.emplace( std::string_view( reinterpret_cast< const char * >( p ), len ), fileSize );
+		p = p + ( len + 1 );
+	}
+	if ( n ) {
+		qWarning() << "Archive index" << file.fileName() << "is truncated";
+		clear();
+		checked = true;
+		return false;
+	}
 
+	valid = true;
+	return true;
+}
+
+struct archive_index_scan_function_data {
+	QByteArray * buf;
+	quint32 count;
+};
+
+static bool archiveIndexScanFunction( void * p, const BA2File::FileInfo & fd )
+{
+	archive_index_scan_function_data & o = *( reinterpret_cast< archive_index_scan_function_data * >( p ) );
+	if ( fd.fileName.length() > 0xFFFF ) [[unlikely]]
+		return false;
+	uchar	tmp[10];
+	qToLittleEndian< qint64 >( qint64(fd.unpackedSize), tmp );
+	qToLittleEndian< quint16 >( quint16(fd.fileName.length()), tmp + 8 );
+	o.buf->append( reinterpret_cast< const char * >( tmp ), 10 );
+	o.buf->append( fd.fileName.data(), qsizetype(fd.fileName.length()) );
+	o.buf->append( '\0' );
+	o.count++;
+	return false;
+}
+
+void ArchiveIndex::save( GameMode game, const QStringList & folders, const BA2File & ba2File )
+{
+	// A valid index mapped by an earlier query already describes these archives
+	if ( checked && valid )
+		return;
+	// Walking the loose files again is as slow as the validation that found the index stale
+	QByteArray	sig = ( !loadedSignature.isEmpty() && loadedFolders == folders ? loadedSignature : signature( folders ) );
+	clear();
+
+	QByteArray	buf;
+	uchar	tmp[12];
+	qToLittleEndian< quint32 >( magic, tmp );
+	qToLittleEndian< quint32 >( version, tmp + 4 );
+	qToLittleEndian< quint32 >( quint32(sig.size()), tmp + 8 );
+	buf.append( reinterpret_cast< const char * >( tmp ), 12 );
+	buf.append( sig );
+	qsizetype	countPos = buf.size();
+	buf.append( 4, '\0' );
+
+	archive_index_scan_function_data	data { &buf, 0 };
+	ba2File.scanFileList( &archiveIndexScanFunction, &data );
+	qToLittleEndian< quint32 >( data.count, buf.data() + countPos );
+
+	QString	path = fileName( game );
+	QDir().mkpath( QFileInfo( path ).absolutePath() );
+	QSaveFile	f( path );
+	if ( !( f.open( QIODevice::WriteOnly ) && f.write( buf ) == buf.size() && f.commit() ) )
+		qWarning() << "Could not write archive index" << path;
+}
+
+//! The resource archives of each game, the methods may be called from any thread
 struct BA2Files {
 	std::vector< std::pair< BA2File*, BA2File* > >	archives;
+	ArchiveIndex	indexes[NUM_GAMES];
+	//! The folder or archive set with set_temp_folder()
+	QString	tempPaths[NUM_GAMES];
+	//! Modification time of each temporary path when it was opened
+	QDateTime	tempStamps[NUM_GAMES];
+	//! Guards the archives and indexes, recursive because opening a game may be triggered by a lookup
+	QRecursiveMutex	mutex;
+	//! Held for reading while a file is extracted without mutex, and for writing to delete an archive
+	QReadWriteLock	extractLock;
 	BA2Files();
 	~BA2Files();
+	void delete_archive(BA2File*& ba2File);
 	void open_folders(GameMode game, const QStringList& folders);
 	void close_all(bool tempPathsFirst = false);
 	bool set_temp_folder(GameMode game, const char* pathName, bool ignoreErrors);
+	bool open_game(GameMode game);
+	const ArchiveIndex* get_index(GameMode game);
 	static unsigned char* byteArrayAllocFunc(void* bufPtr, size_t nBytes);
 	bool get_file(GameMode game, const std::string_view& pathName, QByteArray* outBuf = nullptr);
+	qint64 file_size(GameMode game, const std::string_view& pathName);
 };
 
 BA2Files::BA2Files()
@@ -38,6 +272,13 @@ BA2Files::~BA2Files()
 	close_all();
 }
 
+void BA2Files::delete_archive(BA2File*& ba2File)
+{
+	QWriteLocker	locker(&extractLock);
+	delete ba2File;
+	ba2File = nullptr;
+}
+
 static bool archiveFilterFunction_1( [[maybe_unused]] void * p, const std::string_view & s )
 {
 	return !( s.ends_with( ".mp3" ) || s.ends_with( ".ogg" ) || s.ends_with( ".wav" ) );
@@ -72,11 +313,12 @@ void BA2Files::open_folders(GameMode game, const QStringList& folders)
 {
 	if (!(game >= OTHER && game < NUM_GAMES))
 		return;
+	QMutexLocker	locker(&mutex);
 	if (game == STARFIELD)
 		GameManager::close_materials();
 	if (archives[game].first) {
-		delete archives[game].first;
-		archives[game].first = nullptr;
+		archives_id++;
+		delete_archive(archives[game].first);
 	}
 	std::vector< std::string >	tmp;
 	for (const auto& s : folders) {
@@ -96,28 +338,32 @@ void BA2Files::open_folders(GameMode game, const QStringList& folders)
 		}
 	}
 	if (!archivesLoaded) {
-		delete archives[game].first;
-		archives[game].first = nullptr;
+		delete_archive(archives[game].first);
+		return;
 	}
+	indexes[game].save(game, folders, *(archives[game].first));
 }
 
 void BA2Files::close_all(bool tempPathsFirst)
 {
+	QMutexLocker	locker(&mutex);
+	archives_id++;
 	for (std::vector< std::pair< BA2File*, BA2File* > >::iterator i = archives.begin(); i != archives.end(); i++) {
 		if (i->second) {
 			if (i == (archives.begin() + STARFIELD) && have_temp_materials)
 				GameManager::close_materials();
-			delete i->second;
-			i->second = nullptr;
+			delete_archive(i->second);
+			tempPaths[i - archives.begin()].clear();
+			tempStamps[i - archives.begin()] = QDateTime();
 			if (tempPathsFirst)
 				continue;
 		}
 		if (i->first) {
 			if (i == (archives.begin() + STARFIELD))
 				GameManager::close_materials();
-			delete i->first;
+			delete_archive(i->first);
 		}
-		i->first = nullptr;
+		indexes[i - archives.begin()].clear();
 	}
 }
 
@@ -125,11 +371,21 @@ bool BA2Files::set_temp_folder(GameMode game, const char* pathName, bool ignoreE
 {
 	if (!(game >= OTHER && game < NUM_GAMES))
 		return false;
+	QMutexLocker	locker(&mutex);
+	// Loading a NIF sets the folder of every file, only reopen it if it is a different one or has changed
+	QString	path = QString::fromUtf8(pathName ? pathName : "");
+	QDateTime	stamp;
+	if (!path.isEmpty())
+		stamp = QFileInfo(path).lastModified();
+	if (path == tempPaths[game] && archives[game].second && stamp == tempStamps[game])
+		return true;
+	tempPaths[game].clear();
+	tempStamps[game] = QDateTime();
 	if (archives[game].second) {
+		archives_id++;
 		if (game == STARFIELD && have_temp_materials)
 			GameManager::close_materials();
-		delete archives[game].second;
-		archives[game].second = nullptr;
+		delete_archive(archives[game].second);
 	}
 	if (!(pathName && *pathName))
 		return true;
@@ -141,12 +397,14 @@ bool BA2Files::set_temp_folder(GameMode game, const char* pathName, bool ignoreE
 			have_temp_materials = true;
 		}
 	} catch (FO76UtilsError& e) {
-		delete archives[game].second;
-		archives[game].second = nullptr;
+		delete_archive(archives[game].second);
 		if (!ignoreErrors)
 			QMessageBox::critical(nullptr, "NifSkope error", QString("Error opening archive path '%1': %2").arg(pathName).arg(e.what()));
 		return false;
 	}
+	tempPaths[game] = path;
+	tempStamps[game] = stamp;
+	archives_id++;
 	return true;
 }
 
@@ -163,29 +421,32 @@ bool BA2Files::get_file(GameMode game, const std::string_view& pathName, QByteAr
 		outBuf->resize(0);
 	if (!(game >= OTHER && game < NUM_GAMES && !pathName.empty())) [[unlikely]]
 		return false;
-	const BA2File::FileInfo*	fd;
-	if (archives[game].second && (fd = archives[game].second->findFile(pathName)) != nullptr) {
-		if (outBuf)
-			archives[game].second->extractFile(outBuf, &byteArrayAllocFunc, *fd);
-		return true;
-	}
-	if (!archives[game].first) { [[unlikely]]
-		try {
-			open_folders(game, GameManager::folders(game));
-		}
-		catch (...)
-		{
-		}
-		if (!archives[game].first) {
-			qWarning() << "Archive(s) not loaded for game " << STRING[game];
-			return false;
+	QMutexLocker	locker(&mutex);
+	BA2File*	ba2File = archives[game].second;
+	const BA2File::FileInfo*	fd = nullptr;
+	if (ba2File)
+		fd = ba2File->findFile(pathName);
+	if (!fd) {
+		if (!archives[game].first) { [[unlikely]]
+			if (!outBuf) {
+				if (const ArchiveIndex* index = get_index(game); index)
+					return index->files.find(pathName) != index->files.end();
+			}
+			if (!open_game(game)) {
+				qWarning() << "Archive(s) not loaded for game " << STRING[game];
+				return false;
+			}
 		}
+		ba2File = archives[game].first;
+		fd = ba2File->findFile(pathName);
 	}
-	fd = archives[game].first->findFile(pathName);
 	if (!outBuf || !fd)
 		return bool(fd);
+	// Decompress without blocking the other lookups, the archive cannot be deleted meanwhile
+	QReadLocker	extractLocker(&extractLock);
+	locker.unlock();
 	try {
-		archives[game].first->extractFile(outBuf, &byteArrayAllocFunc, *fd);
+		ba2File->extractFile(outBuf, &byteArrayAllocFunc, *fd);
 	} catch (FO76UtilsError&) {
 		outBuf->clear();
 		return false;
@@ -193,6 +454,53 @@ bool BA2Files::get_file(GameMode game, const std::string_view& pathName, QByteAr
 	return true;
 }
 
+qint64 BA2Files::file_size(GameMode game, const std::string_view& pathName)
+{
+	if (!(game >= OTHER && game < NUM_GAMES && !pathName.empty())) [[unlikely]]
+		return -1;
+	QMutexLocker	locker(&mutex);
+	for (BA2File* ba2File : { archives[game].second, archives[game].first }) {
+		const BA2File::FileInfo*	fd;
+		if (ba2File && (fd = ba2File->findFile(pathName)) != nullptr)
+			return qint64(fd->unpackedSize);
+	}
+	if (!archives[game].first) {
+		if (const ArchiveIndex* index = get_index(game); index) {
+			auto	i = index->files.find(pathName);
+			if (i != index->files.end())
+				return i->second;
+		}
+	}
+	return -1;
+}
+
+bool BA2Files::open_game(GameMode game)
+{
+	if (!(game >= OTHER && game < NUM_GAMES)) [[unlikely]]
+		return false;
+	QMutexLocker	locker(&mutex);
+	if (!archives[game].first) {
+		try {
+			open_folders(game, GameManager::folders(game));
+		}
+		catch (...)
+		{
+		}
+	}
+	return bool(archives[game].first);
+}
+
+const ArchiveIndex* BA2Files::get_index(GameMode game)
+{
+	if (!(game >= OTHER && game < NUM_GAMES)) [[unlikely]]
+		return nullptr;
+	QStringList	folders = GameManager::folders(game);
+	QMutexLocker	locker(&mutex);
+	if (folders.isEmpty() || !indexes[game].load(game, folders))
+		return nullptr;
+	return &(indexes[game]);
+}
+
 static BA2Files	ba2Files;
 
 static const auto GAME_PATHS = QString("Game Paths");
@@ -468,6 +776,7 @@ QString GameManager::find_file(const GameMode game, const QString& path, const c
 
 bool GameManager::get_file(QByteArray& data, const GameMode game, const std::string_view& fullPath)
 {
+	TRACE_ZONE( "GameManager::get_file", fullPath );
 	if (!ba2Files.get_file(game, fullPath, &data)) {
 		qWarning() << "File '" << QString::fromUtf8(fullPath.data(), qsizetype(fullPath.length())) << "' not found in archives";
 		return false;
@@ -477,6 +786,7 @@ bool GameManager::get_file(QByteArray& data, const GameMode game, const std::str
 
 bool GameManager::get_file(QByteArray& data, const GameMode game, const QString& path, const char* archiveFolder, const char* extension)
 {
+	TRACE_ZONE( "GameManager::get_file", path );
 	std::string	fullPath(get_full_path(path, archiveFolder, extension));
 	if (!ba2Files.get_file(game, fullPath, &data)) {
 		qWarning() << "File '" << fullPath.c_str() << "' not found in archives";
@@ -485,12 +795,52 @@ bool GameManager::get_file(QByteArray& data, const GameMode game, const QString&
 	return true;
 }
 
+qint64 GameManager::file_size(const GameMode game, const std::string_view& fullPath)
+{
+	return ba2Files.file_size(game, fullPath);
+}
+
+QByteArray GameManager::loose_file_stamp(const GameMode game, const std::string_view& fullPath)
+{
+	if ( !(game >= OTHER && game < NUM_GAMES && !fullPath.empty()) )
+		return {};
+	QStringList	paths = folders( game );
+	{
+		QMutexLocker	locker( &ba2Files.mutex );
+		if ( !ba2Files.tempPaths[game].isEmpty() )
+			paths.prepend( ba2Files.tempPaths[game] );
+	}
+	QString	relPath = QString::fromUtf8( fullPath.data(), qsizetype( fullPath.length() ) );
+	QByteArray	stamp;
+	for ( const auto & p : paths ) {
+		if ( p.isEmpty() )
+			continue;
+		QFileInfo	f( p + '/' + relPath );
+		if ( !f.isFile() )
+			continue;
+		qint64	tmp[2] = { f.size(), f.lastModified().toMSecsSinceEpoch() };
+		stamp.append( reinterpret_cast< const char * >( tmp ), qsizetype( sizeof( tmp ) ) );
+	}
+	return stamp;
+}
+
+static void wait_materials_loader()
+{
+	QMutexLocker	locker( &materials_loader_mutex );
+	if ( materials_loader ) {
+		materials_loader->wait();
+		delete materials_loader;
+		materials_loader = nullptr;
+	}
+}
+
 CE2MaterialDB* GameManager::materials(const GameMode game)
 {
 	if ( game == STARFIELD ) {
+		wait_materials_loader();
+		QMutexLocker	locker( &ba2Files.mutex );
 		if ( !have_materials_cdb ) {
-			(void) ba2Files.get_file( STARFIELD, std::string(".") );
-			if ( ba2Files.archives[STARFIELD].first ) {
+			if ( ba2Files.open_game( STARFIELD ) ) {
 				starfield_materials_id++;
 				starfield_materials.loadArchives( *(ba2Files.archives[STARFIELD].first), ( have_temp_materials ? ba2Files.archives[STARFIELD].second : nullptr ) );
 				have_materials_cdb = true;
@@ -501,18 +851,89 @@ CE2MaterialDB* GameManager::materials(const GameMode game)
 	return nullptr;
 }
 
+CE2MaterialDB* GameManager::loaded_materials(const GameMode game)
+{
+	if ( game == STARFIELD && have_materials_cdb.load( std::memory_order_acquire ) )
+		return &starfield_materials;
+	return nullptr;
+}
+
+bool GameManager::preload_materials(const GameMode game, QObject* context, std::function< void() > onLoaded)
+{
+	if ( game != STARFIELD )
+		return false;
+	if ( have_materials_cdb )
+		return true;
+	if ( materials_load_failed.load( std::memory_order_acquire ) )
+		return false;
+	{
+		QMutexLocker	locker( &materials_loader_mutex );
+		if ( materials_loader ) {
+			if ( context && onLoaded && !materials_loader->isFinished() )
+				QObject::connect( materials_loader, &QThread::finished, context, onLoaded );
+			return true;
+		}
+	}
+	// the archives are opened on the calling thread, only the database is parsed in the background
+	QMutexLocker	archivesLocker( &ba2Files.mutex );
+	if ( !ba2Files.open_game( STARFIELD ) )
+		return false;
+	QMutexLocker	locker( &materials_loader_mutex );
+	if ( materials_loader || have_materials_cdb )
+		return true;
+	const BA2File *	archives = ba2Files.archives[STARFIELD].first;
+	const BA2File *	tempArchives = ( have_temp_materials ? ba2Files.archives[STARFIELD].second : nullptr );
+	materials_loader = QThread::create( [archives, tempArchives]() {
+		try {
+			starfield_materials.loadArchives( *archives, tempArchives );
+		} catch ( std::exception & e ) {
+			// Do not keep a partially loaded database, and report the error on the GUI thread
+			starfield_materials.clear();
+			materials_load_failed.store( true, std::memory_order_release );
+			starfield_materials_id++;
+			QString	msg = QString( "Error loading Starfield material database: %1" ).arg( e.what() );
+			qWarning() << msg;
+			QCoreApplication *	app = QCoreApplication::instance();
+			if ( app && app->inherits( "QApplication" ) ) {
+				QMetaObject::invokeMethod( app, [msg]() {
+					QMessageBox::critical( nullptr, "NifSkope error", msg );
+				}, Qt::QueuedConnection );
+			}
+			return;
+		}
+		starfield_materials_id++;
+		have_materials_cdb.store( true, std::memory_order_release );
+	} );
+	if ( context && onLoaded )
+		QObject::connect( materials_loader, &QThread::finished, context, onLoaded );
+	materials_loader->start( QThread::LowPriority );
+	return true;
+}
+
 std::uintptr_t GameManager::get_material_db_id()
 {
 	return starfield_materials_id;
 }
 
+bool GameManager::open_archives(const GameMode game)
+{
+	return ba2Files.open_game( game );
+}
+
 void GameManager::close_archives(bool tempPathsFirst)
 {
 	ba2Files.close_all( tempPathsFirst );
 }
 
+std::uintptr_t GameManager::get_archives_id()
+{
+	return archives_id;
+}
+
 void GameManager::close_materials()
 {
+	wait_materials_loader();
+	materials_load_failed = false;
 	if ( have_materials_cdb ) {
 		starfield_materials_id++;
 		have_materials_cdb = false;
@@ -544,12 +965,22 @@ void GameManager::list_files(std::set< std::string_view >& fileSet, const GameMo
 {
 	if ( !(game >= OTHER && game < NUM_GAMES) )
 		return;
-	// make sure that archives are loaded
-	(void) ba2Files.get_file( game, std::string(".") );
 	list_files_scan_function_data	tmp;
 	tmp.fileSet = &fileSet;
 	tmp.filterFunc = fileListFilterFunc;
 	tmp.filterFuncData = fileListFilterFuncData;
+	QMutexLocker	locker( &ba2Files.mutex );
+	// use the archive index if the archives have not been opened yet, the names remain valid until close_archives()
+	if ( !ba2Files.archives[game].first ) {
+		if ( const ArchiveIndex * index = ba2Files.get_index( game ); index ) {
+			for ( const auto & i : index->files ) {
+				if ( !fileListFilterFunc || fileListFilterFunc( fileListFilterFuncData, i.first ) )
+					fileSet.insert( i.first );
+			}
+		} else {
+			(void) ba2Files.open_game( game );
+		}
+	}
 	for ( int i = 0; i < 2; i++ ) {
 		const BA2File *	ba2File = ( !i ? ba2Files.archives[game].first : ba2Files.archives[game].second );
 		if ( !ba2File )
@@ -2,6 +2,7 @@
 #define GAMEMANAGER_H
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 
 #include <QMap>
@@ -153,12 +154,25 @@ public:
 	//! Find and load resource file to 'data'. The return value is true on success.
 	static bool get_file(QByteArray& data, const GameMode game, const std::string_view& fullPath);
 	static bool get_file(QByteArray& data, const GameMode game, const QString& path, const char* archiveFolder, const char* extension);
+	//! Return the unpacked size of a file in the resource archives, or -1 if the archives are not loaded or the file is not found.
+	static qint64 file_size(const GameMode game, const std::string_view& fullPath);
+	//! Return the sizes and modification times of the loose files 'fullPath' may be loaded from, which change when one of them is edited. Empty if the file is only in archives.
+	static QByteArray loose_file_stamp(const GameMode game, const std::string_view& fullPath);
 	//! Return pointer to Starfield material database, loading it first if necessary. On error, nullptr is returned.
 	static CE2MaterialDB* materials(const GameMode game);
+	//! Return pointer to Starfield material database if it is already loaded, or nullptr otherwise. Does not block.
+	static CE2MaterialDB* loaded_materials(const GameMode game);
+	//! Start loading the Starfield material database on a background thread. Returns false if it cannot be loaded for 'game'.
+	// If 'context' is not nullptr, 'onLoaded' is called on its thread when the database has been loaded.
+	static bool preload_materials(const GameMode game, QObject* context = nullptr, std::function< void() > onLoaded = {});
 	//! Returns a non-zero ID unique to the currently loaded material database. Previously returned material pointers become invalid when this value changes.
 	static std::uintptr_t get_material_db_id();
+	//! Open the resource archives of 'game' if they are not open yet. Returns false if no archives could be opened.
+	static bool open_archives(const GameMode game);
 	//! Close all currently opened resource archives and files.
 	static void close_archives(bool tempPathsFirst = false);
+	//! Returns an ID that changes whenever resource archives or temporary data paths are opened or closed.
+	static std::uintptr_t get_archives_id();
 	//! Deallocate Starfield material database if it is currently loaded.
 	static void close_materials();
 	//! Open a folder or archive without adding it to the list of data paths.
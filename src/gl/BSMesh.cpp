@@ -10,6 +10,8 @@
 #include <QDir>
 #include <QBuffer>
 
+#include <algorithm>
+
 
 BSMesh::BSMesh(Scene* s, const QModelIndex& iBlock) : Shape(s, iBlock)
 {
@@ -29,15 +31,23 @@ void BSMesh::drawShapes( NodeList * secondPass )
 	if ( isHidden() || ( !scene->hasOption(Scene::ShowMarkers) && name.contains("EditorMarker") ) )
 		return;
 
+	if ( scene->isCulled( this ) )
+		return;
+
 	// Draw translucent meshes in second pass
 	if ( secondPass && drawInSecondPass ) {
 		secondPass->add(this);
 		return;
 	}
 
+	// Draw opaque meshes after the scene traversal, sorted by render state
+	if ( queueDraw() )
+		return;
+
 	auto nif = NifModel::fromIndex(iBlock);
 	if ( lodLevel != scene->lodLevel ) {
 		lodLevel = scene->lodLevel;
+		needUpdateBounds = true;
 		updateData(nif);
 	}
 
@@ -85,8 +95,11 @@ void BSMesh::drawShapes( NodeList * secondPass )
 		}
 	}
 
-	if ( sortedTriangles.count() )
-		glDrawElements(GL_TRIANGLES, sortedTriangles.count() * 3, GL_UNSIGNED_SHORT, sortedTriangles.constData());
+	const QVector<Triangle> & tris = ( Node::SELECTING ? sortedTriangles : cullMeshlets() );
+	if ( tris.count() ) {
+		glDrawElements(GL_TRIANGLES, tris.count() * 3, GL_UNSIGNED_SHORT, tris.constData());
+		scene->countDrawCall( tris.count() );
+	}
 
 	if ( !Node::SELECTING )
 		scene->renderer->stopProgram();
@@ -188,9 +201,56 @@ BoundSphere BSMesh::bounds() const
 	return worldTrans() * boundSphere;
 }
 
+const QVector<Triangle> & BSMesh::cullMeshlets()
+{
+	meshletStats = MeshletStats();
+
+	// Meshlets only cover the full detail triangles, and skinned vertices may move outside their bounds
+	const MeshFile * mesh = getMeshFile();
+	if ( !mesh || mesh->meshlets.isEmpty() || ( lodLevel > 0 && !mesh->lods.isEmpty() )
+		|| mesh->triangles.count() != sortedTriangles.count() || ( isSkinned && scene->hasOption(Scene::DoSkinning) ) ) {
+		meshletStats.triangles = sortedTriangles.count();
+		return sortedTriangles;
+	}
+
+	const Transform & vt = viewTrans();
+
+	meshletTriangles.resize( sortedTriangles.count() );
+	Triangle * out = meshletTriangles.data();
+	for ( const auto & m : mesh->meshlets ) {
+		BoundSphere sphere = vt * BoundSphere( m.center, m.radius );
+		if ( scene->frustum.isValid() && !scene->frustum.intersects( sphere ) ) {
+			meshletStats.culledFrustum++;
+			continue;
+		}
+
+		meshletStats.drawn++;
+		out = std::copy_n( sortedTriangles.constData() + m.triangleOffset, m.triangleCount, out );
+	}
+	meshletTriangles.resize( int( out - meshletTriangles.constData() ) );
+	meshletStats.triangles = meshletTriangles.count();
+
+	return meshletTriangles;
+}
+
 QString BSMesh::textStats() const
 {
-	return QString();
+	QString stats = Node::textStats() + QString( "\nshader: %1\n" ).arg( shader );
+
+	const MeshFile * mesh = getMeshFile();
+	if ( mesh && !mesh->meshlets.isEmpty() ) {
+		int total = mesh->meshlets.count();
+		int culled = meshletStats.culledFrustum;
+		int numTriangles = std::max( int(sortedTriangles.count()), 1 );
+		stats += QString( "\nmeshlets: %1\ndrawn: %2\nculled by frustum: %3\n" )
+			.arg( total ).arg( meshletStats.drawn ).arg( meshletStats.culledFrustum );
+		stats += QString( "culled meshlets: %1%\ntriangles drawn: %2 of %3 (%4%)\n" )
+			.arg( culled * 100 / std::max( total, 1 ) )
+			.arg( meshletStats.triangles ).arg( sortedTriangles.count() )
+			.arg( meshletStats.triangles * 100 / numTriangles );
+	}
+
+	return stats;
 }
 
 void BSMesh::forMeshIndex(const NifModel* nif, std::function<void(const QString&, int)>& f)
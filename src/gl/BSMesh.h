@@ -72,5 +72,18 @@ protected:
 
 	BoundSphere dataBound;
 
+	//! Triangles of the meshlets that passed culling in the last drawShapes()
+	QVector<Triangle> meshletTriangles;
+	//! Meshlet culling results of the last drawShapes()
+	struct MeshletStats
+	{
+		int drawn = 0;
+		int culledFrustum = 0;
+		int triangles = 0;
+	} meshletStats;
+
+	//! Returns the triangles to draw, without the meshlets that are outside the view
+	const QVector<Triangle> & cullMeshlets();
+
 	quint32 lodLevel = 0;
 };
@@ -258,12 +258,19 @@ void BSShape::drawShapes( NodeList * secondPass )
 	if ( !scene->hasOption(Scene::ShowMarkers) && name.contains( "EditorMarker" ) )
 		return;
 
+	if ( scene->isCulled( this ) )
+		return;
+
 	// Draw translucent meshes in second pass
 	if ( secondPass && drawInSecondPass ) {
 		secondPass->add( this );
 		return;
 	}
 
+	// Draw opaque meshes after the scene traversal, sorted by render state
+	if ( queueDraw() )
+		return;
+
 	auto nif = NifModel::fromIndex( iBlock );
 
 	if ( Node::SELECTING ) {
@@ -326,11 +333,13 @@ void BSShape::drawShapes( NodeList * secondPass )
 	if ( isDoubleSided ) {
 		glCullFace( GL_FRONT );
 		glDrawElements( GL_TRIANGLES, triangles.count() * 3, GL_UNSIGNED_SHORT, triangles.constData() );
+		scene->countDrawCall( triangles.count() );
 		glCullFace( GL_BACK );
 	}
 
 	if ( !isLOD ) {
 		glDrawElements( GL_TRIANGLES, triangles.count() * 3, GL_UNSIGNED_SHORT, triangles.constData() );
+		scene->countDrawCall( triangles.count() );
 	} else if ( triangles.count() ) {
 		auto lod0 = nif->get<uint>( iBlock, "LOD0 Size" );
 		auto lod1 = nif->get<uint>( iBlock, "LOD1 Size" );
@@ -344,17 +353,23 @@ void BSShape::drawShapes( NodeList * secondPass )
 		// If Level1, also render Level0
 		switch ( scene->lodLevel ) {
 		case Scene::Level0:
-			if ( lod2tris.count() )
+			if ( lod2tris.count() ) {
 				glDrawElements( GL_TRIANGLES, lod2tris.count() * 3, GL_UNSIGNED_SHORT, lod2tris.constData() );
+				scene->countDrawCall( lod2tris.count() );
+			}
 			[[fallthrough]];
 		case Scene::Level1:
-			if ( lod1tris.count() )
+			if ( lod1tris.count() ) {
 				glDrawElements( GL_TRIANGLES, lod1tris.count() * 3, GL_UNSIGNED_SHORT, lod1tris.constData() );
+				scene->countDrawCall( lod1tris.count() );
+			}
 			[[fallthrough]];
 		case Scene::Level2:
 		default:
-			if ( lod0tris.count() )
+			if ( lod0tris.count() ) {
 				glDrawElements( GL_TRIANGLES, lod0tris.count() * 3, GL_UNSIGNED_SHORT, lod0tris.constData() );
+				scene->countDrawCall( lod0tris.count() );
+			}
 			break;
 		}
 	}
@@ -40,6 +40,10 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gamemanager.h"
 
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
 // `NiControllerManager` blocks
 
 ControllerManager::ControllerManager( Node * node, const QModelIndex & index )
@@ -560,6 +564,45 @@ ParticleController::ParticleController( Particles * particles, const QModelIndex
 {
 }
 
+void ParticleController::ParticleList::append( const FloatVector4 & p, const FloatVector4 & v, float age, float span, float last, int vtx )
+{
+	position.append( p );
+	velocity.append( v );
+	lifetime.append( age );
+	lifespan.append( span );
+	lasttime.append( last );
+	vertex.append( vtx );
+}
+
+void ParticleController::ParticleList::remove( int n )
+{
+	int last = count() - 1;
+	if ( n != last ) {
+		position[n] = position[last];
+		velocity[n] = velocity[last];
+		lifetime[n] = lifetime[last];
+		lifespan[n] = lifespan[last];
+		lasttime[n] = lasttime[last];
+		vertex[n] = vertex[last];
+	}
+	position.removeLast();
+	velocity.removeLast();
+	lifetime.removeLast();
+	lifespan.removeLast();
+	lasttime.removeLast();
+	vertex.removeLast();
+}
+
+void ParticleController::ParticleList::clear()
+{
+	position.clear();
+	velocity.clear();
+	lifetime.clear();
+	lifespan.clear();
+	lasttime.clear();
+	vertex.clear();
+}
+
 bool ParticleController::update( const NifModel * nif, const QModelIndex & index )
 {
 	if ( !target )
@@ -602,14 +645,12 @@ bool ParticleController::update( const NifModel * nif, const QModelIndex & index
 			//if ( iParticles.isValid() )
 			//{
 			for ( int p = 0; p < numValid && p < nif->rowCount( iParticles ); p++ ) {
-				Particle particle;
-				particle.velocity = nif->get<Vector3>( QModelIndex_child( iParticles, p ), "Velocity" );
-				particle.lifetime = nif->get<float>( QModelIndex_child( iParticles, p ), "Age" );
-				particle.lifespan = nif->get<float>( QModelIndex_child( iParticles, p ), "Life Span" );
-				particle.lasttime = nif->get<float>( QModelIndex_child( iParticles, p ), "Last Update" );
-				particle.vertex = nif->get<int>( QModelIndex_child( iParticles, p ), "Code" );
+				QModelIndex iParticle = QModelIndex_child( iParticles, p );
+				Vector3 v = nif->get<Vector3>( iParticle, "Velocity" );
 				// Display saved particle start on initial load
-				list.append( particle );
+				list.append( FloatVector4( 0.0f ), FloatVector4( v[0], v[1], v[2], 0.0f ),
+								nif->get<float>( iParticle, "Age" ), nif->get<float>( iParticle, "Life Span" ),
+								nif->get<float>( iParticle, "Last Update" ), nif->get<int>( iParticle, "Code" ) );
 			}
 
 			//}
@@ -622,6 +663,7 @@ bool ParticleController::update( const NifModel * nif, const QModelIndex & index
 		iExtras.clear();
 		grav.clear();
 		iColorKeys = QModelIndex();
+		colorTable.clear();
 		QModelIndex iExtra = nif->getBlockIndex( nif->getLink( iBlock, "Particle Modifier" ) );
 
 		while ( iExtra.isValid() ) {
@@ -638,14 +680,28 @@ bool ParticleController::update( const NifModel * nif, const QModelIndex & index
 				Gravity g;
 				g.force = nif->get<float>( iExtra, "Force" );
 				g.type = nif->get<int>( iExtra, "Type" );
-				g.position = nif->get<Vector3>( iExtra, "Position" );
-				g.direction = nif->get<Vector3>( iExtra, "Direction" );
+				Vector3 pos = nif->get<Vector3>( iExtra, "Position" );
+				Vector3 dir = nif->get<Vector3>( iExtra, "Direction" );
+				g.position = FloatVector4( pos[0], pos[1], pos[2], 0.0f );
+				g.direction = FloatVector4( dir[0], dir[1], dir[2], 0.0f );
 				grav.append( g );
 			}
 
 			iExtra = nif->getBlockIndex( nif->getLink( iExtra, "Next Modifier" ) );
 		}
 
+		if ( iColorKeys.isValid() ) {
+			// Sampling the keys once is much cheaper than interpolating them for every particle and frame
+			colorTable.resize( colorTableSize + 1 );
+			int last = 0;
+			for ( int i = 0; i <= colorTableSize; i++ ) {
+				if ( !interpolate( colorTable[i], iColorKeys, float( i ) / float( colorTableSize ), last ) ) {
+					colorTable.clear();
+					break;
+				}
+			}
+		}
+
 		return true;
 	}
 
@@ -659,26 +715,42 @@ void ParticleController::updateTime( float time )
 
 	localtime = ctrlTime( time );
 
-	int n = 0;
+	// Age the particles and remove the expired ones
+	int vertCount = target->verts.count();
+	for ( int n = 0; n < list.count(); ) {
+		float deltaTime = (localtime > list.lasttime[n] ? localtime - list.lasttime[n] : 0); //( stop - start ) - p.lasttime + localtime );
 
-	while ( n < list.count() ) {
-		Particle & p = list[n];
+		list.lifetime[n] += deltaTime;
 
-		float deltaTime = (localtime > p.lasttime ? localtime - p.lasttime : 0); //( stop - start ) - p.lasttime + localtime );
-
-		p.lifetime += deltaTime;
-
-		if ( p.lifetime < p.lifespan && p.vertex < target->verts.count() ) {
-			p.position = target->verts[p.vertex];
-
-			for ( int i = 0; i < 4; i++ )
-				moveParticle( p, deltaTime / 4 );
-
-			p.lasttime = localtime;
+		if ( list.lifetime[n] < list.lifespan[n] && list.vertex[n] < vertCount )
 			n++;
-		} else {
+		else
 			list.remove( n );
+	}
+
+	// Large emitters are simulated on the thread pool
+	int count = list.count();
+	int threadCount = std::min( QThread::idealThreadCount(), count / particlesPerThread );
+	if ( threadCount > 1 ) {
+		// moveParticles() must not detach the arrays concurrently
+		list.position.detach();
+		list.velocity.detach();
+		list.lasttime.detach();
+
+		QSemaphore done;
+		int chunk = ( count + threadCount - 1 ) / threadCount;
+		for ( int t = 1; t < threadCount; t++ ) {
+			int first = t * chunk;
+			int last = std::min( first + chunk, count );
+			QThreadPool::globalInstance()->start( [this, first, last, &done]() {
+				moveParticles( first, last );
+				done.release();
+			} );
 		}
+		moveParticles( 0, std::min( chunk, count ) );
+		done.acquire( threadCount - 1 );
+	} else {
+		moveParticles( 0, count );
 	}
 
 	if ( emitNode && emitNode->isVisible() && localtime >= emitStart && localtime <= emitStop ) {
@@ -692,91 +764,114 @@ void ParticleController::updateTime( float time )
 		if ( num > 0 ) {
 			emitAccu -= num;
 
-			while ( num-- > 0 && list.count() < target->verts.count() ) {
-				Particle p;
-				startParticle( p );
-				list.append( p );
-			}
+			while ( num-- > 0 && list.count() < vertCount )
+				startParticle();
 		}
 	}
 
-	n = 0;
-
-	while ( n < list.count() ) {
-		Particle & p = list[n];
-		p.vertex = n;
-		target->verts[n] = p.position;
-
-		if ( n < target->sizes.count() )
-			sizeParticle( p, target->sizes[n] );
-
-		if ( n < target->colors.count() )
-			colorParticle( p, target->colors[n] );
-
-		n++;
+	count = list.count();
+	const FloatVector4 * position = list.position.constData();
+	Vector3 * verts = target->verts.data();
+	int numSizes = std::min( count, int( target->sizes.count() ) );
+	int numColors = ( colorTable.isEmpty() ? 0 : std::min( count, int( target->colors.count() ) ) );
+	for ( int n = 0; n < count; n++ ) {
+		list.vertex[n] = n;
+		verts[n] = Vector3( position[n][0], position[n][1], position[n][2] );
 	}
+	for ( int n = 0; n < numSizes; n++ )
+		target->sizes[n] = particleSize( n );
+	for ( int n = 0; n < numColors; n++ )
+		target->colors[n] = particleColor( n );
 
-	target->active = list.count();
+	target->active = count;
 	target->size = size;
 }
 
-void ParticleController::startParticle( Particle & p )
+void ParticleController::startParticle()
 {
-	p.position = random( emitRadius * 2 ) - emitRadius;
-	p.position += target->worldTrans().rotation.inverted() * (emitNode->worldTrans().translation - target->worldTrans().translation);
+	Vector3 position = random( emitRadius * 2 ) - emitRadius;
+	position += target->worldTrans().rotation.inverted() * (emitNode->worldTrans().translation - target->worldTrans().translation);
 
 	float i = inc + random( incRnd );
 	float d = dec + random( decRnd );
 
-	p.velocity = Vector3( rand() & 1 ? sin( i ) : -sin( i ), 0, cos( i ) );
+	Vector3 velocity = Vector3( rand() & 1 ? sin( i ) : -sin( i ), 0, cos( i ) );
 
 	Matrix m; m.fromEuler( 0, 0, rand() & 1 ? d : -d );
-	p.velocity = m * p.velocity;
+	velocity = m * velocity;
 
-	p.velocity = p.velocity * (spd + random( spdRnd ));
-	p.velocity = target->worldTrans().rotation.inverted() * emitNode->worldTrans().rotation * p.velocity;
+	velocity = velocity * (spd + random( spdRnd ));
+	velocity = target->worldTrans().rotation.inverted() * emitNode->worldTrans().rotation * velocity;
 
-	p.lifetime = 0;
-	p.lifespan = ttl + random( ttlRnd );
-	p.lasttime = localtime;
+	// Emitted particles keep their position, the vertex is only read for particles that have moved
+	list.append( FloatVector4( position[0], position[1], position[2], 0.0f ), FloatVector4( velocity[0], velocity[1], velocity[2], 0.0f ),
+					0.0f, ttl + random( ttlRnd ), localtime, list.count() );
 }
 
-void ParticleController::moveParticle( Particle & p, float deltaTime )
+void ParticleController::moveParticles( int first, int last )
 {
-	for ( Gravity g : grav ) {
-		switch ( g.type ) {
-		case 0:
-			p.velocity += g.direction * (g.force * deltaTime);
-			break;
-		case 1:
-		{
-			Vector3 dir = (g.position - p.position);
-			dir.normalize();
-			p.velocity += dir * (g.force * deltaTime);
-		}
-		break;
+	const Vector3 * verts = target->verts.constData();
+	FloatVector4 * position = list.position.data();
+	FloatVector4 * velocity = list.velocity.data();
+	float * lasttime = list.lasttime.data();
+	const int * vertex = list.vertex.constData();
+	const Gravity * g = grav.constData();
+	int numGrav = grav.count();
+
+	for ( int n = first; n < last; n++ ) {
+		float deltaTime = (localtime > lasttime[n] ? localtime - lasttime[n] : 0) * 0.25f;
+		const Vector3 & v = verts[vertex[n]];
+		FloatVector4 p( v[0], v[1], v[2], 0.0f );
+		FloatVector4 vel = velocity[n];
+
+		for ( int i = 0; i < 4; i++ ) {
+			for ( int j = 0; j < numGrav; j++ ) {
+				switch ( g[j].type ) {
+				case 0:
+					vel += g[j].direction * (g[j].force * deltaTime);
+					break;
+				case 1:
+				{
+					FloatVector4 dir = g[j].position - p;
+					float l = dir.dotProduct3( dir );
+					if ( l > 0.0f )
+						dir *= 1.0f / float( std::sqrt( l ) );
+					vel += dir * (g[j].force * deltaTime);
+				}
+				break;
+				}
+			}
+			p += vel * deltaTime;
 		}
+
+		position[n] = p;
+		velocity[n] = vel;
+		lasttime[n] = localtime;
 	}
-	p.position += p.velocity * deltaTime;
 }
 
-void ParticleController::sizeParticle( Particle & p, float & sz )
+float ParticleController::particleSize( int n ) const
 {
-	sz = 1.0;
+	float sz = 1.0;
+	float lifetime = list.lifetime[n];
+	float lifespan = list.lifespan[n];
 
-	if ( grow > 0 && p.lifetime < grow )
-		sz *= p.lifetime / grow;
+	if ( grow > 0 && lifetime < grow )
+		sz *= lifetime / grow;
 
-	if ( fade > 0 && p.lifespan - p.lifetime < fade )
-		sz *= (p.lifespan - p.lifetime) / fade;
+	if ( fade > 0 && lifespan - lifetime < fade )
+		sz *= (lifespan - lifetime) / fade;
+
+	return sz;
 }
 
-void ParticleController::colorParticle( Particle & p, Color4 & color )
+Color4 ParticleController::particleColor( int n ) const
 {
-	if ( iColorKeys.isValid() ) {
-		int i = 0;
-		interpolate( color, iColorKeys, p.lifetime / p.lifespan, i );
-	}
+	float x = list.lifetime[n] / list.lifespan[n];
+	x = std::min( std::max( x, 0.0f ), 1.0f ) * float( colorTableSize );
+	int i = std::min( int( x ), colorTableSize - 1 );
+	x -= float( i );
+	return colorTable[i] * ( 1.0f - x ) + colorTable[i + 1] * x;
 }
 
 
@@ -182,28 +182,29 @@ class Particles;
 //! Controller for `NiParticleSystemController` and other blocks
 class ParticleController final : public Controller
 {
-	struct Particle
+	//! Particle state as a structure of arrays, the order of particles is not preserved
+	struct ParticleList
 	{
-		Vector3 position;
-		Vector3 velocity;
-		Vector3 unknown;
-		float lifetime = 0;
-		float lifespan = 0;
-		float lasttime = 0;
-		short y = 0;
-		short vertex = 0;
-
-		Particle()
-		{
-		}
+		QVector<FloatVector4> position;
+		QVector<FloatVector4> velocity;
+		QVector<float> lifetime;
+		QVector<float> lifespan;
+		QVector<float> lasttime;
+		QVector<int> vertex;
+
+		int count() const { return lifetime.count(); }
+		void append( const FloatVector4 & p, const FloatVector4 & v, float age, float span, float last, int vtx );
+		//! Removes particle n by moving the last particle in its place
+		void remove( int n );
+		void clear();
 	};
-	QVector<Particle> list;
+	ParticleList list;
 	struct Gravity
 	{
 		float force;
 		int type;
-		Vector3 position;
-		Vector3 direction;
+		FloatVector4 position;
+		FloatVector4 direction;
 	};
 	QVector<Gravity> grav;
 
@@ -227,6 +228,11 @@ class ParticleController final : public Controller
 
 	QList<QPersistentModelIndex> iExtras;
 	QPersistentModelIndex iColorKeys;
+	//! Particle colors sampled over the normalized lifetime from iColorKeys
+	QVector<Color4> colorTable;
+	static constexpr int colorTableSize = 256;
+	//! Minimum number of particles per thread when simulating large emitters in parallel
+	static constexpr int particlesPerThread = 2048;
 
 public:
 	ParticleController( Particles * particles, const QModelIndex & index );
@@ -235,13 +241,14 @@ public:
 
 	void updateTime( float time ) override final;
 
-	void startParticle( Particle & p );
+	void startParticle();
 
-	void moveParticle( Particle & p, float deltaTime );
+	//! Moves particles [first, last) from their vertex positions to the current time
+	void moveParticles( int first, int last );
 
-	void sizeParticle( Particle & p, float & size );
+	float particleSize( int n ) const;
 
-	void colorParticle( Particle & p, Color4 & color );
+	Color4 particleColor( int n ) const;
 };
 
 
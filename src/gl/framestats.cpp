@@ -0,0 +1,297 @@
+#include "framestats.h"
+
+#include "gl/glscene.h"
+
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QOpenGLTimerQuery>
+#include <QPainter>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+
+
+//! \file framestats.cpp FrameStats implementation
+
+FrameStats::FrameStats()
+{
+	current.sample.times.fill( -1 );
+}
+
+FrameStats::~FrameStats()
+{
+	releaseQueries();
+}
+
+QString FrameStats::stageName( Stage stage )
+{
+	switch ( stage ) {
+	case StageFrame:
+		return "Frame";
+	case StageTransform:
+		return "Transform";
+	case StageSkinning:
+		return "Skinning";
+	case StageDraw:
+		return "Draw";
+	case StagePicking:
+		return "Picking";
+	case StageGpu:
+		return "GPU";
+	default:
+		return {};
+	}
+}
+
+void FrameStats::setOverlayVisible( bool visible )
+{
+	overlay = visible;
+}
+
+bool FrameStats::setLogFile( const QString & fileName, QString * error )
+{
+	if ( log.isOpen() )
+		log.close();
+
+	if ( fileName.isEmpty() )
+		return true;
+
+	log.setFileName( fileName );
+	if ( !log.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+		if ( error )
+			*error = log.errorString();
+		return false;
+	}
+
+	log.write( csvHeader().toUtf8() + '\n' );
+	return true;
+}
+
+bool FrameStats::saveCsv( const QString & fileName, QString * error ) const
+{
+	QFile file( fileName );
+	if ( !file.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+		if ( error )
+			*error = file.errorString();
+		return false;
+	}
+
+	QTextStream out( &file );
+	out << csvHeader() << '\n';
+	for ( const Sample & s : history )
+		out << csvLine( s ) << '\n';
+
+	return true;
+}
+
+void FrameStats::beginFrame()
+{
+	if ( !isEnabled() )
+		return;
+
+	current = PendingFrame();
+	current.sample.frame = ++frameCount;
+	current.sample.times.fill( -1 );
+	current.sample.times[StagePicking] = picking;
+	picking = -1;
+
+	if ( gpuTiming ) {
+		// Only wait for the GPU if it is several frames behind
+		if ( freeQueries.isEmpty() && pending.count() >= maxPendingQueries )
+			collect( true );
+
+		if ( !freeQueries.isEmpty() ) {
+			current.query = freeQueries.takeLast();
+		} else {
+			auto query = new QOpenGLTimerQuery;
+			if ( query->create() ) {
+				current.query = query;
+			} else {
+				// Needs OpenGL 3.3 or ARB_timer_query
+				delete query;
+				gpuTiming = false;
+			}
+		}
+
+		if ( current.query )
+			current.query->begin();
+	}
+
+	inFrame = true;
+	frameTimer.start();
+}
+
+void FrameStats::endFrame( const Scene * scene, const QString & fileName )
+{
+	if ( !inFrame )
+		return;
+
+	inFrame = false;
+
+	if ( current.query )
+		current.query->end();
+
+	Sample & s = current.sample;
+	s.times[StageFrame] = frameTimer.nsecsElapsed();
+	s.fileName = fileName;
+
+	if ( scene ) {
+		s.times[StageTransform] = scene->transformStats.transform;
+		s.times[StageSkinning] = scene->transformStats.skinning;
+		s.drawCalls = scene->drawStats.drawCalls;
+		s.triangles = scene->drawStats.triangles;
+		s.textureBinds = scene->drawStats.textureBinds;
+		s.programSwitches = scene->drawStats.programSwitches;
+		s.shapesDrawn = scene->drawStats.drawn;
+		s.shapesCulled = scene->drawStats.culled;
+	}
+
+	pending.append( current );
+	current = PendingFrame();
+
+	collect( false );
+}
+
+void FrameStats::setTime( Stage stage, qint64 nsecs )
+{
+	if ( inFrame )
+		current.sample.times[stage] = nsecs;
+}
+
+void FrameStats::addPicking( qint64 nsecs )
+{
+	if ( isEnabled() )
+		picking = std::max<qint64>( picking, 0 ) + nsecs;
+}
+
+void FrameStats::collect( bool wait )
+{
+	while ( !pending.isEmpty() ) {
+		PendingFrame & f = pending.first();
+
+		if ( f.query ) {
+			if ( !wait && !f.query->isResultAvailable() )
+				break;
+
+			f.sample.times[StageGpu] = qint64( f.query->waitForResult() );
+			freeQueries.append( f.query );
+			wait = false;
+		}
+
+		addSample( f.sample );
+		pending.removeFirst();
+	}
+}
+
+void FrameStats::addSample( const Sample & sample )
+{
+	history.append( sample );
+	while ( history.count() > historySize )
+		history.removeFirst();
+
+	if ( log.isOpen() )
+		log.write( csvLine( sample ).toUtf8() + '\n' );
+}
+
+void FrameStats::releaseQueries()
+{
+	for ( const PendingFrame & f : pending )
+		delete f.query;
+	pending.clear();
+
+	delete current.query;
+	current.query = nullptr;
+	inFrame = false;
+
+	qDeleteAll( freeQueries );
+	freeQueries.clear();
+}
+
+double FrameStats::percentile( Stage stage, double p ) const
+{
+	QVector<qint64> times;
+	times.reserve( history.count() );
+	for ( const Sample & s : history ) {
+		if ( s.times[stage] >= 0 )
+			times.append( s.times[stage] );
+	}
+
+	if ( times.isEmpty() )
+		return -1.0;
+
+	// Nearest rank
+	std::sort( times.begin(), times.end() );
+	int rank = int( std::ceil( p / 100.0 * times.count() ) ) - 1;
+	rank = std::clamp( rank, 0, int( times.count() ) - 1 );
+
+	return double( times[rank] ) / 1.0e6;
+}
+
+void FrameStats::drawOverlay( QPainter & painter, const QRect & rect ) const
+{
+	QStringList lines;
+
+	if ( history.isEmpty() ) {
+		lines << "Waiting for frames";
+	} else {
+		auto ms = []( double t ) {
+			return ( t < 0 ) ? QString( "-" ).rightJustified( 8 ) : QString::number( t, 'f', 2 ).rightJustified( 8 );
+		};
+
+		lines << QString( "%1%2%3%4" ).arg( "ms", -10 ).arg( "p50", 8 ).arg( "p95", 8 ).arg( "p99", 8 );
+		for ( int i = 0; i < StageCount; i++ ) {
+			Stage stage = Stage( i );
+			if ( stage == StageGpu && !gpuTiming )
+				continue;
+
+			lines << stageName( stage ).leftJustified( 10 )
+				+ ms( percentile( stage, 50 ) ) + ms( percentile( stage, 95 ) ) + ms( percentile( stage, 99 ) );
+		}
+
+		const Sample & s = history.last();
+		lines << QString();
+		lines << QString( "Draw calls %1  Triangles %2" ).arg( s.drawCalls ).arg( s.triangles );
+		lines << QString( "Texture binds %1  Programs %2" ).arg( s.textureBinds ).arg( s.programSwitches );
+		lines << QString( "Shapes %1 drawn, %2 culled" ).arg( s.shapesDrawn ).arg( s.shapesCulled );
+		lines << QString( "%1 frames%2" ).arg( history.count() ).arg( log.isOpen() ? ", logging" : "" );
+	}
+
+	QString text = lines.join( '\n' );
+
+	painter.save();
+	painter.setFont( QFontDatabase::systemFont( QFontDatabase::FixedFont ) );
+
+	QRect box = painter.fontMetrics().boundingRect( rect.adjusted( 8, 8, -8, -8 ), Qt::AlignLeft | Qt::AlignTop, text );
+	painter.fillRect( box.adjusted( -6, -6, 6, 6 ), QColor( 0, 0, 0, 160 ) );
+	painter.setPen( Qt::white );
+	painter.drawText( box, Qt::AlignLeft | Qt::AlignTop, text );
+
+	painter.restore();
+}
+
+QString FrameStats::csvHeader()
+{
+	return "frame,file,frame_ms,transform_ms,skinning_ms,draw_ms,picking_ms,gpu_ms,"
+		"draw_calls,triangles,texture_binds,program_switches,shapes_drawn,shapes_culled";
+}
+
+QString FrameStats::csvLine( const Sample & s )
+{
+	QStringList fields;
+	fields << QString::number( s.frame );
+
+	QString file = s.fileName;
+	fields << "\"" + file.replace( "\"", "\"\"" ) + "\"";
+
+	for ( int i = 0; i < StageCount; i++ ) {
+		qint64 t = s.times[i];
+		fields << ( ( t < 0 ) ? QString() : QString::number( double( t ) / 1.0e6, 'f', 4 ) );
+	}
+
+	fields << QString::number( s.drawCalls ) << QString::number( s.triangles )
+		<< QString::number( s.textureBinds ) << QString::number( s.programSwitches )
+		<< QString::number( s.shapesDrawn ) << QString::number( s.shapesCulled );
+
+	return fields.join( ',' );
+}
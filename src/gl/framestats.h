@@ -0,0 +1,137 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+#include <array>
+
+
+//! \file framestats.h FrameStats
+
+class QOpenGLTimerQuery;
+class QPainter;
+class QRect;
+class Scene;
+
+//! Per frame CPU and GPU times and draw counts of GLView
+/*!
+ * The CPU time of each stage is measured with QElapsedTimer, the scene stages by Scene itself (see
+ * Scene::TransformStats). The GPU time of a frame is measured with a GL_TIME_ELAPSED timer query,
+ * whose result is read a few frames later so that the CPU does not wait for the GPU. A frame is
+ * added to the history and the log once its GPU time is known.
+ *
+ * The overlay shows the percentiles of the last historySize frames. The log appends every frame
+ * to a CSV file, so the numbers of an asset can be compared between versions.
+ */
+class FrameStats final
+{
+public:
+	enum Stage
+	{
+		//! The whole GLView::paintGL() call
+		StageFrame,
+		//! Scene::transform() without the shapes
+		StageTransform,
+		//! Node::transformShapes(), the skinning and morphing
+		StageSkinning,
+		//! Scene::draw(), the submission of the draw calls
+		StageDraw,
+		//! GLView::indexAt() since the previous frame
+		StagePicking,
+		//! The GPU time of the frame, from the timer query
+		StageGpu,
+		StageCount
+	};
+
+	struct Sample
+	{
+		quint64 frame = 0;
+		//! Times of each Stage in nanoseconds, -1 if not measured
+		std::array<qint64, StageCount> times;
+		int drawCalls = 0;
+		qint64 triangles = 0;
+		int textureBinds = 0;
+		int programSwitches = 0;
+		int shapesDrawn = 0;
+		int shapesCulled = 0;
+		//! The file shown in the frame
+		QString fileName;
+	};
+
+	//! Number of frames the percentiles are computed over
+	static constexpr int historySize = 300;
+	//! Number of frames a timer query may stay unfinished before the CPU waits for it
+	static constexpr int maxPendingQueries = 4;
+
+	FrameStats();
+	~FrameStats();
+
+	//! Whether frames are measured, for the overlay or the log
+	bool isEnabled() const { return overlay || log.isOpen(); }
+	bool isOverlayVisible() const { return overlay; }
+	void setOverlayVisible( bool visible );
+
+	//! Appends every frame to a CSV file, or stops logging for an empty file name
+	bool setLogFile( const QString & fileName, QString * error = nullptr );
+
+	//! Writes the frames of the history to a CSV file
+	bool saveCsv( const QString & fileName, QString * error = nullptr ) const;
+
+	//! Starts measuring a frame, the OpenGL context must be current
+	void beginFrame();
+	//! Ends the frame started with beginFrame() and takes the counts of the scene
+	void endFrame( const Scene * scene, const QString & fileName );
+
+	//! Sets the CPU time of a stage of the current frame
+	void setTime( Stage stage, qint64 nsecs );
+	//! Adds the time of a pick, it is reported with the next frame
+	void addPicking( qint64 nsecs );
+
+	//! Returns the time of a stage that p percent of the frames in the history did not exceed, in milliseconds
+	double percentile( Stage stage, double p ) const;
+
+	//! Draws the percentiles and the counts of the last frame in the top left corner
+	void drawOverlay( QPainter & painter, const QRect & rect ) const;
+
+	//! Deletes the timer queries, the OpenGL context must be current
+	void releaseQueries();
+
+	static QString stageName( Stage stage );
+
+private:
+	struct PendingFrame
+	{
+		Sample sample;
+		QOpenGLTimerQuery * query = nullptr;
+	};
+
+	//! Moves finished frames to the history, waiting for the oldest one if wait is true
+	void collect( bool wait );
+	void addSample( const Sample & sample );
+
+	static QString csvHeader();
+	static QString csvLine( const Sample & sample );
+
+	bool overlay = false;
+	QFile log;
+
+	//! Whether timer queries are supported, false after a query could not be created
+	bool gpuTiming = true;
+	QVector<QOpenGLTimerQuery *> freeQueries;
+	QList<PendingFrame> pending;
+
+	QElapsedTimer frameTimer;
+	PendingFrame current;
+	bool inFrame = false;
+	qint64 picking = -1;
+	quint64 frameCount = 0;
+
+	//! The last historySize frames, oldest first
+	QList<Sample> history;
+};
+
+#endif
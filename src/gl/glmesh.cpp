@@ -760,12 +760,19 @@ void Mesh::drawShapes( NodeList * secondPass )
 	if ( !scene->hasOption(Scene::ShowMarkers) && name.startsWith( "EditorMarker" ) )
 		return;
 
+	if ( scene->isCulled( this ) )
+		return;
+
 	// Draw translucent meshes in second pass
 	if ( secondPass && drawInSecondPass ) {
 		secondPass->add( this );
 		return;
 	}
 
+	// Draw opaque meshes after the scene traversal, sorted by render state
+	if ( queueDraw() )
+		return;
+
 	auto nif = NifModel::fromIndex( iBlock );
 
 	if ( Node::SELECTING ) {
@@ -839,8 +846,10 @@ void Mesh::drawShapes( NodeList * secondPass )
 
 	if ( !isLOD ) {
 		// render the triangles
-		if ( sortedTriangles.count() )
+		if ( sortedTriangles.count() ) {
 			glDrawElements( GL_TRIANGLES, sortedTriangles.count() * 3, GL_UNSIGNED_SHORT, sortedTriangles.constData() );
+			scene->countDrawCall( sortedTriangles.count() );
+		}
 
 	} else if ( sortedTriangles.count() ) {
 		auto lod0 = nif->get<uint>( iBlock, "LOD0 Size" );
@@ -855,24 +864,32 @@ void Mesh::drawShapes( NodeList * secondPass )
 		// If Level1, also render Level2
 		switch ( scene->lodLevel ) {
 		case Scene::Level0:
-			if ( lod2tris.count() )
+			if ( lod2tris.count() ) {
 				glDrawElements( GL_TRIANGLES, lod2tris.count() * 3, GL_UNSIGNED_SHORT, lod2tris.constData() );
+				scene->countDrawCall( lod2tris.count() );
+			}
 			[[fallthrough]];
 		case Scene::Level1:
-			if ( lod1tris.count() )
+			if ( lod1tris.count() ) {
 				glDrawElements( GL_TRIANGLES, lod1tris.count() * 3, GL_UNSIGNED_SHORT, lod1tris.constData() );
+				scene->countDrawCall( lod1tris.count() );
+			}
 			[[fallthrough]];
 		case Scene::Level2:
 		default:
-			if ( lod0tris.count() )
+			if ( lod0tris.count() ) {
 				glDrawElements( GL_TRIANGLES, lod0tris.count() * 3, GL_UNSIGNED_SHORT, lod0tris.constData() );
+				scene->countDrawCall( lod0tris.count() );
+			}
 			break;
 		}
 	}
 
 	// render the tristrips
-	for ( auto & s : tristrips )
+	for ( auto & s : tristrips ) {
 		glDrawElements( GL_TRIANGLE_STRIP, s.count(), GL_UNSIGNED_SHORT, s.constData() );
+		scene->countDrawCall( std::max( s.count() - 2, 0 ) );
+	}
 
 	if ( isDoubleSided ) {
 		glEnable( GL_CULL_FACE );
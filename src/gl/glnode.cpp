@@ -38,6 +38,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "gl/glscene.h"
 #include "gl/marker/furniture.h"
 #include "gl/marker/constraints.h"
+#include "gl/renderer.h"
 #include "model/nifmodel.h"
 #include "ui/settingsdialog.h"
 
@@ -189,7 +190,9 @@ Node::Node( Scene * s, const QModelIndex & iBlock) : IControllable( s, iBlock ),
 
 	updateSettings();
 
-	connect( NifSkope::getOptions(), &SettingsDialog::saveSettings, this, &Node::updateSettings );
+	// There are no options without a main window, see Thumbnailer
+	if ( NifSkope::getOptions() )
+		connect( NifSkope::getOptions(), &SettingsDialog::saveSettings, this, &Node::updateSettings );
 }
 
 void Node::updateSettings()
@@ -787,76 +790,9 @@ void drawHvkShape( const NifModel * nif, const QModelIndex & iShape, QStack<QMod
 		glMultMatrix( t );
 		drawHvkShape( nif, nif->getBlockIndex( nif->getLink( iShape, "Shape" ) ), stack, scene, origin_color3fv );
 		glPopMatrix();
-	} else if ( name == "bhkSphereShape" ) {
-		if ( Node::SELECTING ) {
-			int s_nodeId = ID2COLORKEY( nif->getBlockNumber( iShape ) );
-			glColor4ubv( (GLubyte *)&s_nodeId );
-		}
-
-		drawSphere( Vector3(), nif->get<float>( iShape, "Radius" ) );
-	} else if ( name == "bhkMultiSphereShape" ) {
-		if ( Node::SELECTING ) {
-			int s_nodeId = ID2COLORKEY( nif->getBlockNumber( iShape ) );
-			glColor4ubv( (GLubyte *)&s_nodeId );
-		}
-
-		QModelIndex iSpheres = nif->getIndex( iShape, "Spheres" );
-
-		for ( int r = 0; r < nif->rowCount( iSpheres ); r++ ) {
-			drawSphere( nif->get<Vector3>( QModelIndex_child( iSpheres, r ), "Center" ), nif->get<float>( QModelIndex_child( iSpheres, r ), "Radius" ) );
-		}
-	} else if ( name == "bhkBoxShape" ) {
-		if ( Node::SELECTING ) {
-			int s_nodeId = ID2COLORKEY( nif->getBlockNumber( iShape ) );
-			glColor4ubv( (GLubyte *)&s_nodeId );
-		}
-
-		Vector3 v = nif->get<Vector3>( iShape, "Dimensions" );
-		drawBox( v, -v );
-	} else if ( name == "bhkCapsuleShape" ) {
-		if ( Node::SELECTING ) {
-			int s_nodeId = ID2COLORKEY( nif->getBlockNumber( iShape ) );
-			glColor4ubv( (GLubyte *)&s_nodeId );
-		}
-
-		drawCapsule( nif->get<Vector3>( iShape, "First Point" ), nif->get<Vector3>( iShape, "Second Point" ), nif->get<float>( iShape, "Radius" ) );
-	} else if ( name == "bhkNiTriStripsShape" ) {
-		glPushMatrix();
-		float s = bhkInvScale( nif );
-		glScalef( s, s, s );
-
-		if ( Node::SELECTING ) {
-			int s_nodeId = ID2COLORKEY( nif->getBlockNumber( iShape ) );
-			glColor4ubv( (GLubyte *)&s_nodeId );
-		}
-
-		drawNiTSS( nif, iShape );
-
-		//if ( Options::getHavokState() == HAVOK_SOLID ) {
-		//	QColor c = Options::hlColor();
-		//	c.setAlphaF( 0.3 );
-		//	glColor( Color4( c ) );
-		//
-		//	drawNiTSS( nif, iShape, true );
-		//}
-
-		glPopMatrix();
-	} else if ( name == "bhkConvexVerticesShape" ) {
-		if ( Node::SELECTING ) {
-			int s_nodeId = ID2COLORKEY( nif->getBlockNumber( iShape ) );
-			glColor4ubv( (GLubyte *)&s_nodeId );
-		}
-
-		drawConvexHull( nif, iShape, 1.0 );
-
-		//if ( Options::getHavokState() == HAVOK_SOLID ) {
-		//	QColor c = Options::hlColor();
-		//	c.setAlphaF( 0.3 );
-		//	glColor( Color4( c ) );
-		//
-		//	drawConvexHull( nif, iShape, havokScale, true );
-		//}
-
+	} else if ( name == "bhkSphereShape" || name == "bhkMultiSphereShape" || name == "bhkBoxShape" || name == "bhkCapsuleShape"
+	            || name == "bhkNiTriStripsShape" || name == "bhkConvexVerticesShape" ) {
+		scene->collisionGeometry( nif, iShape ).draw( scene->renderer->fn, nif->getBlockNumber( iShape ), Node::SELECTING );
 	} else if ( name == "bhkMoppBvTreeShape" ) {
 		if ( !Node::SELECTING ) {
 			if ( scene->currentBlock == nif->getBlockIndex( nif->getLink( iShape, "Shape" ) ) ) {
@@ -871,30 +807,14 @@ void drawHvkShape( const NifModel * nif, const QModelIndex & iShape, QStack<QMod
 
 		drawHvkShape( nif, nif->getBlockIndex( nif->getLink( iShape, "Shape" ) ), stack, scene, origin_color3fv );
 	} else if ( name == "bhkPackedNiTriStripsShape" || name == "hkPackedNiTriStripsData" ) {
-		if ( Node::SELECTING ) {
-			int s_nodeId = ID2COLORKEY( nif->getBlockNumber( iShape ) );
-			glColor4ubv( (GLubyte *)&s_nodeId );
-		}
+		scene->collisionGeometry( nif, iShape ).draw( scene->renderer->fn, nif->getBlockNumber( iShape ), Node::SELECTING );
 
 		QModelIndex iData = nif->getBlockIndex( nif->getLink( iShape, "Data" ) );
 
-		if ( iData.isValid() ) {
+		if ( iData.isValid() && !Node::SELECTING && ( scene->currentBlock == iData || scene->currentBlock == iShape ) ) {
 			QVector<Vector3> verts = nif->getArray<Vector3>( iData, "Vertices" );
 			QModelIndex iTris = nif->getIndex( iData, "Triangles" );
 
-			for ( int t = 0; t < nif->rowCount( iTris ); t++ ) {
-				Triangle tri = nif->get<Triangle>( QModelIndex_child( iTris, t ), "Triangle" );
-
-				if ( tri[0] != tri[1] || tri[1] != tri[2] || tri[2] != tri[0] ) {
-					glBegin( GL_LINE_STRIP );
-					glVertex( verts.value( tri[0] ) );
-					glVertex( verts.value( tri[1] ) );
-					glVertex( verts.value( tri[2] ) );
-					glVertex( verts.value( tri[0] ) );
-					glEnd();
-				}
-			}
-
 			// Handle Selection of hkPackedNiTriStripsData
 			if ( scene->currentBlock == iData ) {
 				int i = -1;
@@ -1009,20 +929,7 @@ void drawHvkShape( const NifModel * nif, const QModelIndex & iShape, QStack<QMod
 			}
 		}
 	} else if ( name == "bhkCompressedMeshShape" ) {
-		if ( Node::SELECTING ) {
-			int s_nodeId = ID2COLORKEY( nif->getBlockNumber( iShape ) );
-			glColor4ubv( (GLubyte *)&s_nodeId );
-		}
-
-		drawCMS( nif, iShape );
-
-		//if ( Options::getHavokState() == HAVOK_SOLID ) {
-		//	QColor c = Options::hlColor();
-		//	c.setAlphaF( 0.3 );
-		//	glColor( Color4( c ) );
-		//
-		//	drawCMS( nif, iShape, true );
-		//}
+		scene->collisionGeometry( nif, iShape ).draw( scene->renderer->fn, nif->getBlockNumber( iShape ), Node::SELECTING );
 	}
 
 	stack.pop();
@@ -1800,9 +1707,25 @@ void Node::drawFurn()
 	glPopMatrix();
 }
 
+void Node::updateCullBounds()
+{
+	cullBounds = BoundSphere();
+	cullShapes = 0;
+	cullable = true;
+
+	for ( Node * node : children.list() ) {
+		node->updateCullBounds();
+		cullShapes += node->cullShapes;
+		if ( node->cullable )
+			cullBounds |= node->cullBounds;
+		else
+			cullable = false;
+	}
+}
+
 void Node::drawShapes( NodeList * secondPass )
 {
-	if ( isHidden() )
+	if ( isHidden() || scene->isCulled( this ) )
 		return;
 
 	if ( presorted )
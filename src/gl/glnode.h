@@ -35,6 +35,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gl/icontrollable.h" // Inherited
 #include "gl/glproperty.h"
+#include "gl/gltools.h"
 
 #include <QList>
 #include <QPersistentModelIndex>
@@ -82,6 +83,7 @@ class Node : public IControllable
 	friend class VisibilityController;
 	friend class NodeList;
 	friend class LODNode;
+	friend class Scene;
 
 	typedef union
 	{
@@ -108,6 +110,8 @@ public:
 	// end IControllable
 
 	virtual void transformShapes();
+	//! Refits cullBounds bottom up after the transforms have changed, see Scene::transform()
+	virtual void updateCullBounds();
 
 	virtual void draw();
 	virtual void drawShapes( NodeList * secondPass = nullptr );
@@ -173,6 +177,13 @@ protected:
 
 	bool presorted = false;
 
+	//! World space bounds of the shapes in the subtree, used for view frustum culling
+	BoundSphere cullBounds;
+	//! Number of shapes in the subtree
+	int cullShapes = 0;
+	//! False if the subtree draws something cullBounds does not cover
+	bool cullable = false;
+
 	int nodeId;
 	int ref;
 };
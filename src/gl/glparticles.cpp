@@ -36,6 +36,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "gl/glscene.h"
 #include "model/nifmodel.h"
 
+#include <algorithm>
 #include <math.h>
 
 
@@ -50,6 +51,9 @@ void Particles::clear()
 	verts.clear();
 	colors.clear();
 	transVerts.clear();
+	quadVerts.clear();
+	quadCoords.clear();
+	quadColors.clear();
 }
 
 void Particles::updateImpl( const NifModel * nif, const QModelIndex & index )
@@ -126,9 +130,17 @@ BoundSphere Particles::bounds() const
 	return worldTrans() * sphere | Node::bounds();
 }
 
+void Particles::updateCullBounds()
+{
+	// Particles may be simulated in the space of another node, they are never culled
+	cullBounds = BoundSphere();
+	cullShapes = 1;
+	cullable = false;
+}
+
 void Particles::drawShapes( NodeList * secondPass )
 {
-	if ( isHidden() )
+	if ( isHidden() || scene->isCulled( this ) )
 		return;
 
 	AlphaProperty * aprop = findProperty<AlphaProperty>();
@@ -194,32 +206,50 @@ void Particles::drawShapes( NodeList * secondPass )
 	 */
 
 	static const Vector2 tex[4] = {
-		Vector2( 1.0, 1.0 ), Vector2( 0.0, 1.0 ), Vector2( 1.0, 0.0 ), Vector2( 0.0, 0.0 )
+		Vector2( 1.0, 1.0 ), Vector2( 0.0, 1.0 ), Vector2( 0.0, 0.0 ), Vector2( 1.0, 0.0 )
 	};
 
-	int p = 0;
-	for ( Vector3 v : transVerts ) {
-		if ( p >= active )
-			break;
-
-		GLfloat s2 = ( sizes.count() > p ? sizes[ p ] * size : size );
-		s2 *= worldTrans().scale;
-
-		glBegin( GL_TRIANGLE_STRIP );
+	// Build all the billboards as quads and draw them in one call
+	int numParticles = std::min( active, int( transVerts.count() ) );
+	if ( numParticles <= 0 )
+		return;
+	bool useColors = ( colors.count() >= numParticles );
+
+	quadVerts.resize( numParticles * 4 );
+	quadCoords.resize( numParticles * 4 );
+	if ( useColors )
+		quadColors.resize( numParticles * 4 );
+
+	float scale = worldTrans().scale;
+	for ( int p = 0; p < numParticles; p++ ) {
+		const Vector3 & v = transVerts[p];
+		GLfloat s2 = ( sizes.count() > p ? sizes[ p ] * size : size ) * scale;
+
+		quadVerts[p * 4] = v + Vector3( +s2, +s2, 0 );
+		quadVerts[p * 4 + 1] = v + Vector3( -s2, +s2, 0 );
+		quadVerts[p * 4 + 2] = v + Vector3( -s2, -s2, 0 );
+		quadVerts[p * 4 + 3] = v + Vector3( +s2, -s2, 0 );
+		for ( int i = 0; i < 4; i++ ) {
+			quadCoords[p * 4 + i] = tex[i];
+			if ( useColors )
+				quadColors[p * 4 + i] = colors[p];
+		}
+	}
 
-		if ( p < colors.count() )
-			glColor( colors[ p ] );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, 0, quadVerts.constData() );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glTexCoordPointer( 2, GL_FLOAT, 0, quadCoords.constData() );
+	if ( useColors ) {
+		glEnableClientState( GL_COLOR_ARRAY );
+		glColorPointer( 4, GL_FLOAT, 0, quadColors.constData() );
+	}
 
-		glTexCoord( tex[0] );
-		glVertex( v + Vector3( +s2, +s2, 0 ) );
-		glTexCoord( tex[1] );
-		glVertex( v + Vector3( -s2, +s2, 0 ) );
-		glTexCoord( tex[2] );
-		glVertex( v + Vector3( +s2, -s2, 0 ) );
-		glTexCoord( tex[3] );
-		glVertex( v + Vector3( -s2, -s2, 0 ) );
-		glEnd();
+	glDrawArrays( GL_QUADS, 0, numParticles * 4 );
+	scene->countDrawCall( numParticles * 2 );
 
-		p++;
-	}
+	if ( useColors )
+		glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
 }
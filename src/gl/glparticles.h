@@ -52,6 +52,7 @@ public:
 	void transform() override;
 
 	void transformShapes() override;
+	void updateCullBounds() override;
 
 	void drawShapes( NodeList * secondPass = nullptr ) override;
 
@@ -69,6 +70,11 @@ protected:
 	QVector<float> sizes;
 	QVector<Vector3> transVerts;
 
+	//! Billboard vertex arrays rebuilt by drawShapes()
+	QVector<Vector3> quadVerts;
+	QVector<Vector2> quadCoords;
+	QVector<Color4> quadColors;
+
 	int active = 0;
 	float size = 0;
 };
@@ -839,8 +839,6 @@ void glProperty( StencilProperty * p )
 
 BSShaderLightingProperty::~BSShaderLightingProperty()
 {
-	if ( material )
-		delete material;
 }
 
 void BSShaderLightingProperty::updateImpl( const NifModel * nif, const QModelIndex & index )
@@ -898,16 +896,11 @@ void BSShaderLightingProperty::clear()
 	sfMaterialPath.clear();
 }
 
-void BSShaderLightingProperty::setMaterial( Material * newMaterial )
+void BSShaderLightingProperty::setMaterial( std::shared_ptr< Material > newMaterial )
 {
-	if (newMaterial && !newMaterial->isValid()) {
-		delete newMaterial;
-		newMaterial = nullptr;
-	}
-	if ( material && material != newMaterial ) {
-		delete material;
-	}
-	material = newMaterial;
+	if ( newMaterial && !newMaterial->isValid() )
+		newMaterial.reset();
+	material = std::move( newMaterial );
 }
 
 void BSShaderLightingProperty::setSFMaterial( const QString & mat_name )
@@ -921,9 +914,15 @@ void BSShaderLightingProperty::loadSFMaterial()
 {
 	sf_material = nullptr;
 	sf_material_valid = false;
-	try {
-		CE2MaterialDB *	materials = Game::GameManager::materials( Game::STARFIELD );
-		if ( materials ) {
+	CE2MaterialDB *	materials = Game::GameManager::loaded_materials( Game::STARFIELD );
+	if ( !materials ) {
+		// Render with the error material while the database is loading in the background,
+		// the material is loaded again when the database ID changes
+		if ( Game::GameManager::preload_materials( Game::STARFIELD ) )
+			return;
+		sfMaterialDB_ID = Game::GameManager::get_material_db_id();
+	} else {
+		try {
 			if ( !sfMaterialPath.empty() ) {
 				sf_material = materials->loadMaterial( sfMaterialPath );
 				sf_material_valid = bool( sf_material );
@@ -931,12 +930,12 @@ void BSShaderLightingProperty::loadSFMaterial()
 			if ( !sf_material_valid )
 				sf_material = materials->loadMaterial( std::string("materials/test/generic/test_generic_white.mat") );
 			sfMaterialDB_ID = Game::GameManager::get_material_db_id();
+		} catch ( std::exception& e ) {
+			sf_material = nullptr;
+			sf_material_valid = false;
+			sfMaterialDB_ID = Game::GameManager::get_material_db_id();
+			QMessageBox::critical( nullptr, "NifSkope error", QString("Error loading material '%1': %2" ).arg( sfMaterialPath.c_str() ).arg( e.what() ) );
 		}
-	} catch ( std::exception& e ) {
-		sf_material = nullptr;
-		sf_material_valid = false;
-		sfMaterialDB_ID = Game::GameManager::get_material_db_id();
-		QMessageBox::critical( nullptr, "NifSkope error", QString("Error loading material '%1': %2" ).arg( sfMaterialPath.c_str() ).arg( e.what() ) );
 	}
 	const NifModel * nif = NifModel::fromValidIndex( iBlock );
 	const_cast< NifModel * >(nif)->loadSFMaterial( iBlock, ( sf_material_valid ? sf_material : nullptr ) );
@@ -1039,7 +1038,7 @@ QString BSShaderLightingProperty::fileName( int id ) const
 	// Fallout 4 or 76 BGSM file
 	if ( bsVersion >= 130 && material && typeid(*material) == typeid(ShaderMaterial) ) {
 		// BSLSP
-		auto m = static_cast<ShaderMaterial *>(material);
+		auto m = static_cast<ShaderMaterial *>(material.get());
 		if ( m->isValid() ) {
 			auto tex = m->textures();
 			if ( tex.count() >= BGSM1_MAX ) {
@@ -1095,7 +1094,7 @@ QString BSShaderLightingProperty::fileName( int id ) const
 			return QString();
 	} else if ( bsVersion >= 130 && material && typeid(*material) == typeid(EffectMaterial) ) {
 		// From Fallout 4 or 76 effect material file
-		auto m = static_cast<EffectMaterial*>(material);
+		auto m = static_cast<EffectMaterial*>(material.get());
 		if ( m->isValid() ) {
 			auto tex = m->textures();
 			if ( id == 6 || id == 7 )
@@ -1203,9 +1202,9 @@ void BSLightingShaderProperty::updateImpl( const NifModel * nif, const QModelInd
 
 	if ( index == iBlock ) {
 		if ( name.endsWith(".bgsm", Qt::CaseInsensitive) && bsVersion < 160 ) {
-			setMaterial( new ShaderMaterial(name, scene->game) );
+			setMaterial( MaterialCache::get( name, scene->game ) );
 			if ( bsVersion >= 151 )
-				const_cast< NifModel * >(nif)->loadFO76Material( index, material );
+				const_cast< NifModel * >(nif)->loadFO76Material( index, material.get() );
 		} else {
 			setMaterial( nullptr );
 		}
@@ -1287,7 +1286,7 @@ void BSLightingShaderProperty::updateParams( const NifModel * nif )
 	}
 	isVertexAlphaAnimation = hasSF2(ShaderFlags::SLSF2_Tree_Anim);
 
-	ShaderMaterial * m = ( material && material->isValid() ) ? static_cast<ShaderMaterial*>(material) : nullptr;
+	ShaderMaterial * m = ( material && material->isValid() ) ? static_cast<ShaderMaterial*>(material.get()) : nullptr;
 	if ( m ) {
 		alpha = m->fAlpha;
 
@@ -1444,9 +1443,9 @@ void BSEffectShaderProperty::updateImpl( const NifModel * nif, const QModelIndex
 
 	if ( index == iBlock ) {
 		if ( name.endsWith(".bgem", Qt::CaseInsensitive) && bsVersion < 160 ) {
-			setMaterial( new EffectMaterial(name, scene->game) );
+			setMaterial( MaterialCache::get( name, scene->game ) );
 			if ( bsVersion >= 151 )
-				const_cast< NifModel * >(nif)->loadFO76Material( index, material );
+				const_cast< NifModel * >(nif)->loadFO76Material( index, material.get() );
 		} else {
 			setMaterial( nullptr );
 		}
@@ -1499,7 +1498,7 @@ void BSEffectShaderProperty::updateParams( const NifModel * nif )
 	hasVertexColors = hasSF2( ShaderFlags::SLSF2_Vertex_Colors );
 	isVertexAlphaAnimation = hasSF2(ShaderFlags::SLSF2_Tree_Anim);
 
-	EffectMaterial * m = ( material && material->isValid() ) ? static_cast<EffectMaterial*>(material) : nullptr;
+	EffectMaterial * m = ( material && material->isValid() ) ? static_cast<EffectMaterial*>(material.get()) : nullptr;
 	if ( m ) {
 		hasSourceTexture = !m->textureList[0].isEmpty();
 		hasGreyscaleMap = !m->textureList[1].isEmpty();
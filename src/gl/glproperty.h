@@ -702,7 +702,7 @@ public:
 	UVOffset uvOffset;
 	TexClampMode clampMode = CLAMP_S_CLAMP_T;
 
-	Material * getMaterial() const { return material; }
+	Material * getMaterial() const { return material.get(); }
 	inline bool getSFMaterial( const CE2Material *& m )
 	{
 		if ( sfMaterialDB_ID != Game::GameManager::get_material_db_id() ) [[unlikely]]
@@ -719,12 +719,12 @@ protected:
 	QPersistentModelIndex	iTextureSet;
 	QPersistentModelIndex	iSPData;
 
-	Material * material = nullptr;
+	std::shared_ptr< Material >	material;
 	const CE2Material *	sf_material = nullptr;
 	std::uintptr_t	sfMaterialDB_ID = 0;
 	bool	sf_material_valid = false;
 	std::string	sfMaterialPath;
-	void setMaterial( Material * newMaterial );
+	void setMaterial( std::shared_ptr< Material > newMaterial );
 	void setSFMaterial( const QString & mat_name );
 	void loadSFMaterial();
 
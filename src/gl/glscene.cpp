@@ -40,13 +40,18 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "gl/BSMesh.h"
 #include "gl/glparticles.h"
 #include "gl/gltex.h"
+#include "io/material.h"
 #include "model/nifmodel.h"
+#include "trace.h"
 
 #include <QAction>
+#include <QElapsedTimer>
 #include <QOpenGLContext>
 #include <QOpenGLFunctions>
 #include <QSettings>
 
+#include <algorithm> // std::stable_sort
+
 
 //! \file glscene.cpp %Scene management
 
@@ -100,6 +105,10 @@ Scene::Scene( TexCache * texcache, QOpenGLContext * context, QOpenGLFunctions *
 
 Scene::~Scene()
 {
+	dropCollisionGeometry();
+	if ( !hvkReleased.isEmpty() && QOpenGLContext::currentContext() )
+		renderer->fn->glDeleteBuffers( hvkReleased.count(), hvkReleased.constData() );
+
 	delete renderer;
 }
 
@@ -108,18 +117,22 @@ void Scene::updateShaders()
 	renderer->updateShaders();
 }
 
-void Scene::clear( [[maybe_unused]] bool flushTextures )
+void Scene::clear( bool flushTextures )
 {
 	nodes.clear();
 	properties.clear();
 	roots.clear();
 	shapes.clear();
+	dropCollisionGeometry();
 
 	animGroups.clear();
 	animTags.clear();
 
-	//if ( flushTextures )
-	textures->flush();
+	// Textures loaded from files can be kept for the next model, see Thumbnailer
+	if ( flushTextures )
+		textures->flush();
+	else
+		textures->flushEmbedded();
 
 	sceneBoundsValid = timeBoundsValid = false;
 
@@ -128,6 +141,8 @@ void Scene::clear( [[maybe_unused]] bool flushTextures )
 
 void Scene::update( const NifModel * nif, const QModelIndex & index )
 {
+	TRACE_ZONE( "Scene::update" );
+
 	if ( !nif )
 		return;
 
@@ -136,12 +151,16 @@ void Scene::update( const NifModel * nif, const QModelIndex & index )
 		if ( !block.isValid() )
 			return;
 
+		dropCollisionGeometry( nif->getBlockNumber( block ) );
+
 		for ( Property * prop : properties.list() )
 			prop->update( nif, block );
 
 		for ( Node * node : nodes.list() )
 			node->update( nif, block );
 	} else {
+		dropCollisionGeometry();
+
 		properties.validate();
 		nodes.validate();
 
@@ -203,17 +222,74 @@ void Scene::updateLodLevel( int level )
 	lodLevel = LodLevel( level );
 }
 
+void Scene::prefetchMaterials( const NifModel * nif )
+{
+	// Parse the BGSM/BGEM files of all shader properties in parallel before the properties are updated
+	QStringList	names;
+	for ( int b = 0; b < nif->getBlockCount(); b++ ) {
+		const NifItem *	block = nif->getBlockItem( b, { "BSLightingShaderProperty", "BSEffectShaderProperty" } );
+		if ( !block )
+			continue;
+		QString	name = nif->get<QString>( block, "Name" );
+		if ( name.endsWith( ".bgsm", Qt::CaseInsensitive ) || name.endsWith( ".bgem", Qt::CaseInsensitive ) )
+			names.append( name );
+	}
+	names.removeDuplicates();
+	MaterialCache::prefetch( names, game );
+}
+
+void Scene::resolveTextures( const NifModel * nif )
+{
+	// Look up the texture paths of the whole scene at once instead of one by one on first draw
+	static const char *	effectTextures[] = {
+		"Source Texture", "Greyscale Texture", "Env Map Texture", "Normal Texture",
+		"Env Mask Texture", "Reflectance Texture", "Lighting Texture", "Emit Gradient Texture"
+	};
+	QStringList	names;
+	for ( int b = 0; b < nif->getBlockCount(); b++ ) {
+		const NifItem *	block = nif->getBlockItem( b );
+		if ( !block )
+			continue;
+		if ( nif->isNiBlock( block, "BSShaderTextureSet" ) ) {
+			for ( const auto & t : nif->getArray<QString>( block, "Textures" ) )
+				names.append( t );
+		} else if ( nif->isNiBlock( block, "NiSourceTexture" ) ) {
+			names.append( nif->get<QString>( block, "File Name" ) );
+		} else if ( nif->isNiBlock( block, { "BSLightingShaderProperty", "BSEffectShaderProperty" } ) ) {
+			QString	name = nif->get<QString>( block, "Name" );
+			if ( name.endsWith( ".bgsm", Qt::CaseInsensitive ) || name.endsWith( ".bgem", Qt::CaseInsensitive ) ) {
+				if ( auto m = MaterialCache::get( name, game ); m )
+					names.append( m->textures() );
+			}
+			if ( nif->isNiBlock( block, "BSEffectShaderProperty" ) ) {
+				for ( const char * t : effectTextures )
+					names.append( nif->get<QString>( block, t ) );
+			}
+		}
+	}
+	TexCache::resolve( names, game );
+}
+
 void Scene::make( NifModel * nif, bool flushTextures )
 {
+	TRACE_ZONE( "Scene::make", nif ? nif->getFilename() : QString() );
+
 	clear( flushTextures );
 
 	if ( !nif )
 		return;
 
 	game = Game::GameManager::get_game(nif->getVersionNumber(), nif->getUserVersion(), nif->getBSVersion());
+	if ( game == Game::STARFIELD )
+		Game::GameManager::preload_materials( game, this, [this]() { emit sceneUpdated(); } );
+	else if ( nif->getBSVersion() >= 130 )
+		prefetchMaterials( nif );
 
 	update( nif, QModelIndex() );
 
+	if ( game != Game::STARFIELD )
+		resolveTextures( nif );
+
 	if ( !animGroups.contains( animGroup ) ) {
 		if ( animGroups.isEmpty() )
 			animGroup = QString();
@@ -307,6 +383,8 @@ void Scene::setSequence( const QString & seqname )
 
 void Scene::transform( const Transform & trans, float time )
 {
+	TRACE_ZONE( "Scene::transform" );
+
 	view = trans;
 	this->time = time;
 
@@ -314,15 +392,28 @@ void Scene::transform( const Transform & trans, float time )
 	viewTrans.clear();
 	bhkBodyTrans.clear();
 
+	QElapsedTimer timer;
+	timer.start();
+
 	for ( Property * prop : properties.list() ) {
 		prop->transform();
 	}
 	for ( Node * node : roots.list() ) {
 		node->transform();
 	}
+
+	qint64 shapesStart = timer.nsecsElapsed();
 	for ( Node * node : roots.list() ) {
 		node->transformShapes();
 	}
+	qint64 shapesEnd = timer.nsecsElapsed();
+
+	for ( Node * node : roots.list() ) {
+		node->updateCullBounds();
+	}
+
+	transformStats.skinning = shapesEnd - shapesStart;
+	transformStats.transform = timer.nsecsElapsed() - transformStats.skinning;
 
 	sceneBoundsValid = false;
 
@@ -331,6 +422,8 @@ void Scene::transform( const Transform & trans, float time )
 
 void Scene::draw()
 {
+	int programSwitches = renderer->programSwitches;
+
 	drawShapes();
 
 	if ( hasOption(ShowNodes) )
@@ -341,16 +434,23 @@ void Scene::draw()
 		drawFurn();
 
 	drawSelection();
+
+	drawStats.programSwitches = renderer->programSwitches - programSwitches;
 }
 
 void Scene::drawShapes()
 {
+	drawStats = DrawStats();
+
 	if ( hasOption(DoBlending) ) {
 		NodeList secondPass;
 
+		queueShapes = true;
 		for ( Node * node : roots.list() ) {
 			node->drawShapes( &secondPass );
 		}
+		queueShapes = false;
+		drawQueuedShapes();
 
 		if ( secondPass.list().count() > 0 )
 			drawSelection(); // for transparency pass
@@ -361,12 +461,74 @@ void Scene::drawShapes()
 			node->drawShapes();
 		}
 	} else {
+		queueShapes = true;
 		for ( Node * node : roots.list() ) {
 			node->drawShapes();
 		}
+		queueShapes = false;
+		drawQueuedShapes();
 	}
 }
 
+bool Scene::isCulled( const Node * node )
+{
+	// Only the scene traversal culls, queued and translucent shapes have already been tested
+	if ( !queueShapes )
+		return false;
+
+	if ( frustum.isValid() && node->cullable && !frustum.intersects( view * node->cullBounds ) ) {
+		drawStats.culled += node->cullShapes;
+		return true;
+	}
+
+	if ( node->children.list().isEmpty() )
+		drawStats.drawn += node->cullShapes;
+
+	return false;
+}
+
+void Scene::flushDrawQueue()
+{
+	if ( drawQueue.isEmpty() )
+		return;
+
+	// The queued shapes have already been culled and must not queue themselves again
+	queueShapes = false;
+	drawQueuedShapes();
+	queueShapes = true;
+}
+
+void Scene::drawQueuedShapes()
+{
+	if ( drawQueue.isEmpty() )
+		return;
+
+	// Sort by program, then by texture set, keeping tree order within each group.
+	// The keys are computed once, the shader name hash is not cheap enough for the comparator.
+	QVector<QPair<quint64, Shape *>> sorted;
+	sorted.reserve( drawQueue.count() );
+	for ( Shape * shape : drawQueue )
+		sorted.append( { shape->drawState(), shape } );
+	drawQueue.clear();
+
+	std::stable_sort( sorted.begin(), sorted.end(),
+		[]( const QPair<quint64, Shape *> & a, const QPair<quint64, Shape *> & b ) {
+			return a.first < b.first;
+		}
+	);
+
+	// Consecutive shapes sharing a program keep it bound, vertex selection draws with fixed function in between
+	bool batch = !Node::SELECTING && !isSelModeVertex();
+	if ( batch )
+		renderer->beginBatch();
+
+	for ( const auto & p : sorted )
+		p.second->drawShapes();
+
+	if ( batch )
+		renderer->endBatch();
+}
+
 void Scene::drawNodes()
 {
 	for ( Node * node : roots.list() ) {
@@ -376,6 +538,11 @@ void Scene::drawNodes()
 
 void Scene::drawHavok()
 {
+	if ( !hvkReleased.isEmpty() ) {
+		renderer->fn->glDeleteBuffers( hvkReleased.count(), hvkReleased.constData() );
+		hvkReleased.clear();
+	}
+
 	for ( Node * node : roots.list() ) {
 		node->drawHavok();
 	}
@@ -398,6 +565,31 @@ void Scene::drawSelection() const
 	}
 }
 
+CollisionGeometry & Scene::collisionGeometry( const NifModel * nif, const QModelIndex & iShape ) const
+{
+	int block = nif->getBlockNumber( iShape );
+
+	auto it = hvkGeometry.find( block );
+	if ( it == hvkGeometry.end() ) {
+		it = hvkGeometry.insert( block, CollisionGeometry() );
+		buildCollisionGeometry( it.value(), nif, iShape );
+	}
+
+	return it.value();
+}
+
+void Scene::dropCollisionGeometry( int block ) const
+{
+	for ( auto it = hvkGeometry.begin(); it != hvkGeometry.end(); ) {
+		if ( block < 0 || it.value().sources.contains( block ) ) {
+			it.value().releaseBuffers( hvkReleased );
+			it = hvkGeometry.erase( it );
+		} else {
+			++it;
+		}
+	}
+}
+
 BoundSphere Scene::bounds() const
 {
 	if ( !sceneBoundsValid ) {
@@ -81,6 +81,11 @@ public:
 	void drawFurn();
 	void drawSelection() const;
 
+	//! Returns the cached geometry of a collision shape, building it on first use
+	CollisionGeometry & collisionGeometry( const NifModel * nif, const QModelIndex & iShape ) const;
+	//! Drops the cached collision geometry built from a block, or all of it for -1
+	void dropCollisionGeometry( int block = -1 ) const;
+
 	void setSequence( const QString & seqname );
 
 	QString textStats();
@@ -121,15 +126,19 @@ public:
 
 	inline int bindTexture( const QString & fname, bool useSecondTexture = false, bool forceTexturing = false )
 	{
-		if ( ( forceTexturing || hasOption(DoTexturing) ) && !fname.isEmpty() ) [[likely]]
+		if ( ( forceTexturing || hasOption(DoTexturing) ) && !fname.isEmpty() ) [[likely]] {
+			drawStats.textureBinds++;
 			return textures->bind( fname, game, useSecondTexture );
+		}
 		return 0;
 	}
 
 	inline int bindTexture( const QModelIndex & iSource )
 	{
-		if ( hasOption(DoTexturing) && iSource.isValid() ) [[likely]]
+		if ( hasOption(DoTexturing) && iSource.isValid() ) [[likely]] {
+			drawStats.textureBinds++;
 			return textures->bind( iSource, game );
+		}
 		return 0;
 	}
 
@@ -198,6 +207,48 @@ public:
 
 	QVector<Shape *> shapes;
 
+	//! Whether drawShapes() is traversing the scene, collecting opaque shapes in drawQueue
+	//! (see Shape::queueDraw()) and culling nodes outside the frustum
+	bool queueShapes = false;
+	//! Opaque shapes of the current drawShapes() call, drawn sorted by render state
+	QVector<Shape *> drawQueue;
+	//! Draws the queued shapes now, before a shape that cannot be queued, to keep the tree order
+	void flushDrawQueue();
+
+	//! View frustum in eye coordinates, set by GLView::glProjection()
+	Frustum frustum;
+
+	//! Shape and call counts of the last drawShapes() call, draw() also counts the nodes, collision and markers
+	struct DrawStats
+	{
+		int drawn = 0;
+		int culled = 0;
+		//! Shape draw calls, see countDrawCall()
+		int drawCalls = 0;
+		qint64 triangles = 0;
+		int textureBinds = 0;
+		int programSwitches = 0;
+	} drawStats;
+
+	//! CPU times of the last transform() call in nanoseconds
+	struct TransformStats
+	{
+		//! Properties, nodes and cull bounds
+		qint64 transform = 0;
+		//! Node::transformShapes(), which updates the skinned and morphed vertices
+		qint64 skinning = 0;
+	} transformStats;
+
+	//! Adds a draw call of a shape to drawStats
+	inline void countDrawCall( qint64 triangles )
+	{
+		drawStats.drawCalls++;
+		drawStats.triangles += triangles;
+	}
+
+	//! Returns true if a node's subtree is outside the view frustum and should not be drawn
+	bool isCulled( const Node * node );
+
 	BoundSphere bounds() const;
 
 	float timeMin() const;
@@ -217,7 +268,18 @@ protected:
 	mutable BoundSphere bndSphere;
 	mutable float tMin = 0, tMax = 0;
 
+	//! Collision shape geometry by shape block number, see collisionGeometry()
+	mutable QHash<int, CollisionGeometry> hvkGeometry;
+	//! Vertex buffers of dropped collision geometry, deleted in drawHavok()
+	mutable QVector<GLuint> hvkReleased;
+
 	void updateTimeBounds() const;
+	//! Draw the shapes collected in drawQueue, grouped by program and textures
+	void drawQueuedShapes();
+	//! Start parsing the BGSM/BGEM materials referenced by nif, see MaterialCache::prefetch()
+	void prefetchMaterials( const NifModel * nif );
+	//! Resolve the texture paths referenced by nif in one batch, see TexCache::resolve()
+	void resolveTextures( const NifModel * nif );
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( Scene::SceneOptions )
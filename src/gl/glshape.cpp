@@ -134,9 +134,58 @@ void Shape::updateImpl( const NifModel * nif, const QModelIndex & index )
 		needUpdateData = true;
 
 	} else if ( (bssp && bssp->isParamBlock(index)) || (alphaProperty && index == alphaProperty->index()) ) {
+		shader = ""; // Shader flags may have changed, reassess conditions
 		updateShader();
 
+	} else if ( index == iData || isPropertyBlock( index ) ) {
+		shader = "";
+
+	}
+}
+
+void Shape::updateCullBounds()
+{
+	// Skinned vertices are not covered by the bounds of the shape's own transform
+	cullable = !( isSkinned && scene->hasOption(Scene::DoSkinning) );
+	cullBounds = ( cullable ? bounds() : BoundSphere() );
+	cullShapes = 1;
+}
+
+bool Shape::queueDraw()
+{
+	if ( !scene->queueShapes )
+		return false;
+
+	// Presorted shapes and shapes without depth testing depend on the tree order,
+	// so the opaque shapes before them are drawn first
+	if ( isPresorted() || !depthTest || !depthWrite ) {
+		scene->flushDrawQueue();
+		return false;
+	}
+
+	scene->drawQueue.append( this );
+	return true;
+}
+
+quint64 Shape::drawState() const
+{
+	// Shapes sharing a material, shader property or texturing property bind the same textures
+	const void * textures = nullptr;
+	if ( bssp )
+		textures = bssp->getMaterial() ? static_cast<const void *>( bssp->getMaterial() ) : bssp;
+	else
+		textures = findProperty<TexturingProperty>();
+
+	return ( quint64( qHash( shader ) ) << 32 ) | quint64( qHash( quintptr( textures ) ) );
+}
+
+bool Shape::isPropertyBlock( const QModelIndex & index ) const
+{
+	for ( Property * p : properties.list() ) {
+		if ( p->index() == index )
+			return true;
 	}
+	return false;
 }
 
 void Shape::boneSphere( const NifModel * nif, const QModelIndex & index ) const
@@ -60,9 +60,14 @@ public:
 
 	// end IControllable
 
+	void updateCullBounds() override;
+
 	virtual void drawVerts() const {};
 	virtual QModelIndex vertexAt( int ) const { return QModelIndex(); };
 
+	//! Sort key of the program and textures the shape was last drawn with, see Scene::drawShapes()
+	quint64 drawState() const;
+
 protected:
 	int shapeNumber;
 
@@ -160,6 +165,10 @@ protected:
 	bool translucent = false;
 
 	void updateShader();
+	//! Adds the shape to the scene's draw queue if it is collecting opaque shapes
+	bool queueDraw();
+	//! Returns true if index is the block of one of the properties attached to the shape
+	bool isPropertyBlock( const QModelIndex & index ) const;
 
 	mutable BoundSphere boundSphere;
 	mutable bool needUpdateBounds = false;
@@ -38,15 +38,20 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "model/nifmodel.h"
 
 #include "gamemanager.h"
+#include "trace.h"
 
 #include <QDebug>
 #include <QDir>
 #include <QListView>
+#include <QMutex>
+#include <QSet>
 #include <QOpenGLContext>
 #include <QOpenGLFunctions>
 #include <QSettings>
+#include <QThread>
 
 #include <algorithm>
+#include <unordered_map>
 
 
 //! @file gltex.cpp TexCache management
@@ -109,12 +114,34 @@ void initializeTextureUnits( const QOpenGLContext * context )
 	initializeTextureLoaders( context );
 }
 
+//! One past the highest texture unit activated since the last full reset of the current context
+/*!
+ * Each GLView and the offscreen contexts of the thumbnailer and benchmark have their own texture
+ * units, so the count is kept per context. A context that was not seen yet starts with all units.
+ */
+static int & texUnitsUsed()
+{
+	thread_local std::unordered_map<const QOpenGLContext *, int> used;
+	thread_local const QOpenGLContext * lastContext = nullptr;
+	thread_local int * last = nullptr;
+
+	const QOpenGLContext * context = QOpenGLContext::currentContext();
+	if ( !last || context != lastContext ) {
+		last = &used.try_emplace( context, 32 ).first->second;
+		lastContext = context;
+	}
+	return *last;
+}
+
 bool activateTextureUnit( int stage, bool noClient )
 {
 	if ( TexCache::num_texture_units <= 1 )
 		return ( stage == 0 );
 
 	if ( stage < TexCache::num_texture_units ) {
+		int & unitsUsed = texUnitsUsed();
+		if ( stage >= unitsUsed )
+			unitsUsed = stage + 1;
 
 		glActiveTexture( GL_TEXTURE0 + stage );
 		if ( stage < TexCache::num_txtunits_client && !noClient )
@@ -132,7 +159,13 @@ void resetTextureUnits( int numTex )
 		return;
 	}
 
-	for ( int x = std::min( numTex, TexCache::num_texture_units ); --x >= 0; ) {
+	// Units above texUnitsUsed() have not been touched since they were last reset
+	int & unitsUsed = texUnitsUsed();
+	int n = std::min( std::min( numTex, unitsUsed ), TexCache::num_texture_units );
+	if ( numTex >= unitsUsed )
+		unitsUsed = 1;
+
+	for ( int x = n; --x >= 0; ) {
 		glActiveTexture( GL_TEXTURE0 + x );
 		glDisable( GL_TEXTURE_2D );
 		glMatrixMode( GL_TEXTURE );
@@ -159,32 +192,118 @@ TexCache::~TexCache()
 	//flush();
 }
 
-QString TexCache::find( const QString & file, Game::GameMode game )
+/*
+	Texture path resolution
+
+	Results of find(), including misses, are cached by game and normalized path until
+	the archive configuration changes (see Game::GameManager::get_archives_id()).
+*/
+
+namespace
 {
-	if ( file.isEmpty() )
-		return QString();
-	if ( file.startsWith("#") && (file.length() == 9 || file.length() == 10) )
-		return file;
+QMutex	texPathCacheMutex;
+QHash<QString, QString>	texPathCache;
+std::uintptr_t	texPathCacheArchivesID = 0;
+bool	texPathAlternateExtensions = false;
 
-	QString filename( file );
+// Must be called with texPathCacheMutex locked
+void checkTexPathCache()
+{
+	std::uintptr_t	archivesID = Game::GameManager::get_archives_id();
+	if ( archivesID != texPathCacheArchivesID ) [[unlikely]] {
+		texPathCache.clear();
+		texPathCacheArchivesID = archivesID;
+		QSettings settings;
+		texPathAlternateExtensions = settings.value( "Settings/Resources/Alternate Extensions", false ).toBool();
+	}
+}
 
+QString texPathCacheKey( const QString & file, Game::GameMode game )
+{
+	QString	key( QChar( ushort( game ) ) );
+	key += file.toLower().replace( '\\', '/' );
+	return key;
+}
+
+// Search the archives for the texture, returns an empty string if it is not found
+QString findTexturePath( const QString & file, Game::GameMode game, bool alternateExtensions )
+{
 	static const char *	extensions[6] = {
 		".dds", ".tga", ".png", ".bmp", ".nif", ".texcache"
 	};
 
 	// attempt to find the texture with one of the extensions
-	for ( size_t i = 0; i < 6; i++ ) {
-		QString	fullPath( Game::GameManager::find_file(game, filename, "textures", extensions[i]) );
+	for ( size_t i = 0; i < ( alternateExtensions ? 6 : 1 ); i++ ) {
+		QString	fullPath( Game::GameManager::find_file(game, file, "textures", extensions[i]) );
 		if ( !fullPath.isEmpty() )
 			return fullPath;
-		if ( i == 0 ) {
-			QSettings settings;
-			if ( !settings.value( "Settings/Resources/Alternate Extensions", false ).toBool() )
-				break;
+	}
+	return QString();
+}
+
+bool isTexturePathLiteral( const QString & file )
+{
+	return file.isEmpty() || ( file.startsWith("#") && (file.length() == 9 || file.length() == 10) );
+}
+}
+
+QString TexCache::find( const QString & file, Game::GameMode game )
+{
+	if ( isTexturePathLiteral( file ) )
+		return file;
+
+	QString	key = texPathCacheKey( file, game );
+	bool	alternateExtensions;
+	{
+		QMutexLocker	locker( &texPathCacheMutex );
+		checkTexPathCache();
+		auto	i = texPathCache.constFind( key );
+		if ( i != texPathCache.cend() )
+			return ( i.value().isEmpty() ? file : i.value() );
+		alternateExtensions = texPathAlternateExtensions;
+	}
+
+	QString	fullPath = findTexturePath( file, game, alternateExtensions );
+	QMutexLocker	locker( &texPathCacheMutex );
+	texPathCache.insert( key, fullPath );
+	return ( fullPath.isEmpty() ? file : fullPath );
+}
+
+void TexCache::resolve( const QStringList & files, Game::GameMode game )
+{
+	QVector<QString>	keys, names;
+	QSet<QString>	pending;
+	bool	alternateExtensions;
+	{
+		QMutexLocker	locker( &texPathCacheMutex );
+		checkTexPathCache();
+		alternateExtensions = texPathAlternateExtensions;
+		for ( const auto & f : files ) {
+			if ( isTexturePathLiteral( f ) )
+				continue;
+			QString	key = texPathCacheKey( f, game );
+			if ( texPathCache.contains( key ) || pending.contains( key ) )
+				continue;
+			pending.insert( key );
+			keys.append( key );
+			names.append( f );
 		}
 	}
+	if ( names.isEmpty() )
+		return;
+
+	// The lookups are hash table lookups under the lock of GameManager, so they are done on this
+	// thread; worker threads would only wait for each other
+	QVector<QString>	results( names.size() );
+	for ( int i = 0; i < names.size(); i++ )
+		results[i] = findTexturePath( names[i], game, alternateExtensions );
 
-	return filename;
+	QMutexLocker	locker( &texPathCacheMutex );
+	// The cache was invalidated while resolving
+	if ( Game::GameManager::get_archives_id() != texPathCacheArchivesID )
+		return;
+	for ( int i = 0; i < keys.size(); i++ )
+		texPathCache.insert( keys[i], results[i] );
 }
 
 /*!
@@ -241,6 +360,8 @@ bool TexCache::isSupported( const QString & filePath )
 
 int TexCache::bind( const QString & fname, Game::GameMode game, bool useSecondTexture )
 {
+	TRACE_ZONE( "TexCache::bind", fname );
+
 	Tex * tx = textures.value( fname );
 	if ( !tx ) [[unlikely]] {
 		tx = new Tex;
@@ -275,6 +396,8 @@ int TexCache::bind( const QString & fname, Game::GameMode game, bool useSecondTe
 
 int TexCache::bind( const QModelIndex & iSource, Game::GameMode game )
 {
+	TRACE_ZONE( "TexCache::bind" );
+
 	auto nif = NifModel::fromValidIndex(iSource);
 	if ( nif ) {
 		if ( nif->get<quint8>( iSource, "Use External" ) == 0 ) {
@@ -293,6 +416,7 @@ int TexCache::bind( const QModelIndex & iSource, Game::GameMode game )
 						glGenTextures( 1, tx->id );
 						glBindTexture( GL_TEXTURE_2D, tx->id[0] );
 						embedTextures.insert( iData, tx );
+						TRACE_ZONE( "TexCache::texLoad" );
 						texLoad( iData, tx->format, tx->target, tx->width, tx->height, tx->mipmaps, tx->id );
 					}
 					catch ( QString & e ) {
@@ -321,6 +445,11 @@ void TexCache::flush()
 	qDeleteAll( textures );
 	textures.clear();
 
+	flushEmbedded();
+}
+
+void TexCache::flushEmbedded()
+{
 	for ( Tex * tx : embedTextures ) {
 		if ( tx->id[0] )
 			glDeleteTextures( ( !tx->id[1] ? 1 : 2 ), tx->id );
@@ -417,6 +546,7 @@ void TexCache::Tex::load()
 
 	try
 	{
+		TRACE_ZONE( "TexCache::texLoad", filepath );
 		QByteArray	data;
 		texLoad( game, filepath, format, target, width, height, mipmaps, data, id );
 	}
@@ -109,6 +109,8 @@ public:
 
 	//! Find a texture based on its filename
 	static QString find( const QString & file, Game::GameMode game = Game::OTHER );
+	//! Resolve the paths of several textures in one batch, so that later find() calls are answered from the cache
+	static void resolve( const QStringList & files, Game::GameMode game );
 	//! Remove the path from a filename
 	static QString stripPath( const QString & file, const QString & nifFolder );
 	//! Checks whether the given file can be loaded
@@ -126,6 +128,8 @@ signals:
 
 public slots:
 	void flush();
+	//! Drop the textures loaded from pixel data blocks, which belong to the current model
+	void flushEmbedded();
 
 	/*! Set the folder to read textures from
 	 *
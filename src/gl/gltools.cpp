@@ -35,6 +35,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "model/nifmodel.h"
 
 #include <QMap>
+#include <QOffscreenSurface>
+#include <QOpenGLFunctions>
 #include <QStack>
 #include <QVector>
 
@@ -344,6 +346,53 @@ BoundSphere operator*( const Transform & t, const BoundSphere & sphere )
 }
 
 
+/*
+ * Frustum
+ */
+
+Frustum::Frustum( bool perspective, float w2, float h2, float nr, float fr )
+{
+	// The eye looks down the negative Z axis
+	if ( perspective ) {
+		normals[0] = Vector3( nr, 0, -w2 );
+		normals[1] = Vector3( -nr, 0, -w2 );
+		normals[2] = Vector3( 0, nr, -h2 );
+		normals[3] = Vector3( 0, -nr, -h2 );
+		for ( int i = 0; i < 4; i++ ) {
+			normals[i].normalize();
+			distances[i] = 0;
+		}
+	} else {
+		normals[0] = Vector3( 1, 0, 0 );
+		normals[1] = Vector3( -1, 0, 0 );
+		normals[2] = Vector3( 0, 1, 0 );
+		normals[3] = Vector3( 0, -1, 0 );
+		distances[0] = distances[1] = w2;
+		distances[2] = distances[3] = h2;
+	}
+
+	normals[4] = Vector3( 0, 0, -1 );
+	distances[4] = -nr;
+	normals[5] = Vector3( 0, 0, 1 );
+	distances[5] = fr;
+
+	valid = true;
+}
+
+bool Frustum::intersects( const BoundSphere & sphere ) const
+{
+	if ( sphere.radius < 0 )
+		return false;
+
+	for ( int i = 0; i < 6; i++ ) {
+		if ( Vector3::dotproduct( normals[i], sphere.center ) + distances[i] < -sphere.radius )
+			return false;
+	}
+
+	return true;
+}
+
+
 /*
  * draw primitives
  */
@@ -999,171 +1048,326 @@ static QVector<Vector3> generateTris( const NifModel * nif, const QModelIndex &
 	return tris;
 }
 
-void drawConvexHull( const NifModel * nif, const QModelIndex & iShape, float scale, bool solid )
+/*
+ *  CollisionGeometry
+ */
+
+void CollisionGeometry::addLineStrip( const QVector<Vector3> & strip )
+{
+	for ( int i = 1; i < strip.count(); i++ )
+		lines << strip[i - 1] << strip[i];
+}
+
+void CollisionGeometry::addBox( const Vector3 & a, const Vector3 & b )
 {
-	static QMap<QModelIndex, QVector<Vector3>> shapes;
-	QVector<Vector3> shape;
+	addLineStrip( { { a[0], a[1], a[2] }, { a[0], b[1], a[2] }, { a[0], b[1], b[2] }, { a[0], a[1], b[2] }, { a[0], a[1], a[2] } } );
+	addLineStrip( { { b[0], a[1], a[2] }, { b[0], b[1], a[2] }, { b[0], b[1], b[2] }, { b[0], a[1], b[2] }, { b[0], a[1], a[2] } } );
 
-	shape = shapes[iShape];
+	lines << Vector3( a[0], a[1], a[2] ) << Vector3( b[0], a[1], a[2] );
+	lines << Vector3( a[0], b[1], a[2] ) << Vector3( b[0], b[1], a[2] );
+	lines << Vector3( a[0], b[1], b[2] ) << Vector3( b[0], b[1], b[2] );
+	lines << Vector3( a[0], a[1], b[2] ) << Vector3( b[0], a[1], b[2] );
+}
 
-	if ( shape.empty() ) {
-		shape = generateTris( nif, iShape, scale );
-		shapes[iShape] = shape;
+void CollisionGeometry::addSphere( const Vector3 & c, float r, int sd )
+{
+	QVector<Vector3> strip( sd * 2 + 1 );
+
+	// Same outline as drawSphere
+	for ( int axis = 0; axis < 3; axis++ ) {
+		for ( int j = -sd; j <= sd; j++ ) {
+			float f = PI * float(j) / float(sd);
+			float rj = r * sin( f );
+
+			Vector3 cj = c;
+			cj[2 - axis] += r * cos( f );
+
+			for ( int i = 0; i <= sd * 2; i++ ) {
+				float s = sin( PI / sd * i ) * rj;
+				float t = cos( PI / sd * i ) * rj;
+
+				if ( axis == 0 )
+					strip[i] = Vector3( s, t, 0 ) + cj;
+				else if ( axis == 1 )
+					strip[i] = Vector3( s, 0, t ) + cj;
+				else
+					strip[i] = Vector3( 0, s, t ) + cj;
+			}
+
+			addLineStrip( strip );
+		}
 	}
+}
 
-	glPolygonMode( GL_FRONT_AND_BACK, solid ? GL_FILL : GL_LINE );
-	glDisable( GL_CULL_FACE );
-	glBegin( GL_TRIANGLES );
+void CollisionGeometry::addCapsule( const Vector3 & a, const Vector3 & b, float r, int sd )
+{
+	Vector3 d = b - a;
 
-	for ( int i = 0; i < shape.count(); i += 3 ) {
-		// DRAW ABC
-		glVertex( shape[i] );
-		glVertex( shape[i+1] );
-		glVertex( shape[i+2] );
+	if ( d.length() < 0.001 ) {
+		addSphere( a, r );
+		return;
 	}
 
-	glEnd();
-	glPolygonMode( GL_FRONT_AND_BACK, solid ? GL_LINE : GL_FILL );
-	glEnable( GL_CULL_FACE );
+	Vector3 n = d;
+	n.normalize();
+
+	Vector3 x( n[1], n[2], n[0] );
+	Vector3 y = Vector3::crossproduct( n, x );
+	x = Vector3::crossproduct( n, y );
+
+	x *= r;
+	y *= r;
+
+	// Same outline as drawCapsule
+	QVector<Vector3> strip( sd * 2 + 1 );
+
+	for ( int i = 0; i <= sd * 2; i++ )
+		strip[i] = a + d / 2 + x * sin( PI / sd * i ) + y * cos( PI / sd * i );
+	addLineStrip( strip );
+
+	for ( int i = 0; i <= sd * 2; i++ )
+		lines << ( a + x * sin( PI / sd * i ) + y * cos( PI / sd * i ) ) << ( b + x * sin( PI / sd * i ) + y * cos( PI / sd * i ) );
+
+	for ( int j = 0; j <= sd; j++ ) {
+		float f = PI * float(j) / float(sd * 2);
+		Vector3 dj = n * r * cos( f );
+		float rj = sin( f );
+
+		for ( int i = 0; i <= sd * 2; i++ )
+			strip[i] = a - dj + x * sin( PI / sd * i ) * rj + y * cos( PI / sd * i ) * rj;
+		addLineStrip( strip );
+
+		for ( int i = 0; i <= sd * 2; i++ )
+			strip[i] = b + dj + x * sin( PI / sd * i ) * rj + y * cos( PI / sd * i ) * rj;
+		addLineStrip( strip );
+	}
 }
 
-void drawNiTSS( const NifModel * nif, const QModelIndex & iShape, bool solid )
+void CollisionGeometry::upload( QOpenGLFunctions * fn )
 {
-	QModelIndex iStrips = nif->getIndex( iShape, "Strips Data" );
-	for ( int r = 0; r < nif->rowCount( iStrips ); r++ ) {
-		QModelIndex iStripData = nif->getBlockIndex( nif->getLink( QModelIndex_child( iStrips, r ) ), "NiTriStripsData" );
-		if ( iStripData.isValid() ) {
-			QVector<Vector3> verts = nif->getArray<Vector3>( iStripData, "Vertices" );
-
-			glPolygonMode( GL_FRONT_AND_BACK, solid ? GL_FILL : GL_LINE );
-			glDisable( GL_CULL_FACE );
-			glBegin( GL_TRIANGLES );
-
-			QModelIndex iPoints = nif->getIndex( iStripData, "Points" );
-			for ( int r = 0; r < nif->rowCount( iPoints ); r++ ) {	// draw the strips like they appear in the tescs
-				// (use the unstich strips spell to avoid the spider web effect)
-				QVector<quint16> strip = nif->getArray<quint16>( QModelIndex_child( iPoints, r ) );
-				if ( strip.count() >= 3 ) {
-					quint16 a = strip[0];
-					quint16 b = strip[1];
-
-					for ( int x = 2; x < strip.size(); x++ ) {
-						quint16 c = strip[x];
-						glVertex( verts.value( a ) );
-						glVertex( verts.value( b ) );
-						glVertex( verts.value( c ) );
-						a = b;
-						b = c;
-					}
-				}
-			}
+	numLines = lines.count();
+	numTriangles = triangles.count();
 
-			glEnd();
-			glEnable( GL_CULL_FACE );
-			glPolygonMode( GL_FRONT_AND_BACK, solid ? GL_LINE : GL_FILL );
-		}
-	}
+	QVector<Vector3> verts;
+	verts.reserve( numLines + numTriangles );
+	verts << lines << triangles;
+
+	fn->glGenBuffers( 1, &vertexBuffer );
+	fn->glBindBuffer( GL_ARRAY_BUFFER, vertexBuffer );
+	fn->glBufferData( GL_ARRAY_BUFFER, verts.count() * sizeof( Vector3 ), verts.constData(), GL_STATIC_DRAW );
+
+	// The model data is no longer needed once it is on the GPU
+	lines = QVector<Vector3>();
+	triangles = QVector<Vector3>();
 }
 
-void drawCMS( const NifModel * nif, const QModelIndex & iShape, bool solid )
+void CollisionGeometry::draw( QOpenGLFunctions * fn, int id, bool selecting )
 {
-	QModelIndex iData = nif->getBlockIndex( nif->getLink( iShape, "Data" ) );
-	if ( iData.isValid() ) {
-		QModelIndex iBigVerts = nif->getIndex( iData, "Big Verts" );
-		QModelIndex iBigTris = nif->getIndex( iData, "Big Tris" );
-		QModelIndex iChunkTrans = nif->getIndex( iData, "Chunk Transforms" );
+	if ( !vertexBuffer )
+		upload( fn );
 
-		QVector<Vector4> verts = nif->getArray<Vector4>( iBigVerts );
+	if ( numLines + numTriangles == 0 )
+		return;
 
-		glPolygonMode( GL_FRONT_AND_BACK, solid ? GL_FILL : GL_LINE );
-		glDisable( GL_CULL_FACE );
+	if ( selecting && colorId != id ) {
+		// Picking colors as a vertex attribute, see ID2COLORKEY
+		QVector<int> colors( numLines + numTriangles, ID2COLORKEY( id ) );
 
-		for ( int r = 0; r < nif->rowCount( iBigTris ); r++ ) {
-			Triangle tri = nif->get<Triangle>( QModelIndex_child( iBigTris, r ), "Triangle" );
+		if ( !colorBuffer )
+			fn->glGenBuffers( 1, &colorBuffer );
+		fn->glBindBuffer( GL_ARRAY_BUFFER, colorBuffer );
+		fn->glBufferData( GL_ARRAY_BUFFER, colors.count() * sizeof( int ), colors.constData(), GL_STATIC_DRAW );
+		colorId = id;
+	}
 
-			glBegin( GL_TRIANGLES );
+	fn->glBindBuffer( GL_ARRAY_BUFFER, vertexBuffer );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, 0, nullptr );
 
-			glVertex( verts[tri.v1()] );
-			glVertex( verts[tri.v2()] );
-			glVertex( verts[tri.v3()] );
+	if ( selecting ) {
+		fn->glBindBuffer( GL_ARRAY_BUFFER, colorBuffer );
+		glEnableClientState( GL_COLOR_ARRAY );
+		glColorPointer( 4, GL_UNSIGNED_BYTE, 0, nullptr );
+	}
 
-			glEnd();
-		}
+	if ( numLines > 0 )
+		glDrawArrays( GL_LINES, 0, numLines );
 
-		glPolygonMode( GL_FRONT_AND_BACK, solid ? GL_LINE : GL_FILL );
+	if ( numTriangles > 0 ) {
+		glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
+		glDisable( GL_CULL_FACE );
+		glDrawArrays( GL_TRIANGLES, numLines, numTriangles );
+		glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
 		glEnable( GL_CULL_FACE );
+	}
 
-		QModelIndex iChunkArr = nif->getIndex( iData, "Chunks" );
-		for ( int r = 0; r < nif->rowCount( iChunkArr ); r++ ) {
-			auto iChunk = nif->index(r, 0, iChunkArr);
-			Vector4 chunkOrigin = nif->get<Vector4>( iChunk, "Translation" );
-
-			quint32 transformIndex = nif->get<quint32>( iChunk, "Transform Index" );
-			QModelIndex chunkTransform = QModelIndex_child( iChunkTrans, transformIndex );
-			Vector4 chunkTranslation = nif->get<Vector4>( QModelIndex_child( chunkTransform ) );
-			Quat chunkRotation = nif->get<Quat>( QModelIndex_child( chunkTransform, 1 ) );
+	if ( selecting )
+		glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	fn->glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
 
-			quint32 numOffsets = nif->get<quint32>( iChunk, "Num Vertices" ) / 3;
-			quint32 numIndices = nif->get<quint32>( iChunk, "Num Indices" );
-			quint32 numStrips = nif->get<quint32>( iChunk, "Num Strips" );
-			QVector<UshortVector3> offsets = nif->getArray<UshortVector3>( iChunk, "Vertices" );
-			QVector<quint16> indices = nif->getArray<quint16>( iChunk, "Indices" );
-			QVector<quint16> strips = nif->getArray<quint16>( iChunk, "Strips" );
+void CollisionGeometry::releaseBuffers( QVector<GLuint> & released )
+{
+	if ( vertexBuffer )
+		released << vertexBuffer;
+	if ( colorBuffer )
+		released << colorBuffer;
 
-			QVector<Vector4> vertices( numOffsets );
+	vertexBuffer = colorBuffer = 0;
+	colorId = -1;
+}
 
-			int numStripVerts = 0;
-			int offset = 0;
+//! Adds the triangles of a bhkNiTriStripsShape, drawn like they appear in the TESCS
+static void buildNiTSS( CollisionGeometry & geom, const NifModel * nif, const QModelIndex & iShape )
+{
+	float s = bhkInvScale( nif );
 
-			for ( int v = 0; v < (int)numStrips; v++ ) {
-				numStripVerts += strips[v];
+	QModelIndex iStrips = nif->getIndex( iShape, "Strips Data" );
+	for ( int r = 0; r < nif->rowCount( iStrips ); r++ ) {
+		QModelIndex iStripData = nif->getBlockIndex( nif->getLink( QModelIndex_child( iStrips, r ) ), "NiTriStripsData" );
+		if ( !iStripData.isValid() )
+			continue;
+
+		geom.sources << nif->getBlockNumber( iStripData );
+
+		QVector<Vector3> verts = nif->getArray<Vector3>( iStripData, "Vertices" );
+		for ( Vector3 & v : verts )
+			v *= s;
+
+		QModelIndex iPoints = nif->getIndex( iStripData, "Points" );
+		for ( int p = 0; p < nif->rowCount( iPoints ); p++ ) {
+			// (use the unstich strips spell to avoid the spider web effect)
+			QVector<quint16> strip = nif->getArray<quint16>( QModelIndex_child( iPoints, p ) );
+			if ( strip.count() >= 3 ) {
+				quint16 a = strip[0];
+				quint16 b = strip[1];
+
+				for ( int x = 2; x < strip.size(); x++ ) {
+					quint16 c = strip[x];
+					geom.addTriangle( verts.value( a ), verts.value( b ), verts.value( c ) );
+					a = b;
+					b = c;
+				}
 			}
+		}
+	}
+}
 
-			for ( int n = 0; n < ((int)numOffsets); n++ ) {
-				vertices[n] = chunkOrigin + chunkTranslation + Vector4( offsets[n], 0.0f ) / 1000.0f;
-			}
+//! Adds the triangles of the hkPackedNiTriStripsData of a bhkPackedNiTriStripsShape
+static void buildPackedNiTSS( CollisionGeometry & geom, const NifModel * nif, const QModelIndex & iData )
+{
+	if ( !iData.isValid() )
+		return;
+
+	geom.sources << nif->getBlockNumber( iData );
 
-			glPolygonMode( GL_FRONT_AND_BACK, solid ? GL_FILL : GL_LINE );
-			glDisable( GL_CULL_FACE );
+	QVector<Vector3> verts = nif->getArray<Vector3>( iData, "Vertices" );
+	QModelIndex iTris = nif->getIndex( iData, "Triangles" );
 
-			Transform trans;
-			trans.rotation.fromQuat( chunkRotation );
+	for ( int t = 0; t < nif->rowCount( iTris ); t++ ) {
+		Triangle tri = nif->get<Triangle>( QModelIndex_child( iTris, t ), "Triangle" );
 
-			// Stripped tris
-			for ( int s = 0; s < (int)numStrips; s++ ) {
+		if ( tri[0] != tri[1] || tri[1] != tri[2] || tri[2] != tri[0] )
+			geom.addTriangle( verts.value( tri[0] ), verts.value( tri[1] ), verts.value( tri[2] ) );
+	}
+}
 
-				for ( int idx = 0; idx < strips[s] - 2; idx++ ) {
+//! Adds the big triangles and the decompressed chunks of a bhkCompressedMeshShape
+static void buildCMS( CollisionGeometry & geom, const NifModel * nif, const QModelIndex & iShape )
+{
+	QModelIndex iData = nif->getBlockIndex( nif->getLink( iShape, "Data" ) );
+	if ( !iData.isValid() )
+		return;
 
-					glBegin( GL_TRIANGLES );
+	geom.sources << nif->getBlockNumber( iData );
 
-					glVertex( trans.rotation * Vector3( vertices[indices[offset + idx]] ) );
-					glVertex( trans.rotation * Vector3( vertices[indices[offset + idx + 1]] ) );
-					glVertex( trans.rotation * Vector3( vertices[indices[offset + idx + 2]] ) );
+	QModelIndex iBigVerts = nif->getIndex( iData, "Big Verts" );
+	QModelIndex iBigTris = nif->getIndex( iData, "Big Tris" );
+	QModelIndex iChunkTrans = nif->getIndex( iData, "Chunk Transforms" );
 
-					glEnd();
+	QVector<Vector4> verts = nif->getArray<Vector4>( iBigVerts );
 
-				}
+	for ( int r = 0; r < nif->rowCount( iBigTris ); r++ ) {
+		Triangle tri = nif->get<Triangle>( QModelIndex_child( iBigTris, r ), "Triangle" );
+		geom.addTriangle( Vector3( verts.value( tri.v1() ) ), Vector3( verts.value( tri.v2() ) ), Vector3( verts.value( tri.v3() ) ) );
+	}
 
-				offset += strips[s];
+	QModelIndex iChunkArr = nif->getIndex( iData, "Chunks" );
+	for ( int r = 0; r < nif->rowCount( iChunkArr ); r++ ) {
+		auto iChunk = nif->index(r, 0, iChunkArr);
+		Vector4 chunkOrigin = nif->get<Vector4>( iChunk, "Translation" );
+
+		quint32 transformIndex = nif->get<quint32>( iChunk, "Transform Index" );
+		QModelIndex chunkTransform = QModelIndex_child( iChunkTrans, transformIndex );
+		Vector4 chunkTranslation = nif->get<Vector4>( QModelIndex_child( chunkTransform ) );
+		Quat chunkRotation = nif->get<Quat>( QModelIndex_child( chunkTransform, 1 ) );
+
+		quint32 numOffsets = nif->get<quint32>( iChunk, "Num Vertices" ) / 3;
+		quint32 numIndices = nif->get<quint32>( iChunk, "Num Indices" );
+		quint32 numStrips = nif->get<quint32>( iChunk, "Num Strips" );
+		QVector<UshortVector3> offsets = nif->getArray<UshortVector3>( iChunk, "Vertices" );
+		QVector<quint16> indices = nif->getArray<quint16>( iChunk, "Indices" );
+		QVector<quint16> strips = nif->getArray<quint16>( iChunk, "Strips" );
+
+		Transform trans;
+		trans.rotation.fromQuat( chunkRotation );
+
+		// Decompress and rotate the chunk vertices once
+		QVector<Vector3> vertices( numOffsets );
+		for ( int n = 0; n < ((int)numOffsets); n++ ) {
+			vertices[n] = trans.rotation * Vector3( chunkOrigin + chunkTranslation + Vector4( offsets.value( n ), 0.0f ) / 1000.0f );
+		}
+
+		int offset = 0;
 
+		// Stripped tris
+		for ( int s = 0; s < (int)numStrips; s++ ) {
+			for ( int idx = 0; idx < strips.value( s ) - 2; idx++ ) {
+				geom.addTriangle( vertices.value( indices.value( offset + idx ) ),
+				                  vertices.value( indices.value( offset + idx + 1 ) ),
+				                  vertices.value( indices.value( offset + idx + 2 ) ) );
 			}
 
-			// Non-stripped tris
-			for ( int f = 0; f < (int)(numIndices - offset); f += 3 ) {
-				glBegin( GL_TRIANGLES );
+			offset += strips.value( s );
+		}
 
-				glVertex( trans.rotation * Vector3( vertices[indices[offset + f]] ) );
-				glVertex( trans.rotation * Vector3( vertices[indices[offset + f + 1]] ) );
-				glVertex( trans.rotation * Vector3( vertices[indices[offset + f + 2]] ) );
+		// Non-stripped tris
+		for ( int f = 0; f < (int)(numIndices - offset); f += 3 ) {
+			geom.addTriangle( vertices.value( indices.value( offset + f ) ),
+			                  vertices.value( indices.value( offset + f + 1 ) ),
+			                  vertices.value( indices.value( offset + f + 2 ) ) );
+		}
+	}
+}
 
-				glEnd();
+void buildCollisionGeometry( CollisionGeometry & geom, const NifModel * nif, const QModelIndex & iShape )
+{
+	QString name = nif->itemName( iShape );
 
-			}
+	geom.sources << nif->getBlockNumber( iShape );
 
-			glPolygonMode( GL_FRONT_AND_BACK, solid ? GL_LINE : GL_FILL );
-			glEnable( GL_CULL_FACE );
+	if ( name == "bhkSphereShape" ) {
+		geom.addSphere( Vector3(), nif->get<float>( iShape, "Radius" ) );
+	} else if ( name == "bhkMultiSphereShape" ) {
+		QModelIndex iSpheres = nif->getIndex( iShape, "Spheres" );
 
+		for ( int r = 0; r < nif->rowCount( iSpheres ); r++ ) {
+			geom.addSphere( nif->get<Vector3>( QModelIndex_child( iSpheres, r ), "Center" ), nif->get<float>( QModelIndex_child( iSpheres, r ), "Radius" ) );
 		}
+	} else if ( name == "bhkBoxShape" ) {
+		Vector3 v = nif->get<Vector3>( iShape, "Dimensions" );
+		geom.addBox( v, -v );
+	} else if ( name == "bhkCapsuleShape" ) {
+		geom.addCapsule( nif->get<Vector3>( iShape, "First Point" ), nif->get<Vector3>( iShape, "Second Point" ), nif->get<float>( iShape, "Radius" ) );
+	} else if ( name == "bhkNiTriStripsShape" ) {
+		buildNiTSS( geom, nif, iShape );
+	} else if ( name == "bhkConvexVerticesShape" ) {
+		geom.triangles << generateTris( nif, iShape, 1.0 );
+	} else if ( name == "bhkPackedNiTriStripsShape" ) {
+		buildPackedNiTSS( geom, nif, nif->getBlockIndex( nif->getLink( iShape, "Data" ) ) );
+	} else if ( name == "bhkCompressedMeshShape" ) {
+		buildCMS( geom, nif, iShape );
 	}
 }
 
@@ -1191,3 +1395,24 @@ void renderText( double x, double y, double z, const QString & str )
 	glPopAttrib();
 }
 
+bool createOffscreenContext( QObject * parent, QOpenGLContext *& context, QOffscreenSurface *& surface )
+{
+	// Same version and profile as GLView::create()
+	QSurfaceFormat fmt;
+	fmt.setRenderableType( QSurfaceFormat::OpenGL );
+	fmt.setVersion( 4, 0 );
+	fmt.setProfile( QSurfaceFormat::CompatibilityProfile );
+
+	context = new QOpenGLContext( parent );
+	context->setFormat( fmt );
+
+	surface = new QOffscreenSurface( nullptr, parent );
+	surface->setFormat( fmt );
+	surface->create();
+
+	if ( !context->create() || !surface->isValid() || !context->makeCurrent( surface ) )
+		return false;
+
+	context->functions()->initializeOpenGLFunctions();
+	return true;
+}
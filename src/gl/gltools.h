@@ -38,8 +38,11 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QOpenGLContext>
 #include <QPair>
 
+class QOffscreenSurface;
+class QOpenGLFunctions;
 
-//! @file gltools.h BoundSphere, VertexWeight, BoneWeights, SkinPartition
+
+//! @file gltools.h BoundSphere, Frustum, VertexWeight, BoneWeights, SkinPartition
 
 
 using TriStrip = QVector<quint16>;
@@ -76,6 +79,26 @@ public:
 	friend BoundSphere operator*( const Transform & t, const BoundSphere & s );
 };
 
+//! A view frustum in eye coordinates, as set up by glFrustum() or glOrtho()
+class Frustum final
+{
+public:
+	Frustum() {}
+	Frustum( bool perspective, float w2, float h2, float nr, float fr );
+
+	//! Whether the frustum has been set up
+	bool isValid() const { return valid; }
+
+	//! Returns false if a bounding sphere in eye coordinates is entirely outside the frustum
+	bool intersects( const BoundSphere & sphere ) const;
+
+protected:
+	//! Plane normals and distances, points p inside satisfy normal * p + distance >= 0
+	Vector3 normals[6];
+	float distances[6] = {};
+	bool valid = false;
+};
+
 //! A vertex, weight pair
 class VertexWeight final
 {
@@ -152,6 +175,45 @@ public:
 	QVector<QVector<quint16> > tristrips;
 };
 
+//! Collision shape geometry, converted once from the model and drawn from vertex buffers
+class CollisionGeometry final
+{
+public:
+	//! Line segment vertices, two per segment
+	QVector<Vector3> lines;
+	//! Triangle vertices, three per triangle, drawn as wireframe
+	QVector<Vector3> triangles;
+	//! Numbers of the blocks the geometry was built from
+	QVector<int> sources;
+
+	void addLineStrip( const QVector<Vector3> & strip );
+	void addBox( const Vector3 & a, const Vector3 & b );
+	void addSphere( const Vector3 & c, float r, int sd = 8 );
+	void addCapsule( const Vector3 & a, const Vector3 & b, float r, int sd = 5 );
+
+	void addTriangle( const Vector3 & a, const Vector3 & b, const Vector3 & c )
+	{
+		triangles << a << b << c;
+	}
+
+	//! Draws the geometry in the current color, or in the picking color of block 'id' when selecting
+	void draw( QOpenGLFunctions * fn, int id, bool selecting );
+	//! Moves the vertex buffers to 'released' for deletion while a context is current
+	void releaseBuffers( QVector<GLuint> & released );
+
+private:
+	void upload( QOpenGLFunctions * fn );
+
+	GLuint vertexBuffer = 0;
+	GLuint colorBuffer = 0;
+	int colorId = -1;
+	int numLines = 0;
+	int numTriangles = 0;
+};
+
+//! Converts a single (non-container) collision shape to line and triangle geometry
+void buildCollisionGeometry( CollisionGeometry & geom, const NifModel * nif, const QModelIndex & iShape );
+
 float bhkScale( const NifModel * nif );
 float bhkInvScale( const NifModel * nif );
 float bhkScaleMult( const NifModel * nif );
@@ -176,9 +238,6 @@ void drawSphereSimple( const Vector3 & c, float r, int sd = 36 );
 void drawSphere( const Vector3 & c, float r, int sd = 8 );
 void drawCapsule( const Vector3 & a, const Vector3 & b, float r, int sd = 5 );
 void drawDashLine( const Vector3 & a, const Vector3 & b, int sd = 15 );
-void drawConvexHull( const NifModel * nif, const QModelIndex & iShape, float scale, bool solid = false );
-void drawNiTSS( const NifModel * nif, const QModelIndex & iShape, bool solid = false );
-void drawCMS( const NifModel * nif, const QModelIndex & iShape, bool solid = false );
 void drawSpring( const Vector3 & a, const Vector3 & b, float stiffness, int sd = 16, bool solid = false );
 void drawRail( const Vector3 & a, const Vector3 & b );
 
@@ -272,6 +331,13 @@ inline GLuint glClosestMatch( GLuint * buffer, GLint hits )
 void renderText( double x, double y, double z, const QString & str );
 void renderText( const Vector3 & c, const QString & str );
 
+//! Creates a context and an offscreen surface owned by parent, for rendering without a GLView
+/*!
+ * The context has the version and profile of GLView::create(). Returns false if it could not be
+ * made current on the surface, otherwise it is current and its functions are initialized.
+ */
+bool createOffscreenContext( QObject * parent, QOpenGLContext *& context, QOffscreenSurface *& surface );
+
 #define ID2COLORKEY( id ) (id + 1)
 #define COLORKEY2ID( id ) (id - 1)
 
@@ -44,6 +44,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "gamemanager.h"
 #include "gl/BSMesh.h"
 #include "libfo76utils/src/ddstxt16.hpp"
+#include "trace.h"
 
 #include <QCoreApplication>
 #include <QDebug>
@@ -53,6 +54,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QOpenGLFunctions>
 #include <QSettings>
 #include <QTextStream>
+#include <bit>
 #include <chrono>
 
 
@@ -140,42 +142,76 @@ Renderer::ConditionSingle::ConditionSingle( const QString & line, bool neg ) : i
 		left = line;
 		comp = NONE;
 	}
-}
-
-QModelIndex Renderer::ConditionSingle::getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlocks, QString blkid ) const
-{
-	QString childid;
 
+	// Resolve the strings once instead of on every evaluation
+	QString blkid = left;
 	if ( blkid.startsWith( "HEADER/" ) ) {
-		auto blk = blkid.remove( "HEADER/" );
-		if ( blk.contains("/") ) {
-			auto blks = blk.split( "/" );
-			return nif->getIndex( nif->getIndex( nif->getHeaderIndex(), blks.at(0) ), blks.at(1) );
+		inHeader = true;
+		blkid.remove( 0, 7 );
+		int pos = blkid.indexOf( "/" );
+		if ( pos >= 0 ) {
+			fieldPath = blkid.left( pos );
+			fieldName = blkid.mid( pos + 1 ).section( "/", 0, 0 );
+		} else {
+			fieldName = blkid;
 		}
-		return nif->getIndex( nif->getHeaderIndex(), blk );
+	} else {
+		int pos = blkid.indexOf( "/" );
+		if ( pos > 0 ) {
+			fieldName = blkid.mid( pos + 1 );
+			blkid = blkid.left( pos );
+		}
+		blockType = blkid;
 	}
 
-	int pos = blkid.indexOf( "/" );
+	rightCount = right.toULongLong( nullptr, 0 );
+	rightFloat = float( right.toDouble() );
+	rightUInt = right.toUInt( nullptr, 0 );
+}
 
-	if ( pos > 0 ) {
-		childid = blkid.right( blkid.length() - pos - 1 );
-		blkid = blkid.left( pos );
+QModelIndex Renderer::ConditionSingle::getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const
+{
+	if ( inHeader ) {
+		if ( !fieldPath.isEmpty() )
+			return nif->getIndex( nif->getIndex( nif->getHeaderIndex(), fieldPath ), fieldName );
+		return nif->getIndex( nif->getHeaderIndex(), fieldName );
 	}
 
-	for ( QModelIndex iBlock : iBlocks ) {
-		if ( nif->blockInherits( iBlock, blkid ) ) {
-			if ( childid.isEmpty() )
-				return iBlock;
+	for ( const QModelIndex & iBlock : iBlocks ) {
+		const NifItem * block = nif->getItem( iBlock, false );
+		if ( !block || !nif->isNiBlock( block ) )
+			continue;
+
+		auto it = accessors.find( block->name() );
+		if ( it == accessors.end() ) {
+			FieldAccessor accessor;
+			accessor.inherits = nif->inherits( block->name(), blockType );
+			it = accessors.insert( block->name(), accessor );
+		}
+		if ( !it->inherits )
+			continue;
 
-			return nif->getIndex( iBlock, childid );
+		if ( fieldName.isEmpty() )
+			return iBlock;
+
+		// The row differs between versions of the block, so check the cached one before using it
+		const NifItem * field = ( it->row >= 0 ) ? block->child( it->row ) : nullptr;
+		if ( !field || !field->hasName( fieldName ) || !nif->evalCondition( field ) ) {
+			field = nif->getItem( block, fieldName );
+			if ( !field )
+				return QModelIndex();
+			if ( field->parent() == block )
+				it->row = field->row();
 		}
+
+		return nif->itemToIndex( field );
 	}
 	return QModelIndex();
 }
 
 bool Renderer::ConditionSingle::eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const
 {
-	QModelIndex iLeft = getIndex( nif, iBlocks, left );
+	QModelIndex iLeft = getIndex( nif, iBlocks );
 
 	if ( !iLeft.isValid() )
 		return invert;
@@ -190,13 +226,13 @@ bool Renderer::ConditionSingle::eval( const NifModel * nif, const QVector<QModel
 	if ( item->isString() )
 		return compare( item->getValueAsString(), right ) ^ invert;
 	else if ( item->isCount() )
-		return compare( item->getCountValue(), right.toULongLong( nullptr, 0 ) ) ^ invert;
+		return compare( item->getCountValue(), rightCount ) ^ invert;
 	else if ( item->isFloat() )
-		return compare( item->getFloatValue(), (float)right.toDouble() ) ^ invert;
+		return compare( item->getFloatValue(), rightFloat ) ^ invert;
 	else if ( item->isFileVersion() )
-		return compare( item->getFileVersionValue(), right.toUInt( nullptr, 0 ) ) ^ invert;
+		return compare( item->getFileVersionValue(), rightUInt ) ^ invert;
 	else if ( item->valueType() == NifValue::tBSVertexDesc )
-		return compare( (uint) item->get<BSVertexDesc>().GetFlags(), right.toUInt( nullptr, 0 ) ) ^ invert;
+		return compare( (uint) item->get<BSVertexDesc>().GetFlags(), rightUInt ) ^ invert;
 
 	return false;
 }
@@ -421,6 +457,7 @@ void Renderer::Program::setUniformLocations()
 {
 	for ( int i = 0; i < NUM_UNIFORM_TYPES; i++ )
 		uniformLocations[i] = f->glGetUniformLocation( id, uniforms[i].c_str() );
+	uniformValuesSet.reset();
 }
 
 Renderer::Renderer( QOpenGLContext * c, QOpenGLFunctions * f )
@@ -428,7 +465,8 @@ Renderer::Renderer( QOpenGLContext * c, QOpenGLFunctions * f )
 {
 	updateSettings();
 
-	connect( NifSkope::getOptions(), &SettingsDialog::saveSettings, this, &Renderer::updateSettings );
+	if ( NifSkope::getOptions() )
+		connect( NifSkope::getOptions(), &SettingsDialog::saveSettings, this, &Renderer::updateSettings );
 }
 
 Renderer::~Renderer()
@@ -503,6 +541,10 @@ void Renderer::releaseShaders()
 	if ( !shader_ready )
 		return;
 
+	// Program IDs may be reused by the next updateShaders()
+	useProgram( 0 );
+	boundProgram = ~GLuint( 0 );
+
 	qDeleteAll( programs );
 	programs.clear();
 	qDeleteAll( shaders );
@@ -511,6 +553,8 @@ void Renderer::releaseShaders()
 
 QString Renderer::setupProgram( Shape * mesh, const QString & hint )
 {
+	TRACE_ZONE( "Renderer::setupProgram" );
+
 	PropertyList props;
 	mesh->activeProperties( props );
 
@@ -526,6 +570,14 @@ QString Renderer::setupProgram( Shape * mesh, const QString & hint )
 		return {};
 	}
 
+	// The hint is the program selected for the shape earlier, it is reset by Shape::updateImpl
+	// when the shape, its data or one of its properties changes
+	if ( !hint.isEmpty() ) {
+		Program * program = programs.value( hint );
+		if ( program && program->status && setupProgram( program, mesh, props, {}, false ) )
+			return program->name;
+	}
+
 	QVector<QModelIndex> iBlocks;
 	iBlocks << mesh->index();
 	iBlocks << mesh->iData;
@@ -533,12 +585,6 @@ QString Renderer::setupProgram( Shape * mesh, const QString & hint )
 		iBlocks.append( p->index() );
 	}
 
-	if ( !hint.isEmpty() ) {
-		Program * program = programs.value( hint );
-		if ( program && program->status && setupProgram( program, mesh, props, iBlocks, false ) )
-			return program->name;
-	}
-
 	for ( Program * program : programs ) {
 		if ( program->status && setupProgram( program, mesh, props, iBlocks ) )
 			return program->name;
@@ -551,36 +597,82 @@ QString Renderer::setupProgram( Shape * mesh, const QString & hint )
 
 void Renderer::stopProgram()
 {
-	if ( shader_ready ) {
-		fn->glUseProgram( 0 );
-	}
+	if ( !batching )
+		useProgram( 0 );
 
 	resetTextureUnits();
 }
 
+void Renderer::useProgram( GLuint id )
+{
+	if ( shader_ready && id != boundProgram ) {
+		fn->glUseProgram( id );
+		boundProgram = id;
+		programSwitches++;
+	}
+}
+
+void Renderer::beginBatch()
+{
+	// Other code, like QPainter, may have changed the bound program since the last frame
+	boundProgram = ~GLuint( 0 );
+	batching = true;
+}
+
+void Renderer::endBatch()
+{
+	batching = false;
+	stopProgram();
+}
+
+bool Renderer::Program::uniformChanged( UniformType var, float x, float y, float z, float w )
+{
+	if ( uniformLocations[var] < 0 )
+		return false;
+
+	std::array<std::uint32_t, 4> v = { { std::bit_cast<std::uint32_t>( x ), std::bit_cast<std::uint32_t>( y ),
+											std::bit_cast<std::uint32_t>( z ), std::bit_cast<std::uint32_t>( w ) } };
+	if ( uniformValuesSet.test( var ) && uniformValues[var] == v )
+		return false;
+
+	uniformValues[var] = v;
+	uniformValuesSet.set( var );
+	return true;
+}
+
+bool Renderer::Program::uniformChanged( UniformType var, int val )
+{
+	return uniformChanged( var, std::bit_cast<float>( val ), 0.0f, 0.0f, 0.0f );
+}
+
 void Renderer::Program::uni1f( UniformType var, float x )
 {
-	f->glUniform1f( uniformLocations[var], x );
+	if ( uniformChanged( var, x, 0.0f, 0.0f, 0.0f ) )
+		f->glUniform1f( uniformLocations[var], x );
 }
 
 void Renderer::Program::uni2f( UniformType var, float x, float y )
 {
-	f->glUniform2f( uniformLocations[var], x, y );
+	if ( uniformChanged( var, x, y, 0.0f, 0.0f ) )
+		f->glUniform2f( uniformLocations[var], x, y );
 }
 
 void Renderer::Program::uni3f( UniformType var, float x, float y, float z )
 {
-	f->glUniform3f( uniformLocations[var], x, y, z );
+	if ( uniformChanged( var, x, y, z, 0.0f ) )
+		f->glUniform3f( uniformLocations[var], x, y, z );
 }
 
 void Renderer::Program::uni4f( UniformType var, float x, float y, float z, float w )
 {
-	f->glUniform4f( uniformLocations[var], x, y, z, w );
+	if ( uniformChanged( var, x, y, z, w ) )
+		f->glUniform4f( uniformLocations[var], x, y, z, w );
 }
 
 void Renderer::Program::uni1i( UniformType var, int val )
 {
-	f->glUniform1i( uniformLocations[var], val );
+	if ( uniformChanged( var, val ) )
+		f->glUniform1i( uniformLocations[var], val );
 }
 
 void Renderer::Program::uni3m( UniformType var, const Matrix & val )
@@ -849,7 +941,7 @@ bool Renderer::setupProgramSF( Program * prog, Shape * mesh )
 	if ( !nif )
 		return false;
 
-	fn->glUseProgram( prog->id );
+	useProgram( prog->id );
 
 	auto scene = mesh->scene;
 	auto lsp = mesh->bslsp;
@@ -1265,7 +1357,7 @@ bool Renderer::setupProgram( Program * prog, Shape * mesh, const PropertyList &
 	if ( nif->getBSVersion() >= 160 )
 		return setupProgramSF( prog, mesh );
 
-	fn->glUseProgram( prog->id );
+	useProgram( prog->id );
 
 	auto nifVersion = nif->getBSVersion();
 	auto scene = mesh->scene;
@@ -1736,6 +1828,9 @@ bool Renderer::setupProgram( Program * prog, Shape * mesh, const PropertyList &
 
 void Renderer::setupFixedFunction( Shape * mesh, const PropertyList & props )
 {
+	// A batch may have left the previous shape's program bound
+	useProgram( 0 );
+
 	// setup lighting
 
 	glEnable( GL_LIGHTING );
@@ -41,6 +41,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QString>
 
 #include <array>
+#include <bitset>
 #include <string>
 
 #include "material.hpp"
@@ -87,6 +88,15 @@ public:
 	QString setupProgram( Shape *, const QString & hint = {} );
 	//! Stop shader program
 	void stopProgram();
+	//! Binds a shader program, 0 for fixed function, unless it is already bound
+	void useProgram( GLuint id );
+	//! Starts a batch of shapes that leave their program bound in stopProgram()
+	void beginBatch();
+	//! Ends a batch started with beginBatch() and unbinds the program
+	void endBatch();
+
+	//! Number of glUseProgram() calls so far, see Scene::DrawStats
+	int programSwitches = 0;
 
 	typedef enum
 	{
@@ -199,7 +209,25 @@ protected:
 
 		bool invert;
 
-		QModelIndex getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlock, QString name ) const;
+		//! Left side split on load: header or block type, and the path of the field in it
+		bool inHeader = false;
+		QString blockType, fieldPath, fieldName;
+		//! Right side converted on load for each value type
+		quint64 rightCount = 0;
+		float rightFloat = 0.0f;
+		uint rightUInt = 0;
+
+		//! Field accessor of a block type, resolved on the first evaluation
+		struct FieldAccessor
+		{
+			bool inherits = false;
+			//! Row of fieldName in the block, -1 if not found yet
+			int row = -1;
+		};
+		//! Accessors by block type name, the block types are the same for every model
+		mutable QHash<QString, FieldAccessor> accessors;
+
+		QModelIndex getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlock ) const;
 		template <typename T> bool compare( T a, T b ) const;
 	};
 
@@ -350,6 +378,13 @@ public:
 
 		int uniformLocations[NUM_UNIFORM_TYPES];
 private:
+		//! Last values written through uni1f() .. uni1i(), as raw bits
+		std::array<std::array<std::uint32_t, 4>, NUM_UNIFORM_TYPES> uniformValues;
+		//! Which uniformValues entries are valid
+		std::bitset<NUM_UNIFORM_TYPES> uniformValuesSet;
+		//! Returns false if the uniform is unused or already set to the value
+		bool uniformChanged( UniformType var, float x, float y, float z, float w );
+		bool uniformChanged( UniformType var, int val );
 		struct UniformLocationMapItem {
 			const char *	fmt;
 			std::uint32_t	args;
@@ -399,6 +434,11 @@ public:
 	bool setupProgram( Program *, Shape *, const PropertyList &, const QVector<QModelIndex> & iBlocks, bool eval = true );
 	void setupFixedFunction( Shape *, const PropertyList & );
 
+	//! Program currently bound with useProgram(), or ~0 if unknown
+	GLuint boundProgram = ~GLuint( 0 );
+	//! Whether stopProgram() should keep the program bound
+	bool batching = false;
+
 	struct Settings
 	{
 		bool	useShaders = true;
@@ -0,0 +1,416 @@
+#include "thumbnailer.h"
+
+#include "gl/gltools.h"
+#include "gl/renderer.h"
+#include "model/nifmodel.h"
+#include "gamemanager.h"
+#include "libfo76utils/src/ba2file.hpp"
+
+#include <QBuffer>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageWriter>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QSettings>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <vector>
+
+
+//! \file thumbnailer.cpp Thumbnailer implementation
+
+//! Camera directions by name, the rotations of GLView::setOrientation() and a three-quarter view
+static const QVector<Thumbnailer::View> presetViews = {
+	{ "top", Vector3( 0, 0, 0 ) },
+	{ "bottom", Vector3( 180, 0, 0 ) },
+	{ "front", Vector3( -90, 0, 180 ) },
+	{ "back", Vector3( -90, 0, 0 ) },
+	{ "right", Vector3( -90, 0, 90 ) },
+	{ "left", Vector3( -90, 0, -90 ) },
+	{ "angle", Vector3( -70, 0, 135 ) },
+};
+
+static bool isNifFile( [[maybe_unused]] void * p, const std::string_view & s )
+{
+	return s.ends_with( ".nif" );
+}
+
+static bool collectFileNames( void * p, const BA2File::FileInfo & fd )
+{
+	reinterpret_cast< std::vector< std::string_view > * >( p )->push_back( fd.fileName );
+	return false;
+}
+
+Thumbnailer::Thumbnailer( const Options & options, QObject * parent )
+	: QObject( parent ), opts( options )
+{
+	opts.format = opts.format.toLower();
+	if ( opts.views.isEmpty() && opts.turntableFrames <= 0 )
+		opts.views.append( presetViews.last() );
+
+	// Formats without alpha get an opaque background
+	if ( opts.format == "jpg" || opts.format == "jpeg" || opts.format == "bmp" )
+		opts.background.setAlpha( 255 );
+}
+
+Thumbnailer::~Thumbnailer()
+{
+	// The GL objects must be deleted while the context is current
+	if ( context && surface )
+		context->makeCurrent( surface );
+
+	delete scene;
+	delete textures;
+	delete fbo;
+
+	if ( context )
+		context->doneCurrent();
+}
+
+bool Thumbnailer::initialize( QString * error )
+{
+	if ( !createOffscreenContext( this, context, surface ) ) {
+		if ( error )
+			*error = tr( "Could not create an OpenGL context. Without a display, run under a virtual X server such as xvfb-run." );
+		return false;
+	}
+
+	functions = context->functions();
+
+	QOpenGLFramebufferObjectFormat fboFmt;
+	fboFmt.setTextureTarget( GL_TEXTURE_2D );
+	fboFmt.setInternalTextureFormat( GL_SRGB8_ALPHA8 );
+	fboFmt.setMipmap( false );
+	fboFmt.setAttachment( QOpenGLFramebufferObject::Attachment::CombinedDepthStencil );
+	fboFmt.setSamples( std::max( opts.samples, 0 ) );
+
+	fbo = new QOpenGLFramebufferObject( opts.size, fboFmt );
+	if ( !fbo->isValid() ) {
+		if ( error )
+			*error = tr( "Could not create a %1x%2 framebuffer" ).arg( opts.size.width() ).arg( opts.size.height() );
+		return false;
+	}
+
+	initializeTextureUnits( context );
+
+	textures = new TexCache( this );
+	scene = new Scene( textures, context, functions, this );
+
+	// Only the model itself, none of the helpers of the viewport
+	scene->options &= ~( Scene::ShowAxes | Scene::ShowGrid | Scene::ShowNodes | Scene::ShowCollision
+		| Scene::ShowConstraints | Scene::ShowMarkers );
+	if ( opts.samples <= 0 )
+		scene->options &= ~Scene::DoMultisampling;
+
+	if ( scene->renderer->initialize() )
+		scene->updateShaders();
+
+	return true;
+}
+
+QJsonObject Thumbnailer::render( NifModel * nif, const QString & name )
+{
+	QJsonObject entry;
+	entry.insert( "name", name );
+
+	if ( !scene || !context->makeCurrent( surface ) ) {
+		entry.insert( "error", tr( "No OpenGL context" ) );
+		return entry;
+	}
+
+	auto game = Game::GameManager::get_game( nif->getVersionNumber(), nif->getUserVersion(), nif->getBSVersion() );
+	// Scene::make() only starts loading the Starfield materials, wait for them here
+	if ( game == Game::STARFIELD )
+		(void) Game::GameManager::materials( game );
+	sceneScale = ( game == Game::STARFIELD ) ? 1.0f / 32.0f : 1.0f;
+
+	// Keep the textures loaded from files, the next model often uses them too
+	scene->make( nif, false );
+	scene->transform( Transform(), scene->timeMin() );
+
+	BoundSphere bs = scene->bounds();
+	entry.insert( "center", QJsonArray{ bs.center[0], bs.center[1], bs.center[2] } );
+	entry.insert( "radius", bs.radius );
+
+	QDir out( opts.outputFolder );
+	out.mkpath( QFileInfo( out.filePath( name ) ).path() );
+
+	QJsonArray images;
+	auto addImage = [&]( const QString & view, const Vector3 & rotation ) {
+		QString file = QString( "%1_%2.%3" ).arg( name, view, opts.format );
+		if ( writeImage( renderFrame( rotation ), out.filePath( file ) ) )
+			images.append( QJsonObject{ { "view", view }, { "file", file } } );
+		else
+			entry.insert( "error", tr( "Could not write %1" ).arg( file ) );
+	};
+
+	for ( const View & v : opts.views )
+		addImage( v.name, v.rotation );
+
+	for ( int i = 0; i < opts.turntableFrames; i++ )
+		addImage( QString( "turn%1" ).arg( i, 3, 10, QChar( '0' ) ),
+			Vector3( opts.turntablePitch, 0, 180.0f + 360.0f * i / opts.turntableFrames ) );
+
+	entry.insert( "images", images );
+
+	// Drop the nodes of the model before it is deleted, textures stay loaded for the next one
+	scene->clear( false );
+
+	return entry;
+}
+
+QImage Thumbnailer::renderFrame( const Vector3 & rotation )
+{
+	int w = opts.size.width();
+	int h = opts.size.height();
+
+	fbo->bind();
+
+	glPushAttrib( GL_ALL_ATTRIB_BITS );
+	glViewport( 0, 0, w, h );
+
+	const QColor & c = opts.background;
+	glClearColor( c.redF(), c.greenF(), c.blueF(), c.alphaF() );
+	glDisable( GL_FRAMEBUFFER_SRGB );
+	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
+
+	// Frame the whole scene as GLView::setCenter() does
+	BoundSphere bs = scene->bounds();
+	if ( bs.radius < 1.0f * sceneScale )
+		bs.radius = 1024.0f * sceneScale;
+
+	Transform viewTrans;
+	viewTrans.rotation.fromEuler( deg2rad( rotation[0] ), deg2rad( rotation[1] ), deg2rad( rotation[2] ) );
+	viewTrans.translation = viewTrans.rotation * -bs.center;
+	viewTrans.translation[2] -= bs.radius * 1.2f * 2.0f;
+
+	scene->transform( viewTrans, scene->timeMin() );
+
+	// Perspective projection as in GLView::glProjection()
+	float fov = QSettings().value( "Settings/Render/General/Camera/Field Of View", 45.0f ).toFloat();
+
+	BoundSphere vs = scene->view * scene->bounds();
+	float bounds = std::max( vs.radius, 1024.0f * sceneScale );
+	GLdouble nr = std::max( std::fabs( vs.center[2] ) - bounds * 1.5, 1.0 * sceneScale );
+	GLdouble fr = std::max( std::fabs( vs.center[2] ) + bounds * 1.5, 2.0 * sceneScale );
+	GLdouble h2 = tan( fov / 360 * M_PI ) * nr;
+	GLdouble w2 = h2 * w / h;
+
+	glMatrixMode( GL_PROJECTION );
+	glLoadIdentity();
+	glFrustum( -w2, +w2, -h2, +h2, nr, fr );
+	scene->frustum = Frustum( true, w2, h2, nr, fr );
+
+	glMatrixMode( GL_MODELVIEW );
+	glLoadIdentity();
+
+	// The default frontal light of GLView
+	GLfloat lightDir[] = { 0.0f, 0.0f, 1.0f, 0.0f };
+	GLfloat mat_amb[] = { 1.0f, 1.0f, 1.0f, 0.23641851f };
+	GLfloat mat_diff[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	if ( scene->hasOption( Scene::DisableShaders ) )
+		mat_amb[0] = mat_amb[1] = mat_amb[2] = 0.375f;
+
+	glShadeModel( GL_SMOOTH );
+	glEnable( GL_LIGHT0 );
+	glLightfv( GL_LIGHT0, GL_AMBIENT, mat_amb );
+	glLightfv( GL_LIGHT0, GL_DIFFUSE, mat_diff );
+	glLightfv( GL_LIGHT0, GL_SPECULAR, mat_diff );
+	glLightfv( GL_LIGHT0, GL_POSITION, lightDir );
+
+	if ( scene->hasOption( Scene::DoMultisampling ) )
+		glEnable( GL_MULTISAMPLE_ARB );
+
+	scene->draw();
+
+	glPopAttrib();
+	fbo->release();
+
+	// Reinterpret the pixels as GLView::saveImage() does, the alpha is not premultiplied
+	QImage fboImg( fbo->toImage() );
+	bool alpha = opts.background.alpha() < 255;
+	return QImage( fboImg.constBits(), fboImg.width(), fboImg.height(),
+		alpha ? QImage::Format_ARGB32 : QImage::Format_RGB32 ).copy();
+}
+
+bool Thumbnailer::writeImage( const QImage & image, const QString & file ) const
+{
+	QImageWriter writer( file );
+	writer.setFormat( opts.format.toLatin1() );
+	writer.setCompression( 1 );
+
+	if ( opts.format == "jpg" || opts.format == "jpeg" || opts.format == "webp" )
+		writer.setQuality( opts.quality );
+
+	return writer.write( image );
+}
+
+int Thumbnailer::run( const QStringList & inputs )
+{
+	QJsonArray files;
+	int failed = 0;
+
+	auto addEntry = [&]( QJsonObject entry, const QString & source ) {
+		entry.insert( "source", source );
+		if ( entry.contains( "error" ) )
+			failed++;
+		files.append( entry );
+	};
+
+	// The source of each image name, names are compared without case as on Windows
+	QHash<QString, QString> usedNames;
+	auto claimName = [&]( const QString & name, const QString & source, QJsonObject & entry ) {
+		auto it = usedNames.constFind( name.toLower() );
+		if ( it != usedNames.constEnd() ) {
+			entry.insert( "name", name );
+			entry.insert( "error", tr( "The image name is already used by %1" ).arg( it.value() ) );
+			return false;
+		}
+		usedNames.insert( name.toLower(), source );
+		return true;
+	};
+
+	auto renderFile = [&]( const QString & file, const QString & name ) {
+		NifModel nif;
+		QJsonObject entry;
+		if ( claimName( name, file, entry ) ) {
+			if ( nif.loadFromFile( file ) )
+				entry = render( &nif, name );
+			else
+				entry.insert( "error", tr( "Could not load the file" ) );
+		}
+		addEntry( entry, file );
+	};
+
+	// Lists append their entries to the queue, with the folder of the list that names their images
+	QVector<QPair<QString, QString>> queue;
+	for ( const QString & input : inputs )
+		queue.append( { input, QString() } );
+
+	for ( int i = 0; i < queue.count(); i++ ) {
+		QFileInfo info( queue[i].first );
+		QString ext = info.suffix().toLower();
+
+		if ( info.isDir() ) {
+			QDir root( info.filePath() );
+			QStringList found;
+			QDirIterator it( root.path(), { "*.nif" }, QDir::Files, QDirIterator::Subdirectories );
+			while ( it.hasNext() )
+				found.append( it.next() );
+			found.sort();
+
+			for ( const QString & file : found ) {
+				QString name = root.relativeFilePath( file );
+				name.chop( 4 );
+				renderFile( file, name );
+			}
+		} else if ( ext == "bsa" || ext == "ba2" ) {
+			BA2File archive;
+			std::vector< std::string_view > names;
+			try {
+				archive.loadArchivePath( info.filePath().toStdString().c_str(), &isNifFile );
+				archive.scanFileList( &collectFileNames, &names );
+			} catch ( std::exception & ) {
+				addEntry( QJsonObject{ { "error", tr( "Could not open the archive" ) } }, info.filePath() );
+				continue;
+			}
+			std::sort( names.begin(), names.end() );
+
+			for ( const auto & n : names ) {
+				QString path = QString::fromLatin1( n.data(), qsizetype( n.length() ) );
+				QString name = path;
+				name.chop( 4 );
+
+				NifModel nif;
+				QJsonObject entry;
+				if ( !claimName( name, info.fileName() + "/" + path, entry ) ) {
+					addEntry( entry, info.fileName() + "/" + path );
+					continue;
+				}
+				try {
+					BA2File::UCharArray buf;
+					const unsigned char * dataPtr;
+					size_t dataSize = archive.extractFile( dataPtr, buf, n );
+					QByteArray data( reinterpret_cast< const char * >( dataPtr ), qsizetype( dataSize ) );
+					QBuffer device( &data );
+					if ( device.open( QIODevice::ReadOnly ) && nif.load( device ) )
+						entry = render( &nif, name );
+					else
+						entry.insert( "error", tr( "Could not load the file" ) );
+				} catch ( std::exception & ) {
+					entry.insert( "error", tr( "Could not extract the file" ) );
+				}
+				addEntry( entry, info.fileName() + "/" + path );
+			}
+		} else if ( ext == "txt" || ext == "lst" ) {
+			QFile list( info.filePath() );
+			if ( !list.open( QIODevice::ReadOnly | QIODevice::Text ) ) {
+				addEntry( QJsonObject{ { "error", tr( "Could not read the list" ) } }, info.filePath() );
+				continue;
+			}
+
+			// Relative paths are relative to the list
+			QTextStream in( &list );
+			while ( !in.atEnd() ) {
+				QString line = in.readLine().trimmed();
+				if ( !line.isEmpty() && !line.startsWith( '#' ) )
+					queue.append( { info.dir().filePath( line ), info.absolutePath() } );
+			}
+		} else if ( queue[i].second.isEmpty() ) {
+			renderFile( info.filePath(), info.completeBaseName() );
+		} else {
+			// Entries of a list keep their path relative to the list, so that files of the same name in
+			// different folders do not overwrite each other
+			QString name = QDir( queue[i].second ).relativeFilePath( info.absoluteFilePath() );
+			while ( name.startsWith( "../" ) )
+				name.remove( 0, 3 );
+			if ( !info.suffix().isEmpty() )
+				name.chop( info.suffix().length() + 1 );
+			renderFile( info.filePath(), name );
+		}
+	}
+
+	QJsonArray views;
+	for ( const View & v : opts.views )
+		views.append( v.name );
+
+	QJsonObject manifest {
+		{ "width", opts.size.width() },
+		{ "height", opts.size.height() },
+		{ "format", opts.format },
+		{ "views", views },
+		{ "turntableFrames", opts.turntableFrames },
+		{ "files", files },
+	};
+
+	QFile out( QDir( opts.outputFolder ).filePath( "manifest.json" ) );
+	if ( !out.open( QIODevice::WriteOnly ) || out.write( QJsonDocument( manifest ).toJson() ) < 0 )
+		failed++;
+
+	return failed;
+}
+
+bool Thumbnailer::parseViews( const QString & list, QVector<View> & views )
+{
+	for ( const QString & name : list.split( ',', Qt::SkipEmptyParts ) ) {
+		auto it = std::find_if( presetViews.cbegin(), presetViews.cend(), [&name]( const View & v ) {
+			return v.name.compare( name.trimmed(), Qt::CaseInsensitive ) == 0;
+		} );
+		if ( it == presetViews.cend() )
+			return false;
+
+		views.append( *it );
+	}
+	return true;
+}
@@ -0,0 +1,110 @@
+#ifndef THUMBNAILER_H
+#define THUMBNAILER_H
+
+#include "gl/glscene.h"
+
+#include <QColor>
+#include <QJsonObject>
+#include <QObject> // Inherited
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+
+//! \file thumbnailer.h Thumbnailer
+
+class NifModel;
+class QOffscreenSurface;
+class QOpenGLContext;
+class QOpenGLFramebufferObject;
+class QOpenGLFunctions;
+
+//! Renders images of NIF files without a window, for batch thumbnail generation
+/*!
+ * An offscreen surface and framebuffer stand in for GLView. The context, Scene, Renderer and TexCache
+ * are created once and reused for every file, so the shaders are only compiled once and textures
+ * shared between files are only loaded once.
+ */
+class Thumbnailer final : public QObject
+{
+	Q_OBJECT
+
+public:
+	//! A camera direction, as GLView rotation angles in degrees
+	struct View
+	{
+		QString name;
+		Vector3 rotation;
+	};
+
+	struct Options
+	{
+		//! Image size in pixels
+		QSize size = { 256, 256 };
+		//! Multisampling samples, 0 to disable
+		int samples = 4;
+		//! Image file extension, which selects the format
+		QString format = "png";
+		//! JPEG and WebP quality
+		int quality = 90;
+		//! Background color, transparent by default if the format has alpha
+		QColor background = QColor( 0, 0, 0, 0 );
+		//! The views to render for each file
+		QVector<View> views;
+		//! Number of frames of a turntable around the up axis, 0 for none
+		int turntableFrames = 0;
+		//! Camera pitch of the turntable frames, in degrees
+		float turntablePitch = -70.0f;
+		//! The folder the images and manifest.json are written to
+		QString outputFolder;
+	};
+
+	explicit Thumbnailer( const Options & options, QObject * parent = nullptr );
+	~Thumbnailer();
+
+	//! Creates the context, framebuffer and renderer, returns false if OpenGL is not available
+	bool initialize( QString * error = nullptr );
+
+	//! Renders a model, name is the path of the images below the output folder without extension
+	/*!
+	 * @return The manifest entry of the model
+	 */
+	QJsonObject render( NifModel * nif, const QString & name );
+
+	//! Renders every NIF of the inputs and writes manifest.json
+	/*!
+	 * Inputs can be NIF files, folders, which are searched recursively, BSA or BA2 archives,
+	 * or text files listing any of these, one per line.
+	 *
+	 * The images of a file are named after the file, files in folders and archives and the entries
+	 * of lists by their path relative to the folder, archive or list. A file whose name is already
+	 * used is not rendered and gets an error in the manifest.
+	 *
+	 * @return The number of files that could not be loaded or rendered
+	 */
+	int run( const QStringList & inputs );
+
+	//! Parses a comma separated list of views, names as in GLView::setOrientation() or "angle"
+	static bool parseViews( const QString & list, QVector<View> & views );
+
+private:
+	//! Renders one image of the current scene
+	QImage renderFrame( const Vector3 & rotation );
+	//! Writes an image, returns false on failure
+	bool writeImage( const QImage & image, const QString & file ) const;
+
+	Options opts;
+
+	QOpenGLContext * context = nullptr;
+	QOffscreenSurface * surface = nullptr;
+	QOpenGLFunctions * functions = nullptr;
+	QOpenGLFramebufferObject * fbo = nullptr;
+
+	TexCache * textures = nullptr;
+	Scene * scene = nullptr;
+
+	//! Scale of the scene, see GLView::scale()
+	float sceneScale = 1.0f;
+};
+
+#endif
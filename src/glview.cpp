@@ -34,6 +34,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "message.h"
 #include "nifskope.h"
+#include "gl/framestats.h"
 #include "gl/renderer.h"
 #include "gl/glshape.h"
 #include "gl/gltex.h"
@@ -52,6 +53,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QDebug>
 #include <QDialog>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QGroupBox>
 #include <QImageWriter>
 #include <QKeyEvent>
@@ -59,6 +61,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QMenu>
 #include <QMimeData>
 #include <QMouseEvent>
+#include <QPainter>
 #include <QPushButton>
 #include <QRadioButton>
 #include <QSettings>
@@ -206,6 +209,7 @@ GLView::GLView( const QGLFormat & format, QWidget * p, const QGLWidget * shareWi
 	lastTime = QTime::currentTime();
 
 	textures = new TexCache( this );
+	frameStats = new FrameStats;
 
 	updateSettings();
 
@@ -239,6 +243,12 @@ GLView::~GLView()
 {
 	flush();
 
+	if ( frameStats ) {
+		makeCurrent();
+		frameStats->releaseQueries();
+		delete frameStats;
+	}
+
 	delete textures;
 	delete scene;
 }
@@ -440,11 +450,13 @@ void GLView::glProjection( int x, int y )
 		GLdouble h2 = tan( ( cfg.fov / Zoom ) / 360 * M_PI ) * nr;
 		GLdouble w2 = h2 * aspect;
 		glFrustum( -w2, +w2, -h2, +h2, nr, fr );
+		scene->frustum = Frustum( true, w2, h2, nr, fr );
 	} else {
 		// Orthographic View
 		GLdouble h2 = Dist / Zoom;
 		GLdouble w2 = h2 * aspect;
 		glOrtho( -w2, +w2, -h2, +h2, nr, fr );
+		scene->frustum = Frustum( false, w2, h2, nr, fr );
 	}
 
 	glMatrixMode( GL_MODELVIEW );
@@ -467,6 +479,8 @@ void GLView::paintGL()
 {
 #endif
 
+	frameStats->beginFrame();
+
 	// Save GL state
 	glPushAttrib( GL_ALL_ATTRIB_BITS );
 	glMatrixMode( GL_PROJECTION );
@@ -705,7 +719,10 @@ void GLView::paintGL()
 #endif
 
 	// Draw the model
+	QElapsedTimer drawTimer;
+	drawTimer.start();
 	scene->draw();
+	frameStats->setTime( FrameStats::StageDraw, drawTimer.nsecsElapsed() );
 
 	if ( scene->hasOption(Scene::ShowAxes) ) {
 		// Resize viewport to small corner of screen
@@ -767,6 +784,18 @@ void GLView::paintGL()
 	while ( ( err = glGetError() ) != GL_NO_ERROR )
 		qDebug() << tr( "glview.cpp - GL ERROR (paint): " ) << (const char *)gluErrorString( err );
 
+	frameStats->endFrame( scene, model ? model->getFilename() : QString() );
+
+	if ( frameStats->isOverlayVisible() ) {
+#ifdef USE_GL_QPAINTER
+		frameStats->drawOverlay( painter, rect() );
+#else
+		QPainter overlay( this );
+		frameStats->drawOverlay( overlay, rect() );
+		overlay.end();
+#endif
+	}
+
 	emit paintUpdate();
 
 	// Manually handle the buffer swap
@@ -1005,9 +1034,14 @@ QModelIndex GLView::indexAt( const QPoint & pos, int cycle )
 
 	df << &Scene::drawShapes;
 
+	QElapsedTimer pickTimer;
+	pickTimer.start();
+
 	int choose = -1, furn = -1;
 	choose = ::indexAt( model, scene, df, cycle, pos, /*out*/ furn );
 
+	frameStats->addPicking( pickTimer.nsecsElapsed() );
+
 	glPopAttrib();
 	glMatrixMode( GL_MODELVIEW );
 	glPopMatrix();
@@ -1037,6 +1071,22 @@ QModelIndex GLView::indexAt( const QPoint & pos, int cycle )
 	return chooseIndex;
 }
 
+void GLView::setFrameStatsVisible( bool visible )
+{
+	frameStats->setOverlayVisible( visible );
+	update();
+}
+
+bool GLView::setFrameStatsLog( const QString & fileName, QString * error )
+{
+	return frameStats->setLogFile( fileName, error );
+}
+
+bool GLView::saveFrameStats( const QString & fileName, QString * error ) const
+{
+	return frameStats->saveCsv( fileName, error );
+}
+
 void GLView::center()
 {
 	doCenter = true;
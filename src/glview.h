@@ -47,6 +47,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 class NifSkope;
 class NifModel;
+class FrameStats;
 class GLGraphicsView;
 
 class QGLFormat;
@@ -154,6 +155,11 @@ public:
 
 	QModelIndex indexAt( const QPoint & p, int cycle = 0 );
 
+	//! Appends the frame statistics of every frame to a CSV file, or stops for an empty file name
+	bool setFrameStatsLog( const QString & fileName, QString * error = nullptr );
+	//! Writes the frame statistics of the last frames to a CSV file
+	bool saveFrameStats( const QString & fileName, QString * error = nullptr ) const;
+
 	// UI
 
 	QSize minimumSizeHint() const override final { return { 50, 50 }; }
@@ -180,6 +186,8 @@ public slots:
 	void selectPBRCubeMap( quint32 bsVersion = 0 );
 	void selectF76CubeMap();
 	void selectSTFCubeMap();
+	//! Shows or hides the frame timing overlay
+	void setFrameStatsVisible( bool visible );
 
 signals:
 	void clicked( const QModelIndex & );
@@ -265,6 +273,9 @@ private:
 	QTimer * lightVisTimer;
 	int lightVisTimeout;
 
+	//! Frame timing for the overlay and the log
+	FrameStats * frameStats = nullptr;
+
 	struct Settings
 	{
 		QColor background;
@@ -194,8 +194,50 @@ quint32 MeshFile::readMesh()
 			}
 		}
 
+		readMeshlets();
+
 		return numPositions;
 	}
 
 	return 0;
 }
+
+void MeshFile::readMeshlets()
+{
+	if ( in.atEnd() )
+		return;
+
+	quint32 numMeshlets;
+	in >> numMeshlets;
+	if ( in.status() != QDataStream::Ok || quint64(numMeshlets) * 16 > quint64(data.size()) )
+		return;
+
+	meshlets.resize(numMeshlets);
+	for ( auto& m : meshlets )
+		in >> m.vertexCount >> m.vertexOffset >> m.triangleCount >> m.triangleOffset;
+
+	// Culling data of each meshlet: the center and the half size of its bounding box
+	quint32 numCullData;
+	in >> numCullData;
+	if ( in.status() != QDataStream::Ok || numCullData != numMeshlets ) {
+		meshlets.clear();
+		return;
+	}
+
+	quint64 numTriangles = 0;
+	for ( auto& m : meshlets ) {
+		Vector3 expand;
+		in >> m.center >> expand;
+		m.radius = expand.length();
+
+		if ( quint64(m.triangleOffset) + m.triangleCount > quint64(triangles.size()) )
+			numTriangles = ~quint64(0);
+		else
+			numTriangles += m.triangleCount;
+	}
+
+	if ( in.status() != QDataStream::Ok || numTriangles != quint64(triangles.size()) ) {
+		qWarning() << "Ignoring meshlets that do not match the triangles of" << QString::fromStdString(path);
+		meshlets.clear();
+	}
+}
@@ -47,10 +47,26 @@ public:
 	//! Skeletal Mesh LOD
 	QVector<QVector<Triangle>> lods;
 
+	//! A cluster of triangles with the data needed to cull it as a whole
+	struct Meshlet
+	{
+		quint32 vertexCount;
+		quint32 vertexOffset;
+		//! Range of the cluster in triangles
+		quint32 triangleCount;
+		quint32 triangleOffset;
+		//! Bounding sphere in mesh coordinates, around the bounding box of the file
+		Vector3 center;
+		float radius;
+	};
+	//! Meshlets covering triangles, empty if the file has none or they do not match the triangles
+	QVector<Meshlet> meshlets;
+
 	std::string path;
 
 private:
 	QByteArray data;
 	QDataStream in;
 	quint32 readMesh();
+	void readMeshlets();
 };
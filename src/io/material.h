@@ -41,6 +41,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QDataStream>
 #include <QString>
 
+#include <memory>
+
 
 //! @file material.h Material, ShaderMaterial, EffectMaterial
 
@@ -241,4 +243,23 @@ protected:
 };
 
 
+//! Process-wide cache of parsed BGSM/BGEM files
+/*!
+ * Materials are shared between all the shapes and files that reference them, keyed by game
+ * and resolved path. Entries are dropped when the archives or the temporary data path of the
+ * game manager change (see Game::GameManager::get_archives_id()).
+ */
+class MaterialCache final
+{
+public:
+	//! Return the shared material for 'name', or nullptr if it is not a valid BGSM/BGEM file
+	static std::shared_ptr< Material > get( const QString & name, Game::GameMode game );
+	//! Start parsing the materials in 'names' on the global thread pool
+	static void prefetch( const QStringList & names, Game::GameMode game );
+
+private:
+	static std::shared_ptr< Material > load( const QString & name, Game::GameMode game );
+};
+
+
 #endif // MATERIAL_H
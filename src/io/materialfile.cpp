@@ -33,10 +33,16 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "material.h"
 
 #include <QBuffer>
+#include <QCoreApplication>
 #include <QDataStream>
 #include <QDebug>
 #include <QDir>
+#include <QMutex>
 #include <QSettings>
+#include <QThreadPool>
+
+#include <future>
+#include <unordered_map>
 
 
 //! @file material.cpp BGSM/BGEM file I/O
@@ -260,3 +266,116 @@ bool EffectMaterial::readFile()
 
 	return in.status() == QDataStream::Ok;
 }
+
+
+/*
+	MaterialCache
+*/
+
+namespace
+{
+struct MaterialCacheEntry
+{
+	std::shared_future< std::shared_ptr< Material > > material;
+	//! Sizes and modification times of the loose files, see GameManager::loose_file_stamp()
+	QByteArray stamp;
+};
+
+QMutex	materialCacheMutex;
+std::unordered_map< std::string, MaterialCacheEntry >	materialCache;
+std::uintptr_t	materialCacheArchivesID = 0;
+
+std::string materialCachePath( const QString & name )
+{
+	return Game::GameManager::get_full_path( name, "materials", "" );
+}
+
+std::string materialCacheKey( const std::string & path, Game::GameMode game )
+{
+	return std::string( 1, char( game ) ) + path;
+}
+
+// Must be called with materialCacheMutex locked
+void checkMaterialCache()
+{
+	std::uintptr_t	archivesID = Game::GameManager::get_archives_id();
+	if ( archivesID != materialCacheArchivesID ) {
+		materialCache.clear();
+		materialCacheArchivesID = archivesID;
+	}
+}
+}
+
+std::shared_ptr< Material > MaterialCache::load( const QString & name, Game::GameMode game )
+{
+	std::shared_ptr< Material >	m;
+	if ( name.endsWith( ".bgsm", Qt::CaseInsensitive ) )
+		m = std::make_shared< ShaderMaterial >( name, game );
+	else if ( name.endsWith( ".bgem", Qt::CaseInsensitive ) )
+		m = std::make_shared< EffectMaterial >( name, game );
+	if ( !( m && m->isValid() ) )
+		return nullptr;
+	// Materials parsed on the thread pool are owned by the GUI thread
+	if ( QCoreApplication::instance() && m->thread() != QCoreApplication::instance()->thread() )
+		m->moveToThread( QCoreApplication::instance()->thread() );
+	return m;
+}
+
+std::shared_ptr< Material > MaterialCache::get( const QString & name, Game::GameMode game )
+{
+	if ( name.isEmpty() )
+		return nullptr;
+	std::string	path = materialCachePath( name );
+	std::string	key = materialCacheKey( path, game );
+	// Edited loose files are parsed again
+	QByteArray	stamp = Game::GameManager::loose_file_stamp( game, path );
+	std::shared_future< std::shared_ptr< Material > >	f;
+	{
+		QMutexLocker	locker( &materialCacheMutex );
+		checkMaterialCache();
+		auto	i = materialCache.find( key );
+		if ( i != materialCache.end() && i->second.stamp == stamp ) {
+			f = i->second.material;
+		} else {
+			std::promise< std::shared_ptr< Material > >	p;
+			f = p.get_future().share();
+			materialCache.insert_or_assign( key, MaterialCacheEntry{ f, stamp } );
+			locker.unlock();
+			try {
+				p.set_value( load( name, game ) );
+			} catch ( ... ) {
+				p.set_value( nullptr );
+			}
+		}
+	}
+	// Waits if the material is still being parsed by prefetch()
+	return f.get();
+}
+
+void MaterialCache::prefetch( const QStringList & names, Game::GameMode game )
+{
+	// Open the archives here, the workers only extract files
+	if ( names.isEmpty() || !Game::GameManager::open_archives( game ) )
+		return;
+	QMutexLocker	locker( &materialCacheMutex );
+	checkMaterialCache();
+	for ( const auto & name : names ) {
+		if ( name.isEmpty() )
+			continue;
+		std::string	path = materialCachePath( name );
+		std::string	key = materialCacheKey( path, game );
+		QByteArray	stamp = Game::GameManager::loose_file_stamp( game, path );
+		auto	i = materialCache.find( key );
+		if ( i != materialCache.end() && i->second.stamp == stamp )
+			continue;
+		auto	p = std::make_shared< std::promise< std::shared_ptr< Material > > >();
+		materialCache.insert_or_assign( key, MaterialCacheEntry{ p->get_future().share(), stamp } );
+		QThreadPool::globalInstance()->start( [p, name, game]() {
+			try {
+				p->set_value( load( name, game ) );
+			} catch ( ... ) {
+				p->set_value( nullptr );
+			}
+		} );
+	}
+}
@@ -0,0 +1,161 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#include "nifdigest.h"
+
+
+//! @file nifdigest.cpp Streaming round-trip verification
+
+//! Size of the chunks read by NifDigests::fromDevice()
+#define DIGEST_CHUNK 0x10000
+
+NifDigests NifDigests::fromDevice( QIODevice & device, const QVector<qint64> & starts, qint64 end )
+{
+	NifDigests d;
+	if ( device.isSequential() || starts.isEmpty() )
+		return d;
+
+	qint64 pos = device.pos();
+
+	d.starts = starts;
+	d.size = end;
+	d.digests.reserve( starts.count() );
+
+	QCryptographicHash hash( algorithm );
+	QByteArray chunk;
+	for ( int i = 0; i < starts.count(); i++ ) {
+		qint64 left = d.rangeEnd( i ) - starts.at( i );
+		if ( left < 0 || !device.seek( starts.at( i ) ) ) {
+			d = NifDigests();
+			break;
+		}
+
+		hash.reset();
+		while ( left > 0 ) {
+			chunk = device.read( qMin<qint64>( left, DIGEST_CHUNK ) );
+			if ( chunk.isEmpty() )
+				break;
+			hash.addData( chunk );
+			left -= chunk.size();
+		}
+
+		if ( left > 0 ) {
+			d = NifDigests();
+			break;
+		}
+
+		d.digests << hash.result();
+	}
+
+	device.seek( pos );
+	return d;
+}
+
+
+NifDigestSink::NifDigestSink( const NifDigests & digests )
+	: expected( digests ), hash( NifDigests::algorithm )
+{
+	open( QIODevice::WriteOnly );
+}
+
+qint64 NifDigestSink::readData( char *, qint64 )
+{
+	return -1;
+}
+
+qint64 NifDigestSink::writeData( const char * data, qint64 len )
+{
+	qint64 left = len;
+	while ( left > 0 ) {
+		if ( range >= expected.count() ) {
+			// More data than the file had
+			if ( mismatch < 0 )
+				mismatch = qMax( expected.count() - 1, 0 );
+			written += left;
+			break;
+		}
+
+		qint64 n = qMin( left, expected.rangeEnd( range ) - written );
+		hash.addData( data, int( n ) );
+		written += n;
+		data += n;
+		left -= n;
+
+		if ( written == expected.rangeEnd( range ) )
+			closeRange();
+	}
+
+	return len;
+}
+
+void NifDigestSink::closeRange()
+{
+	if ( mismatch < 0 && hash.result() != expected.digests.at( range ) )
+		mismatch = range;
+
+	hash.reset();
+	range++;
+}
+
+void NifDigestSink::finish()
+{
+	// Empty ranges at the end
+	while ( range < expected.count() && written == expected.rangeEnd( range ) )
+		closeRange();
+
+	// Less data than the file had
+	if ( range < expected.count() && mismatch < 0 )
+		mismatch = range;
+}
+
+qint64 NifDigestSink::mismatchOffset() const
+{
+	return ( mismatch >= 0 && mismatch < expected.starts.count() ) ? expected.starts.at( mismatch ) : written;
+}
+
+
+NifHashDevice::NifHashDevice( QCryptographicHash::Algorithm algorithm )
+	: hash( algorithm )
+{
+	open( QIODevice::WriteOnly );
+}
+
+qint64 NifHashDevice::readData( char *, qint64 )
+{
+	return -1;
+}
+
+qint64 NifHashDevice::writeData( const char * data, qint64 len )
+{
+	hash.addData( data, int( len ) );
+	return len;
+}
@@ -0,0 +1,119 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#ifndef NIFDIGEST_H
+#define NIFDIGEST_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QIODevice>
+#include <QVector>
+
+
+//! @file nifdigest.h NifDigests, NifDigestSink, NifHashDevice
+
+/*! Digests of consecutive byte ranges of a file
+ *
+ * Range i starts at starts[i] and ends where range i + 1 starts, the last range ends at size.
+ * NifModel captures one range per top-level row: the header, each block and the footer.
+ */
+struct NifDigests
+{
+	QVector<qint64> starts;
+	qint64 size = 0;
+	QVector<QByteArray> digests;
+
+	bool isEmpty() const { return digests.isEmpty(); }
+	int count() const { return digests.count(); }
+	qint64 rangeEnd( int range ) const { return ( range + 1 < starts.count() ) ? starts.at( range + 1 ) : size; }
+
+	//! Digests the ranges of a random access device, restoring its position
+	static NifDigests fromDevice( QIODevice & device, const QVector<qint64> & starts, qint64 end );
+
+	static constexpr QCryptographicHash::Algorithm algorithm = QCryptographicHash::Md5;
+};
+
+
+/*! Write-only device that compares the data written to it against NifDigests
+ *
+ * The bytes of each range are hashed as they arrive, so that a save can be checked
+ * without keeping the output in memory or writing it to a file.
+ */
+class NifDigestSink final : public QIODevice
+{
+public:
+	NifDigestSink( const NifDigests & digests );
+
+	//! Compares the range in progress, call once everything has been written
+	void finish();
+
+	//! The data written so far matches the digests
+	bool matches() const { return mismatch < 0; }
+	//! The first range that differs, -1 if none
+	int firstMismatch() const { return mismatch; }
+	//! The start offset of the first range that differs
+	qint64 mismatchOffset() const;
+
+protected:
+	qint64 readData( char * data, qint64 maxSize ) override final;
+	qint64 writeData( const char * data, qint64 len ) override final;
+
+private:
+	//! Compares the digest of the range in progress and starts the next one
+	void closeRange();
+
+	const NifDigests expected;
+	QCryptographicHash hash;
+	int range = 0;
+	qint64 written = 0;
+	int mismatch = -1;
+};
+
+
+//! Write-only device that feeds the data written to it into a hash
+class NifHashDevice final : public QIODevice
+{
+public:
+	NifHashDevice( QCryptographicHash::Algorithm algorithm = NifDigests::algorithm );
+
+	//! The digest of the data written so far
+	QByteArray result() const { return hash.result(); }
+
+protected:
+	qint64 readData( char * data, qint64 maxSize ) override final;
+	qint64 writeData( const char * data, qint64 len ) override final;
+
+private:
+	QCryptographicHash hash;
+};
+
+#endif
@@ -0,0 +1,396 @@
+#include "meshsimplify.h"
+#include "data/niftypes.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <vector>
+
+
+/*
+	Edges are collapsed in passes: the costs of all candidate collapses are computed and sorted,
+	then the cheapest ones are applied, skipping any collapse next to one applied earlier in the
+	same pass, until the target triangle count or the error limit is reached.
+	The geometric error is the Garland-Heckbert quadric of the planes around the removed vertex.
+	The attribute error compares the attributes of the kept vertex with the attribute fields of the
+	removed triangles, extended linearly to the position of the kept vertex, so that attributes
+	changing linearly over a surface are not penalized.
+*/
+
+namespace
+{
+enum VertexKind : quint8
+{
+	Manifold,	// only collapsed along its edges
+	Border,	// only collapsed along an open border edge, into another border vertex
+	Locked	// on a seam or non-manifold edge, never collapsed
+};
+
+//! Weight of the planes added along open borders to keep them in place
+constexpr double borderWeight = 10.0;
+
+struct Quadric
+{
+	double	a2 = 0.0, b2 = 0.0, c2 = 0.0, d2 = 0.0;
+	double	ab = 0.0, ac = 0.0, ad = 0.0, bc = 0.0, bd = 0.0, cd = 0.0;
+	double	w = 0.0;
+
+	void addPlane( const Vector3 & n, const Vector3 & p, double weight )
+	{
+		double	a = n[0], b = n[1], c = n[2];
+		double	d = -( a * p[0] + b * p[1] + c * p[2] );
+		a2 += weight * a * a; b2 += weight * b * b; c2 += weight * c * c; d2 += weight * d * d;
+		ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+		bc += weight * b * c; bd += weight * b * d; cd += weight * c * d;
+	}
+
+	Quadric & operator+=( const Quadric & q )
+	{
+		a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2;
+		ab += q.ab; ac += q.ac; ad += q.ad; bc += q.bc; bd += q.bd; cd += q.cd;
+		w += q.w;
+		return *this;
+	}
+
+	//! Average squared distance of p from the planes
+	double error( const Vector3 & p ) const
+	{
+		double	x = p[0], y = p[1], z = p[2];
+		double	e = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * ( ab * x * y + ac * x * z + bc * y * z )
+				  + 2.0 * ( ad * x + bd * y + cd * z ) + d2;
+		return std::max( e, 0.0 ) / std::max( w, 1e-20 );
+	}
+};
+
+inline quint64 edgeKey( int a, int b )
+{
+	if ( a > b )
+		std::swap( a, b );
+	return ( quint64( quint32( a ) ) << 32 ) | quint32( b );
+}
+
+Vector3 faceNormal( const Vector3 & p0, const Vector3 & p1, const Vector3 & p2 )
+{
+	return Vector3::crossproduct( p1 - p0, p2 - p0 );
+}
+
+struct Collapse
+{
+	int	from;
+	int	to;
+	double	cost;
+};
+}
+
+QVector<Triangle> simplifyMesh( const QVector<Vector3> & positions, const QVector<Triangle> & triangles,
+								const SimplifyOptions & options, float * resultError )
+{
+	if ( resultError )
+		*resultError = 0.0f;
+
+	int	numVertices = positions.count();
+	for ( const Triangle & tri : triangles ) {
+		if ( tri[0] >= numVertices || tri[1] >= numVertices || tri[2] >= numVertices )
+			return triangles;
+	}
+
+	int	stride = options.attributeStride;
+	if ( stride <= 0 || options.attributes.count() < numVertices * stride )
+		stride = 0;
+
+	// Mesh size, the errors are relative to it
+	Vector3	bbMin( FLT_MAX, FLT_MAX, FLT_MAX ), bbMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+	for ( const Triangle & tri : triangles ) {
+		for ( int k = 0; k < 3; k++ ) {
+			const Vector3 &	p = positions[tri[k]];
+			for ( int c = 0; c < 3; c++ ) {
+				bbMin[c] = std::min( bbMin[c], p[c] );
+				bbMax[c] = std::max( bbMax[c], p[c] );
+			}
+		}
+	}
+	double	extent = ( triangles.isEmpty() ? 0.0 : double( ( bbMax - bbMin ).length() ) );
+	if ( !( extent > 0.0 ) )
+		return triangles;
+
+	double	errorLimit = double( options.maxError ) * extent;
+	errorLimit = errorLimit * errorLimit;
+
+	std::vector<double>	attributeScale( size_t( stride ), 0.0 );
+	for ( int k = 0; k < stride; k++ ) {
+		double	s = double( options.attributeWeights.value( k, 1.0f ) );
+		attributeScale[k] = s * s * errorLimit;
+	}
+
+	// Vertices at the same position share a weld ID, the topology is evaluated on these
+	std::vector<int>	weld( numVertices, 0 );
+	{
+		std::vector<int>	order( numVertices, 0 );
+		for ( int v = 0; v < numVertices; v++ )
+			order[v] = v;
+		std::sort( order.begin(), order.end(), [&]( int a, int b ) {
+			const Vector3 &	p = positions[a];
+			const Vector3 &	q = positions[b];
+			if ( p[0] != q[0] )
+				return p[0] < q[0];
+			if ( p[1] != q[1] )
+				return p[1] < q[1];
+			if ( p[2] != q[2] )
+				return p[2] < q[2];
+			return a < b;
+		} );
+		for ( int i = 0; i < numVertices; i++ ) {
+			int	v = order[i];
+			if ( i > 0 && positions[v] == positions[order[i - 1]] )
+				weld[v] = weld[order[i - 1]];
+			else
+				weld[v] = v;
+		}
+	}
+
+	// Referenced vertices with the same position are seams
+	std::vector<bool>	used( numVertices, false );
+	for ( const Triangle & tri : triangles ) {
+		for ( int k = 0; k < 3; k++ )
+			used[tri[k]] = true;
+	}
+	std::vector<int>	weldUsers( numVertices, 0 );
+	for ( int v = 0; v < numVertices; v++ )
+		weldUsers[weld[v]] += ( used[v] ? 1 : 0 );
+
+	// Planes of the triangles around each vertex
+	std::vector<Quadric>	quadrics( numVertices );
+	for ( const Triangle & tri : triangles ) {
+		Vector3	n = faceNormal( positions[tri[0]], positions[tri[1]], positions[tri[2]] );
+		double	area = double( n.length() ) * 0.5;
+		if ( !( area > 0.0 ) )
+			continue;
+		n /= float( area * 2.0 );
+
+		for ( int k = 0; k < 3; k++ ) {
+			quadrics[tri[k]].addPlane( n, positions[tri[k]], area );
+			quadrics[tri[k]].w += area;
+		}
+	}
+
+	QVector<Triangle>	current = triangles;
+	std::vector<int>	collapseTo( numVertices, 0 );
+	std::vector<quint8>	kind( numVertices, Manifold );
+	std::vector<bool>	touched( numVertices, false );
+	std::vector<int>	triStart( size_t( numVertices ) + 1, 0 );
+	std::vector<int>	vertexTris;
+	std::vector<Collapse>	collapses;
+	QHash<quint64, int>	edgeCount;
+	double	maxCost = 0.0;
+	bool	firstPass = true;
+
+	int	target = std::max( options.targetTriangles, 0 );
+
+	while ( current.count() > target ) {
+		int	numTriangles = current.count();
+
+		// Triangles of each vertex
+		std::fill( triStart.begin(), triStart.end(), 0 );
+		for ( const Triangle & tri : current ) {
+			for ( int k = 0; k < 3; k++ )
+				triStart[tri[k] + 1]++;
+		}
+		for ( int v = 0; v < numVertices; v++ )
+			triStart[v + 1] += triStart[v];
+		vertexTris.resize( size_t( numTriangles ) * 3 );
+		{
+			std::vector<int>	fill( triStart.begin(), triStart.end() - 1 );
+			for ( int t = 0; t < numTriangles; t++ ) {
+				for ( int k = 0; k < 3; k++ )
+					vertexTris[fill[current[t][k]]++] = t;
+			}
+		}
+
+		// Topology of the welded mesh
+		edgeCount.clear();
+		edgeCount.reserve( numTriangles * 2 );
+		for ( const Triangle & tri : current ) {
+			for ( int k = 0; k < 3; k++ )
+				edgeCount[edgeKey( weld[tri[k]], weld[tri[( k + 1 ) % 3]] )]++;
+		}
+
+		for ( int v = 0; v < numVertices; v++ )
+			kind[v] = ( weldUsers[weld[v]] > 1 ? Locked : Manifold );
+		for ( const Triangle & tri : current ) {
+			for ( int k = 0; k < 3; k++ ) {
+				int	a = tri[k], b = tri[( k + 1 ) % 3];
+				int	n = edgeCount.value( edgeKey( weld[a], weld[b] ) );
+				if ( n == 1 ) {
+					if ( kind[a] == Manifold )
+						kind[a] = Border;
+					if ( kind[b] == Manifold )
+						kind[b] = Border;
+				} else if ( n > 2 ) {
+					kind[a] = kind[b] = Locked;
+				}
+			}
+		}
+
+		// Border planes, perpendicular to the triangle through the open edge
+		if ( firstPass ) {
+			firstPass = false;
+
+			for ( const Triangle & tri : current ) {
+				Vector3	n = faceNormal( positions[tri[0]], positions[tri[1]], positions[tri[2]] );
+				if ( !( n.length() > 0.0f ) )
+					continue;
+				n.normalize();
+
+				for ( int k = 0; k < 3; k++ ) {
+					int	a = tri[k], b = tri[( k + 1 ) % 3];
+					if ( edgeCount.value( edgeKey( weld[a], weld[b] ) ) != 1 )
+						continue;
+
+					Vector3	e = positions[b] - positions[a];
+					double	len2 = double( e.squaredLength() );
+					Vector3	pn = Vector3::crossproduct( e, n );
+					if ( !( pn.length() > 0.0f ) )
+						continue;
+					pn.normalize();
+
+					quadrics[a].addPlane( pn, positions[a], len2 * borderWeight );
+					quadrics[b].addPlane( pn, positions[b], len2 * borderWeight );
+				}
+			}
+		}
+
+		auto attributeError = [&]( int from, int to ) {
+			if ( !stride )
+				return 0.0;
+
+			const Vector3 &	p = positions[to];
+			const float *	s = options.attributes.constData() + size_t( to ) * stride;
+			double	error = 0.0, weight = 0.0;
+
+			for ( int i = triStart[from]; i < triStart[from + 1]; i++ ) {
+				const Triangle &	tri = current[vertexTris[i]];
+
+				// Barycentric coordinates of p projected onto the plane of the triangle
+				Vector3	e0 = positions[tri[1]] - positions[tri[0]];
+				Vector3	e1 = positions[tri[2]] - positions[tri[0]];
+				Vector3	e2 = p - positions[tri[0]];
+				double	d00 = Vector3::dotproduct( e0, e0 ), d01 = Vector3::dotproduct( e0, e1 );
+				double	d11 = Vector3::dotproduct( e1, e1 ), d20 = Vector3::dotproduct( e2, e0 );
+				double	d21 = Vector3::dotproduct( e2, e1 );
+				double	denom = d00 * d11 - d01 * d01;
+				if ( !( denom > 0.0 ) )
+					continue;
+				double	v = ( d11 * d20 - d01 * d21 ) / denom;
+				double	w = ( d00 * d21 - d01 * d20 ) / denom;
+				double	u = 1.0 - v - w;
+				double	area = std::sqrt( denom ) * 0.5;
+
+				const float *	s0 = options.attributes.constData() + size_t( tri[0] ) * stride;
+				const float *	s1 = options.attributes.constData() + size_t( tri[1] ) * stride;
+				const float *	s2 = options.attributes.constData() + size_t( tri[2] ) * stride;
+				double	e = 0.0;
+				for ( int k = 0; k < stride; k++ ) {
+					double	d = u * s0[k] + v * s1[k] + w * s2[k] - s[k];
+					e += d * d * attributeScale[k];
+				}
+
+				error += e * area;
+				weight += area;
+			}
+
+			return ( weight > 0.0 ? error / weight : 0.0 );
+		};
+
+		// Candidate collapses within the error limit
+		collapses.clear();
+		for ( const Triangle & tri : current ) {
+			for ( int k = 0; k < 3; k++ ) {
+				int	a = tri[k], b = tri[( k + 1 ) % 3];
+
+				for ( int dir = 0; dir < 2; dir++ ) {
+					if ( kind[a] == Manifold
+						 || ( kind[a] == Border && kind[b] != Manifold && edgeCount.value( edgeKey( weld[a], weld[b] ) ) == 1 ) ) {
+						double	cost = quadrics[a].error( positions[b] ) + attributeError( a, b );
+						if ( cost <= errorLimit )
+							collapses.push_back( { a, b, cost } );
+					}
+					std::swap( a, b );
+				}
+			}
+		}
+
+		std::sort( collapses.begin(), collapses.end(), []( const Collapse & x, const Collapse & y ) {
+			return x.cost < y.cost;
+		} );
+
+		for ( int v = 0; v < numVertices; v++ ) {
+			collapseTo[v] = v;
+			touched[v] = false;
+		}
+
+		int	remaining = numTriangles;
+		int	applied = 0;
+
+		for ( const Collapse & c : collapses ) {
+			if ( remaining <= target )
+				break;
+			if ( touched[c.from] || touched[c.to] )
+				continue;
+
+			// Reject collapses flipping or degenerating any of the remaining triangles
+			bool	valid = true;
+			int	removed = 0;
+			for ( int i = triStart[c.from]; i < triStart[c.from + 1] && valid; i++ ) {
+				const Triangle &	tri = current[vertexTris[i]];
+				if ( tri[0] == c.to || tri[1] == c.to || tri[2] == c.to ) {
+					removed++;
+					continue;
+				}
+
+				Vector3	p[3], q[3];
+				for ( int k = 0; k < 3; k++ ) {
+					p[k] = positions[tri[k]];
+					q[k] = ( tri[k] == c.from ? positions[c.to] : p[k] );
+				}
+				Vector3	n0 = faceNormal( p[0], p[1], p[2] );
+				Vector3	n1 = faceNormal( q[0], q[1], q[2] );
+				if ( Vector3::dotproduct( n0, n1 ) <= 0.0f )
+					valid = false;
+			}
+			if ( !valid || !removed )
+				continue;
+
+			collapseTo[c.from] = c.to;
+			quadrics[c.to] += quadrics[c.from];
+			remaining -= removed;
+			applied++;
+			maxCost = std::max( maxCost, c.cost );
+
+			// The neighbors are moved by this collapse, their own costs and flip tests are out of date
+			for ( int i = triStart[c.from]; i < triStart[c.from + 1]; i++ ) {
+				const Triangle &	tri = current[vertexTris[i]];
+				for ( int k = 0; k < 3; k++ )
+					touched[tri[k]] = true;
+			}
+		}
+
+		if ( !applied )
+			break;
+
+		QVector<Triangle>	next;
+		next.reserve( remaining );
+		for ( const Triangle & tri : current ) {
+			Triangle	t( quint16( collapseTo[tri[0]] ), quint16( collapseTo[tri[1]] ), quint16( collapseTo[tri[2]] ) );
+			if ( t[0] != t[1] && t[1] != t[2] && t[2] != t[0] )
+				next.append( t );
+		}
+		current = next;
+	}
+
+	if ( resultError )
+		*resultError = float( std::sqrt( maxCost ) / extent );
+
+	return current;
+}
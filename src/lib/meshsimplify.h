@@ -0,0 +1,41 @@
+#ifndef MESHSIMPLIFY_H
+#define MESHSIMPLIFY_H
+
+#include <QVector>
+
+
+class Triangle;
+class Vector3;
+
+//! Options for simplifyMesh()
+struct SimplifyOptions
+{
+	//! Triangle count to stop at
+	int targetTriangles = 0;
+	//! Largest error allowed, relative to the diagonal of the bounding box of the mesh
+	float maxError = 0.01f;
+
+	//! Per vertex attributes, attributeStride floats for each vertex, may be empty
+	QVector<float> attributes;
+	int attributeStride = 0;
+	//! Weight of each attribute, an error of 1.0 in the attribute counts as maxError times the weight
+	QVector<float> attributeWeights;
+};
+
+//! Simplifies a triangle list with half-edge collapses ordered by quadric error
+/*!
+ * Vertices are never moved or created, so all vertex data stays valid and the result only
+ * references a subset of the original vertices.
+ * Vertices sharing a position with another vertex (UV and normal seams) and vertices on non-manifold
+ * edges are kept, and open borders are only collapsed along themselves.
+ *
+ * @param positions	The vertex positions
+ * @param triangles	The triangles to simplify
+ * @param options	The target triangle count, the error limit and the attributes
+ * @param resultError	If not null, receives the largest error of the collapses, relative to the mesh size
+ * @return			The simplified triangles
+ */
+QVector<Triangle> simplifyMesh( const QVector<Vector3> & positions, const QVector<Triangle> & triangles,
+								const SimplifyOptions & options, float * resultError = nullptr );
+
+#endif
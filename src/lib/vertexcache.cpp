@@ -0,0 +1,229 @@
+#include "vertexcache.h"
+#include "data/niftypes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+/*
+	Forsyth's algorithm scores each vertex by its position in a simulated LRU cache and by the
+	number of triangles still using it, and greedily adds the triangle with the highest total score.
+	See https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+*/
+
+namespace
+{
+constexpr int	lruCacheSize = 32;
+constexpr float	cacheDecayPower = 1.5f;
+constexpr float	lastTriScore = 0.75f;
+constexpr float	valenceBoostScale = 2.0f;
+constexpr float	valenceBoostPower = 0.5f;
+
+float vertexScore( int cachePosition, int remainingTriangles )
+{
+	if ( remainingTriangles <= 0 )
+		return -1.0f;
+
+	float	score = 0.0f;
+	if ( cachePosition >= 0 ) {
+		// The vertices of the last triangle get a fixed score, so that the next one does not simply reuse its edge
+		if ( cachePosition < 3 )
+			score = lastTriScore;
+		else
+			score = std::pow( 1.0f - float( cachePosition - 3 ) / float( lruCacheSize - 3 ), cacheDecayPower );
+	}
+
+	// Boost vertices with few remaining triangles, to finish them off and keep them out of the cache
+	score += valenceBoostScale * std::pow( float( remainingTriangles ), -valenceBoostPower );
+
+	return score;
+}
+
+int countCacheMisses( const QVector<Triangle> & triangles, int cacheSize )
+{
+	std::vector<int>	fifo( size_t( std::max( cacheSize, 1 ) ), -1 );
+	size_t	next = 0;
+	int	misses = 0;
+
+	for ( const Triangle & tri : triangles ) {
+		for ( int k = 0; k < 3; k++ ) {
+			int	v = tri[k];
+			if ( std::find( fifo.begin(), fifo.end(), v ) != fifo.end() )
+				continue;
+
+			fifo[next] = v;
+			next = ( next + 1 ) % fifo.size();
+			misses++;
+		}
+	}
+
+	return misses;
+}
+}
+
+QVector<Triangle> optimizeVertexCache( const QVector<Triangle> & triangles, int numVertices )
+{
+	int	numTriangles = triangles.count();
+
+	for ( const Triangle & tri : triangles ) {
+		if ( tri[0] >= numVertices || tri[1] >= numVertices || tri[2] >= numVertices )
+			return triangles;
+	}
+
+	// Triangles of each vertex, the first remaining[v] entries are the ones not added yet
+	std::vector<int>	triStart( size_t( numVertices ) + 1, 0 );
+	for ( const Triangle & tri : triangles ) {
+		for ( int k = 0; k < 3; k++ )
+			triStart[tri[k] + 1]++;
+	}
+	for ( int v = 0; v < numVertices; v++ )
+		triStart[v + 1] += triStart[v];
+
+	std::vector<int>	remaining( size_t( numVertices ), 0 );
+	std::vector<int>	vertexTris( size_t( numTriangles ) * 3 );
+	for ( int t = 0; t < numTriangles; t++ ) {
+		for ( int k = 0; k < 3; k++ ) {
+			int	v = triangles[t][k];
+			vertexTris[triStart[v] + remaining[v]++] = t;
+		}
+	}
+
+	std::vector<int>	cachePosition( size_t( numVertices ), -1 );
+	std::vector<float>	vScore( size_t( numVertices ), 0.0f );
+	std::vector<float>	tScore( size_t( numTriangles ), 0.0f );
+	std::vector<bool>	added( size_t( numTriangles ), false );
+
+	for ( int v = 0; v < numVertices; v++ ) {
+		vScore[v] = vertexScore( -1, remaining[v] );
+		for ( int i = triStart[v]; i < triStart[v] + remaining[v]; i++ )
+			tScore[vertexTris[i]] += vScore[v];
+	}
+
+	auto updateScore = [&]( int v ) {
+		float	score = vertexScore( cachePosition[v], remaining[v] );
+		float	delta = score - vScore[v];
+		vScore[v] = score;
+		for ( int i = triStart[v]; i < triStart[v] + remaining[v]; i++ )
+			tScore[vertexTris[i]] += delta;
+	};
+
+	int	best = int( std::max_element( tScore.begin(), tScore.end() ) - tScore.begin() );
+	int	scanPos = 0;
+
+	std::vector<int>	cache;
+	cache.reserve( lruCacheSize + 3 );
+	std::vector<int>	evicted;
+
+	QVector<Triangle>	result;
+	result.reserve( numTriangles );
+
+	while ( result.count() < numTriangles ) {
+		if ( best < 0 ) {
+			// Nothing in the cache has triangles left, continue with the first triangle not added yet
+			while ( added[scanPos] )
+				scanPos++;
+			best = scanPos;
+		}
+
+		const Triangle &	tri = triangles[best];
+		added[best] = true;
+		result.append( tri );
+
+		for ( int k = 2; k >= 0; k-- ) {
+			int	v = tri[k];
+
+			// Move the triangle out of the remaining range of the vertex
+			int	first = triStart[v];
+			int	last = first + remaining[v] - 1;
+			for ( int i = first; i <= last; i++ ) {
+				if ( vertexTris[i] == best ) {
+					std::swap( vertexTris[i], vertexTris[last] );
+					break;
+				}
+			}
+			remaining[v]--;
+
+			auto	it = std::find( cache.begin(), cache.end(), v );
+			if ( it != cache.end() )
+				cache.erase( it );
+			cache.insert( cache.begin(), v );
+		}
+
+		evicted.clear();
+		while ( int( cache.size() ) > lruCacheSize ) {
+			evicted.push_back( cache.back() );
+			cache.pop_back();
+		}
+
+		for ( int v : evicted ) {
+			cachePosition[v] = -1;
+			updateScore( v );
+		}
+		for ( int i = 0; i < int( cache.size() ); i++ ) {
+			cachePosition[cache[i]] = i;
+			updateScore( cache[i] );
+		}
+
+		// Only the triangles of cached vertices had their scores changed
+		best = -1;
+		float	bestScore = -1.0f;
+		for ( int v : cache ) {
+			for ( int i = triStart[v]; i < triStart[v] + remaining[v]; i++ ) {
+				int	t = vertexTris[i];
+				if ( tScore[t] > bestScore ) {
+					bestScore = tScore[t];
+					best = t;
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+QVector<int> optimizeVertexFetch( const QVector<Triangle> & triangles, int numVertices )
+{
+	QVector<int>	remap( numVertices, -1 );
+	int	next = 0;
+
+	for ( const Triangle & tri : triangles ) {
+		for ( int k = 0; k < 3; k++ ) {
+			int	v = tri[k];
+			if ( v < numVertices && remap[v] < 0 )
+				remap[v] = next++;
+		}
+	}
+
+	for ( int v = 0; v < numVertices; v++ ) {
+		if ( remap[v] < 0 )
+			remap[v] = next++;
+	}
+
+	return remap;
+}
+
+double averageCacheMissRatio( const QVector<Triangle> & triangles, int cacheSize )
+{
+	if ( triangles.isEmpty() )
+		return 0.0;
+
+	return double( countCacheMisses( triangles, cacheSize ) ) / double( triangles.count() );
+}
+
+double averageTransformToVertexRatio( const QVector<Triangle> & triangles, int cacheSize )
+{
+	std::vector<int>	used;
+	used.reserve( size_t( triangles.count() ) * 3 );
+	for ( const Triangle & tri : triangles ) {
+		for ( int k = 0; k < 3; k++ )
+			used.push_back( tri[k] );
+	}
+	std::sort( used.begin(), used.end() );
+	used.erase( std::unique( used.begin(), used.end() ), used.end() );
+
+	if ( used.empty() )
+		return 0.0;
+
+	return double( countCacheMisses( triangles, cacheSize ) ) / double( used.size() );
+}
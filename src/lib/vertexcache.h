@@ -0,0 +1,19 @@
+#ifndef VERTEXCACHE_H
+#define VERTEXCACHE_H
+
+#include <QVector>
+
+
+class Triangle;
+
+//! Reorders triangles for the post-transform vertex cache, using Tom Forsyth's linear-speed algorithm
+QVector<Triangle> optimizeVertexCache( const QVector<Triangle> & triangles, int numVertices );
+//! Returns the new index of each vertex when the vertices are ordered by first use, unused vertices last
+QVector<int> optimizeVertexFetch( const QVector<Triangle> & triangles, int numVertices );
+
+//! Average number of vertex cache misses per triangle (ACMR) with a FIFO cache of cacheSize vertices
+double averageCacheMissRatio( const QVector<Triangle> & triangles, int cacheSize = 16 );
+//! Average number of vertex cache misses per referenced vertex (ATVR), 1.0 is the optimum
+double averageTransformToVertexRatio( const QVector<Triangle> & triangles, int cacheSize = 16 );
+
+#endif
@@ -31,8 +31,12 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***** END LICENCE BLOCK *****/
 
 #include "nifskope.h"
+#include "nifbench.h"
+#include "trace.h"
 #include "version.h"
 #include "data/nifvalue.h"
+#include "gl/thumbnailer.h"
+#include "model/nifdiff.h"
 #include "model/nifmodel.h"
 #include "model/kfmmodel.h"
 
@@ -42,21 +46,40 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QCommandLineParser>
 #include <QDesktopServices>
 #include <QDir>
+#include <QFile>
+#include <QJsonDocument>
 #include <QSettings>
 #include <QStack>
+#include <QTextStream>
 #include <QUdpSocket>
 #include <QUrl>
 
 
+static bool hasArgument( int argc, char * argv[], const char * arg )
+{
+	for ( int i = 1; i < argc; ++i ) {
+		if ( !qstrcmp( argv[i], arg ) )
+			return true;
+	}
+	return false;
+}
+
 QCoreApplication * createApplication( int &argc, char *argv[] )
 {
 	QApplication::setAttribute( Qt::AA_UseDesktopOpenGL );
-	// Iterate over args
-	for ( int i = 1; i < argc; ++i ) {
-		// -no-gui: start as core app without all the GUI overhead
-		if ( !qstrcmp( argv[i], "-no-gui" ) ) {
-			return new QCoreApplication( argc, argv );
+
+	// -no-gui: start as core app without all the GUI overhead
+	if ( hasArgument( argc, argv, "-no-gui" ) ) {
+		// Rendering needs a GUI application, but no window
+		if ( hasArgument( argc, argv, "-thumbnails" ) || hasArgument( argc, argv, "-bench" ) ) {
+#ifdef Q_OS_LINUX
+			if ( qEnvironmentVariableIsEmpty( "QT_QPA_PLATFORM" ) && qEnvironmentVariableIsEmpty( "DISPLAY" )
+				&& qEnvironmentVariableIsEmpty( "WAYLAND_DISPLAY" ) )
+				qputenv( "QT_QPA_PLATFORM", "offscreen" );
+#endif
+			return new QApplication( argc, argv );
 		}
+		return new QCoreApplication( argc, argv );
 	}
 	return new QApplication( argc, argv );
 }
@@ -69,9 +92,11 @@ QCoreApplication * createApplication( int &argc, char *argv[] )
 //! The main program
 int main( int argc, char * argv[] )
 {
+	bool batch = hasArgument( argc, argv, "-no-gui" );
 	QScopedPointer<QCoreApplication> app( createApplication( argc, argv ) );
 
-	if ( auto a = qobject_cast<QApplication *>(app.data()) ) {
+	auto a = qobject_cast<QApplication *>(app.data());
+	if ( a && !batch ) {
 		a->setOrganizationName( "NifTools" );
 		a->setOrganizationDomain( "niftools.org" );
 		a->setApplicationName( "NifSkope " + NifSkopeVersion::rawToMajMin( NIFSKOPE_VERSION ) );
@@ -155,7 +180,199 @@ int main( int argc, char * argv[] )
 			return 0;
 		}
 	} else {
-		// Future command line batch tools here
+		// Command line batch tools
+		QCoreApplication::setOrganizationName( "NifTools" );
+		QCoreApplication::setOrganizationDomain( "niftools.org" );
+		QCoreApplication::setApplicationName( "NifSkope " + NifSkopeVersion::rawToMajMin( NIFSKOPE_VERSION ) );
+		QCoreApplication::setApplicationVersion( NIFSKOPE_VERSION );
+
+		QCommandLineParser parser;
+		parser.setSingleDashWordOptionMode( QCommandLineParser::ParseAsLongOptions );
+		parser.addHelpOption();
+
+		QCommandLineOption noGuiOption( "no-gui", "Run without the user interface" );
+		parser.addOption( noGuiOption );
+
+		QCommandLineOption diffOption( "diff", "Compare two NIF files and list the differences, exits with 0 if they are equal and 1 if not" );
+		parser.addOption( diffOption );
+
+		QCommandLineOption thumbOption( "thumbnails", "Render images of the NIF files, folders, archives or file lists into a folder, with a manifest.json", "folder" );
+		QCommandLineOption viewsOption( "views", "Views to render: top, bottom, front, back, left, right, angle", "views", "angle" );
+		QCommandLineOption framesOption( "frames", "Number of turntable frames to render", "count", "0" );
+		QCommandLineOption sizeOption( "size", "Image size", "WxH", "256x256" );
+		QCommandLineOption formatOption( "format", "Image format: png, jpg, webp or bmp", "format", "png" );
+		QCommandLineOption samplesOption( "samples", "Multisampling samples", "count", "4" );
+		QCommandLineOption backgroundOption( "background", "Background color, transparent if not set", "color" );
+		parser.addOptions( { thumbOption, viewsOption, framesOption, sizeOption, formatOption, samplesOption, backgroundOption } );
+
+		NifBench::Options benchDefaults;
+		QCommandLineOption benchOption( "bench", "Time loading, saving, scene setup and spells on generated files, and write the results", "results.json" );
+		QCommandLineOption gamesOption( "games", "Games to generate files for: " + NifBench::games().join( ", " ), "games" );
+		QCommandLineOption shapesOption( "shapes", "Number of shapes in each file", "count", QString::number( benchDefaults.shapes ) );
+		QCommandLineOption verticesOption( "vertices", "Number of vertices of each shape", "count", QString::number( benchDefaults.vertices ) );
+		QCommandLineOption bonesOption( "bones", "Number of bones, 0 for no skinning", "count", QString::number( benchDefaults.bones ) );
+		QCommandLineOption keysOption( "keys", "Number of animation keys of each bone, 0 for no animation", "count", QString::number( benchDefaults.keys ) );
+		QCommandLineOption warmupOption( "warmup", "Iterations of each stage before timing", "count", QString::number( benchDefaults.warmup ) );
+		QCommandLineOption repeatOption( "repeat", "Timed iterations of each stage", "count", QString::number( benchDefaults.repetitions ) );
+		QCommandLineOption baselineOption( "baseline", "Earlier results to compare with, exits with 1 if a stage got slower", "results.json" );
+		QCommandLineOption thresholdOption( "threshold", "How much slower than the baseline a stage may be", "percent", "10" );
+		parser.addOptions( { benchOption, gamesOption, shapesOption, verticesOption, bonesOption, keysOption, warmupOption, repeatOption,
+			baselineOption, thresholdOption } );
+
+		QCommandLineOption traceOption( "trace", "Record trace zones and write them as a Chrome trace", "trace.json" );
+		parser.addOption( traceOption );
+
+		parser.addPositionalArgument( "files", "The files to process" );
+
+		parser.process( *app );
+
+		// Writes the trace when the batch tool returns
+		struct TraceFile
+		{
+			QString fileName;
+
+			~TraceFile()
+			{
+				if ( fileName.isEmpty() )
+					return;
+
+				QString error;
+				if ( !Trace::save( fileName, &error ) )
+					QTextStream( stderr ) << "Could not write " << fileName << ": " << error << '\n';
+			}
+		} traceFile;
+
+		if ( parser.isSet( traceOption ) ) {
+			traceFile.fileName = parser.value( traceOption );
+			Trace::setRecording( true );
+		}
+
+		if ( parser.isSet( diffOption ) ) {
+			QTextStream err( stderr );
+			QStringList files = parser.positionalArguments();
+			if ( files.count() != 2 ) {
+				err << "-diff needs two files\n";
+				return 2;
+			}
+
+			NifModel::loadXML();
+
+			QVector<NifDifference> diffs;
+			QString error;
+			if ( !NifDiff::compareFiles( files[0], files[1], diffs, &error ) ) {
+				err << error << '\n';
+				return 2;
+			}
+
+			QTextStream out( stdout );
+			for ( const NifDifference & d : diffs )
+				out << d.toString() << '\n';
+
+			return diffs.isEmpty() ? 0 : 1;
+		}
+
+		if ( parser.isSet( thumbOption ) ) {
+			QTextStream err( stderr );
+
+			Thumbnailer::Options opts;
+			opts.outputFolder = parser.value( thumbOption );
+			opts.turntableFrames = parser.value( framesOption ).toInt();
+			opts.format = parser.value( formatOption );
+			opts.samples = parser.value( samplesOption ).toInt();
+
+			QStringList size = parser.value( sizeOption ).split( 'x' );
+			opts.size = QSize( size.first().toInt(), size.last().toInt() );
+
+			if ( parser.isSet( backgroundOption ) )
+				opts.background = QColor( parser.value( backgroundOption ) );
+
+			// Only turntable frames if views were not asked for
+			if ( ( parser.isSet( viewsOption ) || opts.turntableFrames <= 0 )
+				&& !Thumbnailer::parseViews( parser.value( viewsOption ), opts.views ) ) {
+				err << "Unknown view in " << parser.value( viewsOption ) << '\n';
+				return 2;
+			}
+
+			if ( opts.size.isEmpty() || parser.positionalArguments().isEmpty() )
+				parser.showHelp( 2 );
+
+			NifModel::loadXML();
+			(void) Game::GameManager::get();
+
+			Thumbnailer thumbnailer( opts );
+			QString error;
+			if ( !QDir().mkpath( opts.outputFolder ) || !thumbnailer.initialize( &error ) ) {
+				err << ( error.isEmpty() ? QString( "Could not create %1" ).arg( opts.outputFolder ) : error ) << '\n';
+				return 2;
+			}
+
+			return thumbnailer.run( parser.positionalArguments() ) > 0 ? 1 : 0;
+		}
+
+		if ( parser.isSet( benchOption ) ) {
+			QTextStream err( stderr );
+
+			NifBench::Options opts;
+			if ( parser.isSet( gamesOption ) )
+				opts.games = parser.value( gamesOption ).split( ',', Qt::SkipEmptyParts );
+			for ( const QString & game : opts.games ) {
+				if ( !NifBench::games().contains( game ) ) {
+					err << "Unknown game " << game << '\n';
+					return 2;
+				}
+			}
+
+			opts.shapes = parser.value( shapesOption ).toInt();
+			opts.vertices = parser.value( verticesOption ).toInt();
+			opts.bones = parser.value( bonesOption ).toInt();
+			opts.keys = parser.value( keysOption ).toInt();
+			opts.warmup = parser.value( warmupOption ).toInt();
+			opts.repetitions = parser.value( repeatOption ).toInt();
+			if ( opts.repetitions < 1 ) {
+				err << "The number of repetitions must be at least 1" << '\n';
+				return 2;
+			}
+			if ( opts.warmup < 0 ) {
+				err << "The number of warmup iterations must not be negative" << '\n';
+				return 2;
+			}
+
+			QJsonObject baseline;
+			if ( parser.isSet( baselineOption ) ) {
+				QFile f( parser.value( baselineOption ) );
+				if ( !f.open( QIODevice::ReadOnly ) ) {
+					err << "Could not open " << f.fileName() << '\n';
+					return 2;
+				}
+				baseline = QJsonDocument::fromJson( f.readAll() ).object();
+			}
+
+			NifModel::loadXML();
+
+			NifBench bench( opts );
+			QString error;
+			if ( !bench.initialize( &error ) )
+				err << error << '\n';
+
+			QJsonObject results = bench.run();
+
+			QFile f( parser.value( benchOption ) );
+			if ( !f.open( QIODevice::WriteOnly ) ) {
+				err << "Could not write " << f.fileName() << '\n';
+				return 2;
+			}
+			f.write( QJsonDocument( results ).toJson() );
+			f.close();
+
+			QTextStream out( stdout );
+			NifBench::print( results, out );
+
+			if ( baseline.isEmpty() )
+				return 0;
+
+			out << '\n';
+			return NifBench::compare( results, baseline, parser.value( thresholdOption ).toDouble(), out ) > 0 ? 1 : 0;
+		}
 	}
 
 	return 0;
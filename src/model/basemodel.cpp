@@ -35,16 +35,33 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "xml/xmlconfig.h"
 
+#include <QApplication>
 #include <QByteArray>
 #include <QColor>
 #include <QBuffer>
 #include <QFile>
 #include <QFileInfo>
+#include <QPointer>
+#include <QThread>
 #include <QTime>
 
 
 //! @file basemodel.cpp Abstract base class for NIF data models
 
+//! Shows a message to the user, passing it to the GUI thread if a model is loaded on another thread
+static void appendUserMessage( QWidget * parent, const QString & message, const QString & details, QMessageBox::Icon lvl )
+{
+	if ( !qApp || QThread::currentThread() == qApp->thread() ) {
+		Message::append( parent, message, details, lvl );
+		return;
+	}
+
+	QPointer<QWidget> p( parent );
+	QMetaObject::invokeMethod( qApp, [p, message, details, lvl]() {
+		Message::append( p, message, details, lvl );
+	}, Qt::QueuedConnection );
+}
+
 /*
  *  BaseModel
  */
@@ -70,7 +87,7 @@ void BaseModel::setMessageMode( MsgMode mode )
 void BaseModel::logMessage( const QString & message, const QString & details, QMessageBox::Icon lvl ) const
 {
 	if ( msgMode == MSG_USER ) {
-		Message::append( nullptr, message, details, lvl );
+		appendUserMessage( nullptr, message, details, lvl );
 	} else {
 		testMsg( details );
 	}
@@ -93,6 +110,7 @@ inline NifItem * indexToItem( const QModelIndex & index )
 
 void BaseModel::beginInsertRows( const QModelIndex & parent, int first, int last )
 {
+	onItemChildrenChange( parent.isValid() ? indexToItem( parent ) : root );
 	setState( Inserting );
 	QAbstractItemModel::beginInsertRows( parent, first, last );
 }
@@ -105,6 +123,7 @@ void BaseModel::endInsertRows()
 
 void BaseModel::beginRemoveRows( const QModelIndex & parent, int first, int last )
 {
+	onItemChildrenChange( parent.isValid() ? indexToItem( parent ) : root );
 	setState( Removing );
 	QAbstractItemModel::beginRemoveRows( parent, first, last );
 }
@@ -574,6 +593,11 @@ bool BaseModel::saveToFile( const QString & str ) const
 	if ( buf.open( QIODevice::WriteOnly ) && save( buf ) )
 		success = f.open( QIODevice::WriteOnly ) && f.write( buf.data() ) > 0;
 
+	if ( success && f.size() == buf.size() ) {
+		f.close();
+		onFileSaved( str );
+	}
+
 	return success;
 }
 
@@ -835,7 +859,7 @@ QString BaseModel::topItemRepr( const NifItem * item ) const
 void BaseModel::reportError( const QString & err ) const
 {
 	if ( msgMode == MSG_USER )
-		Message::append(getWindow(), "Parsing warnings:", err);
+		appendUserMessage( getWindow(), "Parsing warnings:", err, QMessageBox::Warning );
 	else
 		testMsg(err);
 }
@@ -562,7 +562,11 @@ protected:
 	void endRemoveRows();
 
 	virtual void onItemValueChange( NifItem * item );
-	void onArrayValuesChange( NifItem * arrayRootItem );
+	virtual void onArrayValuesChange( NifItem * arrayRootItem );
+	//! Called before children are inserted into or removed from an item
+	virtual void onItemChildrenChange( NifItem * parent ) { Q_UNUSED( parent ); }
+	//! Called after saveToFile() has written the whole file
+	virtual void onFileSaved( const QString & fname ) const { Q_UNUSED( fname ); }
 
 	//! NifSkope window the model belongs to
 	QWidget * parentWindow;
@@ -0,0 +1,409 @@
+#include "nifdiff.h"
+
+#include "model/nifmodel.h"
+
+#include <QList>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <functional>
+
+
+//! \file nifdiff.cpp NifDiff implementation
+
+QString NifDifference::blockText() const
+{
+	if ( blockA >= 0 && blockB >= 0 && blockA != blockB )
+		return QString( "[%1 -> %2] %3" ).arg( blockA ).arg( blockB ).arg( type );
+	if ( blockA >= 0 || blockB >= 0 )
+		return QString( "[%1] %2" ).arg( blockA >= 0 ? blockA : blockB ).arg( type );
+
+	return type;
+}
+
+QString NifDifference::toString() const
+{
+	if ( kind == BlockRemoved )
+		return "- " + blockText();
+	if ( kind == BlockAdded )
+		return "+ " + blockText();
+
+	QString line = blockText();
+
+	if ( !path.isEmpty() )
+		line += ": " + path;
+
+	if ( kind == SizeChanged )
+		return line + QString( " size %1 -> %2" ).arg( valueA, valueB );
+	if ( kind == StructureChanged && valueA.isEmpty() && valueB.isEmpty() )
+		return line + " structure differs";
+	if ( valueA.isEmpty() && valueB.isEmpty() )
+		return line + " changed";
+
+	return line + QString( ": %1 -> %2" ).arg( valueA, valueB );
+}
+
+
+//! The path of a child below path, array entries are written as indices
+static QString childPath( const QString & path, const NifItem * parent, int row )
+{
+	if ( parent->isArray() )
+		return QString( "%1[%2]" ).arg( path ).arg( row );
+
+	const QString & name = parent->child( row )->name();
+	return path.isEmpty() ? name : path + '/' + name;
+}
+
+//! The Name of a block, empty if it has none
+static QString blockName( const NifModel * nif, const NifItem * block )
+{
+	const NifItem * item = nif->getItem( block, "Name" );
+	return item ? nif->resolveString( item ) : QString();
+}
+
+NifDiff::NifDiff( const NifModel * a, const NifModel * b )
+	: nifA( a ), nifB( b )
+{
+}
+
+bool NifDiff::compare()
+{
+	diffs.clear();
+
+	computeDigests();
+	alignBlocks();
+	compareHeader();
+
+	for ( qint32 a = 0; a < blockMap.count(); a++ ) {
+		const NifItem * blockA = nifA->getBlockItem( a );
+		curA = a;
+		curB = blockMap[a];
+		curType = blockA->name();
+
+		if ( curB < 0 ) {
+			addDifference( NifDifference::BlockRemoved, QString() );
+			continue;
+		}
+
+		const NifItem * blockB = nifB->getBlockItem( curB );
+		if ( sameDigest( blockA, blockB ) )
+			compareLinks( blockA, blockB, QString() );
+		else
+			compareItems( blockA, blockB, QString() );
+	}
+
+	for ( qint32 b = 0; b < reverseMap.count(); b++ ) {
+		if ( reverseMap[b] >= 0 )
+			continue;
+
+		curA = -1;
+		curB = b;
+		curType = nifB->getBlockItem( b )->name();
+		addDifference( NifDifference::BlockAdded, QString() );
+	}
+
+	const NifItem * footerA = nifA->getFooterItem();
+	const NifItem * footerB = nifB->getFooterItem();
+	if ( footerA && footerB ) {
+		curA = curB = -1;
+		curType = tr( "Footer" );
+		compareItems( footerA, footerB, QString() );
+	}
+
+	return diffs.isEmpty();
+}
+
+void NifDiff::computeDigests()
+{
+	digestsA.clear();
+	digestsB.clear();
+
+	// The models are independent, hash the second one on the pool while this thread hashes the first
+	QSemaphore done;
+	QThreadPool::globalInstance()->start( [this, &done]() {
+		for ( qint32 b = 0; b < nifB->getBlockCount(); b++ )
+			nifB->contentDigest( nifB->getBlockItem( b ), &digestsB, false );
+		done.release();
+	} );
+
+	for ( qint32 a = 0; a < nifA->getBlockCount(); a++ )
+		nifA->contentDigest( nifA->getBlockItem( a ), &digestsA, false );
+
+	done.acquire();
+}
+
+void NifDiff::alignBlocks()
+{
+	int numA = nifA->getBlockCount();
+	int numB = nifB->getBlockCount();
+	blockMap.fill( -1, numA );
+	reverseMap.fill( -1, numB );
+
+	// Candidates of the second model by key, taken in file order
+	QHash<QByteArray, QList<qint32>> candidates;
+
+	auto matchBlocks = [&]( const std::function<QByteArray ( const NifModel *, const NifItem * )> & key ) {
+		candidates.clear();
+		for ( qint32 b = 0; b < numB; b++ ) {
+			if ( reverseMap[b] >= 0 )
+				continue;
+
+			QByteArray k = key( nifB, nifB->getBlockItem( b ) );
+			if ( !k.isEmpty() )
+				candidates[k].append( b );
+		}
+
+		for ( qint32 a = 0; a < numA; a++ ) {
+			if ( blockMap[a] >= 0 )
+				continue;
+
+			QByteArray k = key( nifA, nifA->getBlockItem( a ) );
+			auto it = candidates.find( k );
+			if ( k.isEmpty() || it == candidates.end() || it->isEmpty() )
+				continue;
+
+			qint32 b = it->takeFirst();
+			blockMap[a] = b;
+			reverseMap[b] = a;
+		}
+	};
+
+	// Identical blocks, wherever they are in the file
+	matchBlocks( [this]( const NifModel * nif, const NifItem * block ) -> QByteArray {
+		const auto & digests = ( nif == nifA ) ? digestsA : digestsB;
+		return block->name().toLatin1() + '\0' + digests.value( block );
+	} );
+
+	// Changed blocks that kept their name
+	matchBlocks( []( const NifModel * nif, const NifItem * block ) -> QByteArray {
+		QString name = blockName( nif, block );
+		return name.isEmpty() ? QByteArray() : block->name().toLatin1() + '\0' + name.toUtf8();
+	} );
+
+	// Anything else of the same type, in file order
+	matchBlocks( []( const NifModel *, const NifItem * block ) -> QByteArray {
+		return block->name().toLatin1();
+	} );
+}
+
+void NifDiff::compareHeader()
+{
+	curA = curB = -1;
+	curType = tr( "Header" );
+
+	if ( nifA->getVersionNumber() != nifB->getVersionNumber() )
+		addDifference( NifDifference::HeaderChanged, "Version", nifA->getVersion(), nifB->getVersion() );
+	if ( nifA->getUserVersion() != nifB->getUserVersion() )
+		addDifference( NifDifference::HeaderChanged, "User Version",
+			QString::number( nifA->getUserVersion() ), QString::number( nifB->getUserVersion() ) );
+	if ( nifA->getBSVersion() != nifB->getBSVersion() )
+		addDifference( NifDifference::HeaderChanged, "BS Version",
+			QString::number( nifA->getBSVersion() ), QString::number( nifB->getBSVersion() ) );
+}
+
+void NifDiff::compareItems( const NifItem * itemA, const NifItem * itemB, const QString & path )
+{
+	if ( itemA->childCount() != itemB->childCount() ) {
+		addDifference( NifDifference::StructureChanged, path );
+		return;
+	}
+
+	for ( int row = 0; row < itemA->childCount(); row++ ) {
+		const NifItem * childA = itemA->child( row );
+		const NifItem * childB = itemB->child( row );
+		if ( childA->name() != childB->name() ) {
+			addDifference( NifDifference::StructureChanged, path );
+			return;
+		}
+
+		if ( childA->isAbstract() )
+			continue;
+
+		bool activeA = nifA->evalCondition( childA );
+		bool activeB = nifB->evalCondition( childB );
+		if ( !activeA && !activeB )
+			continue;
+
+		QString p = childPath( path, itemA, row );
+		if ( activeA != activeB ) {
+			addDifference( NifDifference::StructureChanged, p,
+				activeA ? tr( "present" ) : tr( "absent" ), activeB ? tr( "present" ) : tr( "absent" ) );
+		} else if ( ( childA->isArray() || childA->childCount() > 0 ) && sameDigest( childA, childB ) ) {
+			// Equal arrays and compounds can still link to different blocks
+			compareLinks( childA, childB, p );
+		} else if ( childA->isArray() ) {
+			compareArray( childA, childB, p );
+		} else if ( childA->childCount() > 0 ) {
+			compareItems( childA, childB, p );
+		} else {
+			compareLeaf( childA, childB, p );
+		}
+	}
+}
+
+void NifDiff::compareArray( const NifItem * itemA, const NifItem * itemB, const QString & path )
+{
+	int countA = itemA->childCount();
+	int countB = itemB->childCount();
+	if ( countA != countB )
+		addDifference( NifDifference::SizeChanged, path, QString::number( countA ), QString::number( countB ) );
+
+	auto sameEntry = [this]( const NifItem * a, const NifItem * b ) {
+		if ( a->childCount() > 0 || b->childCount() > 0 )
+			return sameDigest( a, b );
+		return sameLeaf( a, b );
+	};
+
+	// Single entries are compared in detail, longer runs are reported as one range
+	auto reportRange = [&]( int first, int last ) {
+		if ( first < last ) {
+			addDifference( NifDifference::ValueChanged, QString( "%1[%2-%3]" ).arg( path ).arg( first ).arg( last ) );
+			return;
+		}
+
+		const NifItem * a = itemA->child( first );
+		const NifItem * b = itemB->child( first );
+		QString p = childPath( path, itemA, first );
+		if ( a->isArray() )
+			compareArray( a, b, p );
+		else if ( a->childCount() > 0 )
+			compareItems( a, b, p );
+		else
+			compareLeaf( a, b, p );
+	};
+
+	int count = std::min( countA, countB );
+	int first = -1;
+	for ( int i = 0; i <= count; i++ ) {
+		if ( i < count && !sameEntry( itemA->child( i ), itemB->child( i ) ) ) {
+			if ( first < 0 )
+				first = i;
+			continue;
+		}
+
+		if ( first >= 0 ) {
+			reportRange( first, i - 1 );
+			first = -1;
+		}
+
+		// Equal compounds can still link to different blocks
+		if ( i < count && itemA->child( i )->childCount() > 0 )
+			compareLinks( itemA->child( i ), itemB->child( i ), childPath( path, itemA, i ) );
+	}
+}
+
+void NifDiff::compareLinks( const NifItem * itemA, const NifItem * itemB, const QString & path )
+{
+	for ( int row : itemA->getLinkRows() ) {
+		const NifItem * childA = itemA->child( row );
+		const NifItem * childB = itemB->child( row );
+		if ( childB && nifA->evalCondition( childA ) )
+			compareLeaf( childA, childB, childPath( path, itemA, row ) );
+	}
+
+	for ( int row : itemA->getLinkAncestorRows() ) {
+		const NifItem * childA = itemA->child( row );
+		const NifItem * childB = itemB->child( row );
+		if ( childB && nifA->evalCondition( childA ) )
+			compareLinks( childA, childB, childPath( path, itemA, row ) );
+	}
+}
+
+void NifDiff::compareLeaf( const NifItem * itemA, const NifItem * itemB, const QString & path )
+{
+	if ( sameLeaf( itemA, itemB ) )
+		return;
+
+	auto kind = ( itemA->isLink() && itemB->isLink() ) ? NifDifference::LinkChanged : NifDifference::ValueChanged;
+	addDifference( kind, path, leafText( nifA, itemA ), leafText( nifB, itemB ) );
+}
+
+bool NifDiff::sameDigest( const NifItem * itemA, const NifItem * itemB ) const
+{
+	QByteArray d = digestsA.value( itemA );
+	return !d.isEmpty() && d == digestsB.value( itemB );
+}
+
+bool NifDiff::sameLeaf( const NifItem * itemA, const NifItem * itemB ) const
+{
+	if ( itemA->isLink() && itemB->isLink() )
+		return mapLink( itemA->getLinkValue() ) == itemB->getLinkValue();
+
+	if ( itemA->valueType() != itemB->valueType() )
+		return false;
+
+	if ( itemA->isString() || itemA->hasValueType( NifValue::tStringIndex ) )
+		return nifA->resolveString( itemA ) == nifB->resolveString( itemB );
+
+	return itemA->hasValueType( NifValue::tNone ) || itemA->value() == itemB->value();
+}
+
+qint32 NifDiff::mapLink( qint32 link ) const
+{
+	if ( link < 0 )
+		return -1;
+
+	// Links to removed blocks can never match
+	if ( link >= blockMap.count() || blockMap[link] < 0 )
+		return -2;
+
+	return blockMap[link];
+}
+
+QString NifDiff::leafText( const NifModel * nif, const NifItem * item ) const
+{
+	if ( item->isLink() ) {
+		qint32 link = item->getLinkValue();
+		const NifItem * block = nif->getBlockItem( link );
+		if ( !block )
+			return tr( "None" );
+
+		return QString( "%1 (%2)" ).arg( link ).arg( block->name() );
+	}
+
+	if ( item->isString() || item->hasValueType( NifValue::tStringIndex ) )
+		return nif->resolveString( item );
+
+	return item->getValueAsString();
+}
+
+void NifDiff::addDifference( NifDifference::Kind kind, const QString & path, const QString & valueA, const QString & valueB )
+{
+	NifDifference d;
+	d.kind = kind;
+	d.blockA = curA;
+	d.blockB = curB;
+	d.type = curType;
+	d.path = path;
+	d.valueA = valueA;
+	d.valueB = valueB;
+	diffs.append( d );
+}
+
+bool NifDiff::compareFiles( const QString & fileA, const QString & fileB, QVector<NifDifference> & diffs, QString * error )
+{
+	NifModel a, b;
+
+	// Load the second file on the pool while this thread loads the first
+	bool loadedB = false;
+	QSemaphore done;
+	QThreadPool::globalInstance()->start( [&b, &fileB, &loadedB, &done]() {
+		loadedB = b.loadFromFile( fileB );
+		done.release();
+	} );
+
+	bool loadedA = a.loadFromFile( fileA );
+	done.acquire();
+
+	if ( !loadedA || !loadedB ) {
+		if ( error )
+			*error = tr( "Could not load %1" ).arg( loadedA ? fileB : fileA );
+		return false;
+	}
+
+	NifDiff diff( &a, &b );
+	diff.compare();
+	diffs = diff.differences();
+	return true;
+}
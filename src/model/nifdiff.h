@@ -0,0 +1,107 @@
+#ifndef NIFDIFF_H
+#define NIFDIFF_H
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+
+//! \file nifdiff.h NifDiff, NifDifference
+
+class NifItem;
+class NifModel;
+
+//! A single difference found by NifDiff
+struct NifDifference
+{
+	enum Kind
+	{
+		HeaderChanged,   //!< A header field differs
+		BlockRemoved,    //!< A block of the first file has no counterpart in the second
+		BlockAdded,      //!< A block of the second file has no counterpart in the first
+		ValueChanged,    //!< A value, or a range of array entries, differs
+		SizeChanged,     //!< An array has a different size
+		LinkChanged,     //!< A link points to blocks that were not aligned with each other
+		StructureChanged //!< The fields of the block differ, for example when a condition changed
+	};
+
+	Kind kind;
+	//! The block in each file, -1 if there is none
+	qint32 blockA = -1, blockB = -1;
+	//! The block type
+	QString type;
+	//! The path of the field below the block, with array indices or ranges
+	QString path;
+	//! The value in each file, empty for ranges
+	QString valueA, valueB;
+
+	//! The block numbers and type, or only the type outside of blocks
+	QString blockText() const;
+	//! One line description, as printed by the command line diff
+	QString toString() const;
+};
+
+//! Structural comparison of two NIF models
+/*!
+ * Every block is hashed with NifModel::contentDigest(), ignoring link targets, and blocks of the two
+ * models are aligned by type and hash first, so reordered blocks are still found. Blocks that did not
+ * match are then paired by type and name, and finally by type in file order.
+ *
+ * Aligned blocks are compared field by field. Arrays and compound fields with equal hashes are
+ * skipped except for their links, which are compared through the alignment. Differing array entries
+ * are reported as ranges.
+ */
+class NifDiff final
+{
+	Q_DECLARE_TR_FUNCTIONS( NifDiff )
+
+public:
+	NifDiff( const NifModel * a, const NifModel * b );
+
+	//! Aligns and compares the models, returns true if no difference was found
+	bool compare();
+
+	//! The differences found by compare()
+	const QVector<NifDifference> & differences() const { return diffs; }
+	//! The block of the second model aligned with each block of the first, -1 for removed blocks
+	const QVector<qint32> & alignment() const { return blockMap; }
+
+	//! Loads and compares two files, returns false if either file could not be loaded
+	static bool compareFiles( const QString & fileA, const QString & fileB, QVector<NifDifference> & diffs, QString * error = nullptr );
+
+private:
+	void computeDigests();
+	void alignBlocks();
+	void compareHeader();
+
+	void compareItems( const NifItem * itemA, const NifItem * itemB, const QString & path );
+	void compareArray( const NifItem * itemA, const NifItem * itemB, const QString & path );
+	void compareLinks( const NifItem * itemA, const NifItem * itemB, const QString & path );
+	void compareLeaf( const NifItem * itemA, const NifItem * itemB, const QString & path );
+
+	bool sameDigest( const NifItem * itemA, const NifItem * itemB ) const;
+	bool sameLeaf( const NifItem * itemA, const NifItem * itemB ) const;
+	qint32 mapLink( qint32 link ) const;
+
+	QString leafText( const NifModel * nif, const NifItem * item ) const;
+	void addDifference( NifDifference::Kind kind, const QString & path, const QString & valueA = QString(), const QString & valueB = QString() );
+
+	const NifModel * nifA;
+	const NifModel * nifB;
+
+	//! Linkless digests of every block and compound field
+	QHash<const NifItem *, QByteArray> digestsA, digestsB;
+
+	QVector<qint32> blockMap;
+	QVector<qint32> reverseMap;
+
+	//! The blocks being compared
+	qint32 curA = -1, curB = -1;
+	QString curType;
+
+	QVector<NifDifference> diffs;
+};
+
+#endif
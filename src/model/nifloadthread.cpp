@@ -0,0 +1,35 @@
+#include "nifloadthread.h"
+
+#include <QBuffer>
+#include <QReadWriteLock>
+
+
+//! \file nifloadthread.cpp NifLoadThread implementation
+
+NifLoadThread::NifLoadThread( QObject * parent, const QString & file, const QByteArray & data )
+	: QThread( parent ), fileName( file ), fileData( data )
+{
+	model.setMessageMode( BaseModel::MSG_USER );
+}
+
+void NifLoadThread::cancel()
+{
+	cancelled = true;
+	model.requestAbort();
+}
+
+void NifLoadThread::run()
+{
+	QReadLocker lck( &NifModel::XMLlock );
+
+	if ( fileData.isNull() ) {
+		loaded = model.loadFromFile( fileName );
+	} else {
+		QBuffer buf( &fileData );
+		loaded = buf.open( QIODevice::ReadOnly ) && model.load( buf );
+	}
+
+	// Serializing the model can take as long as loading it, so it is not left to the GUI thread
+	if ( loaded && !cancelled && model.hasDigests() )
+		roundTrip = model.verifyRoundTrip( &roundTripDifference );
+}
@@ -0,0 +1,54 @@
+#ifndef NIFLOADTHREAD_H
+#define NIFLOADTHREAD_H
+
+#include "model/nifmodel.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QThread> // Inherited
+
+
+//! \file nifloadthread.h NifLoadThread
+
+//! Loads a NIF file into a detached NifModel on a worker thread
+/*!
+ * The model only belongs to the thread until it has finished, then the owner reads it or moves
+ * the file into another model with NifModel::takeContents(). Connect the progress signals of
+ * the model before calling start(), they are queued to the thread of the owner.
+ */
+class NifLoadThread final : public QThread
+{
+public:
+	NifLoadThread( QObject * parent, const QString & file, const QByteArray & data = QByteArray() );
+
+	//! Ask the load to stop before its next block
+	void cancel();
+
+	//! The model the file is loaded into
+	NifModel model;
+	//! The file name, or the archive path of the data
+	const QString fileName;
+	//! The load succeeded, valid once the thread has finished
+	bool loaded = false;
+	//! cancel() was called
+	bool cancelled = false;
+	//! Saving the model would reproduce the file, valid once the thread has finished
+	/*!
+	 * Only checked if NifModel::setCaptureDigests() was enabled on the model before start().
+	 */
+	bool roundTrip = true;
+	//! Where saving would differ from the file if roundTrip is false
+	QString roundTripDifference;
+
+	//! The data was read from an archive
+	bool isArchived() const { return !fileData.isNull(); }
+
+protected:
+	void run() override final;
+
+private:
+	//! The file data read from an archive, null to read the file
+	QByteArray fileData;
+};
+
+#endif
@@ -38,6 +38,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "data/niftypes.h"
 #include "io/nifstream.h"
 #include "gamemanager.h"
+#include "trace.h"
 
 #include <QByteArray>
 #include <QColor>
@@ -364,6 +365,18 @@ quint32 NifModel::version2number( const QString & s )
 }
 
 void NifModel::clear()
+{
+	quint32 startupVersion = version2number( cfg.startupVersion );
+
+	if ( !supportedVersions.isEmpty() && !isVersionSupported( startupVersion ) ) {
+		Message::warning( nullptr, tr( "Unsupported 'Startup Version' %1 specified, reverting to 20.0.0.5" ).arg( cfg.startupVersion ) );
+		startupVersion = 0x14000005;
+	}
+
+	clear( startupVersion, cfg.userVersion, cfg.userVersion2 );
+}
+
+void NifModel::clear( quint32 v, quint32 userVersion, quint32 bsVersion )
 {
 	beginResetModel();
 	fileinfo = QFileInfo();
@@ -371,6 +384,11 @@ void NifModel::clear()
 	folder = QString();
 	bsVersion = 0;
 	root->killChildren();
+	resetOffsets();
+	filteredBlocks.clear();
+	dropSource();
+	savedSource = SourceIndex();
+	loadDigests = NifDigests();
 
 	NifData headerData = NifData( "NiHeader", "Header" );
 	NifData footerData = NifData( "NiFooter", "Footer" );
@@ -381,12 +399,7 @@ void NifModel::clear()
 
 	insertType( root, headerData );
 	insertType( root, footerData );
-	version = version2number( cfg.startupVersion );
-
-	if ( !supportedVersions.isEmpty() && !isVersionSupported( version ) ) {
-		Message::warning( nullptr, tr( "Unsupported 'Startup Version' %1 specified, reverting to 20.0.0.5" ).arg( cfg.startupVersion ) );
-		version = 0x14000005;
-	}
+	version = v;
 	endResetModel();
 
 	NifItem * header = getHeaderItem();
@@ -399,8 +412,8 @@ void NifModel::clear()
 	header_string += version2string( version );
 	set<QString>( header, "Header String", header_string );
 
-	set<int>( getItem( header, "User Version", false ), cfg.userVersion );
-	set<int>( getItem( header, "BS Header\\BS Version", false ), cfg.userVersion2 );
+	set<int>( getItem( header, "User Version", false ), userVersion );
+	set<int>( getItem( header, "BS Header\\BS Version", false ), bsVersion );
 	invalidateItemConditions( header );
 
 	//set<int>( header, "Unknown Int 3", 11 );
@@ -482,6 +495,7 @@ void NifModel::updateHeader()
 		QVector<QString> blockTypes;
 		QVector<int> blockTypeIndices;
 		QVector<int> blockSizes;
+		NifSStream stream( this );
 
 		for ( int r = firstBlockRow(); r <= lastBlockRow(); r++ ) {
 			NifItem * itemBlock = root->child( r );
@@ -498,8 +512,15 @@ void NifModel::updateHeader()
 			blockTypeIndices.append( iBlockType );
 
 			if ( itemBlockSizes ) {
-				updateChildArraySizes( itemBlock );
-				blockSizes.append( blockSize( itemBlock ) );
+				int b = r - firstBlockRow();
+				if ( sourceData && isSourceBlock( b ) ) {
+					// Copied unchanged from the source file by save()
+					blockSizes.append( int( source.blockEnds.at( b ) - source.blockStarts.at( b ) ) );
+				} else {
+					updateChildArraySizes( itemBlock );
+					// Always measured from the items, this is what gets saved
+					blockSizes.append( blockSize( itemBlock, stream ) );
+				}
 			}
 		}
 
@@ -529,6 +550,13 @@ void NifModel::updateHeader()
 
 		restoreState();
 
+		// The arrays above were written directly; reseed the offset index with the fresh block sizes
+		invalidateOffsets( header );
+		if ( itemBlockSizes && blockSizes.count() == getBlockCount() && offsets.rowSizes.count() == root->childCount() ) {
+			for ( int i = 0; i < blockSizes.count(); i++ )
+				offsets.rowSizes[firstBlockRow() + i] = blockSizes.at( i );
+		}
+
 		// For 20.1 and above strings are saved in the header.  Max String Length must be updated.
 		if ( version >= 0x14010003 ) {
 			int nMaxLen = 0;
@@ -798,6 +826,46 @@ void NifModel::removeNiBlock( int blocknum )
 	emit linksChanged();
 }
 
+void NifModel::removeNiBlocks( const QList<qint32> & blocks )
+{
+	QVector<bool> removed( getBlockCount(), false );
+	for ( const auto b : blocks ) {
+		if ( isValidBlockNumber( b ) )
+			removed[b] = true;
+	}
+
+	// Links to the removed blocks are cleared, the others are shifted down in one pass
+	QMap<qint32, qint32> map;
+	int shift = 0;
+	for ( int b = 0; b < removed.count(); b++ ) {
+		if ( removed[b] ) {
+			map.insert( b, -1 );
+			shift++;
+		} else if ( shift ) {
+			map.insert( b, b - shift );
+		}
+	}
+
+	if ( !shift )
+		return;
+
+	mapLinks( root, map );
+
+	for ( int b = removed.count() - 1; b >= 0; b-- ) {
+		if ( !removed[b] )
+			continue;
+
+		beginRemoveRows( QModelIndex(), b + 1, b + 1 );
+		root->removeChild( b + 1 );
+		endRemoveRows();
+	}
+
+	updateLinks();
+	updateHeader();
+	updateFooter();
+	emit linksChanged();
+}
+
 void NifModel::moveNiBlock( int src, int dst )
 {
 	if ( !isValidBlockNumber( src ) )
@@ -947,6 +1015,7 @@ void NifModel::reorderBlocks( const QVector<qint32> & order )
 
 void NifModel::mapLinks( const QMap<qint32, qint32> & map )
 {
+	dropSource();
 	mapLinks( root, map );
 	updateLinks();
 	emit linksChanged();
@@ -1639,6 +1708,8 @@ bool NifModel::setData( const QModelIndex & index, const QVariant & value, int r
 		}
 	}
 
+	markBlockChanged( item );
+
 	if ( state == Default ) {
 		onItemValueChange( item );
 	}
@@ -1654,6 +1725,39 @@ void NifModel::reset()
 	endResetModel();
 }
 
+void NifModel::takeContents( NifModel * other )
+{
+	if ( !other || other == this )
+		return;
+
+	beginResetModel();
+	other->beginResetModel();
+
+	std::swap( root, other->root );
+	root->setModel( this );
+	other->root->setModel( other );
+
+	std::swap( version, other->version );
+	std::swap( bsVersion, other->bsVersion );
+	std::swap( childLinks, other->childLinks );
+	std::swap( parentLinks, other->parentLinks );
+	std::swap( rootLinks, other->rootLinks );
+	std::swap( filteredBlocks, other->filteredBlocks );
+	std::swap( source, other->source );
+	std::swap( loadDigests, other->loadDigests );
+	std::swap( fileinfo, other->fileinfo );
+	std::swap( filename, other->filename );
+	std::swap( folder, other->folder );
+	resetOffsets();
+	other->resetOffsets();
+	resetState();
+
+	other->endResetModel();
+	endResetModel();
+
+	other->clear();
+}
+
 bool NifModel::removeRows( int iStart, int count, const QModelIndex & parent )
 {
 	NifItem * item = getItem( parent );
@@ -1821,10 +1925,14 @@ static void setTempDataPath( const Game::GameMode game, const char * pathName )
 
 bool NifModel::load( QIODevice & device, const char* fileName )
 {
+	TRACE_ZONE( "NifModel::load", fileName );
+
 	QSettings settings;
 	bool ignoreSize = settings.value( "Ignore Block Size", true ).toBool();
 
 	clear();
+	abortLoad.storeRelaxed( 0 );
+	aborted = false;
 
 	NifIStream stream( this, &device );
 
@@ -1850,6 +1958,25 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 	emit sigProgress( 0, numblocks );
 	//QTime t = QTime::currentTime();
 
+	// Scratch blocks for the structural skip of filtered loads, see skipBlock
+	QHash<QString, NifItem *> scratch;
+	QHash<QString, bool> accepted;
+
+	// Byte ranges of the block data, for copying unchanged blocks on save
+	SourceIndex loaded;
+	bool exactBlocks = !loadFilter && version >= 0x0303000d;
+	if ( exactBlocks ) {
+		loaded.blockStarts.fill( -1, numblocks );
+		loaded.blockEnds.fill( -1, numblocks );
+	}
+
+	// Start of the header, each block and the footer, for loadDigests
+	QVector<qint64> rowStarts;
+	if ( captureDigests && exactBlocks ) {
+		rowStarts.reserve( numblocks + 2 );
+		rowStarts << 0;
+	}
+
 	qint64 curpos = 0;
 	try
 	{
@@ -1862,6 +1989,11 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 			for ( int c = 0; c < numblocks; c++ ) {
 				emit sigProgress( c + 1, numblocks );
 
+				if ( abortLoad.loadRelaxed() ) {
+					aborted = true;
+					throw tr( "loading was cancelled" );
+				}
+
 				if ( device.atEnd() )
 					throw tr( "unexpected EOF during load" );
 
@@ -1901,7 +2033,7 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 						}
 
 						// for version 20.2.0.? and above the block size is stored in the header
-						if ( !ignoreSize && version >= 0x14020000 )
+						if ( ( !ignoreSize || loadFilter ) && version >= 0x14020000 )
 							size = get<quint32>( index( c, 0, getIndex( createIndex( header->row(), 0, header ), "Block Size" ) ) );
 					} else {
 						int len;
@@ -1919,15 +2051,44 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 					if ( blktyp.startsWith( "NiDataStream\x01" ) )
 						blktyp = extractRTTIArgs( blktyp, metadata );
 
-					if ( isNiBlock( blktyp ) ) {
+					bool keep = true;
+					if ( loadFilter && isNiBlock( blktyp ) ) {
+						auto it = accepted.find( blktyp );
+						if ( it == accepted.end() )
+							it = accepted.insert( blktyp, acceptBlock( blktyp, *loadFilter ) );
+						keep = it.value();
+					}
+
+					if ( !keep ) {
+						// Skip the block without building it in the model
+						if ( size != UINT_MAX ) {
+							if ( !device.seek( curpos + size ) )
+								throw tr( "failed to skip block number %1 (%2)" ).arg( c ).arg( blktyp );
+						} else if ( !skipBlock( blktyp, stream, scratch ) ) {
+							throw tr( "failed to skip block number %1 (%2) previous block was %3" ).arg( c ).arg( blktyp ).arg( prevblktyp );
+						}
+					} else if ( isNiBlock( blktyp ) ) {
 						//qDebug() << "loading block" << c << ":" << blktyp );
+						TRACE_ZONE( "NifModel::loadItem", blktyp );
 						QModelIndex newBlock = insertNiBlock( blktyp, -1 );
+						qint64 blockStart = device.pos();
 
-						if ( !loadItem( root->child( c + 1 ), stream ) ) {
-							NifItem * child = root->child( c );
+						if ( !loadItem( root->child( newBlock.row() ), stream ) ) {
+							NifItem * child = root->child( newBlock.row() - 1 );
 							throw tr( "failed to load block number %1 (%2) previous block was %3" ).arg( c ).arg( blktyp ).arg( child ? child->name() : prevblktyp );
 						}
 
+						if ( exactBlocks ) {
+							loaded.blockStarts[c] = blockStart;
+							loaded.blockEnds[c] = device.pos();
+						}
+
+						if ( captureDigests )
+							rowStarts << blockStart;
+
+						if ( loadFilter )
+							filteredBlocks.append( c );
+
 						// NiMesh hack
 						if ( blktyp == "NiDataStream" ) {
 							set<quint32>( newBlock, "Usage", metadata.usage );
@@ -1945,6 +2106,9 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 					// XXX FIXME: if isNiBlock returned false, block numbering will be screwed up!!
 					if ( size == UINT_MAX )
 						throw err;
+
+					// The model no longer matches the file
+					exactBlocks = false;
 				}
 
 				// Check device position and emit warning if location is not expected
@@ -1952,6 +2116,9 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 					qint64 pos = device.pos();
 
 					if ( (curpos + size) != pos ) {
+						if ( exactBlocks )
+							loaded.blockStarts[c] = -1;
+
 						// unable to seek to location... abort
 						if ( device.seek( curpos + size ) ) {
 							auto m = tr( "device position incorrect after block number %1 (%2) at 0x%3 ended at 0x%4 (expected 0x%5)" )
@@ -1977,6 +2144,9 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 			}
 
 			// read in the footer
+			if ( captureDigests )
+				rowStarts << device.pos();
+
 			// Disabling the throw because it hinders decoding when the XML is wrong,
 			// and prevents any data whatsoever from loading.
 			loadItem( getFooterItem(), stream );
@@ -1990,6 +2160,11 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 				for ( qint32 c = 0; true; c++ ) {
 					emit sigProgress( c + 1, 0 );
 
+					if ( abortLoad.loadRelaxed() ) {
+						aborted = true;
+						throw tr( "loading was cancelled" );
+					}
+
 					if ( device.atEnd() )
 						throw tr( "unexpected EOF during load" );
 
@@ -2021,6 +2196,7 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 
 					if ( isNiBlock( blktyp ) ) {
 						//qDebug() << "loading block" << c << ":" << blktyp );
+						TRACE_ZONE( "NifModel::loadItem", blktyp );
 						insertNiBlock( blktyp, -1 );
 
 						if ( !loadItem( root->child( c + 1 ), stream ) )
@@ -2044,22 +2220,85 @@ bool NifModel::load( QIODevice & device, const char* fileName )
 	}
 	catch ( QString & err )
 	{
-		logMessage(tr(readFail), QString("Pos %1: ").arg(device.pos()) + err, QMessageBox::Critical);
+		qDeleteAll( scratch );
+		if ( !aborted )
+			logMessage(tr(readFail), QString("Pos %1: ").arg(device.pos()) + err, QMessageBox::Critical);
 		reset();
 		return false;
 	}
 
+	qDeleteAll( scratch );
+
 	//qDebug() << t.msecsTo( QTime::currentTime() );
 	reset(); // notify model views that a significant change to the data structure has occurded
+
+	if ( captureDigests && exactBlocks && rowStarts.count() == numblocks + 2 )
+		loadDigests = NifDigests::fromDevice( device, rowStarts, qMax( device.pos(), device.size() ) );
+
+	// Remember where the blocks came from if the file can be read again on save
+	auto file = qobject_cast<QFileDevice *>( &device );
+	if ( exactBlocks && file ) {
+		QFileInfo finfo( file->fileName() );
+		loaded.path = finfo.absoluteFilePath();
+		loaded.size = finfo.size();
+		loaded.modified = finfo.lastModified();
+		fillSourceHeader( loaded );
+		source = loaded;
+	}
+
 	return true;
 }
 
+bool NifModel::verifyRoundTrip( QString * difference ) const
+{
+	if ( loadDigests.isEmpty() )
+		return true;
+
+	// Copying the blocks from the source would prove nothing
+	NifDigestSink sink( loadDigests );
+	serializeAll = true;
+	bool saved = save( sink );
+	serializeAll = false;
+	sink.finish();
+
+	if ( saved && sink.matches() )
+		return true;
+
+	if ( difference ) {
+		int row = saved ? sink.firstMismatch() : 0;
+		QString rowName;
+		if ( row == 0 )
+			rowName = tr( "the header" );
+		else if ( isBlockRow( row ) )
+			rowName = tr( "block %1 (%2)" ).arg( row - firstBlockRow() ).arg( root->child( row )->name() );
+		else
+			rowName = tr( "the footer" );
+
+		*difference = tr( "Saving would change %1 at offset 0x%2" ).arg( rowName ).arg( QString::number( sink.mismatchOffset(), 16 ) );
+	}
+
+	return false;
+}
+
 bool NifModel::save( QIODevice & device ) const
 {
 	NifOStream stream( this, &device );
 
 	setState( Saving );
 
+	// Map the file the model was loaded from to copy the unchanged blocks,
+	//	this has to be known before the header block sizes are updated
+	QFile sourceFile;
+	if ( !serializeAll && isSourceUsable() ) {
+		sourceFile.setFileName( source.path );
+		if ( sourceFile.open( QIODevice::ReadOnly ) )
+			sourceData = sourceFile.map( 0, source.size );
+	}
+
+	savedSource = SourceIndex();
+	savedSource.blockStarts.fill( -1, getBlockCount() );
+	savedSource.blockEnds.fill( -1, getBlockCount() );
+
 	// Force update header and footer prior to save
 	if ( NifModel * mdl = const_cast<NifModel *>(this) ) {
 		mdl->updateHeader();
@@ -2100,13 +2339,39 @@ bool NifModel::save( QIODevice & device ) const
 			}
 		}
 
-		if ( !saveItem( root->child( c ), stream ) ) {
+		int b = c - firstBlockRow();
+		bool isBlock = isBlockRow( c );
+		qint64 blockStart = device.pos();
+
+		bool ok;
+		if ( sourceData && isBlock && isSourceBlock( b ) ) {
+			// Unchanged since it was read, copy it byte for byte
+			qint64 n = source.blockEnds.at( b ) - source.blockStarts.at( b );
+			ok = device.write( reinterpret_cast<const char *>( sourceData + source.blockStarts.at( b ) ), n ) == n;
+		} else {
+			ok = saveItem( root->child( c ), stream );
+		}
+
+		if ( !ok ) {
 			Message::critical( nullptr, tr( "Failed to write block %1 (%2)." ).arg( itemName( index( c, 0 ) ) ).arg( c - 1 ) );
+			sourceData = nullptr;
+			savedSource = SourceIndex();
 			resetState();
 			return false;
 		}
+
+		if ( isBlock && b < savedSource.blockStarts.count() ) {
+			savedSource.blockStarts[b] = blockStart;
+			savedSource.blockEnds[b] = device.pos();
+		}
 	}
 
+	sourceData = nullptr;
+	if ( version >= 0x0303000d )
+		fillSourceHeader( savedSource );
+	else
+		savedSource = SourceIndex();
+
 	if ( version < 0x0303000d ) {
 		QString string = "End Of File";
 		int len = string.length();
@@ -2124,6 +2389,8 @@ bool NifModel::loadIndex( QIODevice & device, const QModelIndex & index )
 	if ( item ) {
 		NifIStream stream( this, &device );
 		bool ok = loadItem( item, stream );
+		resetOffsets();
+		markBlockChanged( item );
 		updateLinks();
 		updateFooter();
 		emit linksChanged();
@@ -2140,6 +2407,8 @@ bool NifModel::loadAndMapLinks( QIODevice & device, const QModelIndex & index, c
 	if ( item ) {
 		NifIStream stream( this, &device );
 		bool ok = loadItem( item, stream );
+		resetOffsets();
+		markBlockChanged( item );
 		mapLinks( item, map );
 		updateLinks();
 		updateFooter();
@@ -2151,6 +2420,101 @@ bool NifModel::loadAndMapLinks( QIODevice & device, const QModelIndex & index, c
 	return false;
 }
 
+bool NifModel::loadFiltered( QIODevice & device, const NifLoadFilter & filter, const char * fileName )
+{
+	loadFilter = &filter;
+	bool ok = load( device, fileName );
+	loadFilter = nullptr;
+
+	return ok;
+}
+
+bool NifModel::loadFilteredFromFile( const QString & fname, const NifLoadFilter & filter )
+{
+	loadFilter = &filter;
+	bool ok = loadFromFile( fname );
+	loadFilter = nullptr;
+
+	return ok;
+}
+
+int NifModel::originalBlockNumber( int block ) const
+{
+	if ( filteredBlocks.isEmpty() )
+		return block;
+
+	return filteredBlocks.value( block, -1 );
+}
+
+bool NifModel::acceptBlock( const QString & identifier, const NifLoadFilter & filter ) const
+{
+	if ( !filter.blockTypes.isEmpty() && !inherits( identifier, filter.blockTypes ) )
+		return false;
+
+	if ( !filter.fieldNames.isEmpty() ) {
+		bool hasField = false;
+		for ( const QString & field : filter.fieldNames ) {
+			QString name = field.section( '\\', 0, 0 );
+			if ( name == QLatin1String( ".." ) ) {
+				hasField = true;
+				break;
+			}
+
+			for ( NifBlockPtr block = blocks.value( identifier ); block && !hasField; block = blocks.value( block->ancestor ) ) {
+				for ( const NifData & data : block->types ) {
+					if ( data.name() == name ) {
+						hasField = true;
+						break;
+					}
+				}
+			}
+
+			if ( hasField )
+				break;
+		}
+
+		if ( !hasField )
+			return false;
+	}
+
+	return !filter.accept || filter.accept( identifier );
+}
+
+bool NifModel::skipBlock( const QString & identifier, NifIStream & stream, QHash<QString, NifItem *> & scratch )
+{
+	// The scratch block sits in the block rows while it is read so that conditions
+	// resolve against the header as usual, and is taken out again without notifying views.
+	int at = getBlockCount() + 1;
+
+	NifItem * branch = scratch.value( identifier );
+	if ( branch ) {
+		root->insertChild( branch, at );
+	} else {
+		NifBlockPtr block = blocks.value( identifier );
+		if ( !block )
+			return false;
+
+		NifData d = NifData( identifier, "NiBlock", block->text );
+		d.setIsConditionless( true );
+		branch = insertBranch( root, d, at );
+
+		if ( !block->ancestor.isEmpty() )
+			insertAncestor( branch, block->ancestor );
+
+		branch->prepareInsert( block->types.count() );
+		for ( const NifData & data : block->types ) {
+			insertType( branch, data );
+		}
+
+		scratch.insert( identifier, branch );
+	}
+
+	bool ok = loadItem( branch, stream );
+	root->takeChild( branch->row() );
+
+	return ok;
+}
+
 bool NifModel::loadHeaderOnly( const QString & fname )
 {
 	clear();
@@ -2162,7 +2526,14 @@ bool NifModel::loadHeaderOnly( const QString & fname )
 		return false;
 	}
 
-	NifIStream stream( this, &f );
+	return loadHeaderOnly( f );
+}
+
+bool NifModel::loadHeaderOnly( QIODevice & device )
+{
+	clear();
+
+	NifIStream stream( this, &device );
 
 	// read header
 	NifItem * header = getHeaderItem();
@@ -2176,10 +2547,22 @@ bool NifModel::loadHeaderOnly( const QString & fname )
 }
 
 bool NifModel::earlyRejection( const QString & filepath, const QString & blockId, quint32 v )
+{
+	QFile f( filepath );
+
+	if ( !f.open( QIODevice::ReadOnly ) ) {
+		Message::critical( nullptr, tr( "Failed to open %1" ).arg( filepath ) );
+		return false;
+	}
+
+	return earlyRejection( f, blockId, v );
+}
+
+bool NifModel::earlyRejection( QIODevice & device, const QString & blockId, quint32 v )
 {
 	NifModel nif;
 
-	if ( nif.loadHeaderOnly( filepath ) == false ) {
+	if ( nif.loadHeaderOnly( device ) == false ) {
 		//File failed to read entierly
 		return false;
 	}
@@ -2219,44 +2602,83 @@ bool NifModel::saveIndex( QIODevice & device, const QModelIndex & index ) const
 	return false;
 }
 
+QByteArray NifModel::contentDigest( const NifItem * item, QHash<const NifItem *, QByteArray> * digests, bool withLinks ) const
+{
+	if ( !item )
+		return QByteArray();
+
+	NifHashDevice device;
+	NifOStream stream( this, &device );
+
+	for ( auto child : item->childIter() ) {
+		if ( child->isAbstract() || !evalCondition( child ) )
+			continue;
+
+		if ( child->childCount() > 0 ) {
+			device.write( contentDigest( child, digests, withLinks ) );
+		} else if ( !withLinks && child->isLink() ) {
+			device.putChar( child->getLinkValue() >= 0 ? 'L' : 'N' );
+		} else if ( child->isString() || child->hasValueType( NifValue::tStringIndex ) ) {
+			device.write( resolveString( child ).toUtf8() );
+			device.putChar( 0 );
+		} else {
+			stream.write( child->value() );
+		}
+	}
+
+	QByteArray d = device.result();
+	if ( digests )
+		digests->insert( item, d );
+
+	return d;
+}
+
 int NifModel::fileOffset( const QModelIndex & index ) const
 {
 	const NifItem * target = getItem( index );
-	if ( target ) {
-		NifSStream stream( this );
-		int ofs = 0;
+	const NifItem * top = getTopItem( target );
+	if ( !top )
+		return -1;
 
-		for ( int c = 0; c < root->childCount(); c++ ) {
-			const NifItem * block = root->child( c );
+	syncOffsets();
 
-			if ( isBlockRow( c ) ) {
-				if ( version > 0x0a000000 ) {
-					if ( version < 0x0a020000 )
-						ofs += 4;
-				} else {
-					if ( version < 0x0303000d ) {
-						if ( rootLinks.contains( c - firstBlockRow() ) )
-							ofs += 4 + QLatin1String( "Top Level Object" ).size();
-					}
-
-					ofs += 4 + ( block ? block->name().length() : 0);
+	int row = top->row();
+	NifSStream stream( this );
 
-					if ( version < 0x0303000d )
-						ofs += 4;
-				}
-			}
+	// Extend the prefix sums of the row offsets up to the target row
+	for ( int r = offsets.validStarts; r <= row; r++ ) {
+		if ( r == 0 )
+			offsets.rowStarts[r] = 0;
+		else
+			offsets.rowStarts[r] = offsets.rowStarts[r - 1] + rowPrefix( r - 1 ) + rowSize( r - 1, stream );
+	}
+	offsets.validStarts = qMax( offsets.validStarts, row + 1 );
 
-			if ( fileOffset( block, target, stream, ofs ) )
-				return ofs;
-		}
+	// Offsets of the items inside the row, computed once per row until it changes
+	auto & items = offsets.itemOffsets[row];
+	if ( items.isEmpty() ) {
+		int ofs = 0;
+		items.insert( top, 0 );
+		fileOffset( top, stream, ofs, items );
+		offsets.rowSizes[row] = ofs;
 	}
 
-	return -1;
+	auto it = items.constFind( target );
+	if ( it == items.constEnd() )
+		return -1;
+
+	return offsets.rowStarts[row] + rowPrefix( row ) + it.value();
 }
 
 int NifModel::blockSize( const NifItem * item ) const
 {
 	NifSStream stream( this );
+
+	if ( item && item->parent() == root ) {
+		syncOffsets();
+		return rowSize( item->row(), stream );
+	}
+
 	return blockSize( item, stream );
 }
 
@@ -2414,28 +2836,183 @@ bool NifModel::saveItem( const NifItem * parent, NifOStream & stream ) const
 	return true;
 }
 
-bool NifModel::fileOffset( const NifItem * parent, const NifItem * target, NifSStream & stream, int & ofs ) const
+void NifModel::fileOffset( const NifItem * parent, NifSStream & stream, int & ofs, QHash<const NifItem *, int> & items ) const
 {
 	if ( !parent )
-		return false;
-	if ( parent == target )
-		return true;
+		return;
 
 	for ( auto child : parent->childIter() ) {
-		if ( child == target )
-			return true;
+		// Items with false conditions get the offset they would have
+		items.insert( child, ofs );
+
+		if ( child->isAbstract() )
+			continue;
 
 		if ( evalCondition( child ) ) {
 			if ( child->isArray() || child->childCount() > 0 ) {
-				if ( fileOffset( child, target, stream, ofs ) )
-					return true;
+				fileOffset( child, stream, ofs, items );
 			} else {
 				ofs += stream.size( child->value() );
 			}
 		}
 	}
+}
 
-	return false;
+int NifModel::rowSize( int row, NifSStream & stream ) const
+{
+	int & size = offsets.rowSizes[row];
+	if ( size < 0 )
+		size = blockSize( root->child( row ), stream );
+
+	return size;
+}
+
+int NifModel::rowPrefix( int row ) const
+{
+	if ( !isBlockRow( row ) )
+		return 0;
+
+	int ofs = 0;
+	if ( version > 0x0a000000 ) {
+		if ( version < 0x0a020000 )
+			ofs += 4;
+	} else {
+		if ( version < 0x0303000d ) {
+			if ( rootLinks.contains( row - firstBlockRow() ) )
+				ofs += 4 + QLatin1String( "Top Level Object" ).size();
+		}
+
+		const NifItem * block = root->child( row );
+		ofs += 4 + ( block ? block->name().length() : 0 );
+
+		if ( version < 0x0303000d )
+			ofs += 4;
+	}
+
+	return ofs;
+}
+
+void NifModel::syncOffsets() const
+{
+	int numRows = root->childCount();
+	if ( offsets.rowSizes.count() != numRows ) {
+		resetOffsets();
+		offsets.rowSizes.fill( -1, numRows );
+		offsets.rowStarts.fill( 0, numRows );
+	}
+}
+
+void NifModel::resetOffsets() const
+{
+	offsets.rowSizes.clear();
+	offsets.rowStarts.clear();
+	offsets.validStarts = 0;
+	offsets.itemOffsets.clear();
+}
+
+void NifModel::fillSourceHeader( SourceIndex & src ) const
+{
+	const NifItem * header = getHeaderItem();
+
+	src.version = version;
+	src.bsVersion = bsVersion;
+
+	const NifItem * userVersion = getItem( header, "User Version", false );
+	src.userVersion = userVersion ? userVersion->get<int>() : 0;
+
+	// ENDIAN_BIG is 0
+	const NifItem * endian = getItem( header, "Endian Type", false );
+	src.bigEndian = endian && endian->get<quint32>() == 0;
+
+	// Blocks refer to the header strings by index from 20.1.0.3
+	const NifItem * strings = ( version >= 0x14010003 ) ? getItem( header, "Strings", false ) : nullptr;
+	src.strings = strings ? getArray<QString>( strings ) : QVector<QString>();
+}
+
+bool NifModel::isSourceUsable() const
+{
+	if ( source.blockStarts.isEmpty() || source.blockStarts.count() != getBlockCount() )
+		return false;
+
+	// Copied blocks would keep their byte order while the rest of the file is written little-endian
+	if ( source.bigEndian )
+		return false;
+
+	SourceIndex current;
+	fillSourceHeader( current );
+	if ( current.version != source.version || current.userVersion != source.userVersion
+		|| current.bsVersion != source.bsVersion || current.strings != source.strings )
+		return false;
+
+	QFileInfo finfo( source.path );
+	return finfo.isFile() && finfo.size() == source.size && finfo.lastModified() == source.modified;
+}
+
+bool NifModel::isSourceBlock( int block ) const
+{
+	return block >= 0 && block < source.blockStarts.count()
+		&& source.blockStarts.at( block ) >= 0 && source.blockEnds.at( block ) <= source.size;
+}
+
+void NifModel::markBlockChanged( const NifItem * item )
+{
+	if ( source.blockStarts.isEmpty() || !item )
+		return;
+
+	const NifItem * top = getTopItem( item );
+	if ( !top ) {
+		dropSource();
+		return;
+	}
+
+	int block = top->row() - firstBlockRow();
+	if ( block >= 0 && block < source.blockStarts.count() )
+		source.blockStarts[block] = -1;
+}
+
+void NifModel::onFileSaved( const QString & fname ) const
+{
+	if ( savedSource.blockStarts.isEmpty() || savedSource.blockStarts.count() != getBlockCount() )
+		return;
+
+	// The file now holds exactly the blocks of the model
+	QFileInfo finfo( fname );
+	savedSource.path = finfo.absoluteFilePath();
+	savedSource.size = finfo.size();
+	savedSource.modified = finfo.lastModified();
+	source = savedSource;
+	savedSource = SourceIndex();
+}
+
+void NifModel::invalidateOffsets( const NifItem * item )
+{
+	if ( offsets.rowSizes.isEmpty() )
+		return;
+
+	const NifItem * top = getTopItem( item );
+	if ( !top ) {
+		resetOffsets();
+		return;
+	}
+
+	// Version fields change the conditions of every block
+	if ( top == getHeaderItem() && item != top
+		&& ( item->hasName( "Version" ) || item->hasName( "User Version" ) || item->hasName( "BS Version" ) ) )
+	{
+		resetOffsets();
+		return;
+	}
+
+	int row = top->row();
+	if ( row < 0 || row >= offsets.rowSizes.count() ) {
+		resetOffsets();
+		return;
+	}
+
+	// The start of this row stays valid, the starts of the following rows do not
+	offsets.rowSizes[row] = -1;
+	offsets.itemOffsets.remove( row );
+	offsets.validStarts = qMin( offsets.validStarts, row + 1 );
 }
 
 NifItem * NifModel::insertBranch( NifItem * parentItem, const NifData & data, int at )
@@ -2551,6 +3128,10 @@ void NifModel::updateLinks( int block )
 		childLinks.clear();
 		parentLinks.clear();
 
+		// Root links are part of the block prefixes before 3.3.0.13
+		if ( version < 0x0303000d )
+			offsets.validStarts = 0;
+
 		// Run updateLinks() for each block
 		for ( int c = 0; c < getBlockCount(); c++ )
 			updateLinks( c );
@@ -3025,6 +3606,8 @@ QString NifModel::topItemRepr( const NifItem * item ) const
 void NifModel::onItemValueChange( NifItem * item )
 {
 	invalidateDependentConditions( item );
+	invalidateOffsets( item );
+	markBlockChanged( item );
 	BaseModel::onItemValueChange( item );
 
 	if ( item->isLink() && !item->isDescendantOf( getFooterItem() ) ) {
@@ -3034,6 +3617,25 @@ void NifModel::onItemValueChange( NifItem * item )
 	}
 }
 
+void NifModel::onArrayValuesChange( NifItem * arrayRootItem )
+{
+	invalidateOffsets( arrayRootItem );
+	markBlockChanged( arrayRootItem );
+	BaseModel::onArrayValuesChange( arrayRootItem );
+}
+
+void NifModel::onItemChildrenChange( NifItem * parent )
+{
+	// Inserting, removing or moving blocks shifts every row after them
+	if ( parent == root ) {
+		resetOffsets();
+		dropSource();
+	} else {
+		invalidateOffsets( parent );
+		markBlockChanged( parent );
+	}
+}
+
 
 /*
  *  NifModelEval
@@ -34,12 +34,16 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define NIFMODEL_H
 
 #include "basemodel.h" // Inherited
+#include "io/nifdigest.h"
 
+#include <QAtomicInt>
+#include <QDateTime>
 #include <QHash>
 #include <QReadWriteLock>
 #include <QStack>
 #include <QStringList>
 
+#include <functional>
 #include <memory>
 
 class SpellBook;
@@ -58,6 +62,18 @@ const char * const readFail = QT_TR_NOOP( "The NIF file could not be read. See D
 const char * const readFailFinal = QT_TR_NOOP( "Failed to load %1" );
 
 
+//! Selects the blocks kept by NifModel::loadFiltered()
+struct NifLoadFilter
+{
+	//! Block types to keep, including their descendants; empty keeps every type
+	QStringList blockTypes;
+	//! Fields the caller will look up; blocks that do not declare the first path component of any of them are skipped
+	QStringList fieldNames;
+	//! Optional predicate over the block type, checked after blockTypes and fieldNames
+	std::function<bool( const QString & )> accept;
+};
+
+
 //! The main data model for the NIF file.
 class NifModel final : public BaseModel
 {
@@ -101,6 +117,9 @@ public:
 
 	// end BaseModel
 
+	//! Clears the model and starts an empty file of the given version instead of the startup version
+	void clear( quint32 version, quint32 userVersion, quint32 bsVersion );
+
 	//! Load from QIODevice and index
 	bool loadIndex( QIODevice & device, const QModelIndex & );
 	//! Save to QIODevice and index
@@ -117,11 +136,72 @@ public:
 	bool loadAndMapLinks( QIODevice & device, const QModelIndex &, const QMap<qint32, qint32> & map );
 	//! Loads the header from a filename
 	bool loadHeaderOnly( const QString & fname );
+	//! Loads the header from a QIODevice
+	bool loadHeaderOnly( QIODevice & device );
+
+	/*! Loads only the blocks accepted by a filter, intended for scanners without attached views
+	 *
+	 * Rejected blocks are skipped with the header block size table where the version has one,
+	 * otherwise they are read into a scratch block that is reused per block type and never
+	 * inserted into the model. Kept blocks are renumbered; links inside them still refer to
+	 * the original block numbers, see originalBlockNumber(). Files older than 3.3.0.13 are
+	 * loaded in full.
+	 *
+	 * @param device	The device to read from
+	 * @param filter	The blocks to keep
+	 * @param fileName	The file name used to set up the game resources
+	 */
+	bool loadFiltered( QIODevice & device, const NifLoadFilter & filter, const char * fileName = nullptr );
+	//! Loads only the blocks accepted by a filter from a filename, see loadFiltered()
+	bool loadFilteredFromFile( const QString & fname, const NifLoadFilter & filter );
+	//! Returns the block number in the file of a block kept by the last filtered load
+	int originalBlockNumber( int block ) const;
+
+	/*! Asks a load running on another thread to stop before its next block
+	 *
+	 * The load then fails without reporting an error, see wasAborted().
+	 */
+	void requestAbort() { abortLoad.storeRelaxed( 1 ); }
+	//! Returns true if the last load was stopped by requestAbort()
+	bool wasAborted() const { return aborted; }
+
+	//! Capture digests of the file on load for verifyRoundTrip()
+	void setCaptureDigests( bool enable ) { captureDigests = enable; }
+	//! Were digests captured by the last load?
+	bool hasDigests() const { return !loadDigests.isEmpty(); }
+
+	/*! Checks that saving the model reproduces the file it was loaded from
+	 *
+	 * Every block is serialized into a NifDigestSink and compared against the digests
+	 * captured by load(), nothing is written anywhere. Meant to be called right after loading.
+	 *
+	 * @param difference	Set to the first row that differs and its file offset
+	 * @return				False if the saved file would differ, true otherwise or without digests
+	 */
+	bool verifyRoundTrip( QString * difference = nullptr ) const;
+
+	/*! Digest of the content of an item and of everything below it
+	 *
+	 * Strings are hashed by value rather than by header string index, and links by block number.
+	 * The digest of a compound item hashes the digests of its compound children (a Merkle tree),
+	 * so that equal subtrees of two models have equal digests.
+	 *
+	 * @param item		The item, usually a block
+	 * @param digests	If not null, receives the digest of every compound item below and including item
+	 * @param withLinks	If false, only whether each link is set is hashed, for comparing models with different block orders
+	 */
+	QByteArray contentDigest( const NifItem * item, QHash<const NifItem *, QByteArray> * digests = nullptr, bool withLinks = true ) const;
+
+	/*! Moves the file held by another model into this one, leaving the other model empty
+	 *
+	 * Used to attach a model loaded on a worker thread to the views of this one.
+	 */
+	void takeContents( NifModel * other );
 
 	//! Returns the the estimated file offset of the model index
 	int fileOffset( const QModelIndex & ) const;
 
-	//! Returns the estimated file size of the item
+	//! Returns the estimated file size of the item (cached for blocks, see fileOffset)
 	int blockSize( const NifItem * item ) const;
 	//! Returns the estimated file size of the stream
 	int blockSize( const NifItem * item, NifSStream & stream ) const;
@@ -135,6 +215,8 @@ public:
 	 * @param version	The version to check for
 	 */
 	bool earlyRejection( const QString & filepath, const QString & blockId, quint32 version );
+	//! Checks the header read from a QIODevice, see earlyRejection( const QString &, const QString &, quint32 )
+	bool earlyRejection( QIODevice & device, const QString & blockId, quint32 version );
 
 	const NifItem * getHeaderItem() const;
 	NifItem * getHeaderItem();
@@ -232,6 +314,8 @@ public:
 	QModelIndex insertNiBlock( const QString & identifier, int row = -1 );
 	//! Remove a block from the list
 	void removeNiBlock( int blocknum );
+	//! Remove several blocks from the list at once, links to them are cleared
+	void removeNiBlocks( const QList<qint32> & blocks );
 	//! Move a block in the list
 	void moveNiBlock( int src, int dst );
 
@@ -678,8 +762,90 @@ protected:
 
 	bool loadItem( NifItem * parent, NifIStream & stream );
 	bool loadHeader( NifItem * parent, NifIStream & stream );
+	//! Reads a block rejected by the load filter into a scratch block reused per block type
+	bool skipBlock( const QString & identifier, NifIStream & stream, QHash<QString, NifItem *> & scratch );
+	//! Does the block type pass the load filter?
+	bool acceptBlock( const QString & identifier, const NifLoadFilter & filter ) const;
 	bool saveItem( const NifItem * parent, NifOStream & stream ) const;
-	bool fileOffset( const NifItem * parent, const NifItem * target, NifSStream & stream, int & ofs ) const;
+	void fileOffset( const NifItem * parent, NifSStream & stream, int & ofs, QHash<const NifItem *, int> & items ) const;
+
+	//! Offset index for fileOffset() and blockSize(), built lazily and invalidated per top-level row
+	struct OffsetIndex
+	{
+		//! Data size of each top-level row (header, blocks, footer), -1 if not computed yet
+		QVector<int> rowSizes;
+		//! File offset of each top-level row, valid below validStarts
+		QVector<int> rowStarts;
+		int validStarts = 0;
+		//! Offsets of the items in rows that have been queried, relative to the row data
+		QHash<int, QHash<const NifItem *, int>> itemOffsets;
+	};
+	mutable OffsetIndex offsets;
+
+	//! Filter of the load in progress, null for a full load
+	const NifLoadFilter * loadFilter = nullptr;
+	//! File block numbers of the blocks kept by the last filtered load, empty after a full load
+	QVector<int> filteredBlocks;
+
+	//! Set by requestAbort(), checked between blocks by load()
+	QAtomicInt abortLoad;
+	//! The last load was stopped by requestAbort()
+	bool aborted = false;
+
+	//! Byte ranges of the blocks in the file the model was last loaded from or saved to
+	struct SourceIndex
+	{
+		QString path;
+		qint64 size = 0;
+		QDateTime modified;
+		//! Header fields the block data depends on
+		quint32 version = 0;
+		int userVersion = 0;
+		quint32 bsVersion = 0;
+		QVector<QString> strings;
+		//! The block data is big-endian, NifOStream only writes little-endian
+		bool bigEndian = false;
+		//! File offset of each block's data, -1 if the block has been changed since
+		QVector<qint64> blockStarts;
+		QVector<qint64> blockEnds;
+	};
+	//! Source of the unchanged blocks written by save()
+	mutable SourceIndex source;
+	//! Serialize every block in save(), set by verifyRoundTrip()
+	mutable bool serializeAll = false;
+
+	//! Capture loadDigests in load()
+	bool captureDigests = false;
+	//! Digests of the header, each block and the footer of the loaded file
+	NifDigests loadDigests;
+	//! The block ranges of the last save(), becomes the source once written to a file
+	mutable SourceIndex savedSource;
+	//! The mapped source file during save(), null if every block is serialized
+	mutable const uchar * sourceData = nullptr;
+
+	//! Record the source header fields the block data depends on
+	void fillSourceHeader( SourceIndex & src ) const;
+	//! Is the source file unchanged and still compatible with the model?
+	bool isSourceUsable() const;
+	//! Can save() copy the block from the source?
+	bool isSourceBlock( int block ) const;
+	//! Mark the block containing an item as changed since the load
+	void markBlockChanged( const NifItem * item );
+	//! Forget the source of the blocks, e.g. after blocks have been inserted or removed
+	void dropSource() { source = SourceIndex(); }
+
+	void onFileSaved( const QString & fname ) const override final;
+
+	//! Drop the cached offsets and sizes of the top-level row containing an item
+	void invalidateOffsets( const NifItem * item );
+	//! Drop all cached offsets and sizes
+	void resetOffsets() const;
+	//! Size the offset index to the current rows
+	void syncOffsets() const;
+	//! Cached data size of a top-level row
+	int rowSize( int row, NifSStream & stream ) const;
+	//! Size of the block type prefix written before a top-level row
+	int rowPrefix( int row ) const;
 
 protected:
 	void insertAncestor( NifItem * parent, const QString & identifier, int row = -1 );
@@ -720,6 +886,8 @@ protected:
 
 	QString topItemRepr( const NifItem * item ) const override final;
 	void onItemValueChange( NifItem * item ) override final;
+	void onArrayValuesChange( NifItem * arrayRootItem ) override final;
+	void onItemChildrenChange( NifItem * parent ) override final;
 
 	void invalidateItemConditions( NifItem * item );
 
@@ -1293,14 +1461,20 @@ template <typename T> inline bool NifModel::set( const QModelIndex & itemParent,
 
 template <typename T> inline bool NifModel::setValue( const NifItem * itemParent, const QString & itemName, const T & val )
 {
+	invalidateOffsets( itemParent );
+	markBlockChanged( itemParent );
 	return NifItem::set<T>( getItem(itemParent, itemName, true), val );
 }
 template <typename T> inline bool NifModel::setValue( const NifItem * itemParent, const QLatin1String & itemName, const T & val )
 {
+	invalidateOffsets( itemParent );
+	markBlockChanged( itemParent );
 	return NifItem::set<T>( getItem(itemParent, itemName, true), val );
 }
 template <typename T> inline bool NifModel::setValue( const NifItem * itemParent, const char * itemName, const T & val )
 {
+	invalidateOffsets( itemParent );
+	markBlockChanged( itemParent );
 	return NifItem::set<T>( getItem(itemParent, QLatin1String(itemName), true), val );
 }
 
@@ -0,0 +1,687 @@
+#include "nifbench.h"
+
+#include "gl/glscene.h"
+#include "gl/gltools.h"
+#include "gl/renderer.h"
+#include "model/nifmodel.h"
+#include "spells/skeleton.h"
+#include "spells/tangentspace.h"
+#include "gamemanager.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+
+
+//! \file nifbench.cpp NifBench implementation
+
+//! The header versions of a game
+struct BenchGame
+{
+	const char * name;
+	quint32 version;
+	quint32 userVersion;
+	quint32 bsVersion;
+};
+
+static const BenchGame benchGames[] = {
+	{ "oblivion", 0x14000005, 11, 11 },
+	{ "sse", 0x14020007, 12, 100 },
+	{ "fo4", 0x14020007, 12, 130 },
+	{ "starfield", 0x14020007, 12, 172 },
+};
+
+//! Length of the generated grids along X and Y
+static constexpr float gridSize = 100.0f;
+//! Frame rate of the generated animation keys
+static constexpr float keyRate = 30.0f;
+
+//! A curved grid, skinned to a chain of bones along the X axis
+struct BenchGrid
+{
+	QVector<Vector3> verts;
+	QVector<Vector3> norms;
+	QVector<Vector2> uvs;
+	QVector<Triangle> tris;
+	//! The first of the two bones of each vertex, the second is the next bone of the chain
+	QVector<int> bones;
+	//! The weight of the first bone
+	QVector<float> weights;
+};
+
+static BenchGrid makeGrid( int vertices, int numBones, float height )
+{
+	BenchGrid g;
+
+	int w = std::max( 2, int( std::sqrt( float( vertices ) ) ) );
+	int h = std::max( 2, vertices / w );
+
+	for ( int j = 0; j < h; j++ ) {
+		for ( int i = 0; i < w; i++ ) {
+			float u = float( i ) / float( w - 1 );
+			float v = float( j ) / float( h - 1 );
+			float x = u * gridSize, y = v * gridSize;
+
+			float sx = std::sin( x * 0.1f ), cx = std::cos( x * 0.1f );
+			float sy = std::sin( y * 0.1f ), cy = std::cos( y * 0.1f );
+
+			g.verts << Vector3( x, y, height + 5.0f * sx * cy );
+			g.norms << Vector3( -0.5f * cx * cy, 0.5f * sx * sy, 1.0f ).normalize();
+			g.uvs << Vector2( u, v );
+
+			if ( numBones > 1 ) {
+				float t = u * float( numBones - 1 );
+				int b = std::min( int( t ), numBones - 2 );
+				g.bones << b;
+				g.weights << 1.0f - ( t - float( b ) );
+			} else {
+				g.bones << 0;
+				g.weights << 1.0f;
+			}
+		}
+	}
+
+	for ( int j = 0; j < h - 1; j++ ) {
+		for ( int i = 0; i < w - 1; i++ ) {
+			quint16 a = quint16( j * w + i );
+			quint16 c = quint16( a + w );
+			g.tris << Triangle( a, a + 1, c + 1 ) << Triangle( a, c + 1, c );
+		}
+	}
+
+	return g;
+}
+
+//! The vertices of each bone and their weights
+static QVector<QVector<QPair<int, float>>> boneWeights( const BenchGrid & g, int numBones )
+{
+	QVector<QVector<QPair<int, float>>> weights( numBones );
+	for ( int v = 0; v < g.verts.count(); v++ ) {
+		int b = g.bones[v];
+		float w = g.weights[v];
+		if ( w > 0.0f )
+			weights[b].append( { v, w } );
+		if ( w < 1.0f && b + 1 < numBones )
+			weights[b + 1].append( { v, 1.0f - w } );
+	}
+	return weights;
+}
+
+static qint32 insertBlock( NifModel * nif, const QString & type, const QString & name = QString() )
+{
+	QModelIndex iBlock = nif->insertNiBlock( type );
+	if ( !name.isEmpty() )
+		nif->set<QString>( iBlock, "Name", name );
+	return nif->getBlockNumber( iBlock );
+}
+
+static void setLinks( NifModel * nif, const QModelIndex & iBlock, const char * count, const char * array, const QVector<qint32> & links )
+{
+	nif->set<int>( iBlock, count, links.count() );
+	nif->updateArraySize( iBlock, array );
+	nif->setLinkArray( iBlock, array, links );
+}
+
+static void setBound( NifModel * nif, const QModelIndex & iBlock, float height )
+{
+	QModelIndex iBound = nif->getIndex( iBlock, "Bounding Sphere" );
+	nif->set<Vector3>( iBound, "Center", Vector3( gridSize / 2, gridSize / 2, height ) );
+	nif->set<float>( iBound, "Radius", gridSize * 0.75f );
+}
+
+//! Adds a transform controller rotating a bone back and forth around Z
+static void addAnimation( NifModel * nif, qint32 bone, const Vector3 & translation, int numKeys, int phase )
+{
+	qint32 ctrl = insertBlock( nif, "NiTransformController" );
+	qint32 interp = insertBlock( nif, "NiTransformInterpolator" );
+	qint32 data = insertBlock( nif, "NiTransformData" );
+
+	QModelIndex iCtrl = nif->getBlockIndex( ctrl );
+	nif->set<float>( iCtrl, "Start Time", 0.0f );
+	nif->set<float>( iCtrl, "Stop Time", float( numKeys - 1 ) / keyRate );
+	nif->setLink( iCtrl, "Target", bone );
+	nif->setLink( iCtrl, "Interpolator", interp );
+	nif->setLink( nif->getBlockIndex( bone ), "Controller", ctrl );
+
+	QModelIndex iInterp = nif->getBlockIndex( interp );
+	nif->set<Vector3>( nif->getIndex( iInterp, "Transform" ), "Translation", translation );
+	nif->setLink( iInterp, "Data", data );
+
+	QModelIndex iData = nif->getBlockIndex( data );
+	nif->set<int>( iData, "Num Rotation Keys", numKeys );
+	nif->set<int>( iData, "Rotation Type", 1 ); // LINEAR_KEY
+	nif->updateArraySize( iData, "Quaternion Keys" );
+
+	QModelIndex iRotKeys = nif->getIndex( iData, "Quaternion Keys" );
+	for ( int k = 0; k < numKeys; k++ ) {
+		float a = 0.2f * std::sin( float( 2.0 * M_PI ) * float( k + phase ) / float( numKeys ) );
+		QModelIndex iKey = QModelIndex_child( iRotKeys, k );
+		nif->set<float>( iKey, "Time", float( k ) / keyRate );
+		nif->set<Quat>( iKey, "Value", Quat( std::cos( a / 2 ), 0, 0, std::sin( a / 2 ) ) );
+	}
+
+	QModelIndex iTrans = nif->getIndex( iData, "Translations" );
+	nif->set<int>( iTrans, "Num Keys", numKeys );
+	nif->set<int>( iTrans, "Interpolation", 1 );
+	nif->updateArraySize( iTrans, "Keys" );
+
+	QModelIndex iTransKeys = nif->getIndex( iTrans, "Keys" );
+	for ( int k = 0; k < numKeys; k++ ) {
+		QModelIndex iKey = QModelIndex_child( iTransKeys, k );
+		nif->set<float>( iKey, "Time", float( k ) / keyRate );
+		nif->set<Vector3>( iKey, "Value", translation );
+	}
+}
+
+static void addTriShape( NifModel * nif, const QModelIndex & iShape, const BenchGrid & g, const QVector<qint32> & bones, qint32 root )
+{
+	qint32 data = insertBlock( nif, "NiTriShapeData" );
+	QModelIndex iData = nif->getBlockIndex( data );
+
+	nif->set<int>( iData, "Num Vertices", g.verts.count() );
+	nif->set<bool>( iData, "Has Vertices", true );
+	nif->set<bool>( iData, "Has Normals", true );
+	nif->set<int>( iData, "Data Flags", 1 ); // One UV set
+	nif->updateArraySize( iData, "Vertices" );
+	nif->updateArraySize( iData, "Normals" );
+	nif->setArray<Vector3>( iData, "Vertices", g.verts );
+	nif->setArray<Vector3>( iData, "Normals", g.norms );
+
+	nif->updateArraySize( iData, "UV Sets" );
+	QModelIndex iUVSet = QModelIndex_child( nif->getIndex( iData, "UV Sets" ) );
+	nif->updateArraySize( iUVSet );
+	nif->setArray<Vector2>( iUVSet, g.uvs );
+
+	nif->set<int>( iData, "Num Triangles", g.tris.count() );
+	nif->set<int>( iData, "Num Triangle Points", g.tris.count() * 3 );
+	nif->set<bool>( iData, "Has Triangles", true );
+	nif->updateArraySize( iData, "Triangles" );
+	nif->setArray<Triangle>( iData, "Triangles", g.tris );
+
+	setBound( nif, iData, g.verts.first()[2] );
+	nif->setLink( iShape, "Data", data );
+
+	if ( bones.isEmpty() )
+		return;
+
+	qint32 skinInst = insertBlock( nif, "NiSkinInstance" );
+	qint32 skinData = insertBlock( nif, "NiSkinData" );
+
+	QModelIndex iSkinInst = nif->getBlockIndex( skinInst );
+	nif->setLink( iSkinInst, "Data", skinData );
+	nif->setLink( iSkinInst, "Skeleton Root", root );
+	setLinks( nif, iSkinInst, "Num Bones", "Bones", bones );
+
+	QModelIndex iSkinData = nif->getBlockIndex( skinData );
+	Transform().writeBack( nif, iSkinData );
+	nif->set<int>( iSkinData, "Num Bones", bones.count() );
+	nif->updateArraySize( iSkinData, "Bone List" );
+
+	auto weights = boneWeights( g, bones.count() );
+	QModelIndex iBoneList = nif->getIndex( iSkinData, "Bone List" );
+	float step = bones.count() > 1 ? gridSize / float( bones.count() - 1 ) : 0.0f;
+
+	for ( int b = 0; b < bones.count(); b++ ) {
+		QModelIndex iBone = QModelIndex_child( iBoneList, b );
+
+		// The inverse of the bind pose of the bone
+		Transform t;
+		t.translation = Vector3( -step * float( b ), 0, 0 );
+		t.writeBack( nif, iBone );
+
+		nif->set<int>( iBone, "Num Vertices", weights[b].count() );
+		nif->updateArraySize( iBone, "Vertex Weights" );
+
+		QModelIndex iWeights = nif->getIndex( iBone, "Vertex Weights" );
+		for ( int w = 0; w < weights[b].count(); w++ ) {
+			QModelIndex iWeight = QModelIndex_child( iWeights, w );
+			nif->set<int>( iWeight, "Index", weights[b][w].first );
+			nif->set<float>( iWeight, "Weight", weights[b][w].second );
+		}
+	}
+
+	nif->setLink( iShape, "Skin Instance", skinInst );
+}
+
+static void addBSTriShape( NifModel * nif, const QModelIndex & iShape, const BenchGrid & g, const QVector<qint32> & bones, qint32 root )
+{
+	// Skinned SSE shapes keep their vertices in the NiSkinPartition, only FO4 skin is generated
+	bool skinned = !bones.isEmpty() && nif->getBSVersion() >= 130;
+
+	BSVertexDesc desc;
+	desc.SetFlag( VertexFlags::VF_VERTEX );
+	desc.SetFlag( VertexFlags::VF_UV );
+	desc.SetFlag( VertexFlags::VF_NORMAL );
+	desc.SetFlag( VertexFlags::VF_TANGENT );
+	if ( skinned )
+		desc.SetFlag( VertexFlags::VF_SKINNED );
+	if ( nif->getBSVersion() >= 130 )
+		desc.SetFlag( VertexFlags::VF_FULLPREC );
+	desc.ResetAttributeOffsets( nif->getBSVersion() );
+
+	int numVerts = g.verts.count();
+	int numTris = g.tris.count();
+
+	nif->set<BSVertexDesc>( iShape, "Vertex Desc", desc );
+	nif->set<int>( iShape, "Num Vertices", numVerts );
+	nif->set<int>( iShape, "Num Triangles", numTris );
+	nif->set<uint>( iShape, "Data Size", desc.GetVertexSize() * numVerts + 6 * numTris );
+	nif->updateArraySize( iShape, "Vertex Data" );
+	nif->updateArraySize( iShape, "Triangles" );
+
+	QModelIndex iVertData = nif->getIndex( iShape, "Vertex Data" );
+	for ( int v = 0; v < numVerts; v++ ) {
+		QModelIndex iVert = QModelIndex_child( iVertData, v );
+		nif->set<Vector3>( iVert, "Vertex", g.verts[v] );
+		nif->set<HalfVector2>( iVert, "UV", HalfVector2( g.uvs[v] ) );
+		nif->set<ByteVector3>( iVert, "Normal", ByteVector3( g.norms[v] ) );
+		nif->set<ByteVector3>( iVert, "Tangent", ByteVector3( 1, 0, 0 ) );
+		nif->set<float>( iVert, "Bitangent X", 0.0f );
+		nif->set<float>( iVert, "Bitangent Y", 1.0f );
+		nif->set<float>( iVert, "Bitangent Z", 0.0f );
+
+		if ( skinned ) {
+			int b = g.bones[v];
+			float w = g.weights[v];
+			nif->setArray<float>( iVert, "Bone Weights", { w, 1.0f - w, 0, 0 } );
+			nif->setArray<quint8>( iVert, "Bone Indices", { quint8( b ), quint8( std::min( b + 1, int( bones.count() ) - 1 ) ), 0, 0 } );
+		}
+	}
+
+	nif->setArray<Triangle>( iShape, "Triangles", g.tris );
+	setBound( nif, iShape, g.verts.first()[2] );
+
+	if ( !skinned )
+		return;
+
+	qint32 skinInst = insertBlock( nif, "BSSkin::Instance" );
+	qint32 boneData = insertBlock( nif, "BSSkin::BoneData" );
+
+	QModelIndex iSkinInst = nif->getBlockIndex( skinInst );
+	nif->setLink( iSkinInst, "Data", boneData );
+	nif->setLink( iSkinInst, "Skeleton Root", root );
+	setLinks( nif, iSkinInst, "Num Bones", "Bones", bones );
+
+	QModelIndex iBoneData = nif->getBlockIndex( boneData );
+	nif->set<int>( iBoneData, "Num Bones", bones.count() );
+	nif->updateArraySize( iBoneData, "Bone List" );
+
+	QModelIndex iBoneList = nif->getIndex( iBoneData, "Bone List" );
+	float step = bones.count() > 1 ? gridSize / float( bones.count() - 1 ) : 0.0f;
+	for ( int b = 0; b < bones.count(); b++ ) {
+		Transform t;
+		t.translation = Vector3( -step * float( b ), 0, 0 );
+		t.writeBack( nif, QModelIndex_child( iBoneList, b ) );
+	}
+
+	nif->setLink( iShape, "Skin", skinInst );
+}
+
+NifBench::NifBench( const Options & options, QObject * parent )
+	: QObject( parent ), opts( options )
+{
+	if ( opts.games.isEmpty() )
+		opts.games = games();
+
+	// Triangle indices are 16 bit
+	opts.vertices = std::clamp( opts.vertices, 4, 32767 );
+	opts.shapes = std::max( opts.shapes, 1 );
+	opts.bones = std::clamp( opts.bones, 0, 255 );
+	opts.keys = std::max( opts.keys, 0 );
+	opts.warmup = std::max( opts.warmup, 0 );
+	opts.repetitions = std::max( opts.repetitions, 1 );
+	opts.frames = std::max( opts.frames, 1 );
+}
+
+NifBench::~NifBench()
+{
+	if ( context && surface )
+		context->makeCurrent( surface );
+
+	delete scene;
+	delete textures;
+
+	if ( context )
+		context->doneCurrent();
+}
+
+QStringList NifBench::games()
+{
+	QStringList names;
+	for ( const BenchGame & g : benchGames )
+		names << g.name;
+	return names;
+}
+
+bool NifBench::initialize( QString * error )
+{
+	if ( !createOffscreenContext( this, context, surface ) ) {
+		if ( error )
+			*error = tr( "Could not create an OpenGL context, the scene stages are skipped" );
+		return false;
+	}
+
+	initializeTextureUnits( context );
+
+	textures = new TexCache( this );
+	scene = new Scene( textures, context, context->functions(), this );
+	if ( scene->renderer->initialize() )
+		scene->updateShaders();
+
+	return true;
+}
+
+bool NifBench::generate( NifModel * nif, const QString & game, const Options & options )
+{
+	const BenchGame * g = std::find_if( std::begin( benchGames ), std::end( benchGames ),
+		[&game]( const BenchGame & b ) { return game == QLatin1String( b.name ); } );
+	if ( g == std::end( benchGames ) )
+		return false;
+
+	nif->clear( g->version, g->userVersion, g->bsVersion );
+	bool prevHold = nif->holdUpdates( true );
+
+	qint32 root = insertBlock( nif, "NiNode", "Scene Root" );
+
+	// A chain of bones along the X axis
+	QVector<qint32> bones;
+	float step = options.bones > 1 ? gridSize / float( options.bones - 1 ) : 0.0f;
+	for ( int b = 0; b < options.bones; b++ ) {
+		qint32 bone = insertBlock( nif, "NiNode", QString( "Bone %1" ).arg( b ) );
+		Vector3 translation( b > 0 ? step : 0.0f, 0, 0 );
+		nif->set<Vector3>( nif->getBlockIndex( bone ), "Translation", translation );
+
+		if ( options.keys > 0 )
+			addAnimation( nif, bone, translation, options.keys, b );
+		if ( b > 0 )
+			setLinks( nif, nif->getBlockIndex( bones.last() ), "Num Children", "Children", { bone } );
+
+		bones << bone;
+	}
+
+	QVector<qint32> children;
+	if ( !bones.isEmpty() )
+		children << bones.first();
+
+	for ( int s = 0; s < options.shapes; s++ ) {
+		BenchGrid grid = makeGrid( options.vertices, bones.count(), float( s ) * 2.0f );
+		QString name = QString( "Shape %1" ).arg( s );
+
+		qint32 shape;
+		if ( g->bsVersion >= 172 ) {
+			// Starfield geometry is in external .mesh files, only the blocks are generated
+			shape = insertBlock( nif, "BSGeometry", name );
+			setBound( nif, nif->getBlockIndex( shape ), grid.verts.first()[2] );
+		} else if ( g->bsVersion >= 100 ) {
+			shape = insertBlock( nif, "BSTriShape", name );
+			addBSTriShape( nif, nif->getBlockIndex( shape ), grid, bones, root );
+		} else {
+			shape = insertBlock( nif, "NiTriShape", name );
+			addTriShape( nif, nif->getBlockIndex( shape ), grid, bones, root );
+		}
+
+		children << shape;
+	}
+
+	setLinks( nif, nif->getBlockIndex( root ), "Num Children", "Children", children );
+
+	nif->holdUpdates( prevHold );
+	nif->updateHeader();
+	nif->updateFooter();
+	return true;
+}
+
+QJsonObject NifBench::measure( const std::function<void()> & setup, const std::function<void()> & stage, int iterations ) const
+{
+	QVector<double> samples;
+	QElapsedTimer timer;
+
+	for ( int r = -opts.warmup; r < opts.repetitions; r++ ) {
+		qint64 nsecs = 0;
+		for ( int i = 0; i < iterations; i++ ) {
+			if ( setup )
+				setup();
+
+			timer.start();
+			stage();
+			nsecs += timer.nsecsElapsed();
+		}
+
+		if ( r >= 0 )
+			samples << double( nsecs ) / 1.0e6 / double( iterations );
+	}
+
+	QJsonObject result;
+
+	int n = samples.count();
+	if ( !n ) {
+		result.insert( "samples", QJsonArray() );
+		return result;
+	}
+
+	QVector<double> sorted = samples;
+	std::sort( sorted.begin(), sorted.end() );
+
+	double median = ( n % 2 ) ? sorted[n / 2] : ( sorted[n / 2 - 1] + sorted[n / 2] ) / 2.0;
+
+	QJsonArray values;
+	double sum = 0.0;
+	for ( double s : samples ) {
+		values.append( s );
+		sum += s;
+	}
+
+	result.insert( "median", median );
+	result.insert( "mean", sum / double( n ) );
+	result.insert( "min", sorted.first() );
+	result.insert( "max", sorted.last() );
+	result.insert( "samples", values );
+	return result;
+}
+
+QJsonObject NifBench::runGame( const QString & game )
+{
+	QJsonObject result;
+	QJsonObject stages;
+	result.insert( "game", game );
+
+	NifModel generated;
+	stages.insert( "generate", measure( nullptr, [&]() { generate( &generated, game, opts ); } ) );
+
+	QByteArray bytes;
+	{
+		QBuffer buffer( &bytes );
+		buffer.open( QIODevice::WriteOnly );
+		generated.save( buffer );
+	}
+
+	stages.insert( "save", measure( nullptr, [&]() {
+		QBuffer buffer;
+		buffer.open( QIODevice::WriteOnly );
+		generated.save( buffer );
+	} ) );
+
+	NifModel nif;
+	auto load = [&bytes]( NifModel & model ) {
+		QBuffer buffer( &bytes );
+		buffer.open( QIODevice::ReadOnly );
+		return model.load( buffer );
+	};
+
+	stages.insert( "load", measure( nullptr, [&]() { load( nif ); } ) );
+
+	if ( !load( nif ) ) {
+		result.insert( "error", tr( "The generated file could not be loaded" ) );
+		return result;
+	}
+
+	int numVerts = 0, numTris = 0;
+	for ( int b = 0; b < nif.getBlockCount(); b++ ) {
+		QModelIndex iBlock = nif.getBlockIndex( b );
+		if ( nif.isNiBlock( iBlock, "NiTriShapeData" ) ) {
+			numVerts += nif.get<int>( iBlock, "Num Vertices" );
+			numTris += nif.get<int>( iBlock, "Num Triangles" );
+		} else if ( nif.blockInherits( iBlock, "BSTriShape" ) ) {
+			numVerts += nif.get<int>( iBlock, "Num Vertices" );
+			numTris += nif.get<int>( iBlock, "Num Triangles" );
+		}
+	}
+
+	result.insert( "blocks", nif.getBlockCount() );
+	result.insert( "vertices", numVerts );
+	result.insert( "triangles", numTris );
+	result.insert( "bytes", bytes.size() );
+
+	if ( scene && context->makeCurrent( surface ) ) {
+		stages.insert( "scene.make", measure( nullptr, [&]() { scene->make( &nif ); } ) );
+
+		int frame = 0;
+		auto frameTime = [&frame, this]() {
+			return float( frame++ % std::max( opts.keys, 1 ) ) / keyRate;
+		};
+
+		stages.insert( "scene.transform", measure( nullptr, [&]() {
+			scene->transform( Transform(), frameTime() );
+		}, opts.frames ) );
+
+		// The shapes alone, mostly CPU skinning
+		stages.insert( "transformShapes", measure( [&]() { scene->transform( Transform(), frameTime() ); }, [&]() {
+			for ( Node * node : scene->roots.list() )
+				node->transformShapes();
+		}, opts.frames ) );
+
+		scene->clear( false );
+	}
+
+	// The spells change the model, so every iteration starts from a freshly loaded file
+	NifModel work;
+	QList<QPersistentModelIndex> shapes;
+	auto reload = [&]() {
+		load( work );
+		shapes.clear();
+		for ( int b = 0; b < work.getBlockCount(); b++ ) {
+			QModelIndex iBlock = work.getBlockIndex( b );
+			if ( work.blockInherits( iBlock, "NiTriBasedGeom" ) || work.blockInherits( iBlock, "BSTriShape" ) )
+				shapes << iBlock;
+		}
+	};
+
+	reload();
+	spTangentSpace tangentSpace;
+	if ( std::any_of( shapes.begin(), shapes.end(), [&]( const QModelIndex & i ) { return tangentSpace.isApplicable( &work, i ); } ) ) {
+		stages.insert( "spell.tangentSpace", measure( reload, [&]() {
+			for ( const QPersistentModelIndex & iShape : shapes ) {
+				if ( tangentSpace.isApplicable( &work, iShape ) )
+					tangentSpace.cast( &work, iShape );
+			}
+		} ) );
+	}
+
+	if ( opts.bones > 0 && work.getBSVersion() < 100 ) {
+		stages.insert( "spell.skinPartition", measure( reload, [&]() {
+			for ( const QPersistentModelIndex & iShape : shapes )
+				makeSkinPartition( &work, iShape, 18, 4 );
+		} ) );
+	}
+
+	result.insert( "stages", stages );
+	return result;
+}
+
+QJsonObject NifBench::run()
+{
+	QJsonObject options;
+	options.insert( "shapes", opts.shapes );
+	options.insert( "vertices", opts.vertices );
+	options.insert( "bones", opts.bones );
+	options.insert( "keys", opts.keys );
+	options.insert( "warmup", opts.warmup );
+	options.insert( "repetitions", opts.repetitions );
+	options.insert( "frames", opts.frames );
+
+	QJsonArray results;
+	for ( const QString & game : opts.games )
+		results.append( runGame( game ) );
+
+	QJsonObject root;
+	root.insert( "version", NIFSKOPE_VERSION );
+	root.insert( "opengl", scene != nullptr );
+	root.insert( "options", options );
+	root.insert( "games", results );
+	return root;
+}
+
+//! The results of a game by name
+static QJsonObject findGame( const QJsonObject & results, const QString & game )
+{
+	for ( const QJsonValue & v : results.value( "games" ).toArray() ) {
+		if ( v.toObject().value( "game" ).toString() == game )
+			return v.toObject();
+	}
+	return QJsonObject();
+}
+
+void NifBench::print( const QJsonObject & results, QTextStream & out )
+{
+	out << QString( "%1 %2 %3 %4" ).arg( "Stage", -32 ).arg( "Median ms", 12 ).arg( "Min ms", 12 ).arg( "Max ms", 12 ) << '\n';
+
+	for ( const QJsonValue & v : results.value( "games" ).toArray() ) {
+		QJsonObject game = v.toObject();
+		QString name = game.value( "game" ).toString();
+
+		if ( game.contains( "error" ) ) {
+			out << name << ": " << game.value( "error" ).toString() << '\n';
+			continue;
+		}
+
+		QJsonObject stages = game.value( "stages" ).toObject();
+		for ( auto it = stages.constBegin(); it != stages.constEnd(); ++it ) {
+			QJsonObject s = it.value().toObject();
+			out << QString( "%1 %2 %3 %4" ).arg( name + "/" + it.key(), -32 )
+				.arg( s.value( "median" ).toDouble(), 12, 'f', 3 )
+				.arg( s.value( "min" ).toDouble(), 12, 'f', 3 )
+				.arg( s.value( "max" ).toDouble(), 12, 'f', 3 ) << '\n';
+		}
+	}
+}
+
+int NifBench::compare( const QJsonObject & results, const QJsonObject & baseline, double threshold, QTextStream & out )
+{
+	if ( results.value( "options" ) != baseline.value( "options" ) )
+		out << "Warning: the baseline was made with different options\n";
+
+	int slower = 0;
+	for ( const QJsonValue & v : results.value( "games" ).toArray() ) {
+		QJsonObject game = v.toObject();
+		QString name = game.value( "game" ).toString();
+		QJsonObject baseStages = findGame( baseline, name ).value( "stages" ).toObject();
+
+		QJsonObject stages = game.value( "stages" ).toObject();
+		for ( auto it = stages.constBegin(); it != stages.constEnd(); ++it ) {
+			if ( !baseStages.contains( it.key() ) )
+				continue;
+
+			double cur = it.value().toObject().value( "median" ).toDouble();
+			double base = baseStages.value( it.key() ).toObject().value( "median" ).toDouble();
+			if ( base <= 0.0 )
+				continue;
+
+			double change = ( cur / base - 1.0 ) * 100.0;
+			bool regressed = change > threshold;
+			if ( regressed )
+				slower++;
+
+			out << QString( "%1 %2 %3 %4%" ).arg( name + "/" + it.key(), -32 )
+				.arg( base, 12, 'f', 3 ).arg( cur, 12, 'f', 3 ).arg( change, 8, 'f', 1 )
+				<< ( regressed ? "  SLOWER" : "" ) << '\n';
+		}
+	}
+
+	return slower;
+}
@@ -0,0 +1,100 @@
+#ifndef NIFBENCH_H
+#define NIFBENCH_H
+
+#include <QJsonObject>
+#include <QObject> // Inherited
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+
+//! \file nifbench.h NifBench
+
+class NifModel;
+class QOffscreenSurface;
+class QOpenGLContext;
+class QTextStream;
+class Scene;
+class TexCache;
+
+//! Times loading, saving, rendering setup and spells on generated NIF files
+/*!
+ * The files are built through the NifModel API with a parameterized number of shapes, vertices,
+ * bones and animation keys, so no game data is needed. Each stage runs a number of warmup
+ * iterations that are not recorded, followed by the timed repetitions, and the results are
+ * returned as JSON that can be compared with an earlier run.
+ *
+ * The scene stages need an OpenGL context for the Renderer, but do not draw anything. They are
+ * skipped if no context can be created.
+ */
+class NifBench final : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Options
+	{
+		//! Games to generate files for, see games()
+		QStringList games;
+		//! Number of shapes in each file
+		int shapes = 16;
+		//! Number of vertices of each shape
+		int vertices = 4096;
+		//! Number of bones the shapes are skinned to, 0 for no skinning
+		int bones = 32;
+		//! Number of animation keys of each bone, 0 for no animation
+		int keys = 100;
+		//! Iterations of each stage that are not recorded
+		int warmup = 1;
+		//! Recorded iterations of each stage
+		int repetitions = 5;
+		//! Number of animation frames timed in each repetition of the transform stages
+		int frames = 60;
+	};
+
+	explicit NifBench( const Options & options, QObject * parent = nullptr );
+	~NifBench();
+
+	//! The games files can be generated for
+	static QStringList games();
+
+	//! Creates the context for the scene stages, returns false if OpenGL is not available
+	bool initialize( QString * error = nullptr );
+
+	//! Replaces the contents of a model with a generated file, returns false for an unknown game
+	static bool generate( NifModel * nif, const QString & game, const Options & options );
+
+	//! Runs every stage for every game
+	QJsonObject run();
+
+	//! Prints the median, minimum and maximum time of every stage
+	static void print( const QJsonObject & results, QTextStream & out );
+
+	//! Compares the median times with a baseline
+	/*!
+	 * @param threshold	How much slower a stage may be, in percent
+	 * @return The number of stages that were slower than allowed
+	 */
+	static int compare( const QJsonObject & results, const QJsonObject & baseline, double threshold, QTextStream & out );
+
+private:
+	//! Times a stage, setup is called before each iteration and is not timed
+	/*!
+	 * @param iterations	The number of times each repetition runs the stage, the sample is the average
+	 */
+	QJsonObject measure( const std::function<void()> & setup, const std::function<void()> & stage, int iterations = 1 ) const;
+
+	//! Runs every stage for one game
+	QJsonObject runGame( const QString & game );
+
+	Options opts;
+
+	QOpenGLContext * context = nullptr;
+	QOffscreenSurface * surface = nullptr;
+
+	TexCache * textures = nullptr;
+	Scene * scene = nullptr;
+};
+
+#endif
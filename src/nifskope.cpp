@@ -39,12 +39,14 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "version.h"
 #include "gl/glscene.h"
 #include "model/kfmmodel.h"
+#include "model/nifloadthread.h"
 #include "model/nifmodel.h"
 #include "model/nifproxymodel.h"
 #include "ui/widgets/fileselect.h"
 #include "ui/widgets/nifview.h"
 #include "ui/widgets/refrbrowser.h"
 #include "ui/widgets/inspect.h"
+#include "ui/widgets/nifdiffview.h"
 #include "ui/about_dialog.h"
 #include "ui/settingsdialog.h"
 #include "gamemanager.h"
@@ -63,10 +65,10 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QMessageBox>
 #include <QProgressBar>
 #include <QSettings>
+#include <QThread>
 #include <QTimer>
 #include <QTranslator>
 #include <QUrl>
-#include <QCryptographicHash>
 
 #include <QListView>
 #include <QTreeView>
@@ -268,6 +270,14 @@ NifSkope::NifSkope()
 	inspect->setNifModel( nif );
 	inspect->setScene( ogl->getScene() );
 
+	// Create NifDiffView
+	/* ********************** */
+
+	diffView = new NifDiffView;
+	diffView->setNifModel( nif );
+	connect( diffView, &NifDiffView::sigSelectBlock, this, &NifSkope::select );
+	connect( this, &NifSkope::completeLoading, diffView, &NifDiffView::clear );
+
 	// Create Progress Bar
 	/* ********************** */
 	progress = new QProgressBar( ui->statusbar );
@@ -346,6 +356,11 @@ void NifSkope::exitRequested()
 
 NifSkope::~NifSkope()
 {
+	if ( loader ) {
+		loader->cancel();
+		loader->wait();
+	}
+
 	delete ui;
 	if ( currentArchive )
 		delete currentArchive;
@@ -391,10 +406,15 @@ void NifSkope::closeEvent( QCloseEvent * e )
 {
 	saveUi();
 
-	if ( saveConfirm() )
+	if ( saveConfirm() ) {
+		if ( loader ) {
+			loader->cancel();
+			loader->wait();
+		}
 		e->accept();
-	else
+	} else {
 		e->ignore();
+	}
 }
 
 
@@ -766,43 +786,12 @@ QModelIndex NifSkope::currentNifIndex() const
 	return index;
 }
 
-QByteArray fileChecksum( const QString &fileName, QCryptographicHash::Algorithm hashAlgorithm )
+void NifSkope::checkFile( const QString & fpath, bool roundTrip, const QString & difference )
 {
-	QFile f( fileName );
-	if ( f.open( QFile::ReadOnly ) ) {
-		QCryptographicHash hash( hashAlgorithm );
-		if ( hash.addData( &f ) ) {
-			return hash.result();
-		}
+	if ( !roundTrip ) {
+		QString err = tr( "This file will not be 100% identical upon saving. This could indicate underlying issues with the data in this file." );
+		Message::warning( this, err, fpath + "\n" + difference );
 	}
-	return QByteArray();
-}
-
-void NifSkope::checkFile( QFileInfo fInfo, QByteArray hash )
-{
-	QString fname = fInfo.fileName();
-	QString fpath = fInfo.filePath();
-	QDir::temp().mkdir( "NifSkope" );
-	QString tmpDir = QDir::tempPath() + "/NifSkope";
-	QDir tmp( tmpDir );
-	QString tmpFile = tmpDir + "/" + fInfo.fileName();
-
-	emit beginSave();
-	bool saved = nif->saveToFile( tmpFile );
-	if ( saved ) {
-		auto filehash2 = fileChecksum( tmpFile, QCryptographicHash::Md5 );
-
-		if ( hash == filehash2 ) {
-			tmp.remove( fname );
-		} else {
-			QString err = "An MD5 hash comparison indicates this file will not be 100% identical upon saving. This could indicate underlying issues with the data in this file.";
-			Message::warning( this, err, fpath );
-#ifdef QT_NO_DEBUG
-			tmp.remove( fname );
-#endif
-		}
-	}
-	emit completeSave( saved, fpath );
 }
 
 static bool archiveFilterFunction( [[maybe_unused]] void * p, const std::string_view & s )
@@ -985,7 +974,7 @@ void NifSkope::openArchiveFile( const QModelIndex & index )
 
 void NifSkope::openArchiveFileString( const BA2File * bsa, const QString & filepath )
 {
-	if ( !currentArchive || currentArchiveNames.empty() )
+	if ( !currentArchive || currentArchiveNames.empty() || loader )
 		return;
 	std::string	filePathStr( filepath.toLower().toStdString() );
 	auto	fd = currentArchive->findFile( filePathStr );
@@ -998,35 +987,16 @@ void NifSkope::openArchiveFileString( const BA2File * bsa, const QString & filep
 	BA2File::UCharArray	data;
 	const unsigned char *	dataPtr;
 	size_t	dataSize = bsa->extractFile( dataPtr, data, filePathStr );
-	QBuffer	buf;
-	buf.setData( reinterpret_cast< const char * >(dataPtr), qsizetype(dataSize) );
+	QByteArray	buf( reinterpret_cast< const char * >(dataPtr), qsizetype(dataSize) );
 
 	// Format like "BSANAME.BSA/path/to/file.nif"
 	QString path( currentArchiveNames[std::min( size_t(fd->archiveFile), size_t(currentArchiveNames.size() - 1) )] );
 	path = path + "/" + filepath;
 
-	if ( buf.open( QBuffer::ReadOnly ) ) {
-
-		emit beginLoading();
-
-		bool loaded = nif->load( buf );
-		if ( loaded )
-			setCurrentFile( path );
-
-		emit completeLoading( loaded, path );
-
-		//if ( loaded ) {
-		//	QCryptographicHash hash( QCryptographicHash::Md5 );
-		//	hash.addData( data );
-		//	filehash = hash.result();
-		//
-		//	QFileInfo f( path );
-		//
-		//	checkFile( f, filehash );
-		//}
+	emit beginLoading();
 
-		buf.close();
-	}
+	// The current file is set by finishLoading() if the load succeeds
+	startLoading( path, buf );
 }
 
 
@@ -1086,6 +1056,9 @@ void NifSkope::saveFile( const QString & filename )
 
 void NifSkope::loadFile( const QString & filename )
 {
+	if ( loader )
+		return;
+
 	QApplication::setOverrideCursor( Qt::WaitCursor );
 
 	setCurrentFile( filename );
@@ -1099,6 +1072,9 @@ void NifSkope::reload()
 
 void NifSkope::load()
 {
+	if ( loader )
+		return;
+
 	{
 		QString	fname = currentFile.toLower().replace('\\', '/');
 		qsizetype	n1 = fname.indexOf(".ba2/");
@@ -1131,15 +1107,62 @@ void NifSkope::load()
 		return;
 	}
 
-	bool loaded = nif->loadFromFile( fname );
+	startLoading( fname );
+}
 
-	emit completeLoading( loaded, fname );
+void NifSkope::startLoading( const QString & fname, const QByteArray & data )
+{
+	loader = new NifLoadThread( this, fname, data );
+	loader->model.setCaptureDigests( true );
+
+	// Queued to the GUI thread, the model is only read by the loader until it has finished
+	connect( &loader->model, &NifModel::sigProgress, progress, [this]( int c, int m ) {
+		progress->setRange( 0, m );
+		progress->setValue( c );
+	} );
+	connect( loader, &QThread::finished, this, &NifSkope::finishLoading );
+
+	progress->setFormat( tr( "%p% (Esc to cancel)" ) );
+
+	loader->start();
+}
 
-	//if ( loaded ) {
-	//	filehash = fileChecksum( fname, QCryptographicHash::Md5 );
-	//
-	//	checkFile( f, filehash );
-	//}
+void NifSkope::cancelLoading()
+{
+	if ( loader )
+		loader->cancel();
+}
+
+void NifSkope::finishLoading()
+{
+	NifLoadThread * done = loader;
+	if ( !done )
+		return;
+
+	done->wait();
+	loader = nullptr;
+	progress->resetFormat();
+
+	QString fname = done->fileName;
+	loadCancelled = done->cancelled;
+	bool loaded = done->loaded && !loadCancelled;
+
+	// Move the file into the model of the views, which are still detached by onLoadBegin()
+	if ( loaded )
+		nif->takeContents( &done->model );
+
+	bool archived = done->isArchived();
+	bool roundTrip = done->roundTrip;
+	QString difference = done->roundTripDifference;
+	delete done;
+
+	if ( loaded && archived )
+		setCurrentFile( fname );
+
+	if ( loaded )
+		checkFile( fname, roundTrip, difference );
+
+	emit completeLoading( loaded, fname );
 }
 
 void NifSkope::save()
@@ -61,7 +61,9 @@ namespace nstypes
 class GLView;
 class GLGraphicsView;
 class InspectView;
+class NifDiffView;
 class KfmModel;
+class NifLoadThread;
 class NifModel;
 class NifProxyModel;
 class NifTreeView;
@@ -206,6 +208,11 @@ public slots:
 	//! Select the font to use
 	void on_aSelectFont_triggered();
 
+	//! Start or stop recording trace zones
+	void on_aRecordTrace_toggled( bool );
+	//! Save the recorded trace zones
+	void on_aSaveTrace_triggered();
+
 	void on_tRender_actionTriggered( QAction * );
 
 	void on_aViewTop_triggered( bool );
@@ -245,6 +252,9 @@ protected slots:
 	void onLoadComplete( bool, QString & );
 	void onSaveComplete( bool, QString & );
 
+	//! Attach the model loaded by the loader thread and complete the load
+	void finishLoading();
+
 	//! Display a context menu at the specified position
 	void contextMenu( const QPoint & pos );
 
@@ -286,8 +296,13 @@ private:
 	void initConnections();
 
 	void loadFile( const QString & );
+	//! Load a NIF file, or the NIF data read from an archive, on a worker thread
+	void startLoading( const QString & fname, const QByteArray & data = QByteArray() );
+	//! Ask the NIF load in progress to stop
+	void cancelLoading();
 	void saveFile( const QString & );
-	void checkFile( QFileInfo fInfo, QByteArray filehash );
+	//! Warn if saving the NIF would not reproduce the file it was loaded from, as found by the loading thread
+	void checkFile( const QString & fpath, bool roundTrip, const QString & difference );
 
 	void openRecentFile();
 	void setCurrentFile( const QString & );
@@ -337,8 +352,6 @@ private:
 	QStringList currentArchiveNames;
 	BA2File * currentArchive = nullptr;
 
-	QByteArray filehash;
-
 	//! Stores the NIF file in memory.
 	NifModel * nif;
 	//! A hierarchical proxy for the NIF file.
@@ -373,6 +386,9 @@ private:
 	//! Transform inspect view
 	InspectView * inspect;
 
+	//! Comparison with another file
+	NifDiffView * diffView;
+
 	//! The main window
 	GLView * ogl;
 
@@ -387,6 +403,11 @@ private:
 
 	QProgressBar * progress = nullptr;
 
+	//! The NIF load in progress, if any
+	NifLoadThread * loader = nullptr;
+	//! The last load was cancelled by the user
+	bool loadCancelled = false;
+
 	QDockWidget * dList;
 	QDockWidget * dTree;
 	QDockWidget * dHeader;
@@ -394,6 +415,7 @@ private:
 	QDockWidget * dRefr;
 	QDockWidget * dInsp;
 	QDockWidget * dBrowser;
+	QDockWidget * dDiff;
 
 	QToolBar * tool;
 
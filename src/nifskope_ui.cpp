@@ -36,6 +36,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "glview.h"
 #include "message.h"
 #include "spellbook.h"
+#include "trace.h"
 #include "version.h"
 #include "gl/glscene.h"
 #include "model/kfmmodel.h"
@@ -64,6 +65,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QFontDialog>
 #include <QGroupBox>
 #include <QHeaderView>
+#include <QKeyEvent>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMouseEvent>
@@ -308,6 +310,33 @@ void NifSkope::initActions()
 
 	connect( ui->aPrintView, &QAction::triggered, ogl, &GLView::saveImage );
 
+	connect( ui->aFrameStats, &QAction::toggled, ogl, &GLView::setFrameStatsVisible );
+	connect( ui->aFrameStatsLog, &QAction::triggered, [this]( bool checked ) {
+		QString filename;
+		if ( checked ) {
+			filename = QFileDialog::getSaveFileName( this, tr( "Log Frame Statistics" ), "nifskope-frames.csv", tr( "CSV (*.csv)" ) );
+			if ( filename.isEmpty() ) {
+				ui->aFrameStatsLog->setChecked( false );
+				return;
+			}
+		}
+
+		QString error;
+		if ( !ogl->setFrameStatsLog( filename, &error ) ) {
+			ui->aFrameStatsLog->setChecked( false );
+			Message::critical( this, tr( "Could not write the frame statistics." ), error );
+		}
+	} );
+	connect( ui->aFrameStatsSave, &QAction::triggered, [this]() {
+		QString filename = QFileDialog::getSaveFileName( this, tr( "Save Frame Statistics" ), "nifskope-frames.csv", tr( "CSV (*.csv)" ) );
+		if ( filename.isEmpty() )
+			return;
+
+		QString error;
+		if ( !ogl->saveFrameStats( filename, &error ) )
+			Message::critical( this, tr( "Could not save the frame statistics." ), error );
+	} );
+
 #ifdef QT_NO_DEBUG
 	ui->aColorKeyDebug->setDisabled( true );
 	ui->aColorKeyDebug->setVisible( false );
@@ -382,6 +411,11 @@ void NifSkope::initDockWidgets()
 	dKfm = ui->KfmDock;
 	dBrowser = ui->BrowserDock;
 
+	dDiff = new QDockWidget( tr( "Compare" ), this );
+	dDiff->setObjectName( "DiffDock" );
+	dDiff->setAllowedAreas( Qt::BottomDockWidgetArea | Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea );
+	addDockWidget( Qt::RightDockWidgetArea, dDiff );
+
 	// Tabify List and Header
 	tabifyDockWidget( dList, dHeader );
 	tabifyDockWidget( dHeader, dBrowser );
@@ -393,10 +427,12 @@ void NifSkope::initDockWidgets()
 	dRefr->toggleViewAction()->setChecked( false );
 	dInsp->toggleViewAction()->setChecked( false );
 	dKfm->toggleViewAction()->setChecked( false );
+	dDiff->toggleViewAction()->setChecked( false );
 
 	dRefr->setVisible( false );
 	dInsp->setVisible( false );
 	dKfm->setVisible( false );
+	dDiff->setVisible( false );
 
 	ui->menuShow->addAction(dList->toggleViewAction());
 	ui->menuShow->addAction(dTree->toggleViewAction());
@@ -405,6 +441,7 @@ void NifSkope::initDockWidgets()
 	ui->menuShow->addAction(dInsp->toggleViewAction());
 	ui->menuShow->addAction(dKfm->toggleViewAction());
 	ui->menuShow->addAction(dRefr->toggleViewAction());
+	ui->menuShow->addAction(dDiff->toggleViewAction());
 
 	ui->tView->addAction(dList->toggleViewAction());
 	ui->tView->addAction(dTree->toggleViewAction());
@@ -413,9 +450,12 @@ void NifSkope::initDockWidgets()
 	ui->tView->addAction(dInsp->toggleViewAction());
 	ui->tView->addAction(dKfm->toggleViewAction());
 	ui->tView->addAction(dRefr->toggleViewAction());
+	ui->tView->addAction(dDiff->toggleViewAction());
 
 	// Set Inspect widget
 	dInsp->setWidget( inspect );
+	// Set Compare widget
+	dDiff->setWidget( diffView );
 
 	connect( dList->toggleViewAction(), &QAction::triggered, tree, &NifTreeView::clearRootIndex );
 
@@ -796,6 +836,8 @@ void NifSkope::onLoadBegin()
 	// Disconnect the models from the views
 	swapModels();
 
+	loadCancelled = false;
+
 	ogl->setUpdatesEnabled( false );
 	ogl->setEnabled( false );
 	setEnabled( false );
@@ -845,17 +887,19 @@ void NifSkope::onLoadComplete( bool success, QString & fname )
 		enableUi();
 
 	} else {
-		// File failed to load
-		Message::append( this, NifModel::tr( readFail ),
-						 NifModel::tr( readFailFinal ).arg( fname ), QMessageBox::Critical );
+		// File failed to load, or the load was cancelled
+		if ( !loadCancelled ) {
+			Message::append( this, NifModel::tr( readFail ),
+							 NifModel::tr( readFailFinal ).arg( fname ), QMessageBox::Critical );
+
+			// Remove from Current Files
+			clearCurrentFile();
+		}
 
 		nif->clear();
 		kfm->clear();
 		timeout = 0;
 
-		// Remove from Current Files
-		clearCurrentFile();
-
 		// Reset
 		currentFile.clear();
 		setWindowFilePath( "" );
@@ -1269,6 +1313,15 @@ bool NifSkope::eventFilter( QObject * o, QEvent * e )
 	//	QTimer::singleShot( 0, this, SLOT( overrideViewFont() ) );
 	//}
 
+	// Cancel the NIF load in progress, the window is disabled while loading
+	if ( loader && e->type() == QEvent::KeyPress && o->isWidgetType()
+		 && static_cast<QWidget *>(o)->window() == this
+		 && static_cast<QKeyEvent *>(e)->key() == Qt::Key_Escape )
+	{
+		cancelLoading();
+		return true;
+	}
+
 	// Global mouse press
 	if ( o->isWindowType() && e->type() == QEvent::MouseButtonPress ) {
 		//qDebug() << "Mouse Press";
@@ -1436,6 +1489,25 @@ void NifSkope::on_aSelectFont_triggered()
 	settings.setValue( "UI/View Font", fnt );
 }
 
+void NifSkope::on_aRecordTrace_toggled( bool checked )
+{
+	Trace::setRecording( checked );
+}
+
+void NifSkope::on_aSaveTrace_triggered()
+{
+	QString filename = QFileDialog::getSaveFileName( this, tr( "Save Trace" ), "nifskope-trace.json",
+		tr( "Chrome Trace (*.json)" )
+	);
+
+	if ( filename.isEmpty() )
+		return;
+
+	QString error;
+	if ( !Trace::save( filename, &error ) )
+		Message::critical( this, tr( "Could not save the trace." ), error );
+}
+
 void NifSkope::on_aWindow_triggered()
 {
 	createWindow();
@@ -33,6 +33,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "spellbook.h"
 
 #include "ui/checkablemessagebox.h"
+#include "trace.h"
 
 #include <QCache>
 #include <QDir>
@@ -42,6 +43,54 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 //! \file spellbook.cpp SpellBook implementation
 
+//! Dispatch key of an index: block type and target kind combined with the value type
+static QPair<QString, quint32> dispatchKey( const NifModel * nif, const NifItem * item )
+{
+	if ( !item )
+		return { QString(), quint32( Spell::TargetNone << 16 ) };
+
+	const NifItem * block = nif->getTopItem( item );
+	if ( nif->getBlockNumber( block ) < 0 )
+		return { QString(), quint32( ( Spell::TargetHeader << 16 ) | item->valueType() ) };
+
+	if ( item == block )
+		return { block->name(), quint32( Spell::TargetBlock << 16 ) };
+
+	return { block->name(), quint32( ( Spell::TargetField << 16 ) | item->valueType() ) };
+}
+
+//! Check the target, block type and value type declarations of a spell against a dispatch key
+static bool matchesKey( const Spell * spell, const NifModel * nif, const QPair<QString, quint32> & key )
+{
+	int target = key.second >> 16;
+	if ( !( spell->targets() & target ) )
+		return false;
+
+	if ( target == Spell::TargetBlock || target == Spell::TargetField ) {
+		QStringList blocks = spell->blockTypes();
+		if ( !blocks.isEmpty() && !nif->inherits( key.first, blocks ) )
+			return false;
+	}
+
+	if ( target == Spell::TargetField || target == Spell::TargetHeader ) {
+		QVector<NifValue::Type> types = spell->valueTypes();
+		if ( !types.isEmpty() && !types.contains( NifValue::Type( key.second & 0xFFFF ) ) )
+			return false;
+	}
+
+	return true;
+}
+
+//! Check the field name declarations of a spell against an item
+static bool matchesField( const Spell * spell, const NifModel * nif, const NifItem * item )
+{
+	if ( !item || item == nif->getBlockItem( item ) )
+		return true;
+
+	QStringList fields = spell->fieldNames();
+	return fields.isEmpty() || fields.contains( item->name() );
+}
+
 QList<SpellPtr> & SpellBook::spells()
 {
 	static QList<SpellPtr> _spells = QList<SpellPtr>();
@@ -118,6 +167,7 @@ void SpellBook::cast( NifModel * nif, const QModelIndex & index, SpellPtr spell
 
 	// Cast non-modifying spells
 	if ( spell && spell->isApplicable( nif, index ) && spell->constant() ) {
+		TRACE_ZONE( "Spell::cast", spell->name() );
 		auto idx = spell->cast( nif, index );
 		emit sigIndex( idx );
 		return;
@@ -135,10 +185,14 @@ void SpellBook::cast( NifModel * nif, const QModelIndex & index, SpellPtr spell
 		if ( noSignals )
 			nif->setState( BaseModel::Processing );
 		// Cast the spell and return index
+		TRACE_ZONE( "Spell::cast", spell->name() );
 		auto idx = spell->cast( nif, index );
 		if ( noSignals )
 			nif->resetState();
 
+		// Changes made while processing did not emit signals
+		sltResetCache();
+
 		// Refresh the header
 		nif->invalidateHeaderConditions();
 		nif->updateHeader();
@@ -160,13 +214,51 @@ void SpellBook::sltSpellTriggered( QAction * action )
 void SpellBook::sltNif( NifModel * nif )
 {
 	if ( Nif )
-		disconnect( Nif, &NifModel::modelReset, this, static_cast<void (SpellBook::*)()>(&SpellBook::checkActions) );
+		disconnect( Nif, nullptr, this, nullptr );
 
 	Nif = nif;
 	Index = QModelIndex();
+	dispatch.clear();
+	applicableCache.clear();
 
-	if ( Nif )
+	if ( Nif ) {
+		// The cache must be reset before the actions are checked again
+		connect( Nif, &NifModel::modelReset, this, &SpellBook::sltResetCache );
 		connect( Nif, &NifModel::modelReset, this, static_cast<void (SpellBook::*)()>(&SpellBook::checkActions) );
+		connect( Nif, &NifModel::layoutChanged, this, &SpellBook::sltResetCache );
+		connect( Nif, &NifModel::linksChanged, this, &SpellBook::sltResetCache );
+		connect( Nif, &NifModel::dataChanged, this, &SpellBook::sltDataChanged );
+		connect( Nif, &NifModel::rowsInserted, this, &SpellBook::sltRowsChanged );
+		connect( Nif, &NifModel::rowsRemoved, this, &SpellBook::sltRowsChanged );
+	}
+}
+
+void SpellBook::sltDataChanged( const QModelIndex & topLeft, const QModelIndex & bottomRight )
+{
+	int block = Nif ? Nif->getBlockNumber( topLeft ) : -1;
+	// Header changes (e.g. the version) affect every block
+	if ( block < 0 || block != Nif->getBlockNumber( bottomRight ) )
+		applicableCache.clear();
+	else
+		applicableCache.remove( block );
+}
+
+void SpellBook::sltRowsChanged( const QModelIndex & parent, int first, int last )
+{
+	Q_UNUSED( first );
+	Q_UNUSED( last );
+
+	int block = Nif ? Nif->getBlockNumber( parent ) : -1;
+	// Inserting or removing blocks shifts the block numbers
+	if ( block < 0 )
+		applicableCache.clear();
+	else
+		applicableCache.remove( block );
+}
+
+void SpellBook::sltResetCache()
+{
+	applicableCache.clear();
 }
 
 void SpellBook::sltIndex( const QModelIndex & index )
@@ -181,31 +273,80 @@ void SpellBook::sltIndex( const QModelIndex & index )
 
 void SpellBook::checkActions()
 {
-	checkActions( this, QString() );
+	checkActions( this, applicableSpells() );
 }
 
-void SpellBook::checkActions( QMenu * menu, const QString & page )
+void SpellBook::checkActions( QMenu * menu, const QSet<const Spell *> & applicable )
 {
 	bool menuEnable = false;
 	for ( QAction * action : menu->actions() ) {
 		if ( action->menu() ) {
-			checkActions( action->menu(), action->menu()->title() );
+			checkActions( action->menu(), applicable );
 			menuEnable |= action->menu()->isEnabled();
 			action->setVisible( action->menu()->isEnabled() );
 		} else {
-			for ( SpellPtr spell : spells() ) {
-				if ( action->text() == spell->name() && page == spell->page() ) {
-					bool actionEnable = Nif && spell->isApplicable( Nif, Index );
-					action->setVisible( actionEnable );
-					action->setEnabled( actionEnable );
-					menuEnable |= actionEnable;
-				}
+			SpellPtr spell = Map.value( action );
+			if ( spell ) {
+				bool actionEnable = applicable.contains( spell.get() );
+				action->setVisible( actionEnable );
+				action->setEnabled( actionEnable );
+				menuEnable |= actionEnable;
 			}
 		}
 	}
 	menu->setEnabled( menuEnable );
 }
 
+const QVector<SpellPtr> & SpellBook::candidates( const DispatchKey & key )
+{
+	auto it = dispatch.find( key );
+	if ( it == dispatch.end() ) {
+		QVector<SpellPtr> list;
+		for ( SpellPtr spell : spells() ) {
+			if ( matchesKey( spell.get(), Nif, key ) )
+				list.append( spell );
+		}
+		it = dispatch.insert( key, list );
+	}
+
+	return it.value();
+}
+
+QSet<const Spell *> SpellBook::applicableSpells()
+{
+	QSet<const Spell *> applicable;
+	if ( !Nif )
+		return applicable;
+
+	QModelIndex index = Index;
+	const NifItem * item = Nif->getItem( index, false );
+	const DispatchKey key = dispatchKey( Nif, item );
+
+	// Cached results of the cacheable spells, only valid until the block changes
+	auto & blockCache = applicableCache[Nif->getBlockNumber( item )];
+	auto cached = blockCache.constFind( item );
+	bool isCached = ( cached != blockCache.constEnd() );
+	if ( isCached )
+		applicable = cached.value();
+
+	QSet<const Spell *> cacheable;
+	for ( SpellPtr spell : candidates( key ) ) {
+		if ( isCached && spell->cacheable() )
+			continue;
+
+		if ( matchesField( spell.get(), Nif, item ) && spell->isApplicable( Nif, index ) ) {
+			applicable.insert( spell.get() );
+			if ( spell->cacheable() )
+				cacheable.insert( spell.get() );
+		}
+	}
+
+	if ( !isCached )
+		blockCache.insert( item, cacheable );
+
+	return applicable;
+}
+
 void SpellBook::newSpellRegistered( SpellPtr spell )
 {
 	if ( spell->page().isEmpty() ) {
@@ -245,6 +386,8 @@ void SpellBook::registerSpell( SpellPtr spell )
 		checkers().append( spell );
 
 	for ( SpellBook * book : books() ) {
+		book->dispatch.clear();
+		book->applicableCache.clear();
 		book->newSpellRegistered( spell );
 	}
 }
@@ -287,18 +430,28 @@ SpellPtr SpellBook::lookup( const QKeySequence & hotkey )
 SpellPtr SpellBook::instant( const NifModel * nif, const QModelIndex & index )
 {
 	for ( SpellPtr spell : instants() ) {
-		if ( spell->isApplicable( nif, index ) )
+		if ( isCandidate( spell.get(), nif, index ) && spell->isApplicable( nif, index ) )
 			return spell;
 	}
 	return nullptr;
 }
 
+bool SpellBook::isCandidate( const Spell * spell, const NifModel * nif, const QModelIndex & index )
+{
+	if ( !spell || !nif )
+		return false;
+
+	const NifItem * item = nif->getItem( index, false );
+	return matchesKey( spell, nif, dispatchKey( nif, item ) ) && matchesField( spell, nif, item );
+}
+
 QModelIndex SpellBook::sanitize( NifModel * nif )
 {
 	QPersistentModelIndex ridx;
 
 	for ( SpellPtr spell : sanitizers() ) {
 		if ( spell->isApplicable( nif, QModelIndex() ) ) {
+			TRACE_ZONE( "Spell::cast", spell->name() );
 			QModelIndex idx = spell->cast( nif, QModelIndex() );
 
 			if ( idx.isValid() && !ridx.isValid() )
@@ -315,6 +468,7 @@ QModelIndex SpellBook::check( NifModel * nif )
 
 	for ( SpellPtr spell : checkers() ) {
 		if ( spell->isApplicable(nif, QModelIndex()) ) {
+			TRACE_ZONE( "Spell::cast", spell->name() );
 			QModelIndex idx = spell->cast(nif, QModelIndex());
 
 			if ( idx.isValid() && !ridx.isValid() )
@@ -44,7 +44,9 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QList>
 #include <QMap>
 #include <QPersistentModelIndex>
+#include <QSet>
 #include <QString>
+#include <QVector>
 
 #include <memory>
 
@@ -60,6 +62,16 @@ using QIconPtr = std::shared_ptr<QIcon>;
 class Spell
 {
 public:
+	//! Kinds of model index a spell can be cast on
+	enum Target
+	{
+		TargetNone = 0x1,   //!< No index (the file as a whole)
+		TargetBlock = 0x2,  //!< The top item of a NiBlock
+		TargetField = 0x4,  //!< An item inside a NiBlock
+		TargetHeader = 0x8, //!< The header or footer, or an item inside them
+		TargetAny = 0xF
+	};
+
 	//! Constructor
 	Spell() {}
 	//! Destructor
@@ -86,6 +98,24 @@ public:
 	//! Hotkey sequence
 	virtual QKeySequence hotkey() const { return QKeySequence(); }
 
+	/*! Applicability declarations
+	 *
+	 * These are used by SpellBook to build a dispatch table so that isApplicable() is only
+	 * called for spells that can possibly apply to an index. They must never be stricter than
+	 * isApplicable() itself; an empty list means no restriction.
+	 */
+
+	//! Kinds of index the spell can be cast on (combination of Target flags)
+	virtual int targets() const { return TargetAny; }
+	//! Block types (or ancestors) the index must belong to
+	virtual QStringList blockTypes() const { return QStringList(); }
+	//! Names of the items the spell can be cast on (not checked for TargetBlock)
+	virtual QStringList fieldNames() const { return QStringList(); }
+	//! Value types of the items the spell can be cast on (not checked for TargetBlock)
+	virtual QVector<NifValue::Type> valueTypes() const { return {}; }
+	//! Whether isApplicable() depends only on the block of the index and may be cached until it changes
+	virtual bool cacheable() const { return true; }
+
 	//! Determine if/when the spell can be cast
 	virtual bool isApplicable( const NifModel * nif, const QModelIndex & index ) = 0;
 
@@ -147,6 +177,9 @@ public:
 	static QList<SpellPtr> & sanitizers();
 	static QList<SpellPtr> & checkers();
 
+	//! Check the applicability declarations of a spell against an index, without calling isApplicable()
+	static bool isCandidate( const Spell * spell, const NifModel * nif, const QModelIndex & index );
+
 public slots:
 	void sltNif( NifModel * nif );
 
@@ -161,6 +194,9 @@ signals:
 
 protected slots:
 	void sltSpellTriggered( QAction * action );
+	void sltDataChanged( const QModelIndex & topLeft, const QModelIndex & bottomRight );
+	void sltRowsChanged( const QModelIndex & parent, int first, int last );
+	void sltResetCache();
 
 protected:
 	NifModel * Nif;
@@ -168,7 +204,20 @@ protected:
 	QMap<QAction *, SpellPtr> Map;
 
 	void newSpellRegistered( SpellPtr spell );
-	void checkActions( QMenu * menu, const QString & page );
+	void checkActions( QMenu * menu, const QSet<const Spell *> & applicable );
+
+	//! Key of the dispatch table: block type and (target kind | value type)
+	using DispatchKey = QPair<QString, quint32>;
+
+	//! Spells that can apply to the current index
+	QSet<const Spell *> applicableSpells();
+	//! Spells whose block and item type declarations match a dispatch key
+	const QVector<SpellPtr> & candidates( const DispatchKey & key );
+
+	//! Precomputed candidate spells per (block type, item type)
+	QHash<DispatchKey, QVector<SpellPtr>> dispatch;
+	//! Cached isApplicable() results per block number and item
+	QHash<qint32, QHash<const void *, QSet<const Spell *>>> applicableCache;
 
 private:
 	static QList<SpellBook *> & books();
@@ -24,6 +24,8 @@ public:
 	QString name() const override final { return Spell::tr( "Attach .KF" ); }
 	QString page() const override final { return Spell::tr( "Animation" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && !index.isValid();
@@ -311,6 +313,9 @@ public:
 	QString name() const override final { return Spell::tr( "Convert Quat- to ZYX-Rotations" ); }
 	QString page() const override final { return Spell::tr( "Animation" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiKeyframeData" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex iBlock = nif->getBlockIndex( index, "NiKeyframeData" );
@@ -368,6 +373,9 @@ public:
 	QString name() const override final { return Spell::tr( "Fix Invalid AV Object Refs" ); }
 	QString page() const override final { return Spell::tr( "Animation" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiDefaultAVObjectPalette" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex iBlock = nif->getBlockIndex( index, "NiDefaultAVObjectPalette" );
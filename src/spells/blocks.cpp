@@ -674,6 +674,8 @@ public:
 	QString name() const override final { return Spell::tr( "Insert" ); }
 	QString page() const override final { return Spell::tr( "Block" ); }
 
+	int targets() const override final { return TargetNone | TargetBlock | TargetHeader; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		Q_UNUSED( nif );
@@ -785,6 +787,9 @@ public:
 	QString name() const override final { return Spell::tr( "Attach Node" ); }
 	QString page() const override final { return Spell::tr( "Node" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiNode" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index ) && nif->blockInherits( index, "NiNode" );
@@ -944,6 +949,9 @@ public:
 	QString name() const override final { return Spell::tr( "Attach Effect" ); }
 	QString page() const override final { return Spell::tr( "Node" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiNode" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index ) && nif->blockInherits( index, "NiNode" );
@@ -996,6 +1004,9 @@ public:
 	QString name() const override final { return Spell::tr( "Attach Extra Data" ); }
 	QString page() const override final { return Spell::tr( "Node" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiObjectNET" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index ) && nif->blockInherits( index, "NiObjectNET" ) && nif->checkVersion( 0x0a000100, 0 );
@@ -1037,6 +1048,8 @@ public:
 	QString name() const override final { return Spell::tr( "Remove" ); }
 	QString page() const override final { return Spell::tr( "Block" ); }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index ) && nif->getBlockNumber( index ) >= 0;
@@ -1060,6 +1073,8 @@ public:
 	bool constant() const override final { return true; }
 	QKeySequence hotkey() const override final { return{ Qt::CTRL | Qt::SHIFT | Qt::Key_C }; }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index );
@@ -1113,6 +1128,8 @@ public:
 		return {};
 	}
 
+	bool cacheable() const override final { return false; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		Q_UNUSED( index );
@@ -1210,6 +1227,8 @@ public:
 		return {};
 	}
 
+	bool cacheable() const override final { return false; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		const QMimeData * mime = QApplication::clipboard()->mimeData();
@@ -1526,6 +1545,8 @@ public:
 		return QString();
 	}
 
+	bool cacheable() const override final { return false; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		//if ( index.isValid() && ! nif->isNiBlock( index ) && ! nif->isLink( index ) )
@@ -1577,6 +1598,9 @@ public:
 	QString name() const override final { return Spell::tr( "Flatten Branch" ); }
 	QString page() const override final { return Spell::tr( "Block" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiNode" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex iParent = nif->getBlockIndex( nif->getParent( nif->getBlockNumber( index ) ), "NiNode" );
@@ -1627,6 +1651,8 @@ public:
 	QString page() const override final { return Spell::tr( "Block" ); }
 	QKeySequence hotkey() const override final { return { Qt::ControlModifier | Qt::Key_Up }; }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index ) && nif->getBlockNumber( index ) > 0;
@@ -1650,6 +1676,8 @@ public:
 	QString page() const override final { return Spell::tr( "Block" ); }
 	QKeySequence hotkey() const override final { return { Qt::ControlModifier | Qt::Key_Down }; }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index ) && nif->getBlockNumber( index ) < nif->getBlockCount() - 1;
@@ -1672,6 +1700,8 @@ public:
 	QString name() const override final { return Spell::tr( "Remove By Id" ); }
 	QString page() const override final { return Spell::tr( "Block" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		Q_UNUSED( nif );
@@ -1718,6 +1748,8 @@ public:
 	QString name() const override final { return Spell::tr( "Crop To Branch" ); }
 	QString page() const override final { return Spell::tr( "Block" ); }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index );
@@ -1773,6 +1805,8 @@ public:
 	QString name() const override final { return Spell::tr( "Convert" ); }
 	QString page() const override final { return Spell::tr( "Block" ); }
 
+	int targets() const override final { return TargetBlock | TargetField | TargetHeader; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		Q_UNUSED( nif );
@@ -1837,6 +1871,8 @@ public:
 	QString page() const override final { return Spell::tr( "Block" ); }
 	QKeySequence hotkey() const override final { return{ Qt::CTRL | Qt::SHIFT | Qt::Key_D }; }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index );
@@ -2005,6 +2041,8 @@ public:
 	QString name() const override final { return Spell::tr( "Sort By Name" ); }
 	QString page() const override final { return Spell::tr( "Block" ); }
 
+	int targets() const override final { return TargetNone | TargetBlock | TargetHeader; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		Q_UNUSED( nif );
@@ -2064,6 +2102,8 @@ public:
 	QString name() const override final { return Spell::tr( "Attach Parent Node" ); }
 	QString page() const override final { return Spell::tr( "Node" ); }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index );
@@ -2123,6 +2163,8 @@ public:
 	QString page() const override final { return Spell::tr( "" ); }
 	bool constant() const override final { return true; }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index );
@@ -31,6 +31,8 @@ public:
 	bool constant() const override final { return true; }
 	QKeySequence hotkey() const override final { return QKeySequence( QKeySequence::Copy ); }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final;
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final;
 };
@@ -46,6 +48,8 @@ public:
 
 	QString acceptFormat( const QString & format, const NifModel * nif );
 
+	bool cacheable() const override final { return false; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final;
 
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final;
@@ -58,6 +62,8 @@ public:
 	QString page() const override final { return Spell::tr( "Block" ); }
 	QKeySequence hotkey() const override final { return{ QKeySequence( int( Qt::CTRL ) + int( Qt::Key_D ) ) }; }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final;
 
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final;
@@ -71,6 +77,8 @@ public:
 	QString page() const override final { return Spell::tr( "Block" ); }
 	QKeySequence hotkey() const override final { return{ QKeySequence( int( Qt::CTRL ) + int( Qt::Key_Delete ) ) }; }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final;
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final;
 };
@@ -219,6 +219,8 @@ public:
 	bool constant() const override final { return true; }
 	bool instant() const override final { return true; }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return ( nif && !index.isValid() );
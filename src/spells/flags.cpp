@@ -969,6 +969,10 @@ public:
 	bool instant() const override final { return true; }
 	QIcon icon() const override final { return QIcon( ":/img/flag" ); }
 
+	int targets() const override final { return TargetField; }
+	QStringList blockTypes() const override final { return { "BSTriShape" }; }
+	QStringList fieldNames() const override final { return { "Vertex Desc" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->blockInherits( index.parent(), "BSTriShape" ) && nif->itemName( index ) == "Vertex Desc";
@@ -35,6 +35,11 @@ public:
 	QString name() const override final { return Spell::tr( "Create Convex Shape" ); }
 	QString page() const override final { return Spell::tr( "Havok" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTriBasedGeom", "BSTriShape" }; }
+	//! Depends on the linked data block
+	bool cacheable() const override final { return false; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		if ( !(nif->blockInherits( index, "NiTriBasedGeom" ) || nif->blockInherits( index, "BSTriShape" ))
@@ -385,6 +390,9 @@ public:
 	QString name() const override final { return Spell::tr( "Calculate Spring Length" ); }
 	QString page() const override final { return Spell::tr( "Havok" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "bhkStiffSpringConstraint" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & idx ) override final
 	{
 		return nif && nif->isNiBlock( nif->getBlockIndex( idx ), "bhkStiffSpringConstraint" );
@@ -428,6 +436,9 @@ public:
 	QString name() const override final { return Spell::tr( "Pack Strips" ); }
 	QString page() const override final { return Spell::tr( "Havok" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "bhkNiTriStripsShape" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & idx ) override final
 	{
 		return nif->isNiBlock( idx, "bhkNiTriStripsShape" );
@@ -536,6 +547,9 @@ public:
 	QString name() const override final { return Spell::tr( "Convert to bhkConvexListShape" ); }
 	QString page() const override final { return Spell::tr( "Havok" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "bhkListShape" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & idx ) override final
 	{
 		return nif->isNiBlock( idx, "bhkListShape" );
@@ -573,6 +587,9 @@ public:
 	QString name() const override final { return Spell::tr( "Convert to bhkListShape" ); }
 	QString page() const override final { return Spell::tr( "Havok" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "bhkConvexListShape" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & idx ) override final
 	{
 		return nif->isNiBlock( idx, "bhkConvexListShape" );
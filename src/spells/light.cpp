@@ -66,6 +66,9 @@ public:
 		return *light42_xpm_icon;
 	}
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiLight" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex iBlock  = nif->getBlockIndex( index );
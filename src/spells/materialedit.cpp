@@ -106,6 +106,9 @@ public:
 		return *mat42_xpm_icon;
 	}
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiMaterialProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex iBlock  = nif->getBlockIndex( index, "NiMaterialProperty" );
@@ -712,6 +712,9 @@ public:
 	QString name() const override final { return Spell::tr( "Update Bounds" ); }
 	QString page() const override final { return Spell::tr( "Mesh" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "BSGeometry", "BSTriShape" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		if ( nif->getBSVersion() >= 172 && nif->blockInherits( index, "BSGeometry" ) )
@@ -808,6 +811,8 @@ public:
 	QString name() const override final { return Spell::tr( "Update All Bounds" ); }
 	QString page() const override final { return Spell::tr( "Batch" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & idx ) override final
 	{
 		if ( !nif || idx.isValid() )
@@ -13,6 +13,9 @@ public:
 	QString name() const override final { return Spell::tr( "Update Bounding Sphere" ); }
 	QString page() const override final { return Spell::tr( "Mesh" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiGeometryData" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final;
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final;
 };
@@ -24,6 +27,11 @@ public:
 	QString name() const override final { return Spell::tr( "Update Triangles From Skin" ); }
 	QString page() const override final { return Spell::tr( "Mesh" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiTriShape" }; }
+	//! Depends on the linked skin and data blocks
+	bool cacheable() const override final { return false; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final;
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final;
 };
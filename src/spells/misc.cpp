@@ -66,6 +66,8 @@ public:
 	QString name() const override final { return Spell::tr( "Update" ); }
 	QString page() const override final { return Spell::tr( "Header" ); }
 
+	int targets() const override final { return TargetHeader; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		auto block = nif->getTopItem( index );
@@ -88,6 +90,8 @@ public:
 	QString name() const override final { return Spell::tr( "Update" ); }
 	QString page() const override final { return Spell::tr( "Footer" ); }
 
+	int targets() const override final { return TargetHeader; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		auto block = nif->getTopItem( index );
@@ -112,6 +116,9 @@ public:
 	bool instant() const override final { return true; }
 	QIcon icon() const override final { return QIcon( ":/img/link" ); }
 
+	int targets() const override final { return TargetField; }
+	QVector<NifValue::Type> valueTypes() const override final { return { NifValue::tLink, NifValue::tUpLink }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isLink( index ) && nif->getLink( index ) >= 0;
@@ -137,6 +144,8 @@ public:
 	QString name() const override final { return Spell::tr( "File Offset" ); }
 	bool constant() const override final { return true; }
 
+	int targets() const override final { return TargetBlock | TargetField | TargetHeader; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && index.isValid();
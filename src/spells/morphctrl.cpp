@@ -19,6 +19,9 @@ public:
 	QString name() const override final { return Spell::tr( "Save Vertices To Frame" ); }
 	QString page() const override final { return Spell::tr( "Morph" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiGeomMorpherController" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index, "NiGeomMorpherController" ) && nif->checkVersion( 0x0a010000, 0 )
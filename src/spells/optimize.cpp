@@ -34,6 +34,8 @@ public:
 	QString name() const override final { return Spell::tr( "Combine Properties" ); }
 	QString page() const override final { return Spell::tr( "Optimize" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && !index.isValid();
@@ -116,6 +118,75 @@ public:
 
 REGISTER_SPELL( spCombiProps )
 
+//! Merges blocks with identical content
+/*!
+ * Blocks of the same type with equal NifModel::contentDigest() are merged into the first one,
+ * so each round is linear in the size of the file. Blocks that only differed by links to merged
+ * blocks become identical in the next round, which repeats until nothing is merged.
+ *
+ * \sa spCombiProps
+ */
+class spDeduplicateBlocks final : public Spell
+{
+public:
+	QString name() const override final { return Spell::tr( "Deduplicate Blocks" ); }
+	QString page() const override final { return Spell::tr( "Optimize" ); }
+
+	int targets() const override final { return TargetNone; }
+
+	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
+	{
+		return nif && !index.isValid();
+	}
+
+	//! Blocks that can be shared by several parents
+	static bool canShare( const NifModel * nif, const NifItem * block )
+	{
+		// these need to be unique, see spCombiProps
+		if ( nif->blockInherits( block, "BSShaderProperty" ) )
+			return false;
+
+		return nif->blockInherits( block, { "NiTriBasedGeomData", "NiProperty", "NiSourceTexture", "BSShaderTextureSet",
+			"NiInterpolator", "NiKeyframeData", "NiFloatData", "NiPosData", "NiBoolData", "NiColorData", "NiExtraData" } );
+	}
+
+	QModelIndex cast( NifModel * nif, const QModelIndex & ) override final
+	{
+		int numRemoved = 0;
+		QHash<QByteArray, qint32> survivors;
+		QMap<qint32, qint32> map;
+
+		do {
+			survivors.clear();
+			map.clear();
+
+			for ( qint32 b = 0; b < nif->getBlockCount(); b++ ) {
+				const NifItem * block = nif->getBlockItem( b );
+				if ( !block || !canShare( nif, block ) )
+					continue;
+
+				QByteArray key = block->name().toLatin1() + '\0' + nif->contentDigest( block );
+				auto it = survivors.constFind( key );
+				if ( it == survivors.constEnd() )
+					survivors.insert( key, b );
+				else
+					map.insert( b, it.value() );
+			}
+
+			if ( !map.isEmpty() ) {
+				numRemoved += map.count();
+				nif->mapLinks( map );
+				nif->removeNiBlocks( map.keys() );
+			}
+		} while ( !map.isEmpty() );
+
+		Message::info( nullptr, Spell::tr( "Removed %1 duplicate blocks" ).arg( numRemoved ) );
+		return QModelIndex();
+	}
+};
+
+REGISTER_SPELL( spDeduplicateBlocks )
+
 //! Creates unique properties from shared ones
 /*!
  * \sa spDuplicateBlock
@@ -127,6 +198,8 @@ public:
 	QString name() const override final { return Spell::tr( "Split Properties" ); }
 	QString page() const override final { return Spell::tr( "Optimize" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && !index.isValid();
@@ -199,6 +272,8 @@ public:
 	QString name() const override final { return Spell::tr( "Remove Bogus Nodes" ); }
 	QString page() const override final { return Spell::tr( "Optimize" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && !index.isValid();
@@ -265,6 +340,9 @@ public:
 	QString name() const override final { return Spell::tr( "Combine Shapes" ); }
 	QString page() const override final { return Spell::tr( "Optimize" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiNode" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && nif->isNiBlock( index, "NiNode" );
@@ -532,6 +610,8 @@ public:
 	QString name() const override final { return Spell::tr( "Remove Unused Strings" ); }
 	QString page() const override final { return Spell::tr( "Optimize" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && !index.isValid();
@@ -0,0 +1,321 @@
+#include "optimizecache.h"
+#include "gamemanager.h"
+
+#include "lib/vertexcache.h"
+
+#include <cstring>
+#include <functional>
+
+// Brief description is deliberately not autolinked to class Spell
+/*! \file optimizecache.cpp
+ * \brief Vertex cache optimization spell (spOptimizeVertexCache)
+ *
+ * All classes here inherit from the Spell class.
+ */
+
+//! Moves old row i of an array to row remap[i], copying the values of all items in the rows
+static void permuteRows( NifModel * nif, const QModelIndex & iArray, const QVector<int> & remap )
+{
+	int numRows = nif->rowCount( iArray );
+	if ( numRows != remap.count() )
+		return;
+
+	std::function<void( const QModelIndex &, QVector<NifValue> & )> readValues;
+	readValues = [&]( const QModelIndex & idx, QVector<NifValue> & values ) {
+		int n = nif->rowCount( idx );
+		if ( !n )
+			values.append( nif->getValue( idx ) );
+		for ( int r = 0; r < n; r++ )
+			readValues( QModelIndex_child( idx, r ), values );
+	};
+
+	std::function<void( const QModelIndex &, const QVector<NifValue> &, int & )> writeValues;
+	writeValues = [&]( const QModelIndex & idx, const QVector<NifValue> & values, int & pos ) {
+		int n = nif->rowCount( idx );
+		if ( !n && pos < values.count() )
+			nif->setIndexValue( idx, values[pos++] );
+		for ( int r = 0; r < n; r++ )
+			writeValues( QModelIndex_child( idx, r ), values, pos );
+	};
+
+	QVector<QVector<NifValue>> rows( numRows );
+	for ( int r = 0; r < numRows; r++ )
+		readValues( QModelIndex_child( iArray, r ), rows[r] );
+
+	for ( int r = 0; r < numRows; r++ ) {
+		int pos = 0;
+		writeValues( QModelIndex_child( iArray, remap[r] ), rows[r], pos );
+	}
+}
+
+//! Moves old element i of an array to remap[i]
+template <typename T> static void permuteArray( NifModel * nif, const QModelIndex & iArray, const QVector<int> & remap )
+{
+	QVector<T> src = nif->getArray<T>( iArray );
+	if ( src.isEmpty() || src.count() != remap.count() )
+		return;
+
+	QVector<T> dst( src.count() );
+	for ( int i = 0; i < src.count(); i++ )
+		dst[remap[i]] = src[i];
+
+	nif->setArray<T>( iArray, dst );
+}
+
+static void remapTriangles( QVector<Triangle> & tris, const QVector<int> & remap )
+{
+	for ( Triangle & t : tris ) {
+		for ( int k = 0; k < 3; k++ )
+			t[k] = quint16( remap.value( t[k], t[k] ) );
+	}
+}
+
+QModelIndex spOptimizeVertexCache::getSSEPartition( const NifModel * nif, const QModelIndex & iShape )
+{
+	if ( nif->getBSVersion() != 100 || !( nif->get<BSVertexDesc>( iShape, "Vertex Desc" ) & VertexFlags::VF_SKINNED ) )
+		return QModelIndex();
+
+	auto iSkinInst = nif->getBlockIndex( nif->getLink( iShape, "Skin" ), "NiSkinInstance" );
+	return nif->getBlockIndex( nif->getLink( iSkinInst, "Skin Partition" ), "NiSkinPartition" );
+}
+
+int spOptimizeVertexCache::getVertexData( const NifModel * nif, const QModelIndex & iShape, QModelIndex & iData, QModelIndex & iPartBlock )
+{
+	if ( nif->isNiBlock( iShape, "NiTriShape" ) ) {
+		iData = nif->getBlockIndex( nif->getLink( iShape, "Data" ), "NiTriShapeData" );
+
+		auto iSkinInst = nif->getBlockIndex( nif->getLink( iShape, "Skin Instance" ), "NiSkinInstance" );
+		auto iSkinData = nif->getBlockIndex( nif->getLink( iSkinInst, "Data" ), "NiSkinData" );
+		iPartBlock = nif->getBlockIndex( nif->getLink( iSkinInst, "Skin Partition" ), "NiSkinPartition" );
+		if ( !iPartBlock.isValid() )
+			iPartBlock = nif->getBlockIndex( nif->getLink( iSkinData, "Skin Partition" ), "NiSkinPartition" );
+
+		return nif->get<int>( iData, "Num Vertices" );
+	}
+
+	iData = QModelIndex();
+	iPartBlock = getSSEPartition( nif, iShape );
+	if ( iPartBlock.isValid() )
+		return nif->get<uint>( iPartBlock, "Data Size" ) / std::max( nif->get<uint>( iPartBlock, "Vertex Size" ), 1u );
+
+	return nif->get<int>( iShape, "Num Vertices" );
+}
+
+bool spOptimizeVertexCache::isApplicable( const NifModel * nif, const QModelIndex & index )
+{
+	// Subclasses with triangle ranges (segments, LODs) or separate vertex arrays are not supported
+	if ( !nif->isNiBlock( index, { "NiTriShape", "BSTriShape" } ) )
+		return false;
+
+	QModelIndex iData, iPartBlock;
+	int numVerts = getVertexData( nif, index, iData, iPartBlock );
+
+	// A partition without a vertex map uses the shape vertices directly, so its vertex weights must cover all of them
+	QModelIndex iParts = nif->getIndex( iPartBlock, "Partitions" );
+	for ( int p = 0; iParts.isValid() && p < nif->rowCount( iParts ); p++ ) {
+		QModelIndex iPart = QModelIndex_child( iParts, p );
+		if ( nif->rowCount( nif->getIndex( iPart, "Vertex Map" ) ) > 0 )
+			continue;
+		if ( nif->get<int>( iPart, "Num Vertices" ) != numVerts || nif->get<int>( iPart, "Num Strips" ) > 0 )
+			return false;
+	}
+
+	if ( iPartBlock.isValid() && !iData.isValid() )
+		return true;
+
+	QModelIndex iTris = nif->getIndex( iData.isValid() ? iData : index, "Triangles" );
+	return iTris.isValid() && nif->rowCount( iTris ) > 0;
+}
+
+QModelIndex spOptimizeVertexCache::cast( NifModel * nif, const QModelIndex & index )
+{
+	Stats stats = optimize( nif, index );
+
+	Message::info( nullptr, Spell::tr( "ACMR %1 to %2, ATVR %3 to %4" )
+		.arg( stats.acmrBefore, 0, 'f', 3 ).arg( stats.acmrAfter, 0, 'f', 3 )
+		.arg( stats.atvrBefore, 0, 'f', 3 ).arg( stats.atvrAfter, 0, 'f', 3 ) );
+
+	return index;
+}
+
+spOptimizeVertexCache::Stats spOptimizeVertexCache::optimize( NifModel * nif, const QModelIndex & index )
+{
+	QModelIndex iDataTmp, iPartBlockTmp;
+	int numVerts = getVertexData( nif, index, iDataTmp, iPartBlockTmp );
+
+	QPersistentModelIndex iShape = index;
+	QPersistentModelIndex iData = iDataTmp;
+	QPersistentModelIndex iPartBlock = iPartBlockTmp;
+
+	// Shape triangles, and the partitions that are drawn instead of them when present
+	QModelIndex iTriParent = ( iData.isValid() ? iData : iShape );
+	QVector<Triangle> tris = nif->getArray<Triangle>( iTriParent, "Triangles" );
+	QModelIndex iParts = nif->getIndex( iPartBlock, "Partitions" );
+	// rowCount() of an invalid index is the number of blocks
+	int numParts = iParts.isValid() ? nif->rowCount( iParts ) : 0;
+
+	auto drawnTriangles = [&]() {
+		if ( !numParts )
+			return nif->getArray<Triangle>( iTriParent, "Triangles" );
+
+		QVector<Triangle> drawn;
+		for ( int p = 0; p < numParts; p++ ) {
+			QModelIndex iPart = QModelIndex_child( iParts, p );
+			QVector<Triangle> partTris = nif->getArray<Triangle>( iPart, "Triangles" );
+			QVector<int> vertexMap = nif->getArray<int>( iPart, "Vertex Map" );
+			if ( !vertexMap.isEmpty() )
+				remapTriangles( partTris, vertexMap );
+			drawn << partTris;
+		}
+		return drawn;
+	};
+
+	Stats stats;
+	QVector<Triangle> before = drawnTriangles();
+	stats.acmrBefore = averageCacheMissRatio( before );
+	stats.atvrBefore = averageTransformToVertexRatio( before );
+
+	nif->setState( BaseModel::Processing );
+
+	// Reorder the triangles and the vertices of each partition
+	for ( int p = 0; p < numParts; p++ ) {
+		QModelIndex iPart = QModelIndex_child( iParts, p );
+		if ( nif->get<int>( iPart, "Num Strips" ) > 0 )
+			continue;
+
+		int numPartVerts = nif->get<int>( iPart, "Num Vertices" );
+		QVector<Triangle> partTris = optimizeVertexCache( nif->getArray<Triangle>( iPart, "Triangles" ), numPartVerts );
+
+		// Without a vertex map the partition uses the shape vertices, they are renumbered below
+		if ( nif->rowCount( nif->getIndex( iPart, "Vertex Map" ) ) == 0 ) {
+			nif->setArray<Triangle>( iPart, "Triangles", partTris );
+			continue;
+		}
+
+		QVector<int> partRemap = optimizeVertexFetch( partTris, numPartVerts );
+		remapTriangles( partTris, partRemap );
+
+		permuteRows( nif, nif->getIndex( iPart, "Vertex Map" ), partRemap );
+		permuteRows( nif, nif->getIndex( iPart, "Vertex Weights" ), partRemap );
+		permuteRows( nif, nif->getIndex( iPart, "Bone Indices" ), partRemap );
+		nif->setArray<Triangle>( iPart, "Triangles", partTris );
+	}
+
+	if ( !tris.isEmpty() )
+		tris = optimizeVertexCache( tris, numVerts );
+
+	// Renumber the vertices in the order they are drawn
+	QVector<Triangle> drawn = ( numParts ? drawnTriangles() : tris );
+	QVector<int> remap = optimizeVertexFetch( drawn, numVerts );
+
+	remapTriangles( tris, remap );
+
+	for ( int p = 0; p < numParts; p++ ) {
+		QModelIndex iPart = QModelIndex_child( iParts, p );
+		QModelIndex iVertexMap = nif->getIndex( iPart, "Vertex Map" );
+		QVector<int> vertexMap = nif->getArray<int>( iVertexMap );
+		if ( vertexMap.isEmpty() ) {
+			// The partition vertices are the shape vertices
+			QVector<Triangle> partTris = nif->getArray<Triangle>( iPart, "Triangles" );
+			remapTriangles( partTris, remap );
+			nif->setArray<Triangle>( iPart, "Triangles", partTris );
+
+			permuteRows( nif, nif->getIndex( iPart, "Vertex Weights" ), remap );
+			permuteRows( nif, nif->getIndex( iPart, "Bone Indices" ), remap );
+		} else {
+			for ( int & v : vertexMap )
+				v = remap.value( v, v );
+			nif->setArray<int>( iVertexMap, vertexMap );
+		}
+
+		QModelIndex iTrisCopy = nif->getIndex( iPart, "Triangles Copy" );
+		if ( iTrisCopy.isValid() ) {
+			QVector<Triangle> trisCopy = nif->getArray<Triangle>( iPart, "Triangles" );
+			remapTriangles( trisCopy, vertexMap );
+			nif->setArray<Triangle>( iTrisCopy, trisCopy );
+		}
+	}
+
+	if ( iData.isValid() )
+		remapNiTriShape( nif, iShape, iData, remap );
+	else
+		permuteRows( nif, nif->getIndex( iPartBlock.isValid() ? iPartBlock : iShape, "Vertex Data" ), remap );
+
+	nif->resetState();
+
+	// Set the triangles outside of processing so the shape is updated
+	if ( !tris.isEmpty() )
+		nif->setArray<Triangle>( iTriParent, "Triangles", tris );
+
+	QVector<Triangle> after = drawnTriangles();
+	stats.acmrAfter = averageCacheMissRatio( after );
+	stats.atvrAfter = averageTransformToVertexRatio( after );
+
+	return stats;
+}
+
+void spOptimizeVertexCache::remapNiTriShape( NifModel * nif, const QModelIndex & iShape, const QModelIndex & iData, const QVector<int> & remap )
+{
+	permuteArray<Vector3>( nif, nif->getIndex( iData, "Vertices" ), remap );
+	permuteArray<Vector3>( nif, nif->getIndex( iData, "Normals" ), remap );
+	permuteArray<Vector3>( nif, nif->getIndex( iData, "Tangents" ), remap );
+	permuteArray<Vector3>( nif, nif->getIndex( iData, "Bitangents" ), remap );
+	permuteArray<Color4>( nif, nif->getIndex( iData, "Vertex Colors" ), remap );
+
+	QModelIndex iUVSets = nif->getIndex( iData, "UV Sets" );
+	for ( int r = 0; iUVSets.isValid() && r < nif->rowCount( iUVSets ); r++ )
+		permuteArray<Vector2>( nif, QModelIndex_child( iUVSets, r ), remap );
+
+	QModelIndex iMatchGroups = nif->getIndex( iData, "Match Groups" );
+	for ( int r = 0; iMatchGroups.isValid() && r < nif->rowCount( iMatchGroups ); r++ ) {
+		QModelIndex iIndices = nif->getIndex( QModelIndex_child( iMatchGroups, r ), "Vertex Indices" );
+		QVector<int> indices = nif->getArray<int>( iIndices );
+		for ( int & v : indices )
+			v = remap.value( v, v );
+		nif->setArray<int>( iIndices, indices );
+	}
+
+	// Oblivion tangent space, tangents followed by bitangents
+	for ( const auto link : nif->getChildLinks( nif->getBlockNumber( iShape ) ) ) {
+		QModelIndex iTSpace = nif->getBlockIndex( link, "NiBinaryExtraData" );
+		if ( !iTSpace.isValid() || nif->get<QString>( iTSpace, "Name" ) != "Tangent space (binormal & tangent vectors)" )
+			continue;
+
+		QByteArray src = nif->get<QByteArray>( iTSpace, "Binary Data" );
+		if ( src.size() != remap.count() * int( sizeof( Vector3 ) ) * 2 )
+			continue;
+
+		QByteArray dst( src.size(), 0 );
+		for ( int half = 0; half < 2; half++ ) {
+			int offset = half * remap.count() * int( sizeof( Vector3 ) );
+			for ( int v = 0; v < remap.count(); v++ )
+				memcpy( dst.data() + offset + remap[v] * sizeof( Vector3 ), src.constData() + offset + v * sizeof( Vector3 ), sizeof( Vector3 ) );
+		}
+		nif->set<QByteArray>( iTSpace, "Binary Data", dst );
+	}
+
+	QModelIndex iSkinInst = nif->getBlockIndex( nif->getLink( iShape, "Skin Instance" ), "NiSkinInstance" );
+	QModelIndex iSkinData = nif->getBlockIndex( nif->getLink( iSkinInst, "Data" ), "NiSkinData" );
+	QModelIndex iBones = nif->getIndex( iSkinData, "Bone List" );
+	for ( int b = 0; iBones.isValid() && b < nif->rowCount( iBones ); b++ ) {
+		QModelIndex iWeights = nif->getIndex( QModelIndex_child( iBones, b ), "Vertex Weights" );
+		for ( int w = 0; w < nif->rowCount( iWeights ); w++ ) {
+			QModelIndex iWeight = QModelIndex_child( iWeights, w );
+			int v = nif->get<int>( iWeight, "Index" );
+			nif->set<int>( iWeight, "Index", remap.value( v, v ) );
+		}
+	}
+
+	// Morph targets of geometry morpher controllers
+	for ( QModelIndex iCtrl = nif->getBlockIndex( nif->getLink( iShape, "Controller" ) ); iCtrl.isValid();
+		  iCtrl = nif->getBlockIndex( nif->getLink( iCtrl, "Next Controller" ) ) ) {
+		if ( !nif->isNiBlock( iCtrl, "NiGeomMorpherController" ) )
+			continue;
+
+		QModelIndex iMorphs = nif->getIndex( nif->getBlockIndex( nif->getLink( iCtrl, "Data" ), "NiMorphData" ), "Morphs" );
+		for ( int m = 0; iMorphs.isValid() && m < nif->rowCount( iMorphs ); m++ )
+			permuteArray<Vector3>( nif, nif->getIndex( QModelIndex_child( iMorphs, m ), "Vectors" ), remap );
+	}
+}
+
+REGISTER_SPELL( spOptimizeVertexCache )
@@ -0,0 +1,48 @@
+#ifndef SP_OPTIMIZECACHE_H
+#define SP_OPTIMIZECACHE_H
+
+#include "spellbook.h"
+
+
+//! \file optimizecache.h spOptimizeVertexCache
+
+//! Reorders triangles for the vertex cache and vertices for fetch locality
+/*!
+ * Triangle lists are reordered with Forsyth's algorithm, and vertices are renumbered in order of first use.
+ * All vertex attributes, skin weights, skin partitions and morphs are remapped to match.
+ * Skin partitions are optimized separately, each one is drawn on its own.
+ */
+class spOptimizeVertexCache final : public Spell
+{
+public:
+	QString name() const override final { return Spell::tr( "Optimize Vertex Cache" ); }
+	QString page() const override final { return Spell::tr( "Mesh" ); }
+
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiTriShape", "BSTriShape" }; }
+
+	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final;
+	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final;
+
+	//! Average cache miss and transform to vertex ratios before and after optimizing
+	struct Stats
+	{
+		double acmrBefore = 0.0, acmrAfter = 0.0;
+		double atvrBefore = 0.0, atvrAfter = 0.0;
+	};
+
+	//! Optimizes a shape without reporting the result; unused vertices are moved to the end
+	static Stats optimize( NifModel * nif, const QModelIndex & iShape );
+
+	//! The partition block holding the vertex data of a skinned Skyrim SE shape
+	static QModelIndex getSSEPartition( const NifModel * nif, const QModelIndex & iShape );
+
+protected:
+	//! Finds the vertex data of a shape and returns its number of vertices
+	static int getVertexData( const NifModel * nif, const QModelIndex & iShape, QModelIndex & iData, QModelIndex & iPartBlock );
+
+	//! Remaps the vertex arrays of NiTriShapeData and the skin weights and morphs referring to them
+	static void remapNiTriShape( NifModel * nif, const QModelIndex & iShape, const QModelIndex & iData, const QVector<int> & remap );
+};
+
+#endif
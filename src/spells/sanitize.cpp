@@ -102,6 +102,8 @@ public:
 	QString page() const override final { return Spell::tr( "Sanitize" ); }
 	bool sanity() const override final { return true; }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		Q_UNUSED( nif );
@@ -150,6 +152,8 @@ public:
 	QString page() const override final { return Spell::tr( "Sanitize" ); }
 	bool sanity() const override final { return true; }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && !index.isValid();
@@ -286,6 +290,8 @@ public:
 	QString page() const override final { return Spell::tr( "Sanitize" ); }
 	bool sanity() const override final { return true; }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		Q_UNUSED( nif );
@@ -360,6 +366,8 @@ public:
 	QString page() const override final { return Spell::tr( "Sanitize" ); }
 	bool sanity() const override final { return true; }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && nif->getIndex( nif->getHeaderIndex(), "Num Strings" ).isValid() && !index.isValid();
@@ -528,6 +536,8 @@ public:
 	QString name() const override final { return Spell::tr( "Fill Blank NiControllerSequence Types" ); }
 	QString page() const override final { return Spell::tr( "Sanitize" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && nif->getIndex( nif->getHeaderIndex(), "Num Strings" ).isValid() && !index.isValid();
@@ -0,0 +1,446 @@
+#include "optimizecache.h"
+#include "gamemanager.h"
+
+#include "lib/meshsimplify.h"
+
+#include <QDialog>
+#include <QDoubleSpinBox>
+#include <QGridLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QSemaphore>
+#include <QSet>
+#include <QThreadPool>
+
+// Brief description is deliberately not autolinked to class Spell
+/*! \file simplify.cpp
+ * \brief Mesh simplification spells
+ *
+ * All classes here inherit from the Spell class.
+ */
+
+//! Input and result of the simplification of one shape
+struct SimplifyJob
+{
+	QPersistentModelIndex shape;
+	QVector<Vector3> positions;
+	QVector<Triangle> triangles;
+	SimplifyOptions options;
+
+	QVector<Triangle> result;
+	float error = 0.0f;
+};
+
+//! Whether a shape is a plain triangle list with its vertices in the shape or its data block
+static bool canSimplify( const NifModel * nif, const QModelIndex & iShape )
+{
+	// Subclasses with triangle ranges (segments, LODs) are not supported
+	if ( nif->isNiBlock( iShape, "NiTriShape" ) ) {
+		auto iTris = nif->getIndex( nif->getBlockIndex( nif->getLink( iShape, "Data" ), "NiTriShapeData" ), "Triangles" );
+		return iTris.isValid() && nif->rowCount( iTris ) > 0;
+	}
+
+	if ( nif->isNiBlock( iShape, "BSTriShape" ) && !spOptimizeVertexCache::getSSEPartition( nif, iShape ).isValid() ) {
+		auto iTris = nif->getIndex( iShape, "Triangles" );
+		return iTris.isValid() && nif->rowCount( iTris ) > 0;
+	}
+
+	return false;
+}
+
+//! Reads the positions, triangles and attributes of a shape; normals, the first UV set and skin weights are preserved
+static void readShape( const NifModel * nif, SimplifyJob & job )
+{
+	QVector<Vector3> normals;
+	QVector<Vector2> uvs;
+	QVector<QVector<QPair<int, float>>> weights;	// per vertex, bone and weight
+	int numBones = 0;
+
+	if ( nif->isNiBlock( job.shape, "NiTriShape" ) ) {
+		QModelIndex iData = nif->getBlockIndex( nif->getLink( job.shape, "Data" ), "NiTriShapeData" );
+		job.positions = nif->getArray<Vector3>( iData, "Vertices" );
+		job.triangles = nif->getArray<Triangle>( iData, "Triangles" );
+		normals = nif->getArray<Vector3>( iData, "Normals" );
+		uvs = nif->getArray<Vector2>( QModelIndex_child( nif->getIndex( iData, "UV Sets" ), 0 ) );
+
+		QModelIndex iSkinInst = nif->getBlockIndex( nif->getLink( job.shape, "Skin Instance" ), "NiSkinInstance" );
+		QModelIndex iSkinData = nif->getBlockIndex( nif->getLink( iSkinInst, "Data" ), "NiSkinData" );
+		QModelIndex iBones = nif->getIndex( iSkinData, "Bone List" );
+		// rowCount() of an invalid index is the number of blocks
+		numBones = iBones.isValid() ? nif->rowCount( iBones ) : 0;
+		if ( numBones )
+			weights.resize( job.positions.count() );
+
+		for ( int b = 0; b < numBones; b++ ) {
+			QModelIndex iWeights = nif->getIndex( QModelIndex_child( iBones, b ), "Vertex Weights" );
+			for ( int w = 0; w < nif->rowCount( iWeights ); w++ ) {
+				QModelIndex iWeight = QModelIndex_child( iWeights, w );
+				int v = nif->get<int>( iWeight, "Index" );
+				if ( v >= 0 && v < weights.count() )
+					weights[v].append( { b, nif->get<float>( iWeight, "Weight" ) } );
+			}
+		}
+	} else {
+		QModelIndex iVertData = nif->getIndex( job.shape, "Vertex Data" );
+		auto vf = nif->get<BSVertexDesc>( job.shape, "Vertex Desc" );
+		bool hasNormals = vf.HasFlag( VertexFlags::VF_NORMAL );
+		bool hasUVs = vf.HasFlag( VertexFlags::VF_UV );
+		bool isSkinned = vf.HasFlag( VertexFlags::VF_SKINNED );
+
+		int numVerts = nif->rowCount( iVertData );
+		if ( isSkinned )
+			weights.resize( numVerts );
+
+		for ( int v = 0; v < numVerts; v++ ) {
+			QModelIndex idx = QModelIndex_child( iVertData, v );
+			job.positions << nif->get<Vector3>( idx, "Vertex" );
+			if ( hasNormals )
+				normals += nif->get<ByteVector3>( idx, "Normal" );
+			if ( hasUVs )
+				uvs << nif->get<HalfVector2>( idx, "UV" );
+
+			if ( isSkinned ) {
+				auto wts = nif->getArray<float>( idx, "Bone Weights" );
+				auto bns = nif->getArray<quint8>( idx, "Bone Indices" );
+				for ( int i = 0; i < std::min( wts.count(), bns.count() ); i++ ) {
+					if ( wts[i] > 0.0f ) {
+						weights[v].append( { int( bns[i] ), wts[i] } );
+						numBones = std::max( numBones, int( bns[i] ) + 1 );
+					}
+				}
+			}
+		}
+
+		job.triangles = nif->getArray<Triangle>( job.shape, "Triangles" );
+	}
+
+	int numVerts = job.positions.count();
+	if ( normals.count() != numVerts )
+		normals.clear();
+	if ( uvs.count() != numVerts )
+		uvs.clear();
+	if ( weights.count() != numVerts )
+		numBones = 0;
+
+	// Normals are allowed to change more than UVs, skin weights are kept like UVs
+	SimplifyOptions & o = job.options;
+	o.attributeStride = ( normals.isEmpty() ? 0 : 3 ) + ( uvs.isEmpty() ? 0 : 2 ) + numBones;
+	o.attributes.fill( 0.0f, numVerts * o.attributeStride );
+	o.attributeWeights.clear();
+	if ( !normals.isEmpty() )
+		o.attributeWeights << 0.5f << 0.5f << 0.5f;
+	if ( !uvs.isEmpty() )
+		o.attributeWeights << 1.0f << 1.0f;
+	for ( int b = 0; b < numBones; b++ )
+		o.attributeWeights << 1.0f;
+
+	for ( int v = 0; v < numVerts; v++ ) {
+		float * a = o.attributes.data() + v * o.attributeStride;
+		if ( !normals.isEmpty() ) {
+			*a++ = normals[v][0];
+			*a++ = normals[v][1];
+			*a++ = normals[v][2];
+		}
+		if ( !uvs.isEmpty() ) {
+			*a++ = uvs[v][0];
+			*a++ = uvs[v][1];
+		}
+		if ( numBones ) {
+			for ( const auto & w : weights[v] )
+				a[w.first] += w.second;
+		}
+	}
+}
+
+//! Writes the simplified triangles and removes the vertices no longer used
+static void writeShape( NifModel * nif, const SimplifyJob & job, bool & partitionRemoved )
+{
+	int numTris = job.result.count();
+	QVector<bool> used( job.positions.count(), false );
+	for ( const Triangle & t : job.result ) {
+		for ( int k = 0; k < 3; k++ )
+			used[t[k]] = true;
+	}
+	int numVerts = int( used.count( true ) );
+
+	if ( nif->isNiBlock( job.shape, "NiTriShape" ) ) {
+		QPersistentModelIndex iData = nif->getBlockIndex( nif->getLink( job.shape, "Data" ), "NiTriShapeData" );
+		QPersistentModelIndex iSkinInst = nif->getBlockIndex( nif->getLink( job.shape, "Skin Instance" ), "NiSkinInstance" );
+		QPersistentModelIndex iSkinData = nif->getBlockIndex( nif->getLink( iSkinInst, "Data" ), "NiSkinData" );
+
+		// The partitions refer to removed triangles and vertices
+		QModelIndex iSkinPart = nif->getBlockIndex( nif->getLink( iSkinInst, "Skin Partition" ), "NiSkinPartition" );
+		if ( !iSkinPart.isValid() )
+			iSkinPart = nif->getBlockIndex( nif->getLink( iSkinData, "Skin Partition" ), "NiSkinPartition" );
+		if ( iSkinPart.isValid() ) {
+			nif->removeNiBlock( nif->getBlockNumber( iSkinPart ) );
+			partitionRemoved = true;
+		}
+
+		nif->set<int>( iData, "Num Triangles", numTris );
+		nif->set<int>( iData, "Num Triangle Points", numTris * 3 );
+		nif->updateArraySize( iData, "Triangles" );
+		nif->setArray<Triangle>( iData, "Triangles", job.result );
+
+		// Move the unused vertices to the end, and cut them off
+		spOptimizeVertexCache::optimize( nif, job.shape );
+
+		int oldVerts = nif->get<int>( iData, "Num Vertices" );
+		nif->set<int>( iData, "Num Vertices", numVerts );
+		for ( const auto & name : { "Vertices", "Normals", "Tangents", "Bitangents", "Vertex Colors" } )
+			nif->updateArraySize( iData, name );
+
+		QModelIndex iUVSets = nif->getIndex( iData, "UV Sets" );
+		for ( int r = 0; iUVSets.isValid() && r < nif->rowCount( iUVSets ); r++ )
+			nif->updateArraySize( QModelIndex_child( iUVSets, r ) );
+
+		QModelIndex iMatchGroups = nif->getIndex( iData, "Match Groups" );
+		for ( int r = 0; iMatchGroups.isValid() && r < nif->rowCount( iMatchGroups ); r++ ) {
+			QModelIndex iGroup = QModelIndex_child( iMatchGroups, r );
+			QVector<int> indices;
+			for ( int v : nif->getArray<int>( iGroup, "Vertex Indices" ) ) {
+				if ( v < numVerts )
+					indices << v;
+			}
+			nif->set<int>( iGroup, "Num Vertices", indices.count() );
+			nif->updateArraySize( iGroup, "Vertex Indices" );
+			nif->setArray<int>( iGroup, "Vertex Indices", indices );
+		}
+
+		QModelIndex iBones = nif->getIndex( iSkinData, "Bone List" );
+		for ( int b = 0; iBones.isValid() && b < nif->rowCount( iBones ); b++ ) {
+			QModelIndex iBone = QModelIndex_child( iBones, b );
+			QModelIndex iWeights = nif->getIndex( iBone, "Vertex Weights" );
+			QVector<QPair<int, float>> weights;
+			for ( int w = 0; w < nif->rowCount( iWeights ); w++ ) {
+				QModelIndex iWeight = QModelIndex_child( iWeights, w );
+				int v = nif->get<int>( iWeight, "Index" );
+				if ( v < numVerts )
+					weights.append( { v, nif->get<float>( iWeight, "Weight" ) } );
+			}
+
+			nif->set<int>( iBone, "Num Vertices", weights.count() );
+			nif->updateArraySize( iWeights );
+			for ( int w = 0; w < weights.count(); w++ ) {
+				nif->set<int>( QModelIndex_child( iWeights, w ), "Index", weights[w].first );
+				nif->set<float>( QModelIndex_child( iWeights, w ), "Weight", weights[w].second );
+			}
+		}
+
+		// Oblivion tangent space, tangents followed by bitangents
+		for ( const auto link : nif->getChildLinks( nif->getBlockNumber( job.shape ) ) ) {
+			QModelIndex iTSpace = nif->getBlockIndex( link, "NiBinaryExtraData" );
+			if ( !iTSpace.isValid() || nif->get<QString>( iTSpace, "Name" ) != "Tangent space (binormal & tangent vectors)" )
+				continue;
+
+			QByteArray data = nif->get<QByteArray>( iTSpace, "Binary Data" );
+			int size = int( sizeof( Vector3 ) );
+			if ( data.size() == oldVerts * size * 2 )
+				nif->set<QByteArray>( iTSpace, "Binary Data", data.left( numVerts * size ) + data.mid( oldVerts * size, numVerts * size ) );
+		}
+
+		for ( QModelIndex iCtrl = nif->getBlockIndex( nif->getLink( job.shape, "Controller" ) ); iCtrl.isValid();
+			  iCtrl = nif->getBlockIndex( nif->getLink( iCtrl, "Next Controller" ) ) ) {
+			if ( !nif->isNiBlock( iCtrl, "NiGeomMorpherController" ) )
+				continue;
+
+			QModelIndex iMorphData = nif->getBlockIndex( nif->getLink( iCtrl, "Data" ), "NiMorphData" );
+			nif->set<int>( iMorphData, "Num Vertices", numVerts );
+			QModelIndex iMorphs = nif->getIndex( iMorphData, "Morphs" );
+			for ( int m = 0; iMorphs.isValid() && m < nif->rowCount( iMorphs ); m++ )
+				nif->updateArraySize( QModelIndex_child( iMorphs, m ), "Vectors" );
+		}
+	} else {
+		nif->set<int>( job.shape, "Num Triangles", numTris );
+		nif->updateArraySize( job.shape, "Triangles" );
+		nif->setArray<Triangle>( job.shape, "Triangles", job.result );
+
+		spOptimizeVertexCache::optimize( nif, job.shape );
+
+		nif->set<int>( job.shape, "Num Vertices", numVerts );
+		auto iDataSize = nif->getIndex( job.shape, "Data Size" );
+		if ( iDataSize.isValid() )
+			nif->set<uint>( iDataSize, nif->get<BSVertexDesc>( job.shape, "Vertex Desc" ).GetVertexSize() * numVerts + 6 * numTris );
+		nif->updateArraySize( job.shape, "Vertex Data" );
+	}
+}
+
+//! Asks for the target triangle ratio and the error limit
+static bool simplifyDialog( float & ratio, float & maxError )
+{
+	QDialog dlg;
+	dlg.setWindowTitle( Spell::tr( "Simplify" ) );
+
+	QGridLayout * grid = new QGridLayout;
+	dlg.setLayout( grid );
+
+	QDoubleSpinBox * spRatio = new QDoubleSpinBox;
+	spRatio->setRange( 1, 100 );
+	spRatio->setDecimals( 1 );
+	spRatio->setSingleStep( 5 );
+	spRatio->setSuffix( "%" );
+	spRatio->setValue( 50 );
+
+	grid->addWidget( new QLabel( Spell::tr( "Target Triangles" ) ), 0, 0 );
+	grid->addWidget( spRatio, 0, 1 );
+
+	QDoubleSpinBox * spError = new QDoubleSpinBox;
+	spError->setRange( 0, 100 );
+	spError->setDecimals( 2 );
+	spError->setSingleStep( 0.25 );
+	spError->setSuffix( "%" );
+	spError->setValue( 1 );
+	spError->setToolTip( Spell::tr( "Largest error allowed, relative to the size of the mesh" ) );
+
+	grid->addWidget( new QLabel( Spell::tr( "Max Error" ) ), 1, 0 );
+	grid->addWidget( spError, 1, 1 );
+
+	QPushButton * btOk = new QPushButton;
+	btOk->setText( Spell::tr( "Simplify" ) );
+	QObject::connect( btOk, &QPushButton::clicked, &dlg, &QDialog::accept );
+
+	QPushButton * btCancel = new QPushButton;
+	btCancel->setText( Spell::tr( "Cancel" ) );
+	QObject::connect( btCancel, &QPushButton::clicked, &dlg, &QDialog::reject );
+
+	grid->addWidget( btOk, 2, 0 );
+	grid->addWidget( btCancel, 2, 1 );
+
+	if ( dlg.exec() != QDialog::Accepted )
+		return false;
+
+	ratio = float( spRatio->value() / 100.0 );
+	maxError = float( spError->value() / 100.0 );
+	return true;
+}
+
+//! Simplifies the shapes, each one on its own thread
+/*!
+ * Shapes sharing a data block are simplified once, through the first of them; simplifying the
+ * data again would write triangles with the old vertex numbers into the already trimmed block.
+ */
+static void simplifyShapes( NifModel * nif, const QList<QPersistentModelIndex> & allShapes )
+{
+	QList<QPersistentModelIndex> shapes;
+	QSet<qint32> dataBlocks;
+	int sharedShapes = 0;
+	for ( const auto & iShape : allShapes ) {
+		if ( nif->isNiBlock( iShape, "NiTriShape" ) ) {
+			qint32 data = nif->getLink( iShape, "Data" );
+			if ( dataBlocks.contains( data ) ) {
+				sharedShapes++;
+				continue;
+			}
+			dataBlocks.insert( data );
+		}
+		shapes << iShape;
+	}
+
+	float ratio, maxError;
+	if ( shapes.isEmpty() || !simplifyDialog( ratio, maxError ) )
+		return;
+
+	QVector<SimplifyJob> jobs( shapes.count() );
+	for ( int i = 0; i < shapes.count(); i++ ) {
+		SimplifyJob & job = jobs[i];
+		job.shape = shapes[i];
+		readShape( nif, job );
+		job.options.targetTriangles = int( job.triangles.count() * ratio );
+		job.options.maxError = maxError;
+	}
+
+	auto run = []( SimplifyJob & job ) {
+		job.result = simplifyMesh( job.positions, job.triangles, job.options, &job.error );
+	};
+
+	QSemaphore done;
+	for ( int i = 1; i < jobs.count(); i++ ) {
+		SimplifyJob * job = &jobs[i];
+		QThreadPool::globalInstance()->start( [job, &run, &done]() {
+			run( *job );
+			done.release();
+		} );
+	}
+	run( jobs[0] );
+	done.acquire( jobs.count() - 1 );
+
+	int trisBefore = 0, trisAfter = 0;
+	float maxResultError = 0.0f;
+	bool partitionRemoved = false;
+
+	for ( const SimplifyJob & job : jobs ) {
+		trisBefore += job.triangles.count();
+		trisAfter += job.result.count();
+		maxResultError = std::max( maxResultError, job.error );
+
+		if ( job.result.count() < job.triangles.count() && job.shape.isValid() )
+			writeShape( nif, job, partitionRemoved );
+	}
+
+	Message::info( nullptr, Spell::tr( "Simplified %1 shapes from %2 to %3 triangles, largest error %4%" )
+		.arg( jobs.count() ).arg( trisBefore ).arg( trisAfter ).arg( maxResultError * 100.0f, 0, 'f', 3 ) );
+
+	if ( sharedShapes )
+		Message::info( nullptr, Spell::tr( "%1 shapes share their data block with another shape and were simplified with it" ).arg( sharedShapes ) );
+
+	if ( partitionRemoved )
+		Message::warning( nullptr, Spell::tr( "The skin partition was removed, please regenerate it with the skin partition spell" ) );
+}
+
+//! Simplifies a mesh by collapsing edges, for LOD models
+/*!
+ * Vertices are not moved, seams and open borders are kept, and the normals, UVs and skin weights
+ * of the removed vertices are taken into account when choosing which edges to collapse.
+ */
+class spSimplifyMesh final : public Spell
+{
+public:
+	QString name() const override final { return Spell::tr( "Simplify" ); }
+	QString page() const override final { return Spell::tr( "Mesh" ); }
+
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiTriShape", "BSTriShape" }; }
+
+	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
+	{
+		return canSimplify( nif, index );
+	}
+
+	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final
+	{
+		simplifyShapes( nif, { index } );
+		return index;
+	}
+};
+
+REGISTER_SPELL( spSimplifyMesh )
+
+//! Simplifies all meshes by collapsing edges, for LOD models
+class spSimplifyAllMeshes final : public Spell
+{
+public:
+	QString name() const override final { return Spell::tr( "Simplify All Meshes" ); }
+	QString page() const override final { return Spell::tr( "Batch" ); }
+
+	int targets() const override final { return TargetNone; }
+
+	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
+	{
+		return nif && !index.isValid();
+	}
+
+	QModelIndex cast( NifModel * nif, const QModelIndex & ) override final
+	{
+		QList<QPersistentModelIndex> shapes;
+		for ( int n = 0; n < nif->getBlockCount(); n++ ) {
+			QModelIndex idx = nif->getBlockIndex( n );
+			if ( canSimplify( nif, idx ) )
+				shapes << idx;
+		}
+
+		simplifyShapes( nif, shapes );
+		return QModelIndex();
+	}
+};
+
+REGISTER_SPELL( spSimplifyAllMeshes )
@@ -36,6 +36,8 @@ public:
 	QString name() const override final { return Spell::tr( "Fix Bip01" ); }
 	QString page() const override final { return Spell::tr( "Skeleton" ); }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return ( nif->getVersion() == "4.0.0.2" && nif->itemStrType( index ) == "NiBlock" && nif->get<QString>( index, "Name" ) == "Bip01" ); //&& QFile::exists( SKEL_DAT ) );
@@ -198,6 +200,8 @@ public:
 	QString name() const override final { return Spell::tr( "Scan Bip01" ); }
 	QString page() const override final { return Spell::tr( "Skeleton" ); }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return ( nif->getVersion() == "4.0.0.2" && nif->itemStrType( index ) == "NiBlock" && nif->get<QString>( index, "Name" ) == "Bip01" );
@@ -253,6 +257,11 @@ public:
 	QString name() const override final { return Spell::tr( "Make Skin Partition" ); }
 	QString page() const override final { return Spell::tr( "Mesh" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiTriShape", "NiTriStrips" }; }
+	//! Depends on the linked skin and data blocks
+	bool cacheable() const override final { return false; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & iShape ) override final
 	{
 		static QStringList testNames = { "NiTriShape", "NiTriStrips" };
@@ -991,6 +1000,15 @@ public:
 
 REGISTER_SPELL( spSkinPartition )
 
+QModelIndex makeSkinPartition( NifModel * nif, const QModelIndex & iShape, int maxBonesPerPartition, int maxBonesPerVertex, bool makeStrips, bool pad )
+{
+	spSkinPartition partitioner;
+	if ( !partitioner.isApplicable( nif, iShape ) || maxBonesPerPartition <= 0 || maxBonesPerVertex <= 0 )
+		return iShape;
+
+	return partitioner.cast( nif, iShape, maxBonesPerPartition, maxBonesPerVertex, makeStrips, pad );
+}
+
 //! Make all skin partitions
 class spAllSkinPartitions final : public Spell
 {
@@ -998,6 +1016,8 @@ public:
 	QString name() const override final { return Spell::tr( "Make All Skin Partitions" ); }
 	QString page() const override final { return Spell::tr( "Batch" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif && !index.isValid();
@@ -1137,6 +1157,9 @@ public:
 	QString name() const override final { return Spell::tr( "Fix Bone Bounds" ); }
 	QString page() const override final { return Spell::tr( "Skeleton" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiSkinData" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index, "NiSkinData" );
@@ -1223,6 +1246,8 @@ public:
 	QString name() const override final { return Spell::tr( "Mirror armature" ); }
 	QString page() const override final { return Spell::tr( "Skeleton" ); }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return ( nif->getVersion() == "4.0.0.2" && nif->itemStrType( index ) == "NiBlock" )
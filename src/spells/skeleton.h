@@ -4,9 +4,11 @@
 #include <QDialog> // Inherited
 
 
-//! \file skeleton.h SkinPartitionDialog
+//! \file skeleton.h SkinPartitionDialog, makeSkinPartition()
 
+class NifModel;
 class QCheckBox;
+class QModelIndex;
 class QSpinBox;
 
 //! Dialog box for skin partitions
@@ -45,4 +47,7 @@ protected:
 	int maxInfluences;
 };
 
+//! Makes the skin partition of a skinned NiTriShape or NiTriStrips without asking for the limits
+QModelIndex makeSkinPartition( NifModel * nif, const QModelIndex & iShape, int maxBonesPerPartition, int maxBonesPerVertex, bool makeStrips = false, bool pad = false );
+
 #endif
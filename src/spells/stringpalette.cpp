@@ -84,6 +84,9 @@ public:
 	}
 	bool instant() const override final { return true; }
 
+	int targets() const override final { return TargetField; }
+	QVector<NifValue::Type> valueTypes() const override final { return { NifValue::tStringOffset }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->getValue( index ).type() == NifValue::tStringOffset && getStringPalette( nif, index ).isValid();
@@ -294,6 +297,9 @@ public:
 
 	bool instant() const override final { return false; }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiSequence" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->blockInherits( index, "NiSequence" )
@@ -451,6 +457,8 @@ public:
 
 	bool instant() const override final { return false; }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return ( !index.isValid() && nif->checkVersion( 0x0A020000, 0x14000005 ) );
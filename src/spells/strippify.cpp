@@ -34,6 +34,9 @@ class spStrippify final : public Spell
 	QString name() const override final { return Spell::tr( "Stripify" ); }
 	QString page() const override final { return Spell::tr( "Mesh" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiTriShape" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->checkVersion( 0x0a000000, 0 ) && nif->isNiBlock( index, "NiTriShape" );
@@ -205,6 +208,8 @@ public:
 	QString name() const override final { return Spell::tr( "Stripify all TriShapes" ); }
 	QString page() const override final { return Spell::tr( "Optimize" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->checkVersion( 0x0a000000, 0 ) && !index.isValid();
@@ -239,6 +244,9 @@ class spTriangulate final : public Spell
 	QString name() const override final { return Spell::tr( "Triangulate" ); }
 	QString page() const override final { return Spell::tr( "Mesh" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiTriStrips" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->isNiBlock( index, "NiTriStrips" );
@@ -337,6 +345,8 @@ public:
 	QString name() const override final { return Spell::tr( "Triangulate All Strips" ); }
 	QString page() const override final { return Spell::tr( "Batch" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( [[maybe_unused]] const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return !index.isValid();
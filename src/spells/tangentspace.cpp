@@ -309,6 +309,8 @@ public:
 	QString name() const override final { return Spell::tr( "Update All Tangent Spaces" ); }
 	QString page() const override final { return Spell::tr( "Batch" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & idx ) override final
 	{
 		if ( !nif || idx.isValid() )
@@ -355,6 +357,8 @@ public:
 	QString name() const override final { return Spell::tr( "Add Tangent Spaces and Update" ); }
 	QString page() const override final { return Spell::tr( "Batch" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & idx ) override final
 	{
 		return nif && !idx.isValid() && nif->checkVersion( 0x0A010000, 0 );
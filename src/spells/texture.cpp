@@ -333,6 +333,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Base Texture" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex block = nif->getBlockIndex( index, "NiTexturingProperty" );
@@ -354,6 +357,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Dark Map" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex block = nif->getBlockIndex( index, "NiTexturingProperty" );
@@ -375,6 +381,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Detail Map" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex block = nif->getBlockIndex( index, "NiTexturingProperty" );
@@ -396,6 +405,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Glow Map" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex block = nif->getBlockIndex( index, "NiTexturingProperty" );
@@ -417,6 +429,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Bump Map" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex block = nif->getBlockIndex( index, "NiTexturingProperty" );
@@ -447,6 +462,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Decal 0 Map" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex block = nif->getBlockIndex( index, "NiTexturingProperty" );
@@ -468,6 +486,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Decal 1 Map" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex block = nif->getBlockIndex( index, "NiTexturingProperty" );
@@ -489,6 +510,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Decal 2 Map" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex block = nif->getBlockIndex( index, "NiTexturingProperty" );
@@ -510,6 +534,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Decal 3 Map" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		QModelIndex block = nif->getBlockIndex( index, "NiTexturingProperty" );
@@ -754,6 +781,8 @@ public:
 	QString name() const override final { return Spell::tr( "Multi Apply Mode" ); }
 	QString page() const override final { return Spell::tr( "Batch" ); }
 
+	int targets() const override final { return TargetNone; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		// Apply Mode field is defined in nifs up to version 20.0.0.5
@@ -1172,6 +1201,9 @@ public:
 	QString name() const override final { return Spell::tr( "Edit Flip Controller" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock; }
+	QStringList blockTypes() const override final { return { "NiFlipController" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return ( nif->itemName( index ) == "NiFlipController" );
@@ -1243,6 +1275,9 @@ public:
 	QString name() const override final { return Spell::tr( "Add Flip Controller" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiTexturingProperty" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		// also check NiTextureProperty?
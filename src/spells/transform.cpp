@@ -294,6 +294,8 @@ public:
 	QString name() const override final { return Spell::tr( "Paste" ); }
 	QString page() const override final { return Spell::tr( "Transform" ); }
 
+	bool cacheable() const override final { return false; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		const QMimeData * mime = QApplication::clipboard()->mimeData();
@@ -395,6 +397,9 @@ public:
 	QString name() const override final { return Spell::tr( "Scale Vertices" ); }
 	QString page() const override final { return Spell::tr( "Transform" ); }
 
+	int targets() const override final { return TargetBlock | TargetField; }
+	QStringList blockTypes() const override final { return { "NiGeometry" }; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return nif->blockInherits( index, "NiGeometry" );
@@ -9,6 +9,8 @@ public:
 	QString name() const override final { return Spell::tr( "Apply" ); }
 	QString page() const override final { return Spell::tr( "Transform" ); }
 
+	int targets() const override final { return TargetBlock; }
+
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final;
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final;
 };
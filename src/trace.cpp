@@ -0,0 +1,253 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+
+//! \file trace.cpp Trace implementation
+
+namespace Trace
+{
+
+std::atomic<bool> recording = false;
+
+namespace
+{
+
+struct Event
+{
+	const char * name;
+	const char * detail;
+	qint64 start;
+	qint64 end;
+};
+
+//! The events of one thread, only that thread writes to it
+struct ThreadBuffer
+{
+	std::vector<Event> events = std::vector<Event>( bufferSize );
+	//! Number of events written so far, the next one goes to head % bufferSize
+	std::atomic<quint64> head = 0;
+	//! The first event of the current recording
+	std::atomic<quint64> first = 0;
+
+	qint64 id = 0;
+	QString threadName;
+	//! The thread has exited, guarded by the mutex
+	bool exited = false;
+	//! The events before this one have been written by save(), guarded by the mutex
+	quint64 saved = 0;
+
+	//! The buffer holds no events that still have to be saved
+	bool isFree() const
+	{
+		return exited && std::max( first.load(), saved ) >= head.load( std::memory_order_acquire );
+	}
+};
+
+//! Guards the list of buffers and the interned strings
+QMutex mutex;
+//! Buffers are kept when their thread exits, so its events can still be saved, and reused once they have been
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+QHash<QString, const char *> strings;
+//! Start of the current recording, the time stamps are relative to it
+std::atomic<qint64> epoch = 0;
+//! Last thread ID, reused buffers get a new one
+qint64 lastId = 0;
+
+//! The buffer of the current thread, released when the thread exits
+struct ThreadSlot
+{
+	ThreadBuffer * buffer = nullptr;
+	//! No buffer was available, the events of the thread are dropped
+	bool full = false;
+
+	~ThreadSlot()
+	{
+		if ( buffer ) {
+			QMutexLocker lock( &mutex );
+			buffer->exited = true;
+		}
+	}
+};
+
+ThreadBuffer * acquireBuffer()
+{
+	QThread * thread = QThread::currentThread();
+	QString threadName;
+	if ( QCoreApplication::instance() && thread == QCoreApplication::instance()->thread() )
+		threadName = QStringLiteral( "Main" );
+	else
+		threadName = thread->objectName();
+
+	QMutexLocker lock( &mutex );
+	ThreadBuffer * b = nullptr;
+	for ( const auto & i : buffers ) {
+		if ( i->isFree() ) {
+			b = i.get();
+			break;
+		}
+	}
+
+	if ( !b && buffers.size() >= size_t( maxThreads ) ) {
+		// Give up the unsaved events of an exited thread rather than those of the current one
+		for ( const auto & i : buffers ) {
+			if ( i->exited ) {
+				b = i.get();
+				break;
+			}
+		}
+		if ( !b )
+			return nullptr;
+	}
+
+	if ( b ) {
+		// The events of the previous thread must not be saved under the new name
+		b->first.store( b->head.load( std::memory_order_acquire ) );
+		b->exited = false;
+	} else {
+		buffers.push_back( std::make_unique<ThreadBuffer>() );
+		b = buffers.back().get();
+	}
+
+	b->id = ++lastId;
+	b->threadName = threadName.isEmpty() ? QString( "Thread %1" ).arg( b->id ) : threadName;
+	return b;
+}
+
+ThreadBuffer * threadBuffer()
+{
+	thread_local ThreadSlot slot;
+	if ( slot.buffer || slot.full ) [[likely]]
+		return slot.buffer;
+
+	slot.buffer = acquireBuffer();
+	slot.full = !slot.buffer;
+	return slot.buffer;
+}
+
+}
+
+void record( const char * name, const char * detail, qint64 start, qint64 end )
+{
+	ThreadBuffer * b = threadBuffer();
+	if ( !b ) [[unlikely]]
+		return;
+	quint64 h = b->head.load( std::memory_order_relaxed );
+	b->events[h % bufferSize] = { name, detail, start, end };
+	b->head.store( h + 1, std::memory_order_release );
+}
+
+const char * intern( const QString & text )
+{
+	thread_local QHash<QString, const char *> cache;
+	auto it = cache.constFind( text );
+	if ( it != cache.constEnd() )
+		return it.value();
+
+	QMutexLocker lock( &mutex );
+	auto s = strings.constFind( text );
+	if ( s == strings.constEnd() ) {
+		if ( strings.size() >= maxStrings )
+			return nullptr;
+		s = strings.insert( text, qstrdup( text.toUtf8().constData() ) );
+	}
+
+	cache.insert( text, s.value() );
+	return s.value();
+}
+
+const char * intern( std::string_view text )
+{
+	return intern( QString::fromUtf8( text.data(), qsizetype( text.size() ) ) );
+}
+
+void setRecording( bool on )
+{
+	if ( on == isRecording() )
+		return;
+
+	if ( on ) {
+		QMutexLocker lock( &mutex );
+		for ( const auto & b : buffers )
+			b->first.store( b->head.load( std::memory_order_acquire ) );
+		epoch.store( now() );
+	}
+
+	recording.store( on, std::memory_order_relaxed );
+}
+
+bool save( const QString & fileName, QString * error )
+{
+	QJsonArray events;
+	qint64 pid = QCoreApplication::applicationPid();
+	qint64 start = epoch.load();
+
+	QMutexLocker lock( &mutex );
+	for ( const auto & b : buffers ) {
+		quint64 head = b->head.load( std::memory_order_acquire );
+		quint64 first = std::max<quint64>( b->first.load(), head > quint64( bufferSize ) ? head - bufferSize : 0 );
+		b->saved = head;
+		if ( first >= head )
+			continue;
+
+		std::vector<Event> copy;
+		copy.reserve( head - first );
+		for ( quint64 i = first; i < head; i++ )
+			copy.push_back( b->events[i % bufferSize] );
+
+		// The thread may have kept recording and overwritten the oldest events while they were copied
+		quint64 newHead = b->head.load( std::memory_order_acquire ) + 1;
+		quint64 valid = newHead > quint64( bufferSize ) ? newHead - bufferSize : 0;
+		size_t skip = valid > first ? size_t( std::min<quint64>( valid - first, copy.size() ) ) : 0;
+
+		events.append( QJsonObject {
+			{ "name", "thread_name" }, { "ph", "M" }, { "pid", pid }, { "tid", b->id },
+			{ "args", QJsonObject { { "name", b->threadName } } }
+		} );
+
+		for ( size_t i = skip; i < copy.size(); i++ ) {
+			const Event & e = copy[i];
+
+			QJsonObject event;
+			event.insert( "name", QString::fromUtf8( e.name ) );
+			event.insert( "cat", "nifskope" );
+			event.insert( "ph", "X" );
+			event.insert( "ts", double( e.start - start ) / 1000.0 );
+			event.insert( "dur", double( e.end - e.start ) / 1000.0 );
+			event.insert( "pid", pid );
+			event.insert( "tid", b->id );
+			if ( e.detail )
+				event.insert( "args", QJsonObject { { "detail", QString::fromUtf8( e.detail ) } } );
+
+			events.append( event );
+		}
+	}
+	lock.unlock();
+
+	QJsonObject root;
+	root.insert( "traceEvents", events );
+	root.insert( "displayTimeUnit", "ms" );
+
+	QFile file( fileName );
+	if ( !file.open( QIODevice::WriteOnly ) ) {
+		if ( error )
+			*error = file.errorString();
+		return false;
+	}
+
+	file.write( QJsonDocument( root ).toJson( QJsonDocument::Compact ) );
+	return true;
+}
+
+}
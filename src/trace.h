@@ -0,0 +1,131 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+#include <string_view>
+
+
+//! \file trace.h Trace, TRACE_ZONE
+
+//! Scoped timing zones, written as Chrome trace JSON
+/*!
+ * A zone writes its start and end time into a ring buffer owned by the current thread, so
+ * recording takes no lock. While recording is off a zone only reads one atomic flag, as long as
+ * its detail is an existing string: pass a UTF-8 std::string_view or const char * rather than
+ * converting it to a QString at the call site, the conversion is done only while recording.
+ * save() writes the newest events of every thread in the Trace Event Format, which opens in
+ * chrome://tracing and ui.perfetto.dev.
+ *
+ * Building with NIFSKOPE_NO_TRACE defined removes the zones entirely.
+ */
+namespace Trace
+{
+	//! Number of events kept per thread, older events are overwritten
+	constexpr int bufferSize = 1 << 16;
+
+	//! Number of thread buffers, the buffer of an exited thread is reused once its events have been saved
+	constexpr int maxThreads = 32;
+
+	extern std::atomic<bool> recording;
+
+	//! Whether zones are being recorded
+	inline bool isRecording()
+	{
+		return recording.load( std::memory_order_relaxed );
+	}
+
+	//! Starts or stops recording, starting drops the events of the previous recording
+	void setRecording( bool on );
+
+	//! Writes the recorded events, returns false if the file could not be written
+	bool save( const QString & fileName, QString * error = nullptr );
+
+	//! Number of distinct details kept, the details of later zones are dropped
+	constexpr int maxStrings = 1 << 16;
+
+	//! Returns a copy of a string that stays valid until the program exits
+	/*!
+	 * The copies are never freed, so at most maxStrings of them are made; after that nullptr
+	 * is returned for new strings.
+	 */
+	const char * intern( const QString & text );
+	const char * intern( std::string_view text );
+
+	//! Adds an event to the buffer of the current thread
+	void record( const char * name, const char * detail, qint64 start, qint64 end );
+
+	//! The trace clock in nanoseconds
+	inline qint64 now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	//! Records the time from construction to destruction, see TRACE_ZONE
+	class Zone final
+	{
+	public:
+		explicit Zone( const char * zoneName )
+		{
+			if ( isRecording() ) {
+				name = zoneName;
+				start = now();
+			}
+		}
+
+		//! A zone with a detail such as a file name or block type, shown as its argument
+		Zone( const char * zoneName, const QString & zoneDetail )
+		{
+			if ( isRecording() ) {
+				name = zoneName;
+				if ( !zoneDetail.isEmpty() )
+					detail = intern( zoneDetail );
+				start = now();
+			}
+		}
+
+		//! A zone with a UTF-8 detail, converted only while recording
+		Zone( const char * zoneName, std::string_view zoneDetail )
+		{
+			if ( isRecording() ) {
+				name = zoneName;
+				if ( !zoneDetail.empty() )
+					detail = intern( zoneDetail );
+				start = now();
+			}
+		}
+
+		Zone( const char * zoneName, const char * zoneDetail )
+			: Zone( zoneName, zoneDetail ? std::string_view( zoneDetail ) : std::string_view() )
+		{
+		}
+
+		~Zone()
+		{
+			if ( name )
+				record( name, detail, start, now() );
+		}
+
+		Zone( const Zone & ) = delete;
+		Zone & operator=( const Zone & ) = delete;
+
+	private:
+		const char * name = nullptr;
+		const char * detail = nullptr;
+		qint64 start = 0;
+	};
+}
+
+#define TRACE_CONCAT_( a, b ) a ## b
+#define TRACE_CONCAT( a, b ) TRACE_CONCAT_( a, b )
+
+//! Records the rest of the enclosing scope, with a static name and an optional QString or UTF-8 detail
+#ifndef NIFSKOPE_NO_TRACE
+#define TRACE_ZONE( ... ) Trace::Zone TRACE_CONCAT( traceZone, __LINE__ )( __VA_ARGS__ )
+#else
+#define TRACE_ZONE( ... ) do {} while ( false )
+#endif
+
+#endif
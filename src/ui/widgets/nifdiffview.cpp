@@ -0,0 +1,192 @@
+#include "nifdiffview.h"
+
+#include "model/nifdiff.h"
+#include "model/nifloadthread.h"
+#include "model/nifmodel.h"
+
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include <memory>
+
+
+//! \file nifdiffview.cpp NifDiffView implementation
+
+//! Item data role holding the block of the loaded NIF
+static constexpr int BlockRole = Qt::UserRole;
+
+NifDiffView::NifDiffView( QWidget * parent ) : QWidget( parent )
+{
+	btnCompare = new QPushButton( tr( "Compare With..." ), this );
+	btnRefresh = new QPushButton( tr( "Refresh" ), this );
+	btnRefresh->setEnabled( false );
+
+	status = new QLabel( this );
+	status->setWordWrap( true );
+
+	tree = new QTreeWidget( this );
+	tree->setColumnCount( 3 );
+	tree->setHeaderLabels( { tr( "Block / Field" ), tr( "This File" ), tr( "Other File" ) } );
+	tree->header()->setSectionResizeMode( 0, QHeaderView::ResizeToContents );
+	tree->setUniformRowHeights( true );
+
+	QHBoxLayout * buttons = new QHBoxLayout;
+	buttons->addWidget( btnCompare );
+	buttons->addWidget( btnRefresh );
+	buttons->addStretch();
+
+	QVBoxLayout * layout = new QVBoxLayout( this );
+	layout->addLayout( buttons );
+	layout->addWidget( status );
+	layout->addWidget( tree );
+
+	connect( btnCompare, &QPushButton::clicked, this, &NifDiffView::chooseFile );
+	connect( btnRefresh, &QPushButton::clicked, [this]() { compareWith( otherFile ); } );
+	connect( tree, &QTreeWidget::itemDoubleClicked, this, &NifDiffView::activateItem );
+}
+
+NifDiffView::~NifDiffView()
+{
+	cancelLoading();
+}
+
+void NifDiffView::setNifModel( NifModel * model )
+{
+	nif = model;
+	clear();
+}
+
+void NifDiffView::clear()
+{
+	tree->clear();
+	status->clear();
+}
+
+void NifDiffView::chooseFile()
+{
+	QString dir = otherFile.isEmpty() && nif ? nif->getFolder() : QFileInfo( otherFile ).absolutePath();
+	QString fname = QFileDialog::getOpenFileName( this, tr( "Choose a file to compare with" ), dir,
+		"NIF (*.nif *.nifcache *.texcache *.pcpatch *.jmi *.kf *.kfa *.kfm *.bto *.btr)" );
+
+	if ( !fname.isEmpty() )
+		compareWith( fname );
+}
+
+void NifDiffView::compareWith( const QString & fname )
+{
+	if ( !nif || fname.isEmpty() )
+		return;
+
+	cancelLoading();
+	clear();
+	otherFile = fname;
+	btnRefresh->setEnabled( true );
+
+	timer.start();
+
+	loader = new NifLoadThread( this, fname );
+	connect( &loader->model, &NifModel::sigProgress, this, [this]( int c, int m ) {
+		status->setText( tr( "Loading %1 (%2%)" ).arg( QFileInfo( otherFile ).fileName() ).arg( m > 0 ? c * 100 / m : 0 ) );
+	} );
+	connect( loader, &QThread::finished, this, &NifDiffView::finishLoading );
+
+	status->setText( tr( "Loading %1" ).arg( QFileInfo( fname ).fileName() ) );
+	loader->start();
+}
+
+void NifDiffView::cancelLoading()
+{
+	if ( !loader )
+		return;
+
+	// finishLoading() ignores the thread once it is no longer the current loader
+	loader->disconnect( this );
+	loader->model.disconnect( this );
+	loader->cancel();
+	loader->wait();
+	delete loader;
+	loader = nullptr;
+}
+
+void NifDiffView::finishLoading()
+{
+	if ( !loader || sender() != loader )
+		return;
+
+	// Declared before the diff, which refers to its model
+	std::unique_ptr<NifLoadThread> done( loader );
+	loader = nullptr;
+	done->wait();
+
+	QString fname = done->fileName;
+	if ( !done->loaded || !nif ) {
+		status->setText( tr( "Could not load %1" ).arg( fname ) );
+		return;
+	}
+
+	NifDiff diff( nif, &done->model );
+	bool equal = diff.compare();
+
+	// One top level item per block, with the fields below it
+	QTreeWidgetItem * blockItem = nullptr;
+	qint32 lastA = -2, lastB = -2;
+	QString lastType;
+
+	for ( const NifDifference & d : diff.differences() ) {
+		if ( d.kind == NifDifference::BlockAdded || d.kind == NifDifference::BlockRemoved ) {
+			auto item = new QTreeWidgetItem( tree, { d.toString() } );
+			item->setData( 0, BlockRole, d.blockA );
+			blockItem = nullptr;
+			continue;
+		}
+
+		if ( !blockItem || d.blockA != lastA || d.blockB != lastB || d.type != lastType ) {
+			blockItem = new QTreeWidgetItem( tree, { d.blockText() } );
+			blockItem->setData( 0, BlockRole, d.blockA );
+			blockItem->setExpanded( true );
+
+			lastA = d.blockA;
+			lastB = d.blockB;
+			lastType = d.type;
+		}
+
+		QString field = d.path;
+		QString valueA = d.valueA, valueB = d.valueB;
+		if ( d.kind == NifDifference::SizeChanged ) {
+			valueA = tr( "%1 entries" ).arg( d.valueA );
+			valueB = tr( "%1 entries" ).arg( d.valueB );
+		} else if ( d.kind == NifDifference::StructureChanged && valueA.isEmpty() ) {
+			field = tr( "%1 (structure differs)" ).arg( field );
+		} else if ( valueA.isEmpty() && valueB.isEmpty() ) {
+			field = tr( "%1 (changed)" ).arg( field );
+		}
+
+		auto item = new QTreeWidgetItem( blockItem, { field, valueA, valueB } );
+		item->setData( 0, BlockRole, d.blockA );
+		item->setToolTip( 1, valueA );
+		item->setToolTip( 2, valueB );
+	}
+
+	tree->expandAll();
+
+	if ( equal )
+		status->setText( tr( "No differences with %1 (%2 ms)" ).arg( QFileInfo( fname ).fileName() ).arg( timer.elapsed() ) );
+	else
+		status->setText( tr( "%1 differences with %2 (%3 ms)" ).arg( diff.differences().count() )
+			.arg( QFileInfo( fname ).fileName() ).arg( timer.elapsed() ) );
+}
+
+void NifDiffView::activateItem( QTreeWidgetItem * item )
+{
+	if ( !nif || !item )
+		return;
+
+	qint32 block = item->data( 0, BlockRole ).toInt();
+	if ( block >= 0 )
+		emit sigSelectBlock( nif->getBlockIndex( block ) );
+}
@@ -0,0 +1,62 @@
+#ifndef NIFDIFFVIEW_H
+#define NIFDIFFVIEW_H
+
+#include <QElapsedTimer>
+#include <QWidget> // Inherited
+
+
+//! \file nifdiffview.h NifDiffView class
+
+class NifLoadThread;
+class NifModel;
+class QLabel;
+class QModelIndex;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+//! Lists the differences between the loaded NIF and another file
+class NifDiffView final : public QWidget
+{
+	Q_OBJECT
+
+public:
+	explicit NifDiffView( QWidget * parent = nullptr );
+	~NifDiffView();
+
+	void setNifModel( NifModel * );
+
+public slots:
+	//! Compares the loaded NIF with a file, once it has been loaded on a worker thread
+	void compareWith( const QString & fname );
+	//! Clears the list, the loaded NIF changed
+	void clear();
+
+signals:
+	//! A block of the loaded NIF was double clicked
+	void sigSelectBlock( const QModelIndex & );
+
+protected slots:
+	void chooseFile();
+	void activateItem( QTreeWidgetItem * item );
+	//! Compares with the file loaded by the loader thread
+	void finishLoading();
+
+private:
+	//! Stops the load in progress, its file is not compared
+	void cancelLoading();
+
+	NifModel * nif = nullptr;
+	QString otherFile;
+	//! Loads the other file, null if no load is in progress
+	NifLoadThread * loader = nullptr;
+	//! Measures the load and the comparison
+	QElapsedTimer timer;
+
+	QPushButton * btnCompare;
+	QPushButton * btnRefresh;
+	QLabel * status;
+	QTreeWidget * tree;
+};
+
+#endif
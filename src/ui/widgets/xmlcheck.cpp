@@ -8,6 +8,7 @@
 #include "spells/sanitize.h"
 
 #include <QAction>
+#include <QBuffer>
 #include <QCheckBox>
 #include <QCloseEvent>
 #include <QDir>
@@ -25,11 +26,22 @@
 #include <QToolButton>
 #include <QComboBox>
 #include <QQueue>
+#include <QTimer>
 
 #include "gamemanager.h"
 
+#include <algorithm>
+#include <set>
+#include <string>
+
 #define NUM_THREADS 4
 
+//! Interval of the progress and throughput updates while the checker runs
+#define STATS_INTERVAL 250
+
+//! Serializes reads from the resource archives, which are shared by all threads
+static QMutex archiveMutex;
+
 
 TestShredder * TestShredder::create()
 {
@@ -65,6 +77,15 @@ TestShredder::TestShredder()
 	chkKfm->setChecked( settings.value( "Check KFM", true ).toBool() );
 	chkKfm->setToolTip( tr( "Check .kfm files" ) );
 
+	chkArchives = new QCheckBox( tr( "Archives" ), this );
+	chkArchives->setChecked( settings.value( "Check Archives", false ).toBool() );
+	chkArchives->setToolTip( tr( "Also check the files in the resource archives of the selected game" ) );
+
+	archiveGame = new QComboBox( this );
+	for ( int g = Game::OTHER + 1; g < Game::NUM_GAMES; g++ )
+		archiveGame->addItem( Game::StringForMode( Game::GameMode( g ) ), g );
+	archiveGame->setCurrentIndex( qMax( archiveGame->findData( settings.value( "Archive Game", int( Game::SKYRIM_SE ) ).toInt() ), 0 ) );
+
 	QAction * aChoose = new QAction( tr( "Block Match" ), this );
 	connect( aChoose, &QAction::triggered, this, &TestShredder::chooseBlock );
 	QToolButton * btChoose = new QToolButton( this );
@@ -110,6 +131,12 @@ TestShredder::TestShredder()
 	label = new QLabel( this );
 	label->setHidden( true );
 
+	queue = std::make_shared<FileQueue>();
+
+	statsTimer = new QTimer( this );
+	statsTimer->setInterval( STATS_INTERVAL );
+	connect( statsTimer, &QTimer::timeout, this, &TestShredder::updateStats );
+
 	btRun = new QPushButton( tr( "Run" ), this );
 	btRun->setCheckable( true );
 	connect( btRun, &QPushButton::clicked, this, &TestShredder::run );
@@ -130,6 +157,8 @@ TestShredder::TestShredder()
 	hbox->addWidget( chkNif );
 	hbox->addWidget( chkKf );
 	hbox->addWidget( chkKfm );
+	hbox->addWidget( chkArchives );
+	hbox->addWidget( archiveGame );
 
 	lay->addLayout( hbox = new QHBoxLayout() );
 	hbox->addWidget( btChoose );
@@ -178,6 +207,8 @@ TestShredder::~TestShredder()
 	settings.setValue( "Check NIF", chkNif->isChecked() );
 	settings.setValue( "Check KF", chkKf->isChecked() );
 	settings.setValue( "Check KFM", chkKfm->isChecked() );
+	settings.setValue( "Check Archives", chkArchives->isChecked() );
+	settings.setValue( "Archive Game", archiveGame->currentData().toInt() );
 	settings.setValue( "List Matches Only", repErr->isChecked() );
 	settings.setValue( "Header Only", hdrOnly->isChecked() );
 	settings.setValue( "Error Checking", chkCheckErrors->isChecked() );
@@ -185,7 +216,11 @@ TestShredder::~TestShredder()
 
 	settings.endGroup();
 
-	queue.clear();
+	queue->clear();
+
+	// The retired threads may still be reading from the archives
+	for ( TestThread * thread : retiredThreads )
+		thread->wait();
 }
 
 void TestShredder::xml()
@@ -198,26 +233,64 @@ void TestShredder::xml()
 	KfmModel::loadXML();
 }
 
+TestThread * TestShredder::createThread( int slot )
+{
+	TestThread * thread = new TestThread( this, queue, slot );
+	connect( thread, &TestThread::sigReady, text, &QTextBrowser::append );
+	connect( thread, &TestThread::finished, this, &TestShredder::threadFinished );
+	connect( thread, &TestThread::incrementError, this, &TestShredder::onIncrementError );
+
+	thread->blockMatch = blockMatch->text();
+	thread->verMatch  = NifModel::version2number( verMatch->text() );
+	thread->reportAll = !repErr->isChecked();
+	thread->headerOnly = hdrOnly->isChecked();
+	thread->checkFile = chkCheckErrors->isChecked();
+
+	thread->valueName = valueName->text();
+	thread->valueMatch = valueMatch->text();
+	thread->op = OpType(valueOps->currentIndex());
+
+	return thread;
+}
+
+void TestShredder::retireThreads( bool recreate )
+{
+	int num = threads.count();
+
+	for ( TestThread * thread : threads ) {
+		if ( thread->isRunning() ) {
+			// Let the thread finish its current file on its own, without reporting it
+			thread->cancel();
+			thread->disconnect( this );
+			thread->disconnect( text );
+			retiredThreads.append( thread );
+			connect( thread, &TestThread::finished, this, [this, thread]() {
+				retiredThreads.removeOne( thread );
+				thread->deleteLater();
+			} );
+			if ( thread->isFinished() ) {
+				retiredThreads.removeOne( thread );
+				thread->deleteLater();
+			}
+		} else {
+			delete thread;
+		}
+	}
+	threads.clear();
+
+	if ( !recreate )
+		return;
+
+	for ( int i = 0; i < num; i++ )
+		threads.append( createThread( i ) );
+}
+
 void TestShredder::renumberThreads( int num )
 {
 	while ( threads.count() < num ) {
-		TestThread * thread = new TestThread( this, &queue );
-		connect( thread, &TestThread::sigStart, this, &TestShredder::threadStarted );
-		connect( thread, &TestThread::sigReady, text, &QTextBrowser::append );
-		connect( thread, &TestThread::finished, this, &TestShredder::threadFinished );
-		connect( thread, &TestThread::incrementError, this, &TestShredder::onIncrementError );
+		TestThread * thread = createThread( threads.count() );
 		threads.append( thread );
 
-		thread->blockMatch = blockMatch->text();
-		thread->verMatch  = NifModel::version2number( verMatch->text() );
-		thread->reportAll = !repErr->isChecked();
-		thread->headerOnly = hdrOnly->isChecked();
-		thread->checkFile = chkCheckErrors->isChecked();
-
-		thread->valueName = valueName->text();
-		thread->valueMatch = valueMatch->text();
-		thread->op = OpType(valueOps->currentIndex());
-
 		if ( btRun->isChecked() ) {
 			thread->start();
 		}
@@ -232,14 +305,14 @@ void TestShredder::renumberThreads( int num )
 void TestShredder::run()
 {
 	errorCount = 0;
-	progress->setMaximum( progress->maximum() - queue.count() );
-	queue.clear();
 
-	if ( !btRun->isChecked() )
+	if ( !btRun->isChecked() ) {
+		queue->clear();
+		retireThreads();
+		statsTimer->stop();
+		updateStats();
+		text->append( tr( "Cancelled." ) );
 		return;
-
-	for ( TestThread * thread : threads ) {
-		thread->wait();
 	}
 
 	text->clear();
@@ -254,53 +327,56 @@ void TestShredder::run()
 	if ( chkKfm->isChecked() )
 		extensions << "*.kfm";
 
-	queue.init( directory->text(), extensions, recursive->isChecked() );
+	queue = std::make_shared<FileQueue>();
+	if ( !chkArchives->isChecked() || !directory->text().isEmpty() )
+		queue->init( directory->text(), extensions, recursive->isChecked() );
+	if ( chkArchives->isChecked() )
+		queue->initArchives( archiveGame->currentData().toInt(), extensions );
+	queue->distribute( threads.count() );
+
+	// Threads still busy with a previous run are left to finish in the background
+	retireThreads();
 
 	time = QDateTime::currentDateTime();
 
-	progress->setRange( 0, queue.count() );
+	progress->setRange( 0, queue->total() );
 	progress->setValue( 0 );
 
 	for ( TestThread * thread : threads ) {
-		thread->verMatch = NifModel::version2number( verMatch->text() );
-		thread->blockMatch = blockMatch->text();
-		thread->reportAll  = !repErr->isChecked();
-		thread->headerOnly = hdrOnly->isChecked();
-		thread->checkFile = chkCheckErrors->isChecked();
-		thread->valueName = valueName->text();
-		thread->valueMatch = valueMatch->text();
-		thread->op = OpType(valueOps->currentIndex());
-
 		thread->start();
 	}
+
+	statsTimer->start();
 }
 
-void TestShredder::threadStarted()
+void TestShredder::updateStats()
 {
-	progress->setValue( progress->maximum() - queue.count() );
+	int done = queue->doneCount();
+	double secs = qMax( time.msecsTo( QDateTime::currentDateTime() ), qint64( 1 ) ) / 1000.0;
+
+	progress->setValue( done );
+
+	label->setText( tr( "%1 of %2 files in %3 seconds (%4 files/s, %5 MB/s)" )
+		.arg( done ).arg( queue->total() ).arg( secs, 0, 'f', 1 )
+		.arg( done / secs, 0, 'f', 1 ).arg( queue->doneBytes() / ( 1024.0 * 1024.0 ) / secs, 0, 'f', 2 ) );
+	label->setVisible( true );
 }
 
 void TestShredder::threadFinished()
 {
-	std::uint32_t finishedThreads = 0;
-	if ( queue.isEmpty() ) {
-		for ( TestThread * thread : threads ) {
-			if ( thread->isRunning() )
-				return;
-		}
+	for ( TestThread * thread : threads ) {
+		if ( thread->isRunning() )
+			return;
+	}
 
-		btRun->setChecked( false );
+	if ( !btRun->isChecked() )
+		return;
 
-		label->setText( tr( "%1 files in %2 seconds" ).arg( progress->maximum() ).arg( time.secsTo( QDateTime::currentDateTime() ) ) );
-		label->setVisible( true );
+	btRun->setChecked( false );
+	statsTimer->stop();
+	updateStats();
 
-		for ( TestThread* thread : threads ) {
-			if ( thread->isFinished() )
-				finishedThreads++;
-		}
-		if ( qsizetype( finishedThreads ) == threads.count() )
-			text->append(tr("Completed with %1 errors.").arg(errorCount));
-	}
+	text->append( tr( "Completed with %1 errors." ).arg( errorCount ) );
 }
 
 void TestShredder::onIncrementError()
@@ -345,21 +421,19 @@ void TestShredder::chooseBlock()
 
 void TestShredder::closeEvent( QCloseEvent * e )
 {
-	for ( TestThread * thread : threads ) {
-		if ( thread->isRunning() ) {
-			e->ignore();
-			queue.clear();
-		}
-	}
+	// Running threads are cancelled, the destructor waits for them to finish their current file
+	queue->clear();
+	retireThreads( false );
+	e->accept();
 }
 
 /*
  *  File Queue
  */
 
-QQueue<QString> FileQueue::make( const QString & dname, const QStringList & extensions, bool recursive )
+QList<TestFile> FileQueue::make( const QString & dname, const QStringList & extensions, bool recursive )
 {
-	QQueue<QString> paths;
+	QList<TestFile> files;
 
 	QDir dir( dname );
 
@@ -367,77 +441,195 @@ QQueue<QString> FileQueue::make( const QString & dname, const QStringList & exte
 		dir.setFilter( QDir::Dirs );
 		for ( const QString& d : dir.entryList() ) {
 			if ( d != "." && d != ".." )
-				paths += make( dir.filePath( d ), extensions, true );
+				files += make( dir.filePath( d ), extensions, true );
 		}
 	}
 
 	dir.setFilter( QDir::Files );
 	dir.setNameFilters( extensions );
-	for ( const QString& f : dir.entryList() ) {
-		paths.enqueue( dir.filePath( f ) );
+	for ( const QFileInfo& f : dir.entryInfoList() ) {
+		files.append( TestFile{ f.filePath(), f.size() } );
 	}
 
-	return paths;
+	return files;
 }
 
 void FileQueue::init( const QString & dname, const QStringList & extensions, bool recursive )
 {
-	QQueue<QString> paths = make( dname, extensions, recursive );
+	QList<TestFile> files = make( dname, extensions, recursive );
+
+	QMutexLocker lock( &mutex );
+	pending += files;
+}
+
+static bool archiveFileFilter( void * p, const std::string_view & fileName )
+{
+	for ( const std::string & suffix : *reinterpret_cast< std::vector<std::string> * >( p ) ) {
+		if ( fileName.ends_with( suffix ) )
+			return true;
+	}
+	return false;
+}
+
+void FileQueue::initArchives( int game, const QStringList & extensions )
+{
+	// Archived paths are in lower case, so match the extension patterns as suffixes
+	std::vector<std::string> suffixes;
+	for ( const QString & ext : extensions )
+		suffixes.push_back( ext.mid( 1 ).toLower().toStdString() );
+
+	QMutexLocker archiveLock( &archiveMutex );
 
-	mutex.lock();
-	this->queue = paths;
-	mutex.unlock();
+	std::set<std::string_view> names;
+	Game::GameManager::list_files( names, Game::GameMode( game ), &archiveFileFilter, &suffixes );
+
+	QList<TestFile> files;
+	files.reserve( int( names.size() ) );
+	for ( const std::string_view & name : names ) {
+		qint64 size = Game::GameManager::file_size( Game::GameMode( game ), name );
+		files.append( TestFile{ QString::fromUtf8( name.data(), qsizetype( name.length() ) ), qMax( size, qint64( 0 ) ), game } );
+	}
+
+	QMutexLocker lock( &mutex );
+	pending += files;
 }
 
-QString FileQueue::dequeue()
+void FileQueue::distribute( int numQueues )
 {
 	QMutexLocker lock( &mutex );
 
-	if ( queue.isEmpty() )
-		return QString();
+	// Largest files first, so the tail of the run is made of small files that balance well
+	std::stable_sort( pending.begin(), pending.end(), []( const TestFile & a, const TestFile & b ) {
+		return a.size > b.size;
+	} );
+
+	queues.clear();
+	for ( int i = 0; i < qMax( numQueues, 1 ); i++ )
+		queues.push_back( std::make_unique<Deque>() );
+
+	totalFiles = pending.count();
+	totalSize = 0;
+	for ( int i = 0; i < pending.count(); i++ ) {
+		totalSize += pending.at( i ).size;
+		queues[size_t( i ) % queues.size()]->files.append( pending.at( i ) );
+	}
+	pending.clear();
+
+	remaining.storeRelaxed( totalFiles );
+}
+
+bool FileQueue::dequeue( int slot, TestFile & file )
+{
+	int n = int( queues.size() );
+
+	if ( slot >= 0 && slot < n ) {
+		Deque & own = *queues[slot];
+		QMutexLocker lock( &own.mutex );
+		if ( !own.files.isEmpty() ) {
+			file = own.files.takeFirst();
+			remaining.fetchAndAddRelaxed( -1 );
+			return true;
+		}
+	}
+
+	// Own queue is empty, steal the smallest file of another queue
+	for ( int i = 1; i <= n; i++ ) {
+		Deque & victim = *queues[( qMax( slot, 0 ) + i ) % n];
+		QMutexLocker lock( &victim.mutex );
+		if ( !victim.files.isEmpty() ) {
+			file = victim.files.takeLast();
+			remaining.fetchAndAddRelaxed( -1 );
+			return true;
+		}
+	}
 
-	return queue.dequeue();
+	return false;
 }
 
 int FileQueue::count()
 {
-	QMutexLocker lock( &mutex );
-	return queue.count();
+	return remaining.loadRelaxed();
 }
 
 void FileQueue::clear()
 {
 	QMutexLocker lock( &mutex );
-	queue.clear();
+	pending.clear();
+
+	for ( const auto & q : queues ) {
+		QMutexLocker qlock( &q->mutex );
+		q->files.clear();
+	}
+	remaining.storeRelaxed( 0 );
+}
+
+void FileQueue::finished( qint64 size )
+{
+	doneFiles.fetchAndAddRelaxed( 1 );
+	doneSize.fetchAndAddRelaxed( size );
 }
 
 /*
  *  Thread
  */
 
-TestThread::TestThread( QObject * o, FileQueue * q )
-	: QThread( o ), queue( q )
+TestThread::TestThread( QObject * o, FileQueuePtr q, int s )
+	: QThread( o ), queue( q ), slot( s )
 {
 }
 
 TestThread::~TestThread()
 {
 	if ( isRunning() ) {
-		quit.lock();
+		stopped.storeRelaxed( 1 );
 		wait();
-		quit.unlock();
 	}
 }
 
+bool TestThread::openArchived( const TestFile & file, QByteArray & data, QBuffer & buffer )
+{
+	{
+		QMutexLocker lock( &archiveMutex );
+		if ( !Game::GameManager::get_file( data, Game::GameMode( file.game ), file.path.toStdString() ) )
+			return false;
+	}
+
+	return buffer.open( QIODevice::ReadOnly );
+}
+
 void TestThread::run()
 {
 	NifModel nif;
 	KfmModel kfm;
 
-	QString filepath = queue->dequeue();
-
-	while ( !filepath.isEmpty() ) {
-		emit sigStart( filepath );
+	// Matching alone only needs the blocks that can match, so skip the rest while loading
+	bool filtered = !headerOnly && !checkFile && ( !blockMatch.isEmpty() || ( !valueName.isEmpty() && !valueMatch.isEmpty() ) );
+	NifLoadFilter filter;
+	if ( !blockMatch.isEmpty() )
+		filter.blockTypes << blockMatch;
+	if ( !valueName.isEmpty() && !valueMatch.isEmpty() )
+		filter.fieldNames << valueName;
+
+	// Error checking also verifies that saving reproduces the file
+	nif.setCaptureDigests( checkFile );
+
+	TestFile file;
+
+	while ( !stopped.loadRelaxed() && queue->dequeue( slot, file ) ) {
+		const QString & filepath = file.path;
+		bool archived = ( file.game >= 0 );
+
+		// Archived files are read into memory up front, loose files are loaded from disk
+		QByteArray data;
+		QBuffer buffer( &data );
+		if ( archived && !openArchived( file, data, buffer ) ) {
+			if ( !cancelled.loadRelaxed() ) {
+				emit sigReady( QString( "Failed to read %1 from the %2 archives" ).arg( filepath, Game::StringForMode( Game::GameMode( file.game ) ) ) );
+				emit incrementError();
+			}
+			queue->finished( 0 );
+			continue;
+		}
 
 		BaseModel * model = &nif;
 		QReadWriteLock * lock = &nif.XMLlock;
@@ -454,11 +646,35 @@ void TestThread::run()
 			QReadLocker lck( lock );
 
 			QString result;
-			if ( model == &nif && nif.earlyRejection( filepath, blockMatch, verMatch ) ) {
-				bool loaded = (headerOnly) ? nif.loadHeaderOnly(filepath) : model->loadFromFile(filepath);
+			bool accepted = ( model == &nif );
+			if ( accepted )
+				accepted = archived ? nif.earlyRejection( buffer, blockMatch, verMatch ) : nif.earlyRejection( filepath, blockMatch, verMatch );
+
+			if ( accepted ) {
+				bool loaded;
+				if ( archived ) {
+					buffer.seek( 0 );
+					if ( headerOnly )
+						loaded = nif.loadHeaderOnly( buffer );
+					else if ( filtered )
+						loaded = nif.loadFiltered( buffer, filter );
+					else
+						loaded = model->load( buffer );
+				} else {
+					if ( headerOnly )
+						loaded = nif.loadHeaderOnly( filepath );
+					else if ( filtered )
+						loaded = nif.loadFilteredFromFile( filepath, filter );
+					else
+						loaded = model->loadFromFile( filepath );
+				}
 
-				result = QString( "<a href=\"nif:%1\">%1</a> (%2, %3, %4)" )
-					.arg( filepath, model->getVersion() ).arg( nif.getUserVersion() ).arg( nif.getBSVersion() );
+				if ( archived )
+					result = QString( "%1: %2 (%3, %4, %5)" )
+						.arg( Game::StringForMode( Game::GameMode( file.game ) ), filepath, model->getVersion() ).arg( nif.getUserVersion() ).arg( nif.getBSVersion() );
+				else
+					result = QString( "<a href=\"nif:%1\">%1</a> (%2, %3, %4)" )
+						.arg( filepath, model->getVersion() ).arg( nif.getUserVersion() ).arg( nif.getBSVersion() );
 				QList<TestMessage> messages = model->getMessages();
 
 				bool blk_match = false;
@@ -535,7 +751,7 @@ void TestThread::run()
 
 								if ( current_match )
 									messages += TestMessage( QtInfoMsg ) <<
-												QString( "[%1] Found Match: %2 %3 %4 | Value: %5" ).arg(b)
+												QString( "[%1] Found Match: %2 %3 %4 | Value: %5" ).arg(nif.originalBlockNumber(b))
 												.arg(valueName).arg(ops_ord[int(op)].toHtmlEscaped())
 												.arg(valueMatch).arg(asStr);
 							} else {
@@ -551,6 +767,10 @@ void TestThread::run()
 					}
 
 					if ( checkFile ) {
+						QString difference;
+						if ( !nif.verifyRoundTrip( &difference ) )
+							messages += TestMessage() << difference;
+
 						for ( auto checker : SpellBook::checkers() )
 							checker->castIfApplicable(&nif, {});
 						messages += nif.getMessages();
@@ -570,22 +790,17 @@ void TestThread::run()
 						}
 					}
 
-					if ( rep )
+					if ( rep && !cancelled.loadRelaxed() )
 						emit sigReady( result );
 				}
-			} else if ( !blockMatch.isEmpty() && !verMatch ) {
+			} else if ( !blockMatch.isEmpty() && !verMatch && !cancelled.loadRelaxed() ) {
 				// Do not silently fail on unrecognized NIFs
 				result += QString("Did not recognize file as a NIF: %1").arg(filepath);
 				emit sigReady(result);
 			}
 		}
 
-		if ( quit.tryLock() )
-			quit.unlock();
-		else
-			break;
-
-		filepath = queue->dequeue();
+		queue->finished( file.size );
 	}
 }
 
@@ -4,6 +4,7 @@
 
 #include <QThread> // Inherited
 #include <QWidget> // Inherited
+#include <QAtomicInteger>
 #include <QMutex>
 #include <QQueue>
 #include <QDateTime>
@@ -11,6 +12,8 @@
 
 #include <map>
 #include <array>
+#include <memory>
+#include <vector>
 
 
 class QCheckBox;
@@ -21,6 +24,8 @@ class QPushButton;
 class QSpinBox;
 class QComboBox;
 class QTextBrowser;
+class QTimer;
+class QBuffer;
 
 class TestMessage;
 class FileSelector;
@@ -59,32 +64,76 @@ static std::map<QString, QPair<OpType, QString>> ops = {
 	{ ops_ord[OP_CONT], {OP_CONT, "Contains"} }
 };
 
+//! A file to check, either loose on disk or inside the resource archives of a game
+struct TestFile
+{
+	QString path;
+	qint64 size = 0;
+	//! Game::GameMode of the archives holding the file, -1 for loose files
+	int game = -1;
+};
+
+/*! Work-stealing file queues for the checker threads
+ *
+ * The files are sorted by size and dealt round-robin into one queue per thread, so every
+ * thread starts with the largest files. A thread takes from the front of its own queue and,
+ * once that is empty, steals from the back of the other queues.
+ */
 class FileQueue final
 {
 public:
 	FileQueue() {}
 
-	QString dequeue();
+	//! Takes the next file for the thread owning queue 'slot'; returns false once all queues are empty
+	bool dequeue( int slot, TestFile & file );
 
 	bool isEmpty() { return count() == 0; }
 	int count();
 
+	//! Collects the loose files in a directory
 	void init( const QString & directory, const QStringList & extensions, bool recursive );
+	//! Collects the files in the resource archives of a game
+	void initArchives( int game, const QStringList & extensions );
+	//! Sorts the collected files and deals them into 'numQueues' queues
+	void distribute( int numQueues );
 	void clear();
 
+	//! Counts a checked file for the throughput statistics
+	void finished( qint64 size );
+
+	int total() const { return totalFiles; }
+	qint64 totalBytes() const { return totalSize; }
+	int doneCount() const { return doneFiles.loadRelaxed(); }
+	qint64 doneBytes() const { return doneSize.loadRelaxed(); }
+
 protected:
-	QQueue<QString> make( const QString & directory, const QStringList & extensions, bool recursive );
+	QList<TestFile> make( const QString & directory, const QStringList & extensions, bool recursive );
+
+	struct Deque
+	{
+		QMutex mutex;
+		QList<TestFile> files;
+	};
 
 	QMutex mutex;
-	QQueue<QString> queue;
+	QList<TestFile> pending;
+	std::vector<std::unique_ptr<Deque>> queues;
+
+	int totalFiles = 0;
+	qint64 totalSize = 0;
+	QAtomicInt remaining;
+	QAtomicInt doneFiles;
+	QAtomicInteger<qint64> doneSize;
 };
 
+using FileQueuePtr = std::shared_ptr<FileQueue>;
+
 class TestThread final : public QThread
 {
 	Q_OBJECT
 
 public:
-	TestThread( QObject * o, FileQueue * q );
+	TestThread( QObject * o, FileQueuePtr q, int slot );
 	~TestThread();
 
 	QString blockMatch;
@@ -96,19 +145,26 @@ public:
 	bool headerOnly = false;
 	bool checkFile = true;
 
+	//! Stops the thread after its current file and drops the result of that file
+	void cancel() { cancelled.storeRelaxed( 1 ); stopped.storeRelaxed( 1 ); }
+
 signals:
-	void sigStart( const QString & file );
 	void sigReady( const QString & result );
 	void incrementError();
 
 protected:
 	void run() override final;
 
+	//! Reads an archived file into a buffer
+	bool openArchived( const TestFile & file, QByteArray & data, QBuffer & buffer );
+
 	QList<TestMessage> checkLinks( const class NifModel * nif, const class QModelIndex & iParent, bool kf );
 
-	FileQueue * queue;
+	FileQueuePtr queue;
+	int slot;
 
-	QMutex quit;
+	QAtomicInt stopped;
+	QAtomicInt cancelled;
 };
 
 //! The XML checker widget.
@@ -127,8 +183,8 @@ protected slots:
 	void run();
 	void xml();
 
-	void threadStarted();
 	void threadFinished();
+	void updateStats();
 
 	void onIncrementError();
 
@@ -137,6 +193,13 @@ protected slots:
 protected:
 	void closeEvent( QCloseEvent * ) override final;
 
+	TestThread * createThread( int slot );
+	//! Cancels the running threads and lets them finish their current file in the background
+	/*!
+	 * @param recreate	Whether to create a new set of idle threads for the next run
+	 */
+	void retireThreads( bool recreate = true );
+
 	FileSelector * directory;
 	QLineEdit * blockMatch;
 	QLineEdit * valueName;
@@ -145,6 +208,8 @@ protected:
 	QCheckBox * recursive;
 	QCheckBox * chkNif, * chkKf, * chkKfm, *chkCheckErrors;
 	QCheckBox * repErr, * hdrOnly;
+	QCheckBox * chkArchives;
+	QComboBox * archiveGame;
 	QSpinBox * count;
 	QLineEdit * verMatch;
 	QTextBrowser * text;
@@ -152,11 +217,14 @@ protected:
 	QLabel * label;
 	QPushButton * btRun;
 
-	FileQueue queue;
+	FileQueuePtr queue;
 
 	QList<TestThread *> threads;
+	//! Cancelled threads still finishing their current file, waited for in the destructor
+	QList<TestThread *> retiredThreads;
 
 	QDateTime time;
+	QTimer * statsTimer;
 
 	QMutex mutex;
 	uint32_t errorCount = 0;